@@ -23,51 +23,17 @@
 # Project configuration
 #-------------------------------------------------------------------------------
 
-TEMPLATE = app
-TARGET = RFID-Manager
+TEMPLATE = subdirs
 
 #-------------------------------------------------------------------------------
-# Deploy options
+# Application & test targets
 #-------------------------------------------------------------------------------
 
-win32* {
-    RC_FILE = $$PWD/deploy/windows/resources/info.rc
-}
-
-#-------------------------------------------------------------------------------
-# Qt modules
-#-------------------------------------------------------------------------------
-
-QT += xml
-QT += svg
-QT += core
-QT += widgets
-
-#-------------------------------------------------------------------------------
-# Include libraries
-#-------------------------------------------------------------------------------
-
-include($$PWD/lib/RFID/RFID.pri)
-
-#-------------------------------------------------------------------------------
-# Import source code
-#-------------------------------------------------------------------------------
+SUBDIRS += \
+    src \
+    tests
 
 DISTFILES += \
     $$PWD/LICENSE.md \
     $$PWD/README.md \
     $$PWD/util/scripts/astyle-format-code.bat
-
-RESOURCES += \
-    $$PWD/resources/resources.qrc
-
-FORMS += \
-    $$PWD/src/MainWindow.ui
-
-HEADERS += \
-    $$PWD/src/AppInfo.h \
-    $$PWD/src/MainWindow.h
-
-SOURCES += \
-    $$PWD/src/MainWindow.cpp \
-    $$PWD/src/main.cpp
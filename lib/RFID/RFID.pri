@@ -26,6 +26,7 @@
 QT += core
 QT += widgets
 QT += serialport
+QT += concurrent
 
 #-------------------------------------------------------------------------------
 # Import source code
@@ -37,11 +38,49 @@ INCLUDEPATH += $$PWD/devices
 HEADERS += \
     $$PWD/devices/SM_6210.h \
     $$PWD/include/RFID.h \
+    $$PWD/include/RFID_Checkpoint.h \
+    $$PWD/include/RFID_Clock.h \
     $$PWD/include/RFID_Global.h \
+    $$PWD/include/RFID_Health.h \
+    $$PWD/include/RFID_JobLedger.h \
+    $$PWD/include/RFID_JobQueue.h \
+    $$PWD/include/RFID_Log.h \
+    $$PWD/include/RFID_LogArchive.h \
+    $$PWD/include/RFID_Profiler.h \
     $$PWD/include/RFID_Reader.h \
-    $$PWD/include/RFID_SerialManager.h
+    $$PWD/include/RFID_Scheduler.h \
+    $$PWD/include/RFID_SerialManager.h \
+    $$PWD/include/RFID_TagHistory.h \
+    $$PWD/include/RFID_TagStore.h \
+    $$PWD/include/RFID_TidTable.h \
+    $$PWD/include/RFID_UserSchema.h
 
 SOURCES += \
     $$PWD/devices/SM_6210.cpp \
     $$PWD/src/RFID.cpp \
-    $$PWD/src/RFID_SerialManager.cpp
+    $$PWD/src/RFID_Checkpoint.cpp \
+    $$PWD/src/RFID_Clock.cpp \
+    $$PWD/src/RFID_Health.cpp \
+    $$PWD/src/RFID_JobLedger.cpp \
+    $$PWD/src/RFID_JobQueue.cpp \
+    $$PWD/src/RFID_Log.cpp \
+    $$PWD/src/RFID_LogArchive.cpp \
+    $$PWD/src/RFID_Profiler.cpp \
+    $$PWD/src/RFID_Scheduler.cpp \
+    $$PWD/src/RFID_SerialManager.cpp \
+    $$PWD/src/RFID_TagHistory.cpp \
+    $$PWD/src/RFID_TagStore.cpp \
+    $$PWD/src/RFID_TidTable.cpp \
+    $$PWD/src/RFID_UserSchema.cpp
+
+#-------------------------------------------------------------------------------
+# Optional SQLite tag history (qmake CONFIG+=rfid_sqlite)
+#-------------------------------------------------------------------------------
+
+rfid_sqlite {
+    QT += sql
+    DEFINES += RFID_SQLITE
+
+    HEADERS += $$PWD/include/RFID_TagDatabase.h
+    SOURCES += $$PWD/src/RFID_TagDatabase.cpp
+}
@@ -1,785 +1,1287 @@
-/*
- * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
- *
- * Permission is hereby granted, free of charge, to any person obtaining a copy
- * of this software and associated documentation files (the "Software"), to deal
- * in the Software without restriction, including without limitation the rights
- * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
- * copies of the Software, and to permit persons to whom the Software is
- * furnished to do so, subject to the following conditions:
- *
- * The above copyright notice and this permission notice shall be included in
- * all copies or substantial portions of the Software.
- *
- * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
- * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
- * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
- * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
- * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
- * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
- * THE SOFTWARE.
- */
-
-#include "SM_6210.h"
-#include "RFID_Global.h"
-#include "RFID_SerialManager.h"
-
-#include <QSerialPort>
-
-//------------------------------------------------------------------------------
-// Temporary buffer
-//------------------------------------------------------------------------------
-
-static QByteArray BUFFER;
-
-//------------------------------------------------------------------------------
-// Define the serial device command bytes
-//------------------------------------------------------------------------------
-
-// Header type byes
-static const quint8 HEADER_START_CODE       = 0xa0;
-static const quint8 HEADER_RESULT_CODE      = 0xe4;
-static const quint8 HEADER_RESPONSE_CODE    = 0xe0;
-
-// Operation command codes
-static const quint8 DEV_STOP_SEARCH         = 0xa8;
-static const quint8 DEV_WRITE_TAG_MW        = 0xab;
-static const quint8 DEV_GET_SINGLE_PARAM    = 0x61;
-static const quint8 DEV_READ_SINGLE_TAG     = 0x82;
-static const quint8 DEV_READ_TAG_DATA       = 0x80;
-static const quint8 CRP_ADD_USERCODE        = 0x64;
-
-// Data reading options
-static const quint8 RFU_LABEL[2]            = {0x00, 0x00};
-static const quint8 EPC_LABEL[2]            = {0x00, 0x01};
-static const quint8 TID_LABEL[2]            = {0x00, 0x02};
-static const quint8 USR_LABEL[2]            = {0x00, 0x03};
-
-//------------------------------------------------------------------------------
-// Utility functions
-//------------------------------------------------------------------------------
-
-/**
- * Calculates an 8-bit checksum with 2's complement for the given @a data
- */
-static quint8 Checksum(const QByteArray& data)
-{
-   quint8 checksum = 0;
-
-   for(int i = 0; i < data.length(); ++i)
-      checksum += data.at(i);
-
-   return (~checksum) + 1;
-}
-
-//------------------------------------------------------------------------------
-// Driver constructor & destructor implementations
-//------------------------------------------------------------------------------
-
-SM_6210::SM_6210()
-{
-   Checksum(QByteArray());
-
-   m_selector = 0;
-   m_shitCount = 0;
-   m_userStartAddress = 0;
-   connect(RFID_SerialManager::getInstance(),
-           &RFID_SerialManager::dataReceived,
-           this,
-           &SM_6210::onDataReceived);
-}
-
-SM_6210::~SM_6210()
-{
-   disconnect(RFID_SerialManager::getInstance(),
-              &RFID_SerialManager::dataReceived,
-              this,
-              &SM_6210::onDataReceived);
-}
-
-//------------------------------------------------------------------------------
-// Driver function implementations
-//------------------------------------------------------------------------------
-
-#include <qdebug.h>
-
-/**
- * @brief UHF_530_RDM::scan
- * Asks the UHF reader to send EPC, TagID, User and RFU data repeatedly for
- * the current tag. If current tag is @c NULL, then the function shall ask the
- * UHF reader to perform a quick-scan for EPC in near RFID tags. If no tags are
- * found, then the function shall reset the UHF reader every 10 cycles.
- */
-void SM_6210::scan()
-{
-   if(!currentTag()) {
-      m_selector = 0;
-
-      // Send stop-and-reset command every 10 failed reading cycles
-      if(m_shitCount > 10) {
-         m_shitCount = 0;
-         QByteArray data;
-         data.append(static_cast<char>(HEADER_START_CODE));
-         data.append(static_cast<char>(0x03));
-         data.append(static_cast<char>(DEV_STOP_SEARCH));
-         data.append(static_cast<char>(0x00));
-         data.append(static_cast<char>(Checksum(data)));
-         RFID_SerialManager::getInstance()->writeData(data);
-      }
-
-      // Send tag read request command
-      else {
-         QByteArray data;
-         data.append(static_cast<char>(HEADER_START_CODE));
-         data.append(static_cast<char>(0x05));
-         data.append(static_cast<char>(DEV_GET_SINGLE_PARAM));
-         data.append(static_cast<char>(0x00));
-         data.append(static_cast<char>(0x00));
-         data.append(static_cast<char>(CRP_ADD_USERCODE));
-         data.append(static_cast<char>(Checksum(data)));
-         RFID_SerialManager::getInstance()->writeData(data);
-      }
-
-      // Increase shit count until we find a tag
-      ++m_shitCount;
-   }
-
-   // Current tag available, read all tag data
-   else {
-      switch(m_selector) {
-         case 0:
-            readEpc();
-            break;
-         case 1:
-            readTid();
-            break;
-         case 2:
-            readRfu();
-            break;
-         case 3:
-            readUsr();
-            break;
-         default:
-            m_selector = 0;
-            break;
-      }
-
-      // Tag ID empty, try to read it
-      if(currentTag()->tid.isEmpty())
-         m_selector = 1;
-
-      // RFU empty, try ro read it
-      else if(currentTag()->rfu.isEmpty())
-         m_selector = 2;
-
-      // User data empty, try to read it
-      else if(currentTag()->usr->isEmpty())
-         m_selector = 3;
-
-      // EPC empty, try to read it
-      else if(currentTag()->epc.isEmpty())
-         m_selector = 0;
-
-      // Try to read next tag section if current section cannot be read
-      if(m_shitCount > RFID_MAX_SHIT_TRESHOLD) {
-         m_shitCount = 0;
-         ++m_selector;
-      }
-
-      // Increase shit count (shit count is set to 0 if a section is read
-      // successfully). This allows us to know if a tag's section cannot
-      // be read or has an error
-      ++m_shitCount;
-   }
-}
-
-/**
- * @brief UHF_530_RDM::loaded
- * Returns @c true if the serial manager has a device connected and configured
- * to communicate with a baud rade of 9600.
- */
-bool SM_6210::loaded()
-{
-   RFID_SerialManager* sm = RFID_SerialManager::getInstance();
-   if(sm->connected())
-      return sm->baudRate() == 9600;
-
-   return false;
-}
-
-//------------------------------------------------------------------------------
-// Tag data access functions
-//------------------------------------------------------------------------------
-
-/**
- * @brief UHF_530_RDM::readEpc
- * Sends an EPC data request packet to the UHF reader.
- */
-void SM_6210::readEpc()
-{
-   const quint8 dataLength = 6;
-   const quint8 startAddress = 2;
-
-   QByteArray data;
-   data.append(static_cast<char>(HEADER_START_CODE));
-   data.append(static_cast<char>(0x06));
-   data.append(static_cast<char>(DEV_READ_TAG_DATA));
-   data.append(static_cast<char>(EPC_LABEL[0]));
-   data.append(static_cast<char>(EPC_LABEL[1]));
-   data.append(static_cast<char>(startAddress));
-   data.append(static_cast<char>(dataLength));
-   data.append(static_cast<char>(Checksum(data)));
-
-   RFID_SerialManager::getInstance()->writeData(data);
-}
-
-/**
- * @brief UHF_530_RDM::readTid
- * Sends a TagID data request packet to the UHF reader.
- */
-void SM_6210::readTid()
-{
-   const quint8 dataLength = 6;
-   const quint8 startAddress = 0;
-
-   QByteArray data;
-   data.append(static_cast<char>(HEADER_START_CODE));
-   data.append(static_cast<char>(0x06));
-   data.append(static_cast<char>(DEV_READ_TAG_DATA));
-   data.append(static_cast<char>(TID_LABEL[0]));
-   data.append(static_cast<char>(TID_LABEL[1]));
-   data.append(static_cast<char>(startAddress));
-   data.append(static_cast<char>(dataLength));
-   data.append(static_cast<char>(Checksum(data)));
-
-   RFID_SerialManager::getInstance()->writeData(data);
-}
-
-/**
- * @brief UHF_530_RDM::readRfu
- * Sends a RFU data request packet to the UHF reader.
- */
-void SM_6210::readRfu()
-{
-   const quint8 dataLength = 4;
-   const quint8 startAddress = 0;
-
-   QByteArray data;
-   data.append(static_cast<char>(HEADER_START_CODE));
-   data.append(static_cast<char>(0x06));
-   data.append(static_cast<char>(DEV_READ_TAG_DATA));
-   data.append(static_cast<char>(RFU_LABEL[0]));
-   data.append(static_cast<char>(RFU_LABEL[1]));
-   data.append(static_cast<char>(startAddress));
-   data.append(static_cast<char>(dataLength));
-   data.append(static_cast<char>(Checksum(data)));
-
-   RFID_SerialManager::getInstance()->writeData(data);
-}
-
-/**
- * @brief UHF_530_RDM::readUsr
- * Sends an user data request packet to the UHF reader.
- */
-void SM_6210::readUsr()
-{
-   // Reset user start address if necessary
-   if(m_userStartAddress > 24)
-      m_userStartAddress = 0;
-
-   // Set data length & start address
-   const quint8 dataLength = 8;
-   const quint8 startAddress = m_userStartAddress;
-
-   // Generate & send packet
-   QByteArray data;
-   data.append(static_cast<char>(HEADER_START_CODE));
-   data.append(static_cast<char>(0x06));
-   data.append(static_cast<char>(DEV_READ_TAG_DATA));
-   data.append(static_cast<char>(USR_LABEL[0]));
-   data.append(static_cast<char>(USR_LABEL[1]));
-   data.append(static_cast<char>(startAddress));
-   data.append(static_cast<char>(dataLength));
-   data.append(static_cast<char>(Checksum(data)));
-   RFID_SerialManager::getInstance()->writeData(data);
-
-   // Increase start address by data length
-   m_userStartAddress += dataLength;
-}
-
-//------------------------------------------------------------------------------
-// Tag management functions
-//------------------------------------------------------------------------------
-
-/**
- * @brief UHF_530_RDM::killTag
- *
- * Sends a tag kill command to the UHF reader, returns @c true if the UHF reader
- * managed to kill the current tag, @c false if there was an error.
- */
-bool SM_6210::killTag()
-{
-   return false;
-}
-
-/**
- * @brief UHF_530_RDM::lockTag
- *
- * Sends a lock tag command to the UHF reader, returns @c true if the UHF reader
- * managed to lock the current tag, @c false if there was an error.
- */
-bool SM_6210::lockTag()
-{
-   return false;
-}
-
-/**
- * @brief UHF_530_RDM::eraseTag
- *
- * Tries to erase all EPC, User and RFU data from the current tag.
- * Returns @c true on success, @c false on failure.
- */
-bool SM_6210::eraseTag()
-{
-   QByteArray epc;
-   for(int i = 0; i < RFID_EPC_LENGTH; ++i)
-      epc.append(static_cast<char>(0x00));
-
-   QByteArray usr;
-   for(int i = 0; i < RFID_USER_LENGTH; ++i)
-      usr.append(static_cast<char>(0x00));
-
-   QByteArray rfu;
-   for(int i = 0; i < RFID_RFU_LENGTH; ++i)
-      rfu.append(static_cast<char>(0x00));
-
-   return writeEpc(epc) && writeRfu(rfu) && writeUserData(usr);
-}
-
-//------------------------------------------------------------------------------
-// Data writing function
-//------------------------------------------------------------------------------
-
-bool SM_6210::writeEpc(const QByteArray& epc)
-{
-   if(currentTag())
-      return writeData(epc, EPC_LABEL, 2, 6);
-
-   return false;
-}
-
-bool SM_6210::writeRfu(const QByteArray& rfu)
-{
-   if(currentTag())
-      return writeData(rfu, RFU_LABEL, 0, 4);
-
-   return false;
-}
-
-bool SM_6210::writeUserData(const QByteArray& userData)
-{
-   if(currentTag()) {
-      bool ok = true;
-      ok &= writeData(userData.mid(0, 16), USR_LABEL, 0, 8);
-      ok &= writeData(userData.mid(16, 32), USR_LABEL, 8, 8);
-      ok &= writeData(userData.mid(32, 48), USR_LABEL, 16, 8);
-      ok &= writeData(userData.mid(48, 64), USR_LABEL, 24, 8);
-      return ok;
-   }
-
-   return false;
-}
-
-//------------------------------------------------------------------------------
-// Data management functions
-//------------------------------------------------------------------------------
-
-/**
- * @brief UHF_530_RDM::onDataReceived
- * @param data
- *
- * Slot function called when the serial manager detects any incoming data from
- * the UHF serial reader.
- *
- * This function appends the given @a data to a buffer and lets the data
- * interpretation functions to read and manage the buffer automatically.
- *
- * If for some reason the buffer size is too large, then this function shall
- * clear the buffer to avoid memory problems.
- */
-void SM_6210::onDataReceived(const QByteArray& data)
-{
-   // Data is empty, abort
-   if(data.isEmpty())
-      return;
-
-   // Driver not ready, abort
-   if(!loaded())
-      return;
-
-   // Append data to buffer
-   BUFFER.append(data);
-
-   // Interpret received data
-   if(BUFFER.size() > 0) {
-      // Try to interpret packet...
-      if(readAckPacket())
-         return;
-      if(readEpcPacketFromScan())
-         return;
-      else if(readEpcPacket())
-         return;
-      else if(readTagIdPacket())
-         return;
-      else if(readRfuPacket())
-         return;
-      else if(readUsrPacket())
-         return;
-      else if(readStdResponse())
-         return;
-      else if(readStdResult())
-         return;
-
-      // Clear buffer if it exceeds max size
-      if(BUFFER.size() > RFID_MAX_BUFFER_SIZE)
-         BUFFER.clear();
-   }
-}
-
-//------------------------------------------------------------------------------
-// Packet interpretation functions
-//------------------------------------------------------------------------------
-
-/**
- * @brief UHF_530_RDM::readAckPacket
- *
- * Reads and interprets a single-tag search acknowledge packet from the UHF
- * reader. If an ACK packet is found and read successfully, then the function
- * shall return @c true and will respond to the UHF reader so that normal tag
- * searching operations can begin.
- */
-bool SM_6210::readAckPacket()
-{
-   // Get information packet header shift
-   int i;
-   for(i = 0; i < BUFFER.length(); ++i)
-      if(BUFFER.at(i) == static_cast<char>(HEADER_RESPONSE_CODE))
-         break;
-
-   // Check buffer size
-   if(i + 8 > BUFFER.length())
-      return false;
-
-   // Check header
-   bool ok = true;
-   ok &= BUFFER[i + 0] == static_cast<char>(HEADER_RESPONSE_CODE);
-   ok &= BUFFER[i + 1] == static_cast<char>(0x06);
-   ok &= BUFFER[i + 2] == static_cast<char>(DEV_GET_SINGLE_PARAM);
-   ok &= BUFFER[i + 3] == static_cast<char>(0x00);
-   ok &= BUFFER[i + 4] == static_cast<char>(0x00);
-   ok &= BUFFER[i + 5] == static_cast<char>(CRP_ADD_USERCODE);
-   ok &= BUFFER[i + 6] == static_cast<char>(0x00);
-   ok &= BUFFER[i + 7] == static_cast<char>(Checksum(BUFFER.mid(i, 7)));
-
-   // Header ok, respond with acknowledgement packet and delete read bytes
-   if(ok) {
-      BUFFER.remove(i, 8);
-
-      QByteArray data;
-      data.append(static_cast<char>(HEADER_START_CODE));
-      data.append(static_cast<char>(0x03));
-      data.append(static_cast<char>(DEV_READ_SINGLE_TAG));
-      data.append(static_cast<char>(0x00));
-      data.append(static_cast<char>(Checksum(data)));
-      RFID_SerialManager::getInstance()->writeData(data);
-   }
-
-   // Return value
-   return ok;
-}
-
-/**
- * @brief UHF_530_RDM::readStdResult
- *
- * Reads and interprets any result packet from the UHF reader, we don't really
- * do something with this information, but it is important to manage the
- * incoming data buffer so that we can extract information from useful data
- * packets.
- *
- * Returns @c true if a result packet was found and ignored, @c false if no
- * response packet was found.
- */
-bool SM_6210::readStdResult()
-{
-   // Get result packet header shift
-   int shift;
-   for(shift = 0; shift < BUFFER.length(); ++shift) {
-      // Header result code found, get packet size and remove it from buffer
-      if(BUFFER.at(shift) == static_cast<char>(HEADER_RESULT_CODE)) {
-         if(BUFFER.length() > shift + 1) {
-            int packetSize = BUFFER.at(shift + 1);
-            BUFFER.remove(0, shift + packetSize);
-            return true;
-         }
-
-         // Get out of loop
-         break;
-      }
-   }
-
-   // Cannot get packet size, ignore
-   return false;
-}
-
-/**
- * @brief UHF_530_RDM::readStdResponse
- *
- * Reads and interprets any response packet from the UHF reader, we don't really
- * do something with this information, but it is important to manage the
- * incoming data buffer so that we can extract information from useful data
- * packets.
- *
- * Returns @c true if a response packet was found and ignored, @c false if no
- * response packet was found.
- */
-bool SM_6210::readStdResponse()
-{
-   // Get result packet header shift
-   int shift;
-   for(shift = 0; shift < BUFFER.length(); ++shift) {
-      // Header response code found, remove it if packet size is less than 6
-      if(BUFFER.at(shift) == static_cast<char>(HEADER_RESPONSE_CODE)) {
-         if(BUFFER.length() > shift + 1) {
-            int packetSize = BUFFER.at(shift + 1);
-            if(packetSize < 6) {
-               BUFFER.remove(0, shift + packetSize);
-               return true;
-            }
-         }
-
-         // Get out of loop
-         break;
-      }
-   }
-
-   // Cannot get packet size, ignore
-   return false;
-}
-
-/**
- * @brief UHF_530_RDM::readTagIdPacket
- *
- * Reads and interprets a TagID information packet, returns @c true on success
- * or @c false on failure.
- */
-bool SM_6210::readTagIdPacket()
-{
-   bool success = false;
-   QByteArray tid = readInformationPacket(TID_LABEL, &success);
-   if(success)
-      emit tidFound(tid);
-
-   return success;
-}
-
-/**
- * @brief UHF_530_RDM::readEpcPacket
- *
- * Reads and interprets an EPC information packet, returns @c true on success
- * or @c false on failure.
- */
-bool SM_6210::readEpcPacket()
-{
-   bool success = false;
-   QByteArray epc = readInformationPacket(EPC_LABEL, &success);
-   if(success)
-      emit epcFound(epc);
-
-   return success;
-}
-
-/**
- * @brief UHF_530_RDM::readRfuPacket
- *
- * Reads and interprets a RFU information packet, returns @c true on success
- * or @c false on failure.
- */
-bool SM_6210::readRfuPacket()
-{
-   bool success = false;
-   QByteArray rfu = readInformationPacket(RFU_LABEL, &success);
-   if(success)
-      emit rfuFound(rfu);
-
-   return success;
-}
-
-/**
- * @brief UHF_530_RDM::readUsrPacket
- *
- * Reads and interprets an user data packet for the first 13 bytes of data,
- * returns @c true if the packet was read successfully, @c false if there
- * was an error while reading and interpreting the packet.
- */
-bool SM_6210::readUsrPacket()
-{
-   int startAddress = 0;
-   bool success = false;
-   QByteArray usr = readInformationPacket(USR_LABEL, &success, &startAddress);
-
-   if(success) {
-      const int datagram = startAddress / 8;
-      if(datagram > RFID_NUM_USER_DATAGRAMS - 1 || datagram < 0)
-         return false;
-
-      emit usrFound(usr, datagram);
-   }
-
-   return success;
-}
-
-/**
- * @brief UHF_530_RDM::readEpcPacketFromScan
- *
- * Reads and interprets quick-scan EPC information packets. Returns @c true if
- * packet was read successfully, @c false if there was an error while reading
- * and interpreting the packet data.
- */
-bool SM_6210::readEpcPacketFromScan()
-{
-   bool success = false;
-   QByteArray epc = readInformationPacket(EPC_LABEL, &success,
-                                          nullptr, nullptr, true, false);
-
-   if(success)
-      emit epcFound(epc);
-
-   return success;
-}
-
-//------------------------------------------------------------------------------
-// Generic packet reading & writing functions
-//------------------------------------------------------------------------------
-
-/**
- * @brief SM_6210::writeData
- * @param data data to write
- * @param label section in which to write the data into (EPC, RFU, etc..)
- * @param startAddress start address of data section
- * @param length number of addresses to write
- * @return
- *
- * Writes the given @a data to the current RFID tag
- */
-bool SM_6210::writeData(const QByteArray& data,
-                        const quint8 label[2],
-                        const quint8 startAddress,
-                        const quint8 length)
-{
-   // Generate packet
-   QByteArray packet;
-   packet.append(static_cast<char>(HEADER_START_CODE));
-   packet.append(static_cast<char>(DEV_WRITE_TAG_MW));
-   packet.append(static_cast<char>(label[0]));
-   packet.append(static_cast<char>(label[1]));
-   packet.append(static_cast<char>(startAddress));
-   packet.append(static_cast<char>(length));
-   packet.append(data);
-   packet.insert(1, static_cast<char>(packet.length()));
-   packet.append(static_cast<char>(Checksum(packet)));
-
-   // Send packet
-   bool ok = true;
-   RFID_SerialManager* sm = RFID_SerialManager::getInstance();
-   for(int i = 0; i < 10; ++i)
-      ok &= (sm->writeData(packet) == packet.length());
-
-   // Serial error
-   return ok;
-}
-
-/**
- * @brief SM_6210::readInformationPacket
- * @param label data type label (two bytes)
- * @param ok set to @c true if packet is read successfully
- * @param startAddress start address of data
- * @param length length of received data
- * @param verifyChecksum verify incoming data with checksum
- *
- * Reads and interprets any information packet received from the SM-6210 reader
- */
-QByteArray SM_6210::readInformationPacket(const quint8 label[2],
-                                          bool* ok,
-                                          int* startAddress,
-                                          int* length,
-                                          const bool singleTag,
-                                          const bool verifyChecksum)
-{
-   // Verify arguments
-   Q_ASSERT(ok != Q_NULLPTR);
-
-   // Set success parameter to false
-   *ok = false;
-
-   // Get information packet header shift
-   int shift;
-   for(shift = 0; shift < BUFFER.length(); ++shift)
-      if(BUFFER.at(shift) == static_cast<char>(HEADER_RESPONSE_CODE))
-         break;
-
-   // Packet just contains response code, wait for more data
-   if(BUFFER.length() < shift + 1)
-      return QByteArray();
-
-   // Verify packet size
-   quint8 size = static_cast<quint8>(BUFFER.at(shift + 1));
-   if(BUFFER.length() > shift + size) {
-      // Check response labels
-      bool headerOk = true;
-      headerOk &= BUFFER[shift + 3] == static_cast<char>(label[0]);
-      headerOk &= BUFFER[shift + 4] == static_cast<char>(label[1]);
-
-      // Check response type
-      if(singleTag)
-         headerOk &= BUFFER[shift + 2] == static_cast<char>(DEV_READ_SINGLE_TAG);
-      else
-         headerOk &= BUFFER[shift + 2] == static_cast<char>(DEV_READ_TAG_DATA);
-
-      // Check that header corresponds to the requested data section
-      if(!headerOk) {
-         *ok = false;
-         return QByteArray();
-      }
-
-      // Get start address
-      if(startAddress)
-         *startAddress = static_cast<int>(BUFFER[shift + 5]);
-
-      // Get data length (in bytes)
-      quint8 len = static_cast<quint8>(BUFFER[shift + 6]) * 2;
-      if(length)
-         *length = static_cast<int>(len);
-
-      // Verify checksum and get read data
-      quint8 checksum = static_cast<quint8>(BUFFER[shift + len + 7]);
-      if(checksum == Checksum(BUFFER.mid(shift, len + 7)) || !verifyChecksum) {
-         // Register data from packet
-         QByteArray data;
-         for(int j = 0; j < len; ++j)
-            data.append(BUFFER.at(shift + 7 + j));
-
-         // Remove read data from buffer
-         BUFFER.remove(0, shift + len + 7);
-
-         // Reset shit counter
-         m_shitCount = 0;
-
-         // Return obtained data
-         *ok = true;
-         return data;
-      }
-   }
-
-   // Checksum or packet size invalid
-   return QByteArray();
-}
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "SM_6210.h"
+#include "RFID_Global.h"
+#include "RFID_Log.h"
+#include "RFID_Health.h"
+#include "RFID_Profiler.h"
+#include "RFID_Scheduler.h"
+#include "RFID_SerialManager.h"
+
+#include <QtMath>
+#include <QTimer>
+#include <QSerialPort>
+
+#include <cstring>
+#include <initializer_list>
+
+//------------------------------------------------------------------------------
+// Temporary buffer
+//------------------------------------------------------------------------------
+
+static QByteArray BUFFER;
+
+//------------------------------------------------------------------------------
+// Define the serial device command bytes
+//------------------------------------------------------------------------------
+
+// Header type byes
+static const quint8 HEADER_START_CODE       = 0xa0;
+static const quint8 HEADER_RESULT_CODE      = 0xe4;
+static const quint8 HEADER_RESPONSE_CODE    = 0xe0;
+
+// Operation command codes
+static const quint8 DEV_STOP_SEARCH         = 0xa8;
+static const quint8 DEV_WRITE_TAG_MW        = 0xab;
+static const quint8 DEV_GET_SINGLE_PARAM    = 0x61;
+static const quint8 DEV_READ_SINGLE_TAG     = 0x82;
+static const quint8 DEV_READ_TAG_DATA       = 0x80;
+static const quint8 CRP_ADD_USERCODE        = 0x64;
+
+// Data reading options
+static const quint8 RFU_LABEL[2]            = {0x00, 0x00};
+static const quint8 EPC_LABEL[2]            = {0x00, 0x01};
+static const quint8 TID_LABEL[2]            = {0x00, 0x02};
+static const quint8 USR_LABEL[2]            = {0x00, 0x03};
+
+// Failed tag searches before resetting the reader (at the default scan rate)
+static const int SEARCH_RESET_CYCLES        = 10;
+
+// Extra time given to the reader between scan cycles (in percent)
+static const int SCAN_INTERVAL_HEADROOM     = 25;
+
+// Scan interval multiplier & max. words per write command in degraded mode
+static const int DEGRADED_SCAN_FACTOR       = 2;
+static const quint8 DEGRADED_FRAME_WORDS    = 2;
+
+// Times that a write command is sent before giving up
+static const int WRITE_ATTEMPTS             = 3;
+
+// Max. size of the data of an information packet (255 words)
+static const int PACKET_DATA_SIZE           = 510;
+
+//------------------------------------------------------------------------------
+// Utility functions
+//------------------------------------------------------------------------------
+
+/**
+ * Calculates an 8-bit checksum with 2's complement for the given @a length
+ * bytes of @a data
+ */
+static quint8 Checksum(const char* data, const int length)
+{
+   quint8 checksum = 0;
+
+   for(int i = 0; i < length; ++i)
+      checksum += static_cast<quint8>(data[i]);
+
+   return (~checksum) + 1;
+}
+
+/**
+ * Calculates an 8-bit checksum with 2's complement for the given @a data
+ */
+static quint8 Checksum(const QByteArray& data)
+{
+   return Checksum(data.constData(), data.length());
+}
+
+/**
+ * Generates a command packet with the given @a bytes and appends its checksum
+ */
+static QByteArray CommandFrame(std::initializer_list<quint8> bytes)
+{
+   QByteArray frame;
+   frame.reserve(static_cast<int>(bytes.size()) + 1);
+   for(quint8 byte : bytes)
+      frame.append(static_cast<char>(byte));
+
+   frame.append(static_cast<char>(Checksum(frame)));
+   return frame;
+}
+
+/**
+ * Generates a tag data write packet that writes the given @a size bytes of
+ * @a data to the memory @a label, beginning at @a startAddress (@a length is
+ * the number of words to write). The packet is allocated once, with its
+ * final size.
+ */
+static QByteArray WriteFrame(const quint8 label[2],
+                             const quint8 startAddress,
+                             const quint8 length,
+                             const char* data,
+                             const int size)
+{
+   QByteArray packet(size + 8, Qt::Uninitialized);
+   char* frame = packet.data();
+   frame[0] = static_cast<char>(HEADER_START_CODE);
+   frame[1] = static_cast<char>(size + 6);
+   frame[2] = static_cast<char>(DEV_WRITE_TAG_MW);
+   frame[3] = static_cast<char>(label[0]);
+   frame[4] = static_cast<char>(label[1]);
+   frame[5] = static_cast<char>(startAddress);
+   frame[6] = static_cast<char>(length);
+   memcpy(frame + 7, data, static_cast<size_t>(size));
+   frame[size + 7] = static_cast<char>(Checksum(frame, size + 7));
+   return packet;
+}
+
+/**
+ * Generates a tag data read request packet for the given memory @a label,
+ * @a startAddress and number of words (@a length)
+ */
+static QByteArray ReadFrame(const quint8 label[2],
+                            const quint8 startAddress,
+                            const quint8 length)
+{
+   return CommandFrame({HEADER_START_CODE, 0x06, DEV_READ_TAG_DATA,
+                        label[0], label[1], startAddress, length
+                       });
+}
+
+//------------------------------------------------------------------------------
+// Pre-generated command packets
+//------------------------------------------------------------------------------
+
+/*
+ * The scan loop only sends a handful of different command packets, generating
+ * them once avoids building (and allocating) a new packet on every scan cycle
+ */
+
+static const QByteArray STOP_SEARCH_FRAME = CommandFrame({
+   HEADER_START_CODE, 0x03, DEV_STOP_SEARCH, 0x00
+});
+
+static const QByteArray SINGLE_PARAM_FRAME = CommandFrame({
+   HEADER_START_CODE, 0x05, DEV_GET_SINGLE_PARAM, 0x00, 0x00, CRP_ADD_USERCODE
+});
+
+static const QByteArray READ_SINGLE_TAG_FRAME = CommandFrame({
+   HEADER_START_CODE, 0x03, DEV_READ_SINGLE_TAG, 0x00
+});
+
+static const QByteArray EPC_READ_FRAME = ReadFrame(EPC_LABEL, 2, 6);
+static const QByteArray TID_READ_FRAME = ReadFrame(TID_LABEL, 0, 6);
+static const QByteArray RFU_READ_FRAME = ReadFrame(RFU_LABEL, 0, 4);
+static const QByteArray USR_READ_FRAMES[RFID_NUM_USER_DATAGRAMS] = {
+   ReadFrame(USR_LABEL, 0, 8),
+   ReadFrame(USR_LABEL, 8, 8),
+   ReadFrame(USR_LABEL, 16, 8),
+   ReadFrame(USR_LABEL, 24, 8)
+};
+
+//------------------------------------------------------------------------------
+// Driver constructor & destructor implementations
+//------------------------------------------------------------------------------
+
+SM_6210::SM_6210()
+{
+   // Reserve buffer memory once, so that the receive loop does not need to
+   // re-allocate the buffers as data arrives
+   BUFFER.reserve(RFID_MAX_BUFFER_SIZE);
+   m_packetData.reserve(PACKET_DATA_SIZE);
+
+   m_selector = 0;
+   m_shitCount = 0;
+   m_userStartAddress = 0;
+   m_scanInterval = RFID_SCAN_INTERVAL;
+   m_skipThreshold = RFID_MAX_SHIT_TRESHOLD;
+   m_resetThreshold = SEARCH_RESET_CYCLES;
+   connect(RFID_SerialManager::getInstance(),
+           &RFID_SerialManager::dataReceived,
+           this,
+           &SM_6210::onDataReceived);
+   connect(RFID_SerialManager::getInstance(),
+           &RFID_SerialManager::connectionStatusChanged,
+           this,
+           &SM_6210::onConnectionChanged);
+   connect(&m_scheduler,
+           &RFID_Scheduler::calibrated,
+           this,
+           &SM_6210::onCalibrated);
+   connect(&m_scheduler,
+           &RFID_Scheduler::commandTimedOut,
+           this,
+           &SM_6210::onCommandTimedOut);
+
+   // Feed the link health monitor with the scheduler events
+   connect(&m_scheduler,
+           &RFID_Scheduler::commandAnswered,
+           &m_health,
+           &RFID_Health::addResponse);
+   connect(&m_scheduler,
+           &RFID_Scheduler::commandTimedOut,
+           &m_health,
+           &RFID_Health::addTimeout);
+   connect(&m_health,
+           &RFID_Health::scoreChanged,
+           this,
+           &SM_6210::onHealthScoreChanged);
+   connect(&m_health,
+           &RFID_Health::degradedChanged,
+           this,
+           &SM_6210::onDegradedChanged);
+
+   // Calibrate the reader if the serial device is already connected
+   QTimer::singleShot(0, this, &SM_6210::onConnectionChanged);
+}
+
+SM_6210::~SM_6210()
+{
+   disconnect(RFID_SerialManager::getInstance(),
+              &RFID_SerialManager::dataReceived,
+              this,
+              &SM_6210::onDataReceived);
+   disconnect(RFID_SerialManager::getInstance(),
+              &RFID_SerialManager::connectionStatusChanged,
+              this,
+              &SM_6210::onConnectionChanged);
+}
+
+//------------------------------------------------------------------------------
+// Driver function implementations
+//------------------------------------------------------------------------------
+
+/**
+ * @brief UHF_530_RDM::scan
+ * Asks the UHF reader to send EPC, TagID, User and RFU data repeatedly for
+ * the current tag. If current tag is @c NULL, then the function shall ask the
+ * UHF reader to perform a quick-scan for EPC in near RFID tags. If no tags are
+ * found, then the function shall reset the UHF reader periodically.
+ *
+ * The failure thresholds are given in scan cycles, and are adjusted to the
+ * scan interval when the reader is calibrated.
+ *
+ * If the link with the reader is degraded, only the EPC of the current tag is
+ * read, so that the tag can still be tracked with the few commands that get
+ * through.
+ */
+void SM_6210::scan()
+{
+   if(!currentTag()) {
+      m_selector = 0;
+
+      // Send stop-and-reset command after some failed reading cycles
+      if(m_shitCount > m_resetThreshold) {
+         RFID_LOG(RFID_LOG_PROTOCOL, RFID_LOG_DEBUG,
+                  "No tag found in %1 cycles, resetting search", m_shitCount);
+         m_shitCount = 0;
+         m_scheduler.enqueue(RFID_LANE_CONTROL, STOP_SEARCH_FRAME, 0, true);
+      }
+
+      // Send tag read request command
+      else
+         m_scheduler.enqueue(RFID_LANE_INVENTORY, SINGLE_PARAM_FRAME, 0, true);
+
+      // Increase shit count until we find a tag
+      ++m_shitCount;
+   }
+
+   // Link degraded, only read the EPC of the current tag
+   else if(m_health.degraded())
+      readEpc();
+
+   // Current tag available, read all tag data
+   else {
+      switch(m_selector) {
+         case 0:
+            readEpc();
+            break;
+         case 1:
+            readTid();
+            break;
+         case 2:
+            readRfu();
+            break;
+         case 3:
+            readUsr();
+            break;
+         default:
+            m_selector = 0;
+            break;
+      }
+
+      // Tag ID empty, try to read it
+      if(!RFID_ValidKey(currentTag()->tid))
+         m_selector = 1;
+
+      // RFU empty, try ro read it
+      else if(currentTag()->rfu.isEmpty())
+         m_selector = 2;
+
+      // User data empty, try to read it
+      else if(currentTag()->usr->isEmpty())
+         m_selector = 3;
+
+      // EPC empty, try to read it
+      else if(currentTag()->epc.isEmpty())
+         m_selector = 0;
+
+      // Try to read next tag section if current section cannot be read
+      if(m_shitCount > m_skipThreshold) {
+         RFID_LOG(RFID_LOG_PROTOCOL, RFID_LOG_DEBUG,
+                  "Cannot read section %1 of tag %2, skipping it",
+                  m_selector, currentTag()->id);
+         m_shitCount = 0;
+         ++m_selector;
+      }
+
+      // Increase shit count (shit count is set to 0 if a section is read
+      // successfully). This allows us to know if a tag's section cannot
+      // be read or has an error
+      ++m_shitCount;
+   }
+}
+
+/**
+ * @brief UHF_530_RDM::loaded
+ * Returns @c true if the serial manager has a device connected and configured
+ * to communicate with a baud rade of 9600.
+ */
+bool SM_6210::loaded()
+{
+   RFID_SerialManager* sm = RFID_SerialManager::getInstance();
+   if(sm->connected())
+      return sm->baudRate() == 9600;
+
+   return false;
+}
+
+/**
+ * @brief SM_6210::scanInterval
+ * @returns the interval between scan cycles, which is derived from the command
+ *          rate measured when the reader is calibrated (and is increased if
+ *          the link with the reader is degraded)
+ */
+int SM_6210::scanInterval() const
+{
+   if(m_health.degraded())
+      return qMin(m_scanInterval * DEGRADED_SCAN_FACTOR, RFID_MAX_SCAN_INTERVAL);
+
+   return m_scanInterval;
+}
+
+//------------------------------------------------------------------------------
+// Tag data access functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief UHF_530_RDM::readEpc
+ * Sends an EPC data request packet to the UHF reader.
+ */
+void SM_6210::readEpc()
+{
+   m_scheduler.enqueue(RFID_LANE_TARGETED_READ, EPC_READ_FRAME,
+                       currentTagId(), true);
+}
+
+/**
+ * @brief UHF_530_RDM::readTid
+ * Sends a TagID data request packet to the UHF reader.
+ */
+void SM_6210::readTid()
+{
+   m_scheduler.enqueue(RFID_LANE_TARGETED_READ, TID_READ_FRAME,
+                       currentTagId(), true);
+}
+
+/**
+ * @brief UHF_530_RDM::readRfu
+ * Sends a RFU data request packet to the UHF reader.
+ */
+void SM_6210::readRfu()
+{
+   m_scheduler.enqueue(RFID_LANE_TARGETED_READ, RFU_READ_FRAME,
+                       currentTagId(), true);
+}
+
+/**
+ * @brief UHF_530_RDM::readUsr
+ * Sends an user data request packet to the UHF reader.
+ */
+void SM_6210::readUsr()
+{
+   // Reset user start address if necessary
+   if(m_userStartAddress > 24)
+      m_userStartAddress = 0;
+
+   // Send the packet for the current user datagram
+   const quint8 dataLength = 8;
+   const int datagram = m_userStartAddress / dataLength;
+   m_scheduler.enqueue(RFID_LANE_TARGETED_READ, USR_READ_FRAMES[datagram],
+                       currentTagId(), true);
+
+   // Increase start address by data length
+   m_userStartAddress += dataLength;
+}
+
+//------------------------------------------------------------------------------
+// Tag management functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief UHF_530_RDM::killTag
+ *
+ * Sends a tag kill command to the UHF reader, returns @c true if the UHF reader
+ * managed to kill the current tag, @c false if there was an error.
+ */
+bool SM_6210::killTag()
+{
+   return false;
+}
+
+/**
+ * @brief UHF_530_RDM::lockTag
+ *
+ * Sends a lock tag command to the UHF reader, returns @c true if the UHF reader
+ * managed to lock the current tag, @c false if there was an error.
+ */
+bool SM_6210::lockTag()
+{
+   return false;
+}
+
+/**
+ * @brief UHF_530_RDM::eraseTag
+ *
+ * Tries to erase all EPC, User and RFU data from the current tag.
+ * Returns @c true on success, @c false on failure.
+ */
+bool SM_6210::eraseTag()
+{
+   QByteArray epc;
+   for(int i = 0; i < RFID_EPC_LENGTH; ++i)
+      epc.append(static_cast<char>(0x00));
+
+   QByteArray usr;
+   for(int i = 0; i < RFID_USER_LENGTH; ++i)
+      usr.append(static_cast<char>(0x00));
+
+   QByteArray rfu;
+   for(int i = 0; i < RFID_RFU_LENGTH; ++i)
+      rfu.append(static_cast<char>(0x00));
+
+   return writeEpc(epc) && writeRfu(rfu) && writeUserData(usr);
+}
+
+//------------------------------------------------------------------------------
+// Data writing function
+//------------------------------------------------------------------------------
+
+bool SM_6210::writeEpc(const QByteArray& epc)
+{
+   if(currentTag())
+      return writeData(epc.constData(), epc.size(), EPC_LABEL, 2, 6);
+
+   return false;
+}
+
+bool SM_6210::writeRfu(const QByteArray& rfu)
+{
+   if(currentTag())
+      return writeData(rfu.constData(), rfu.size(), RFU_LABEL, 0, 4);
+
+   return false;
+}
+
+bool SM_6210::writeUserData(const QByteArray& userData)
+{
+   if(currentTag()) {
+      bool ok = true;
+      for(int i = 0; i < RFID_NUM_USER_DATAGRAMS; ++i) {
+         const int offset = qMin(i * 16, userData.size());
+         const int size = qMin(userData.size() - offset, 16);
+         ok &= writeData(userData.constData() + offset, size, USR_LABEL,
+                         static_cast<quint8>(i * 8), 8);
+      }
+
+      return ok;
+   }
+
+   return false;
+}
+
+//------------------------------------------------------------------------------
+// Data management functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief SM_6210::currentTagChanged
+ *
+ * Cancels the pending reads & writes of the @a previous tag, so that their
+ * responses are not registered as data of the new current tag.
+ */
+void SM_6210::currentTagChanged(RFID_Tag* previous)
+{
+   if(!previous)
+      return;
+
+   m_scheduler.cancelOwner(previous->id);
+
+   QHash<quint32, Write>::iterator it = m_writes.begin();
+   while(it != m_writes.end()) {
+      if(it.value().owner == previous->id)
+         it = m_writes.erase(it);
+      else
+         ++it;
+   }
+}
+
+/**
+ * @brief SM_6210::currentTagId
+ * @returns the ID of the current tag, used as the owner of the commands that
+ *          target the current tag (0 if there is no current tag)
+ */
+quint32 SM_6210::currentTagId() const
+{
+   if(currentTag())
+      return currentTag()->id;
+
+   return 0;
+}
+
+/**
+ * @brief SM_6210::acceptResponse
+ * @param request command packet that produces the received response
+ *
+ * Checks if a tag data packet is the response to the command that is waiting
+ * for its response, in which case the scheduler is notified so that it sends
+ * the next command.
+ *
+ * Returns @c false if the response must be discarded, because its command has
+ * been cancelled, or because it is the late response of a command that timed
+ * out (its data could belong to another tag).
+ */
+bool SM_6210::acceptResponse(const QByteArray& request)
+{
+   if(m_scheduler.currentFrame() != request) {
+      RFID_Profiler::getInstance()->addCount("SM_6210 stray responses");
+      return false;
+   }
+
+   const bool cancelled = m_scheduler.currentCancelled();
+   m_scheduler.responseReceived();
+   return !cancelled;
+}
+
+/**
+ * @brief SM_6210::acceptStatus
+ * @param command command code echoed by an acknowledgement or status packet
+ *
+ * Checks if a status packet is the response to the command that is waiting
+ * for its response (status packets do not carry the request data, so they
+ * are matched by their command code), in which case the scheduler is
+ * notified so that it sends the next command.
+ *
+ * If the command is a tag write, the write is completed if the reader
+ * reports its @a success, otherwise it is sent again (see @c retryWrite()).
+ *
+ * Returns @c false if the packet must be discarded, because its command has
+ * been cancelled, or because it is the late response of a command that timed
+ * out (which must not complete the command that is waiting now).
+ */
+bool SM_6210::acceptStatus(const quint8 command, const bool success)
+{
+   const QByteArray frame = m_scheduler.currentFrame();
+   if(frame.length() < 3 || static_cast<quint8>(frame.at(2)) != command) {
+      RFID_Profiler::getInstance()->addCount("SM_6210 stray responses");
+      return false;
+   }
+
+   const quint32 operation = m_scheduler.currentOperation();
+   const bool cancelled = m_scheduler.currentCancelled();
+   m_scheduler.responseReceived();
+
+   if(m_writes.contains(operation)) {
+      if(success && !cancelled)
+         m_writes.remove(operation);
+      else
+         retryWrite(operation);
+   }
+
+   return !cancelled;
+}
+
+/**
+ * @brief SM_6210::onConnectionChanged
+ *
+ * Drops the data and commands of the previous connection, and calibrates the
+ * reader when the serial device is connected. Stop-search commands are used
+ * for the calibration, since they are cheap and do not change the state of
+ * the reader.
+ */
+void SM_6210::onConnectionChanged()
+{
+   BUFFER.clear();
+   m_writes.clear();
+   m_health.reset();
+   m_scheduler.clear();
+
+   if(loaded())
+      m_scheduler.calibrate(STOP_SEARCH_FRAME);
+}
+
+/**
+ * @brief SM_6210::onCommandTimedOut
+ *
+ * Sends the given write @a operation again if it was not acknowledged by the
+ * reader in time
+ */
+void SM_6210::onCommandTimedOut(const quint32 operation)
+{
+   if(m_writes.contains(operation))
+      retryWrite(operation);
+}
+
+/**
+ * @brief SM_6210::onCalibrated
+ *
+ * Adjusts the scan interval to the command rate of the reader (firmware
+ * revisions differ a lot), and scales the failure thresholds of the scan
+ * loop so that they still span the same amount of time. The defaults are
+ * used if the reader did not answer the calibration commands.
+ */
+void SM_6210::onCalibrated(const RFID_Calibration& calibration)
+{
+   m_scanInterval = RFID_SCAN_INTERVAL;
+   if(calibration.rate > 0) {
+      const double period = 1000 / calibration.rate;
+      m_scanInterval = qCeil(period * (100 + SCAN_INTERVAL_HEADROOM) / 100);
+      m_scanInterval = qBound(RFID_MIN_SCAN_INTERVAL, m_scanInterval,
+                              RFID_MAX_SCAN_INTERVAL);
+   }
+
+   m_resetThreshold = qMax(1, SEARCH_RESET_CYCLES * RFID_SCAN_INTERVAL
+                           / m_scanInterval);
+   m_skipThreshold = qMax(1, RFID_MAX_SHIT_TRESHOLD * RFID_SCAN_INTERVAL
+                          / m_scanInterval);
+
+   RFID_LOG(RFID_LOG_PROTOCOL, RFID_LOG_INFO,
+            "Scan interval set to %1 ms (reader answers %2 commands/s)",
+            m_scanInterval, qRound(calibration.rate));
+
+   m_health.setBaseline(calibration.p50);
+   emit calibrated(calibration);
+}
+
+/**
+ * @brief SM_6210::onHealthScoreChanged
+ *
+ * Registers the health score of the link, so that it is shown in the
+ * diagnostics view
+ */
+void SM_6210::onHealthScoreChanged()
+{
+   RFID_Profiler::getInstance()->setCounter("SM_6210 health score",
+                                            m_health.score());
+}
+
+/**
+ * @brief SM_6210::onDegradedChanged
+ *
+ * Called when the link switches between the full and the degraded scan plans,
+ * the scan loop state is reset so that the new plan starts from the EPC.
+ */
+void SM_6210::onDegradedChanged(const bool degraded)
+{
+   m_selector = 0;
+   m_shitCount = 0;
+
+   if(degraded) {
+      RFID_Profiler::getInstance()->addCount("SM_6210 degraded mode entered");
+      RFID_LOG(RFID_LOG_HEALTH, RFID_LOG_WARNING,
+               "Link degraded (health score %1), reading EPCs only",
+               m_health.score());
+   }
+
+   else {
+      RFID_Profiler::getInstance()->addCount("SM_6210 degraded mode left");
+      RFID_LOG(RFID_LOG_HEALTH, RFID_LOG_INFO,
+               "Link recovered (health score %1)", m_health.score());
+   }
+}
+
+/**
+ * @brief UHF_530_RDM::onDataReceived
+ * @param data
+ * @param timestamp monotonic time at which the @a data was received
+ *
+ * Slot function called when the serial manager detects any incoming data from
+ * the UHF serial reader.
+ *
+ * This function appends the given @a data to a buffer and lets the data
+ * interpretation functions to read and manage the buffer automatically. The
+ * packets completed by the given @a data are reported with its @a timestamp.
+ *
+ * If for some reason the buffer size is too large, then this function shall
+ * drop the oldest data of the buffer to avoid memory problems.
+ */
+void SM_6210::onDataReceived(const QByteArray& data, const qint64 timestamp)
+{
+   RFID_PROFILE("SM_6210::onDataReceived");
+
+   // Data is empty, abort
+   if(data.isEmpty())
+      return;
+
+   // Driver not ready, abort
+   if(!loaded())
+      return;
+
+   // Append data to buffer
+   BUFFER.append(data);
+   setFrameTimestamp(timestamp);
+
+   // Interpret all the packets contained in the buffer
+   readPackets();
+
+   // Buffer exceeds max size, drop the oldest data (instead of the whole
+   // buffer) and interpret the packets that follow it
+   if(BUFFER.size() > RFID_MAX_BUFFER_SIZE) {
+      const int overflow = BUFFER.size() - RFID_MAX_BUFFER_SIZE;
+      BUFFER.remove(0, overflow);
+      RFID_Profiler::getInstance()->addCount("SM_6210 bytes dropped", overflow);
+      RFID_LOG(RFID_LOG_PROTOCOL, RFID_LOG_WARNING,
+               "Receive buffer full, %1 bytes dropped", overflow);
+      m_health.addResync();
+      readPackets();
+   }
+}
+
+//------------------------------------------------------------------------------
+// Packet interpretation functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief SM_6210::readPackets
+ *
+ * Interprets all the packets contained in the buffer, stops when a packet
+ * interpretation function cannot remove any data from the buffer (e.g.
+ * when we need to wait for more data to arrive)
+ */
+void SM_6210::readPackets()
+{
+   int previousSize;
+   do {
+      previousSize = BUFFER.size();
+      readPacket();
+   } while(!BUFFER.isEmpty() && BUFFER.size() < previousSize);
+}
+
+/**
+ * @brief SM_6210::readPacket
+ *
+ * Tries to interpret the first packet of the buffer with each of the packet
+ * interpretation functions. If no function recognizes the packet, then the
+ * packet is discarded (once it has been received completely).
+ *
+ * Recognized packets that answer the command sent by the scheduler notify
+ * the scheduler by themselves (see @c acceptResponse() and
+ * @c acceptStatus()), so that it sends the next queued command.
+ */
+void SM_6210::readPacket()
+{
+   // Tag search acknowledgement
+   if(readAckPacket()) {
+      m_health.addPacket();
+      return;
+   }
+
+   // Tag data packets
+   if(readEpcPacketFromScan()
+         || readEpcPacket()
+         || readTagIdPacket()
+         || readRfuPacket()
+         || readUsrPacket())
+      return;
+
+   // Status packets
+   if(readStdResponse() || readStdResult()) {
+      m_health.addPacket();
+      return;
+   }
+
+   discardUnknownPacket();
+}
+
+/**
+ * @brief SM_6210::discardUnknownPacket
+ *
+ * Removes any data that is not part of a packet from the beginning of the
+ * buffer. If the buffer starts with a complete packet that could not be
+ * interpreted, then the packet is removed, so that it does not block the
+ * interpretation of the packets that follow it.
+ *
+ * This function always removes data from the buffer unless the buffer starts
+ * with an incomplete packet.
+ */
+void SM_6210::discardUnknownPacket()
+{
+   // Get position of the first packet header
+   const int response = BUFFER.indexOf(static_cast<char>(HEADER_RESPONSE_CODE));
+   const int result = BUFFER.indexOf(static_cast<char>(HEADER_RESULT_CODE));
+   int shift = response;
+   if(shift < 0 || (result >= 0 && result < shift))
+      shift = result;
+
+   // No packet headers found, the whole buffer is garbage
+   if(shift < 0) {
+      RFID_LOG(RFID_LOG_PROTOCOL, RFID_LOG_DEBUG,
+               "Discarded %1 bytes without packet header", BUFFER.length());
+      BUFFER.clear();
+      m_health.addResync();
+      return;
+   }
+
+   // Remove garbage before the packet header
+   if(shift > 0) {
+      RFID_LOG(RFID_LOG_PROTOCOL, RFID_LOG_DEBUG,
+               "Discarded %1 bytes before packet header", shift);
+      BUFFER.remove(0, shift);
+      m_health.addResync();
+      return;
+   }
+
+   // Remove the packet once it is complete, if the checksum is invalid, then
+   // the header byte is not a real header, only remove that byte so that we
+   // can look for the real packet header
+   if(BUFFER.length() > 1) {
+      const int packetLength = static_cast<quint8>(BUFFER.at(1)) + 2;
+      if(BUFFER.length() >= packetLength) {
+         const quint8 checksum = static_cast<quint8>(BUFFER.at(packetLength - 1));
+         if(checksum == Checksum(BUFFER.constData(), packetLength - 1))
+            BUFFER.remove(0, packetLength);
+         else {
+            RFID_LOG(RFID_LOG_PROTOCOL, RFID_LOG_DEBUG,
+                     "Invalid checksum in packet of %1 bytes", packetLength);
+            BUFFER.remove(0, 1);
+            m_health.addChecksumError();
+         }
+      }
+   }
+}
+
+/**
+ * @brief UHF_530_RDM::readAckPacket
+ *
+ * Reads and interprets a single-tag search acknowledge packet from the UHF
+ * reader. If an ACK packet is found and read successfully, then the function
+ * shall return @c true and will respond to the UHF reader so that normal tag
+ * searching operations can begin (unless the packet is the late answer of a
+ * search request that timed out).
+ */
+bool SM_6210::readAckPacket()
+{
+   // Check buffer size (the packet must begin at the start of the buffer,
+   // any data before it is removed by discardUnknownPacket())
+   if(BUFFER.length() < 8)
+      return false;
+
+   // Check header
+   bool ok = true;
+   ok &= BUFFER[0] == static_cast<char>(HEADER_RESPONSE_CODE);
+   ok &= BUFFER[1] == static_cast<char>(0x06);
+   ok &= BUFFER[2] == static_cast<char>(DEV_GET_SINGLE_PARAM);
+   ok &= BUFFER[3] == static_cast<char>(0x00);
+   ok &= BUFFER[4] == static_cast<char>(0x00);
+   ok &= BUFFER[5] == static_cast<char>(CRP_ADD_USERCODE);
+   ok &= BUFFER[6] == static_cast<char>(0x00);
+   ok &= BUFFER[7] == static_cast<char>(Checksum(BUFFER.constData(), 7));
+
+   // Header ok, respond with acknowledgement packet and delete read bytes
+   if(ok) {
+      BUFFER.remove(0, 8);
+      if(acceptStatus(DEV_GET_SINGLE_PARAM))
+         m_scheduler.enqueue(RFID_LANE_INVENTORY, READ_SINGLE_TAG_FRAME);
+   }
+
+   // Return value
+   return ok;
+}
+
+/**
+ * @brief UHF_530_RDM::readStdResult
+ *
+ * Reads and interprets any result packet from the UHF reader. The status
+ * byte that follows the command code (0 on success) is used to acknowledge
+ * tag writes, it is also important to manage the incoming data buffer so that
+ * we can extract information from useful data packets.
+ *
+ * The packet must begin at the start of the buffer (any data before it is
+ * removed by @c discardUnknownPacket()), and is only removed if its checksum
+ * is valid, so that a corrupted size byte cannot drop the packets that
+ * follow it.
+ *
+ * Returns @c true if a result packet was found and ignored, @c false if no
+ * response packet was found. The scheduler is only notified if the packet
+ * answers the command that is waiting for its response.
+ */
+bool SM_6210::readStdResult()
+{
+   // Check header & wait until the packet size is received
+   if(BUFFER.length() < 2
+         || BUFFER.at(0) != static_cast<char>(HEADER_RESULT_CODE))
+      return false;
+
+   // Wait until the complete packet (with at least the command code) is
+   // received
+   const int packetLength = static_cast<quint8>(BUFFER.at(1)) + 2;
+   if(packetLength < 4 || BUFFER.length() < packetLength)
+      return false;
+
+   // Verify checksum
+   const quint8 checksum = static_cast<quint8>(BUFFER.at(packetLength - 1));
+   if(checksum != Checksum(BUFFER.constData(), packetLength - 1))
+      return false;
+
+   // Notify the status of the command & remove packet from buffer
+   const bool success = packetLength < 5 || BUFFER.at(3) == 0;
+   acceptStatus(static_cast<quint8>(BUFFER.at(2)), success);
+   BUFFER.remove(0, packetLength);
+   return true;
+}
+
+/**
+ * @brief UHF_530_RDM::readStdResponse
+ *
+ * Reads and interprets any response packet from the UHF reader, we don't really
+ * do something with this information, but it is important to manage the
+ * incoming data buffer so that we can extract information from useful data
+ * packets.
+ *
+ * As with @c readStdResult(), the packet must begin at the start of the
+ * buffer and is only removed if its checksum is valid.
+ *
+ * Returns @c true if a response packet was found and ignored, @c false if no
+ * response packet was found. The scheduler is only notified if the packet
+ * answers the command that is waiting for its response.
+ */
+bool SM_6210::readStdResponse()
+{
+   // Check header & wait until the packet size is received
+   if(BUFFER.length() < 2
+         || BUFFER.at(0) != static_cast<char>(HEADER_RESPONSE_CODE))
+      return false;
+
+   // Only short packets (with at least the command code) are status packets,
+   // wait until the complete packet is received
+   const int packetSize = static_cast<quint8>(BUFFER.at(1));
+   if(packetSize < 2 || packetSize > 5 || BUFFER.length() < packetSize + 2)
+      return false;
+
+   // Verify checksum
+   const quint8 checksum = static_cast<quint8>(BUFFER.at(packetSize + 1));
+   if(checksum != Checksum(BUFFER.constData(), packetSize + 1))
+      return false;
+
+   // Notify the status of the command & remove packet from buffer
+   acceptStatus(static_cast<quint8>(BUFFER.at(2)));
+   BUFFER.remove(0, packetSize + 2);
+   return true;
+}
+
+/**
+ * @brief UHF_530_RDM::readTagIdPacket
+ *
+ * Reads and interprets a TagID information packet, returns @c true on success
+ * or @c false on failure.
+ */
+bool SM_6210::readTagIdPacket()
+{
+   bool success = false;
+   QByteArray tid = readInformationPacket(TID_LABEL, &success);
+   if(success && acceptResponse(TID_READ_FRAME))
+      emit tidFound(tid, frameTimestamp());
+
+   return success;
+}
+
+/**
+ * @brief UHF_530_RDM::readEpcPacket
+ *
+ * Reads and interprets an EPC information packet, returns @c true on success
+ * or @c false on failure.
+ */
+bool SM_6210::readEpcPacket()
+{
+   bool success = false;
+   QByteArray epc = readInformationPacket(EPC_LABEL, &success);
+   if(success && acceptResponse(EPC_READ_FRAME))
+      emit epcFound(epc, frameTimestamp());
+
+   return success;
+}
+
+/**
+ * @brief UHF_530_RDM::readRfuPacket
+ *
+ * Reads and interprets a RFU information packet, returns @c true on success
+ * or @c false on failure.
+ */
+bool SM_6210::readRfuPacket()
+{
+   bool success = false;
+   QByteArray rfu = readInformationPacket(RFU_LABEL, &success);
+   if(success && acceptResponse(RFU_READ_FRAME))
+      emit rfuFound(rfu, frameTimestamp());
+
+   return success;
+}
+
+/**
+ * @brief UHF_530_RDM::readUsrPacket
+ *
+ * Reads and interprets an user data packet for the first 13 bytes of data,
+ * returns @c true if the packet was read successfully, @c false if there
+ * was an error while reading and interpreting the packet.
+ */
+bool SM_6210::readUsrPacket()
+{
+   int startAddress = 0;
+   bool success = false;
+   QByteArray usr = readInformationPacket(USR_LABEL, &success, &startAddress);
+
+   if(success) {
+      const int datagram = startAddress / 8;
+      if(datagram > RFID_NUM_USER_DATAGRAMS - 1 || datagram < 0)
+         return false;
+
+      if(acceptResponse(USR_READ_FRAMES[datagram]))
+         emit usrFound(usr, datagram, frameTimestamp());
+   }
+
+   return success;
+}
+
+/**
+ * @brief UHF_530_RDM::readEpcPacketFromScan
+ *
+ * Reads and interprets quick-scan EPC information packets. Returns @c true if
+ * packet was read successfully, @c false if there was an error while reading
+ * and interpreting the packet data.
+ */
+bool SM_6210::readEpcPacketFromScan()
+{
+   bool success = false;
+   QByteArray epc = readInformationPacket(EPC_LABEL, &success,
+                                          nullptr, nullptr, true);
+
+   // EPC sightings are valid even if they arrive late, so they are never
+   // discarded (they only complete the current command if it is a search)
+   if(success) {
+      acceptResponse(READ_SINGLE_TAG_FRAME);
+      emit epcFound(epc, frameTimestamp());
+   }
+
+   return success;
+}
+
+//------------------------------------------------------------------------------
+// Generic packet reading & writing functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief SM_6210::writeData
+ * @param data data to write
+ * @param size number of bytes to write
+ * @param label section in which to write the data into (EPC, RFU, etc..)
+ * @param startAddress start address of data section
+ * @param length number of addresses to write
+ * @return
+ *
+ * Writes the given @a data to the current RFID tag. The write commands are
+ * queued in the write lane of the scheduler, so that they preempt the tag
+ * scanning commands. Returns @c false if the commands cannot be queued.
+ *
+ * Each write command is queued once, and is only sent again if the reader
+ * does not acknowledge it (see @c retryWrite()). Pending writes to the same
+ * address are cancelled, so that a retry never overwrites newer data.
+ *
+ * If the link with the reader is degraded, the data is split in shorter
+ * write commands, so that a corrupted byte does not discard the whole write.
+ */
+bool SM_6210::writeData(const char* data,
+                        const int size,
+                        const quint8 label[2],
+                        const quint8 startAddress,
+                        const quint8 length)
+{
+   // Get number of words to write with each packet
+   quint8 words = length;
+   if(m_health.degraded())
+      words = qMin(length, DEGRADED_FRAME_WORDS);
+
+   bool ok = true;
+   for(quint8 offset = 0; offset < length; offset += words) {
+      // Generate packet with the data of its words
+      const quint8 count = qMin<quint8>(words, length - offset);
+      const int begin = qMin(offset * 2, size);
+      const int bytes = qMin(size - begin, count * 2);
+      const quint8 address = static_cast<quint8>(startAddress + offset);
+      const QByteArray packet = WriteFrame(label, address, count,
+                                           data + begin, bytes);
+
+      // Cancel the pending writes to the same address
+      QHash<quint32, Write>::iterator it = m_writes.begin();
+      while(it != m_writes.end()) {
+         if(memcmp(it.value().frame.constData() + 3,
+                   packet.constData() + 3, 3) == 0) {
+            m_scheduler.cancel(it.key());
+            it = m_writes.erase(it);
+         }
+
+         else
+            ++it;
+      }
+
+      // Queue packet in the write lane, so that it is sent before any pending
+      // tag read or inventory command
+      Write write;
+      write.attempts = 1;
+      write.frame = packet;
+      write.owner = currentTagId();
+      const quint32 operation = m_scheduler.enqueue(RFID_LANE_WRITE, packet,
+                                                    write.owner);
+      if(operation != 0)
+         m_writes.insert(operation, write);
+      else
+         ok = false;
+   }
+
+   // Serial error
+   return ok;
+}
+
+/**
+ * @brief SM_6210::retryWrite
+ * @param operation operation ID of a write that was not acknowledged
+ *
+ * Queues the given write again, unless it has already been sent
+ * @c WRITE_ATTEMPTS times or its tag is no longer the current tag, in which
+ * case the write is registered as failed.
+ */
+void SM_6210::retryWrite(const quint32 operation)
+{
+   Write write = m_writes.take(operation);
+   if(write.attempts >= WRITE_ATTEMPTS || write.owner != currentTagId()) {
+      RFID_Profiler::getInstance()->addCount("SM_6210 writes failed");
+      RFID_LOG(RFID_LOG_PROTOCOL, RFID_LOG_WARNING,
+               "Write not acknowledged after %1 attempts", write.attempts);
+      return;
+   }
+
+   const quint32 retry = m_scheduler.enqueue(RFID_LANE_WRITE, write.frame,
+                                             write.owner);
+   if(retry != 0) {
+      ++write.attempts;
+      m_writes.insert(retry, write);
+      RFID_Profiler::getInstance()->addCount("SM_6210 write retries");
+   }
+}
+
+/**
+ * @brief SM_6210::readInformationPacket
+ * @param label data type label (two bytes)
+ * @param ok set to @c true if packet is read successfully
+ * @param startAddress start address of data
+ * @param length length of received data
+ * @param singleTag read a quick-scan packet instead of a data packet
+ *
+ * Reads and interprets any information packet received from the SM-6210
+ * reader. The packet must begin at the start of the buffer (any data before
+ * it is removed by @c discardUnknownPacket()), and is only read if its
+ * checksum is valid. Packets with an invalid checksum are left in the buffer,
+ * so that @c discardUnknownPacket() drops their header byte and registers
+ * the checksum error.
+ */
+QByteArray SM_6210::readInformationPacket(const quint8 label[2],
+                                          bool* ok,
+                                          int* startAddress,
+                                          int* length,
+                                          const bool singleTag)
+{
+   // Verify arguments
+   Q_ASSERT(ok != Q_NULLPTR);
+
+   // Set success parameter to false
+   *ok = false;
+
+   // Wait until the complete packet header is received
+   if(BUFFER.length() < 7)
+      return QByteArray();
+
+   // Check header & response labels
+   bool headerOk = true;
+   headerOk &= BUFFER[0] == static_cast<char>(HEADER_RESPONSE_CODE);
+   headerOk &= BUFFER[3] == static_cast<char>(label[0]);
+   headerOk &= BUFFER[4] == static_cast<char>(label[1]);
+
+   // Check response type
+   if(singleTag)
+      headerOk &= BUFFER[2] == static_cast<char>(DEV_READ_SINGLE_TAG);
+   else
+      headerOk &= BUFFER[2] == static_cast<char>(DEV_READ_TAG_DATA);
+
+   // Check that header corresponds to the requested data section
+   if(!headerOk)
+      return QByteArray();
+
+   // Get data length (in bytes) & packet length, the packet length is the
+   // largest of the length reported by the packet size field and the length
+   // needed to read the data and the checksum
+   const int len = static_cast<quint8>(BUFFER[6]) * 2;
+   const int size = static_cast<quint8>(BUFFER[1]);
+   const int packetLength = qMax(size + 2, len + 8);
+
+   // Wait until the complete packet is received
+   if(BUFFER.length() < packetLength)
+      return QByteArray();
+
+   // Verify checksum
+   const quint8 checksum = static_cast<quint8>(BUFFER[len + 7]);
+   if(checksum != Checksum(BUFFER.constData(), len + 7))
+      return QByteArray();
+
+   // Get start address & data length
+   if(startAddress)
+      *startAddress = static_cast<quint8>(BUFFER[5]);
+   if(length)
+      *length = len;
+
+   // Copy the data to the packet data buffer, which is only re-allocated if
+   // its previous data is still in use (e.g. it was stored in a tag)
+   m_packetData.resize(len);
+   memcpy(m_packetData.data(), BUFFER.constData() + 7,
+          static_cast<size_t>(len));
+
+   // Remove read data from buffer
+   BUFFER.remove(0, packetLength);
+
+   // Reset shit counter
+   m_shitCount = 0;
+   m_health.addPacket();
+
+   // Return obtained data
+   *ok = true;
+   return m_packetData;
+}
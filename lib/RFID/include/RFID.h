@@ -1,91 +1,172 @@
-/*
- * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
- *
- * Permission is hereby granted, free of charge, to any person obtaining a copy
- * of this software and associated documentation files (the "Software"), to deal
- * in the Software without restriction, including without limitation the rights
- * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
- * copies of the Software, and to permit persons to whom the Software is
- * furnished to do so, subject to the following conditions:
- *
- * The above copyright notice and this permission notice shall be included in
- * all copies or substantial portions of the Software.
- *
- * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
- * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
- * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
- * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
- * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
- * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
- * THE SOFTWARE.
- */
-
-#ifndef RFID_H
-#define RFID_H
-
-#include "RFID_Global.h"
-
-#include <QTimer>
-
-class RFID_Reader;
-class RFID : public QObject
-{
-      Q_OBJECT
-
-   signals:
-      void tagUpdated();
-      void readerChanged();
-      void tagCountChanged();
-      void currentTagChanged();
-
-   public:
-      static RFID* getInstance();
-
-      int tagCount() const;
-      bool readerAccessible() const;
-
-      RFID_Reader* reader() const;
-      RFID_Tag* currentTag();
-
-      RFID_TagList rfidTags() const;
-      QStringList rfidReaders() const;
-
-      QByteArray getUserData(const RFID_Tag* tag) const;
-      QString generateMemoryMap(const RFID_Tag* tag) const;
-
-      bool writeEpc(const QByteArray& epc);
-      bool writeRfu(const QByteArray& rfu);
-      bool writeUserData(const QByteArray& userData);
-
-   public slots:
-      void clearHistory();
-      void unloadReader();
-      void setReader(const int index);
-      void setReader(RFID_Reader* newReader);
-
-      void lockTag();
-      void killTag();
-      void eraseTag();
-
-   private slots:
-      void scan();
-      void resetCurrentTag();
-      void onEpcFound(const QByteArray& epc);
-      void onTidFound(const QByteArray& tid);
-      void onUsrFound(const QByteArray& usr, const int datagram);
-      void onRfuFound(const QByteArray& rfu);
-
-   private:
-      RFID();
-      ~RFID();
-
-      void updateTagList(RFID_Tag* tag);
-      void updateTagData(QByteArray* dest, const QByteArray& src);
-
-   private:
-      QTimer m_watchdog;
-      RFID_TagList m_tags;
-      RFID_Reader* m_reader;
-};
-
-#endif
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef RFID_H
+#define RFID_H
+
+#include "RFID_Global.h"
+#include "RFID_TagHistory.h"
+#include "RFID_TagStore.h"
+
+#include <QHash>
+#include <QMutex>
+#include <QTimer>
+#include <QAtomicInteger>
+
+class RFID_Reader;
+class RFID : public QObject
+{
+      Q_OBJECT
+
+   signals:
+      void tagUpdated();
+      void tagsChanged(const RFID_ChangeSet& changes);
+      void readerChanged();
+      void tagCountChanged();
+      void currentTagChanged();
+      void readerCalibrated(const RFID_Calibration& calibration);
+
+   public:
+      static RFID* getInstance();
+
+      int tagCount() const;
+      bool readerAccessible() const;
+      quint64 generation() const;
+
+      int pendingEvents() const;
+      int overloadPolicy() const;
+      int maxPendingEvents() const;
+
+      RFID_Reader* reader() const;
+      RFID_Tag* currentTag();
+
+      RFID_TagSnapshotPtr snapshot();
+      const RFID_TagList& rfidTags() const;
+      bool copyTag(const quint32 id, RFID_Tag* tag) const;
+      bool copyTag(const RFID_TagKey& tid, RFID_Tag* tag) const;
+      bool copyTag(const QByteArray& epc, RFID_Tag* tag) const;
+      QStringList rfidReaders() const;
+
+      QByteArray getUserData(const RFID_Tag* tag) const;
+      QString generateMemoryMap(const RFID_Tag* tag) const;
+      QVector<RFID_TagVersion> history(const RFID_Tag* tag) const;
+
+      QString writer() const;
+
+      bool writeEpc(const QByteArray& epc);
+      bool writeRfu(const QByteArray& rfu);
+      bool writeUserData(const QByteArray& userData);
+
+      void restore(const QVector<RFID_Tag>& tags);
+
+   public slots:
+      void clearHistory();
+      void setWriter(const QString& writer);
+      void unloadReader();
+      void setReader(const int index);
+      void setReader(RFID_Reader* newReader);
+      void setOverloadPolicy(const int policy);
+      void setMaxPendingEvents(const int maxEvents);
+
+      void lockTag();
+      void killTag();
+      void eraseTag();
+
+   private slots:
+      void scan();
+      void resetCurrentTag();
+      void processEvents();
+      void publishSnapshot();
+      void onEpcFound(const QByteArray& epc, const qint64 timestamp);
+      void onTidFound(const QByteArray& tid, const qint64 timestamp);
+      void onUsrFound(const QByteArray& usr, const int datagram,
+                      const qint64 timestamp);
+      void onRfuFound(const QByteArray& rfu, const qint64 timestamp);
+
+   private:
+      RFID();
+      ~RFID();
+
+      typedef struct {
+         quint32 field;
+         quint32 owner;
+         QByteArray data;
+         qint64 timestamp;
+         qint64 lastTimestamp;
+      } Event;
+
+      typedef struct {
+         quint32 fields;
+         QString writer;
+         qint64 expires;
+      } Write;
+
+      void enqueueEvent(const quint32 field,
+                        const QByteArray& data,
+                        const qint64 timestamp);
+      bool shedEvents(const Event& event);
+      void processEvent(const Event& event);
+
+      void processEpc(const QByteArray& epc, const qint64 timestamp);
+      void processTid(const QByteArray& tid, const qint64 timestamp);
+      void processUsr(const QByteArray& usr, const int datagram,
+                      const qint64 timestamp);
+      void processRfu(const QByteArray& rfu, const qint64 timestamp);
+
+      quint32 currentTagId();
+      void markModified(const RFID_Tag* tag, const quint32 fields);
+      void updateTagList(RFID_Tag* tag);
+      RFID_Tag* probeTag(const qint64 timestamp);
+      RFID_Tag* findTag(const RFID_Tag* tag) const;
+      void mergeTag(RFID_Tag* dest, const RFID_Tag* src);
+      void removeTag(RFID_Tag* tag);
+      void updateTagData(RFID_Tag* tag, const quint32 field, const QByteArray& src);
+      void updateTagKey(RFID_Tag* tag, const RFID_TagKey& key);
+      void updateTagTimestamps(RFID_Tag* tag, const qint64 timestamp);
+      void registerWrite(const quint32 fields);
+      QString writerOf(const RFID_Tag* tag, const quint32 field);
+
+   private:
+      QTimer m_watchdog;
+      RFID_Tag m_probe;
+      RFID_TagStore m_store;
+      RFID_Reader* m_reader;
+
+      QList<Event> m_events;
+      bool m_processPending;
+      int m_overloadPolicy;
+      int m_maxPendingEvents;
+
+      quint32 m_lastTagId;
+      QHash<quint32, quint32> m_changes;
+
+      QString m_writer;
+      QHash<quint32, Write> m_writes;
+      RFID_TagHistory m_history;
+
+      bool m_publishPending;
+      QMutex m_snapshotMutex;
+      RFID_TagSnapshotPtr m_snapshot;
+      QAtomicInteger<quint64> m_generation;
+};
+
+#endif
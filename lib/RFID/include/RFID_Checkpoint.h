@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef RFID_CHECKPOINT_H
+#define RFID_CHECKPOINT_H
+
+#include <QSet>
+#include <QTimer>
+#include <QObject>
+#include <QString>
+#include <QFutureWatcher>
+
+#include "RFID_Global.h"
+
+#define RFID_CHECKPOINT_VERSION     2
+#define RFID_CHECKPOINT_INTERVAL    5000
+#define RFID_CHECKPOINT_JOURNAL     (1024 * 1024)
+
+/**
+ * @brief The RFID_Checkpoint class
+ *
+ * Periodically saves the tag history of the @c RFID tag store to a compact
+ * binary checkpoint, and restores it when the checkpoint is opened, so that
+ * a station comes back with the tags of its previous session after a crash
+ * or an update restart, without re-scanning them.
+ *
+ * The checkpoint is written incrementally: the change sets of the tag store
+ * are used to track the tags that were modified or removed, and every
+ * @c RFID_CHECKPOINT_INTERVAL milliseconds only those tags are appended to a
+ * journal file (@c fileName() + ".journal"). Once the journal is larger than
+ * the base checkpoint (and @c RFID_CHECKPOINT_JOURNAL bytes), the journal is
+ * compacted: the complete tag list snapshot is written to the base file,
+ * which is replaced atomically, and the journal is emptied. Both operations
+ * run in a worker thread, and snapshots are immutable, so the reader keeps
+ * working while a checkpoint is written.
+ *
+ * Base checkpoints and journal entries carry a sequence number, so that the
+ * entries that were already compacted into the base file are skipped if a
+ * crash happens before the journal is emptied. Torn journal entries (e.g.
+ * after a power loss) are discarded when the checkpoint is opened.
+ *
+ * Restoring a checkpoint memory-maps the files and rebuilds the tags directly
+ * from the mapped records. Timestamps are stored as UTC times and converted
+ * back to the monotonic clock of the new session (see @c RFID_Clock).
+ */
+class RFID_Checkpoint : public QObject
+{
+      Q_OBJECT
+
+   public:
+      explicit RFID_Checkpoint(QObject* parent = Q_NULLPTR);
+      ~RFID_Checkpoint();
+
+      bool isOpen() const;
+      QString fileName() const;
+      QString errorString() const;
+
+      bool open(const QString& fileName);
+
+   public slots:
+      void save();
+      void close();
+
+   private slots:
+      void onSaved();
+      void onTagsChanged(const RFID_ChangeSet& changes);
+
+   private:
+      bool restore();
+      QString journalName() const;
+      QVector<quint32> takeDirtyTags();
+
+   private:
+      QTimer m_timer;
+      QString m_error;
+      QString m_fileName;
+
+      bool m_compact;
+      quint64 m_sequence;
+      QSet<quint32> m_dirty;
+      QFutureWatcher<QString> m_watcher;
+};
+
+#endif
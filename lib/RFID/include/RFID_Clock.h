@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef RFID_CLOCK_H
+#define RFID_CLOCK_H
+
+#include <QTimer>
+#include <QObject>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QAtomicInteger>
+
+#define RFID_CLOCK_CALIBRATION_INTERVAL  60 * 1000
+
+/**
+ * @brief The RFID_Clock class
+ *
+ * Provides the monotonic timestamps (in nanoseconds) that are attached to the
+ * data received from the RFID readers, and a calibrated mapping between the
+ * monotonic clock and the UTC wall clock.
+ *
+ * Monotonic timestamps are not affected by system clock adjustments, so they
+ * must be used to measure latencies and travel times. The UTC mapping is
+ * re-calibrated every @c RFID_CLOCK_CALIBRATION_INTERVAL milliseconds, so that
+ * it follows the adjustments applied to the system clock (e.g. by NTP).
+ */
+class RFID_Clock : public QObject
+{
+      Q_OBJECT
+
+   public:
+      static RFID_Clock* getInstance();
+
+      qint64 now() const;
+      qint64 offset() const;
+      qint64 uncertainty() const;
+      qint64 toUtc(const qint64 timestamp) const;
+      qint64 fromUtc(const qint64 utc) const;
+      QDateTime toDateTime(const qint64 timestamp) const;
+
+   public slots:
+      void calibrate();
+
+   private:
+      RFID_Clock();
+
+   private:
+      QTimer m_timer;
+      QElapsedTimer m_clock;
+      QAtomicInteger<qint64> m_offset;
+      QAtomicInteger<qint64> m_uncertainty;
+};
+
+#endif
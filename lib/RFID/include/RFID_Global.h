@@ -1,50 +1,173 @@
-/*
- * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
- *
- * Permission is hereby granted, free of charge, to any person obtaining a copy
- * of this software and associated documentation files (the "Software"), to deal
- * in the Software without restriction, including without limitation the rights
- * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
- * copies of the Software, and to permit persons to whom the Software is
- * furnished to do so, subject to the following conditions:
- *
- * The above copyright notice and this permission notice shall be included in
- * all copies or substantial portions of the Software.
- *
- * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
- * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
- * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
- * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
- * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
- * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
- * THE SOFTWARE.
- */
-
-#ifndef RFID_GLOBAL_H
-#define RFID_GLOBAL_H
-
-#include <QList>
-#include <QObject>
-#include <QByteArray>
-
-#define RFID_NUM_KEYS               2
-#define RFID_RFU_LENGTH             8
-#define RFID_EPC_LENGTH             12
-#define RFID_TID_LENGTH             12
-#define RFID_USER_LENGTH            64
-#define RFID_NUM_USER_DATAGRAMS     4
-#define RFID_CURRENT_TAG_TIMEOUT    1000
-#define RFID_MAX_SHIT_TRESHOLD      250
-#define RFID_MAX_BUFFER_SIZE        1024 * 16
-
-typedef struct {
-   QByteArray epc;
-   QByteArray tid;
-   QByteArray rfu;
-   QByteArray keys[RFID_NUM_KEYS];
-   QByteArray usr[RFID_NUM_USER_DATAGRAMS];
-} RFID_Tag;
-
-typedef QList<RFID_Tag*> RFID_TagList;
-
-#endif
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef RFID_GLOBAL_H
+#define RFID_GLOBAL_H
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QVector>
+#include <QByteArray>
+#include <QMetaType>
+#include <QSharedPointer>
+
+#define RFID_NUM_KEYS               2
+#define RFID_RFU_LENGTH             8
+#define RFID_EPC_LENGTH             12
+#define RFID_TID_LENGTH             12
+#define RFID_USER_LENGTH            64
+#define RFID_NUM_USER_DATAGRAMS     4
+#define RFID_CURRENT_TAG_TIMEOUT    1000
+#define RFID_MAX_SHIT_TRESHOLD      250
+#define RFID_SCAN_INTERVAL          (RFID_CURRENT_TAG_TIMEOUT / 50)
+#define RFID_MIN_SCAN_INTERVAL      5
+#define RFID_MAX_SCAN_INTERVAL      (RFID_CURRENT_TAG_TIMEOUT / 4)
+#define RFID_MAX_BUFFER_SIZE        1024 * 16
+#define RFID_MAX_PENDING_EVENTS     256
+#define RFID_EVENT_BATCH_SIZE       32
+
+/**
+ * Compact TID of a tag, TIDs of the same manufacturer and model share long
+ * prefixes, so the prefix is stored once in the @c RFID_TidTable and the key
+ * only keeps its ID and the serial number (the last 8 bytes of the TID).
+ *
+ * Tag identity is checked by comparing two 64-bit integers, a @a prefix
+ * of 0 means that the TID is unknown.
+ */
+typedef struct {
+   quint64 prefix;
+   quint64 serial;
+} RFID_TagKey;
+
+inline bool operator==(const RFID_TagKey& a, const RFID_TagKey& b)
+{
+   return a.prefix == b.prefix && a.serial == b.serial;
+}
+
+inline bool operator!=(const RFID_TagKey& a, const RFID_TagKey& b)
+{
+   return !(a == b);
+}
+
+inline uint qHash(const RFID_TagKey& key, uint seed = 0)
+{
+   return qHash(key.serial, seed) ^ static_cast<uint>(key.prefix);
+}
+
+inline bool RFID_ValidKey(const RFID_TagKey& key)
+{
+   return key.prefix != 0;
+}
+
+/**
+ * Data of a RFID tag, @a firstSeen and @a lastSeen are the monotonic
+ * timestamps (see @c RFID_Clock) of the first and latest reads of the tag
+ */
+typedef struct {
+   quint32 id;
+   qint64 firstSeen;
+   qint64 lastSeen;
+   QByteArray epc;
+   RFID_TagKey tid;
+   QByteArray rfu;
+   QByteArray keys[RFID_NUM_KEYS];
+   QByteArray usr[RFID_NUM_USER_DATAGRAMS];
+} RFID_Tag;
+
+typedef QList<RFID_Tag*> RFID_TagList;
+
+/**
+ * Read-only copy of the tag list at a given generation of the tag store,
+ * @a currentTag is the index of the current tag (or -1 if there is no
+ * current tag)
+ */
+typedef struct {
+   quint64 generation;
+   int currentTag;
+   QVector<RFID_Tag> tags;
+} RFID_TagSnapshot;
+
+typedef QSharedPointer<const RFID_TagSnapshot> RFID_TagSnapshotPtr;
+
+/**
+ * Tag fields reported by change sets, the user datagram N field is
+ * @c RFID_FIELD_USR << N
+ */
+enum RFID_TagField {
+   RFID_FIELD_EPC       = 0x0001,
+   RFID_FIELD_TID       = 0x0002,
+   RFID_FIELD_RFU       = 0x0004,
+   RFID_FIELD_USR       = 0x0008,
+   RFID_FIELD_PRESENCE  = 0x0100,
+   RFID_FIELD_ADDED     = 0x0200,
+   RFID_FIELD_REMOVED   = 0x0400,
+   RFID_FIELD_SEEN      = 0x0800
+};
+
+/**
+ * Fields that changed for the tag with the given @a tag id
+ */
+typedef struct {
+   quint32 tag;
+   quint32 fields;
+} RFID_TagChange;
+
+/**
+ * Changes applied to the tag store up to the given @a generation
+ */
+typedef struct {
+   quint64 generation;
+   QVector<RFID_TagChange> changes;
+} RFID_ChangeSet;
+
+Q_DECLARE_METATYPE(RFID_ChangeSet)
+
+/**
+ * Round-trip statistics of a RFID reader, measured by sending a burst of
+ * commands when the serial device is connected. Times are in microseconds,
+ * @a rate is the number of back-to-back commands answered per second and
+ * @a timeout is the response timeout (in milliseconds) derived from them.
+ */
+typedef struct {
+   int sent;
+   int received;
+   qint64 p50;
+   qint64 p99;
+   qint64 max;
+   double rate;
+   int timeout;
+} RFID_Calibration;
+
+Q_DECLARE_METATYPE(RFID_Calibration)
+
+/**
+ * Events that can be discarded when the queue of tag data pending to be
+ * processed is full, EPC and TID reads are never discarded
+ */
+enum RFID_OverloadPolicy {
+   RFID_SHED_NOTHING     = 0x00,
+   RFID_SHED_DUPLICATES  = 0x01,
+   RFID_SHED_BANK_READS  = 0x02
+};
+
+#endif
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef RFID_HEALTH_H
+#define RFID_HEALTH_H
+
+#include <QTimer>
+#include <QObject>
+
+#define RFID_HEALTH_WINDOW          1000
+#define RFID_HEALTH_SMOOTHING       30
+#define RFID_HEALTH_DEGRADED        60
+#define RFID_HEALTH_RECOVERED       85
+
+/**
+ * @brief The RFID_Health class
+ *
+ * Computes a rolling health score (0 to 100) of the link with a RFID reader
+ * from the events reported by its driver: packets with invalid checksums,
+ * commands that time out, re-synchronizations of the receive buffer (garbage
+ * or dropped data) and the drift of the round-trip time from the baseline
+ * measured when the reader was calibrated.
+ *
+ * A score is calculated for every @c RFID_HEALTH_WINDOW milliseconds, and is
+ * smoothed with an exponential moving average (the weight of the newest
+ * window is @c RFID_HEALTH_SMOOTHING percent). Windows without any traffic do
+ * not change the score.
+ *
+ * The link is considered degraded once the score drops below
+ * @c RFID_HEALTH_DEGRADED, and is considered healthy again once the score
+ * rises above @c RFID_HEALTH_RECOVERED, so that the driver does not switch
+ * back and forth between its scan plans.
+ */
+class RFID_Health : public QObject
+{
+      Q_OBJECT
+
+   signals:
+      void scoreChanged(const int score);
+      void degradedChanged(const bool degraded);
+
+   public:
+      explicit RFID_Health(QObject* parent = Q_NULLPTR);
+
+      int score() const;
+      bool degraded() const;
+      qint64 baseline() const;
+
+   public slots:
+      void reset();
+      void addPacket();
+      void addResync();
+      void addTimeout();
+      void addChecksumError();
+      void addResponse(const qint64 roundTrip);
+      void setBaseline(const qint64 roundTrip);
+
+   private slots:
+      void update();
+
+   private:
+      int m_score;
+      bool m_degraded;
+      qint64 m_baseline;
+      QTimer m_timer;
+
+      int m_packets;
+      int m_resyncs;
+      int m_timeouts;
+      int m_responses;
+      int m_checksumErrors;
+      qint64 m_roundTrips;
+};
+
+#endif
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef RFID_JOB_LEDGER_H
+#define RFID_JOB_LEDGER_H
+
+#include <QHash>
+#include <QFile>
+#include <QTimer>
+#include <QObject>
+#include <QByteArray>
+
+#define RFID_LEDGER_RECORD_SIZE     36
+#define RFID_LEDGER_TID_SIZE        16
+#define RFID_LEDGER_BATCH_SIZE      64
+#define RFID_LEDGER_COMMIT_INTERVAL 50
+
+/**
+ * Encoding state of a tag, states are ordered (a verified tag has been
+ * written, and a locked tag has been verified)
+ */
+enum RFID_JobState {
+   RFID_JOB_NONE      = 0,
+   RFID_JOB_PLANNED   = 1,
+   RFID_JOB_WRITTEN   = 2,
+   RFID_JOB_VERIFIED  = 3,
+   RFID_JOB_LOCKED    = 4
+};
+
+/**
+ * @brief The RFID_JobLedger class
+ *
+ * Persistent, append-only record of the encoding state of each tag (keyed by
+ * its TID) and of the job (row of the job queue) that was assigned to it, so
+ * that an interrupted encoding job can be resumed from the first unfinished
+ * job without re-encoding the tags (or re-using the data of the jobs) that
+ * were already done.
+ *
+ * The ledger file is a sequence of fixed-size records, each with its own
+ * checksum. Opening a ledger replays the records of the file (which is
+ * memory-mapped), a torn record left by a crash is detected by its checksum
+ * and truncated.
+ *
+ * Records are written with group commit: they are buffered and written to
+ * disk (followed by a single fsync) once @c RFID_LEDGER_BATCH_SIZE records
+ * are pending or @c RFID_LEDGER_COMMIT_INTERVAL milliseconds after the first
+ * pending record, whichever comes first. Call @c commit() to force a commit
+ * (e.g. before locking a tag). Recorded states are visible immediately, but
+ * they are only registered as committed once they are on disk; a failed
+ * commit is rolled back from the file and retried with the next commit.
+ */
+class RFID_JobLedger : public QObject
+{
+      Q_OBJECT
+
+   signals:
+      void committed(const int records);
+
+   public:
+      explicit RFID_JobLedger(QObject* parent = Q_NULLPTR);
+      ~RFID_JobLedger();
+
+      bool isOpen() const;
+      int tagCount() const;
+      int pendingCount() const;
+      QString fileName() const;
+      QString errorString() const;
+
+      bool open(const QString& fileName);
+      RFID_JobState state(const QByteArray& tid) const;
+      bool done(const QByteArray& tid,
+                const RFID_JobState target = RFID_JOB_VERIFIED) const;
+      RFID_JobState jobState(const int job) const;
+      bool jobDone(const int job,
+                   const RFID_JobState target = RFID_JOB_VERIFIED) const;
+
+   public slots:
+      void close();
+      bool commit();
+      void record(const QByteArray& tid,
+                  const RFID_JobState state,
+                  const int job = -1);
+
+   private:
+      bool replay();
+
+   private:
+      QFile m_file;
+      QTimer m_timer;
+      QString m_error;
+      int m_pendingRecords;
+      QByteArray m_pending;
+      QHash<int, quint8> m_jobs;
+      QHash<QByteArray, quint8> m_states;
+      QHash<int, quint8> m_pendingJobs;
+      QHash<QByteArray, quint8> m_pendingStates;
+};
+
+#endif
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef RFID_JOB_QUEUE_H
+#define RFID_JOB_QUEUE_H
+
+#include "RFID_Global.h"
+
+#include <QVector>
+#include <QString>
+#include <QByteArray>
+
+#define RFID_JOB_SIZE               (1 + RFID_EPC_LENGTH + RFID_USER_LENGTH)
+#define RFID_JOB_MIN_CHUNK_SIZE     (256 * 1024)
+#define RFID_JOB_MAX_ERRORS         1000
+
+/**
+ * Reasons for which a row of an encoding job is rejected
+ */
+enum RFID_JobRowError {
+   RFID_ROW_OK                = 0,
+   RFID_ROW_EMPTY             = 1,
+   RFID_ROW_INVALID_HEX       = 2,
+   RFID_ROW_ODD_LENGTH        = 3,
+   RFID_ROW_EPC_TOO_LONG      = 4,
+   RFID_ROW_USR_TOO_LONG      = 5,
+   RFID_ROW_TOO_MANY_COLUMNS  = 6
+};
+
+/**
+ * Invalid row of an encoding job, @a line starts at 1
+ */
+typedef struct {
+   int line;
+   int reason;
+} RFID_JobError;
+
+/**
+ * @brief The RFID_JobQueue class
+ *
+ * Compact binary queue of the data to write to each tag of an encoding job.
+ *
+ * Jobs are imported from CSV files with two columns: the EPC and the user
+ * data of each tag (in hexadecimal format, spaces are ignored). Empty fields
+ * are not written, and shorter data is padded with zeroes (as it is done when
+ * writing tags manually). The first line is ignored if it is not a valid row
+ * (e.g. a header).
+ *
+ * The CSV file is memory-mapped and split in chunks at line boundaries, the
+ * chunks are parsed and validated in parallel, and invalid rows are reported
+ * (up to @c RFID_JOB_MAX_ERRORS rows) before the job begins.
+ *
+ * Each job is stored as @c RFID_JOB_SIZE bytes: a flags byte, followed by the
+ * zero-padded EPC and user data.
+ */
+class RFID_JobQueue
+{
+   public:
+      RFID_JobQueue();
+
+      int count() const;
+      int errorCount() const;
+      QString errorString() const;
+      QVector<RFID_JobError> errors() const;
+      static QString reason(const int error);
+
+      bool hasEpc(const int index) const;
+      bool hasUserData(const int index) const;
+      QByteArray epc(const int index) const;
+      QByteArray userData(const int index) const;
+
+      void clear();
+      bool import(const QString& fileName);
+
+   private:
+      int m_errorCount;
+      QByteArray m_jobs;
+      QString m_errorString;
+      QVector<RFID_JobError> m_errors;
+};
+
+#endif
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef RFID_LOG_H
+#define RFID_LOG_H
+
+#include <QFile>
+#include <QMutex>
+#include <QVector>
+#include <QString>
+#include <QAtomicInteger>
+
+#include "RFID_LogArchive.h"
+
+#define RFID_LOG_QUEUE_SIZE         4096
+#define RFID_LOG_MAX_VALUES         4
+#define RFID_LOG_BLOCK_SIZE         (64 * 1024)
+#define RFID_LOG_SEGMENT_SIZE       (64 * 1024 * 1024)
+
+/**
+ * Subsystems that generate log records, each category has its own level
+ */
+enum RFID_LogCategory {
+   RFID_LOG_PROTOCOL    = 0,
+   RFID_LOG_SCHEDULER   = 1,
+   RFID_LOG_HEALTH      = 2,
+   RFID_LOG_SERIAL      = 3,
+   RFID_LOG_STORE       = 4,
+   RFID_LOG_CATEGORIES  = 5
+};
+
+/**
+ * Severity of a log record, a category logs the records with a level equal
+ * or higher than its own level (@c RFID_LOG_OFF disables the category)
+ */
+enum RFID_LogLevel {
+   RFID_LOG_DEBUG       = 0,
+   RFID_LOG_INFO        = 1,
+   RFID_LOG_WARNING     = 2,
+   RFID_LOG_ERROR       = 3,
+   RFID_LOG_OFF         = 4
+};
+
+/**
+ * Output format of the log sink
+ */
+enum RFID_LogFormat {
+   RFID_LOG_TEXT        = 0,
+   RFID_LOG_BINARY      = 1
+};
+
+/**
+ * Structured log record, @a message must be a string literal, its @c %1 to
+ * @c %4 placeholders are replaced with the @a values when the record is
+ * written by the sink. @a timestamp is a monotonic timestamp (see
+ * @c RFID_Clock).
+ */
+typedef struct {
+   qint64 timestamp;
+   const char* message;
+   qint64 values[RFID_LOG_MAX_VALUES];
+   quint8 category;
+   quint8 level;
+   quint8 count;
+} RFID_LogRecord;
+
+class RFID_LogSink;
+
+/**
+ * @brief The RFID_Log class
+ *
+ * Asynchronous structured logger, so that protocol and scheduler decisions
+ * can be logged from the hot path without blocking it.
+ *
+ * Producers (any thread) only check the level of the category and, if the
+ * record is enabled, copy it to a bounded lock-free queue. Formatting and
+ * I/O are done by a background sink thread, which writes the records as
+ * text (to the standard error output or to a file) or as binary records.
+ * Records are dropped (and counted) if the queue is full, the producers
+ * never wait for the sink.
+ *
+ * Use the @c RFID_LOG() macro to log records, records of disabled
+ * categories cost a single load and compare.
+ *
+ * Log files are rotated once they reach @c RFID_LOG_SEGMENT_SIZE bytes. The
+ * rotated segment is compressed by a worker thread into a block-indexed
+ * archive (see @c RFID_LogArchive), using the block boundaries and times
+ * registered by the sink while the segment was written.
+ */
+class RFID_Log
+{
+   public:
+      static RFID_Log* getInstance();
+
+      static inline bool enabled(const int category, const int level)
+      {
+         return level >= LEVELS[category].load();
+      }
+
+      static int level(const int category);
+      static void setLevel(const int category, const int level);
+      static void setLevel(const int level);
+
+      static QString levelName(const int level);
+      static QString categoryName(const int category);
+
+      QString fileName() const;
+      QString errorString() const;
+      bool setOutput(const QString& fileName,
+                     const RFID_LogFormat format = RFID_LOG_TEXT);
+
+      void flush();
+      void shutdown();
+      void push(const int category,
+                const int level,
+                const char* message,
+                const qint64* values,
+                const int count);
+
+      template<typename... Args>
+      inline void log(const int category,
+                      const int level,
+                      const char* message,
+                      Args... args)
+      {
+         static_assert(sizeof...(Args) <= RFID_LOG_MAX_VALUES,
+                       "Too many log record values");
+
+         const qint64 values[] = {0, static_cast<qint64>(args)...};
+         push(category, level, message, values + 1, sizeof...(Args));
+      }
+
+   private:
+      RFID_Log();
+
+      void rotate();
+      bool openFile(const QString& fileName, const RFID_LogFormat format);
+
+      bool pop(RFID_LogRecord* record);
+      void write(const RFID_LogRecord& record);
+      void writeData(const QByteArray& data, const qint64 utc);
+
+      typedef struct {
+         QAtomicInteger<quint32> sequence;
+         RFID_LogRecord record;
+      } Slot;
+
+   private:
+      static QAtomicInteger<int> LEVELS[RFID_LOG_CATEGORIES];
+
+      QFile m_file;
+      QString m_error;
+      qint64 m_written;
+      QMutex m_outputMutex;
+      RFID_LogFormat m_format;
+      QVector<RFID_LogBlock> m_blocks;
+
+      quint32 m_tail;
+      RFID_LogSink* m_sink;
+      QAtomicInteger<quint32> m_head;
+      Slot m_slots[RFID_LOG_QUEUE_SIZE];
+};
+
+#define RFID_LOG(category, level, ...) \
+   do { \
+      if(Q_UNLIKELY(RFID_Log::enabled(category, level))) \
+         RFID_Log::getInstance()->log(category, level, __VA_ARGS__); \
+   } while(0)
+
+#endif
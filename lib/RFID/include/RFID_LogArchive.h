@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef RFID_LOG_ARCHIVE_H
+#define RFID_LOG_ARCHIVE_H
+
+#include <QFile>
+#include <QVector>
+#include <QString>
+#include <QByteArray>
+
+#define RFID_LOG_ARCHIVE_VERSION    1
+
+/**
+ * Range of a log segment that is compressed as a single block, @a first and
+ * @a last are the UTC times (in microseconds) of the first and last records
+ * of the block (0 if unknown)
+ */
+typedef struct {
+   qint64 offset;
+   qint64 first;
+   qint64 last;
+} RFID_LogBlock;
+
+/**
+ * @brief The RFID_LogArchive class
+ *
+ * Compressed archive of a rotated log segment (see @c RFID_Log).
+ *
+ * The segment is split in blocks at record boundaries, and each block is
+ * compressed on its own (with zlib, see @c qCompress()). The archive ends
+ * with an index that has the time range, offset and size of every block, so
+ * a reader can memory-map the archive, find the blocks of a time range with
+ * a binary search and only inflate those blocks.
+ *
+ * The decompressed blocks of an archive are the bytes of the original
+ * segment, in the format of the log (text lines or binary records, the
+ * first block of a binary segment begins with the log magic bytes).
+ */
+class RFID_LogArchive
+{
+   public:
+      RFID_LogArchive();
+      ~RFID_LogArchive();
+
+      bool isOpen() const;
+      int format() const;
+      int blockCount() const;
+      QString errorString() const;
+
+      qint64 blockStart(const int index) const;
+      qint64 blockEnd(const int index) const;
+      int findBlock(const qint64 utc) const;
+      QByteArray block(const int index) const;
+
+      bool open(const QString& fileName);
+      void close();
+
+      static bool compress(const QString& segment,
+                           const QVector<RFID_LogBlock>& blocks,
+                           const int format,
+                           const QString& fileName,
+                           QString* error = Q_NULLPTR);
+
+   private:
+      const uchar* indexEntry(const int index) const;
+
+   private:
+      QFile m_file;
+      QString m_error;
+
+      int m_format;
+      int m_blockCount;
+      qint64 m_size;
+      const uchar* m_data;
+};
+
+#endif
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef RFID_PROFILER_H
+#define RFID_PROFILER_H
+
+#include <QHash>
+#include <QMutex>
+#include <QTimer>
+#include <QVector>
+#include <QObject>
+#include <QElapsedTimer>
+#include <QAtomicInteger>
+
+#define RFID_PROFILER_HEARTBEAT     5
+#define RFID_PROFILER_SAMPLES       1024
+
+/**
+ * Timing statistics of a single probe, all times are in microseconds
+ */
+typedef struct {
+   QString name;
+   qint64 calls;
+   qint64 total;
+   qint64 p50;
+   qint64 p95;
+   qint64 p99;
+   qint64 max;
+} RFID_ProbeStats;
+
+typedef QList<RFID_ProbeStats> RFID_ProbeStatsList;
+
+/**
+ * Current value of an event counter or gauge
+ */
+typedef struct {
+   QString name;
+   qint64 value;
+} RFID_Counter;
+
+typedef QList<RFID_Counter> RFID_CounterList;
+
+/**
+ * @brief The RFID_Profiler class
+ *
+ * Measures the lag of the main event loop with a high-frequency heartbeat
+ * timer and collects the run time of the slots that are instrumented with
+ * the @c RFID_PROFILE() macro.
+ *
+ * Each probe keeps a ring of the last @c RFID_PROFILER_SAMPLES samples, so
+ * that percentiles reflect the recent behaviour of the application.
+ *
+ * Profiling is disabled by default (it is enabled from the diagnostics
+ * tab), the heartbeat timer only runs while profiling is enabled. The
+ * enabled flag is atomic, since probes are also used by worker threads.
+ *
+ * The profiler also keeps named counters (e.g. overload metrics), counters
+ * are always registered, even if profiling is disabled.
+ */
+class RFID_Profiler : public QObject
+{
+      Q_OBJECT
+
+   public:
+      static RFID_Profiler* getInstance();
+
+      static inline bool enabled()
+      {
+         return ENABLED.load() != 0;
+      }
+
+      RFID_ProbeStatsList stats() const;
+      RFID_CounterList counters() const;
+      void addSample(const char* probe, const qint64 usecs);
+      void addCount(const char* counter, const qint64 count = 1);
+      void setCounter(const char* counter, const qint64 value);
+      void setCounterMax(const char* counter, const qint64 value);
+
+   public slots:
+      void reset();
+      void setEnabled(const bool enabled);
+
+   private slots:
+      void onHeartbeat();
+
+   private:
+      RFID_Profiler();
+
+      typedef struct {
+         int next;
+         qint64 calls;
+         qint64 total;
+         qint64 max;
+         QVector<qint64> samples;
+      } Probe;
+
+   private:
+      static QAtomicInteger<int> ENABLED;
+
+      qint64 m_lastBeat;
+      QTimer m_heartbeat;
+      QElapsedTimer m_clock;
+
+      mutable QMutex m_mutex;
+      QHash<QByteArray, Probe> m_probes;
+      QHash<QByteArray, qint64> m_counters;
+};
+
+/**
+ * @brief The RFID_ProfilerScope class
+ *
+ * Measures the time elapsed between its construction and its destruction and
+ * registers it as a sample of the given probe. Nested calls are included in
+ * the measured time.
+ */
+class RFID_ProfilerScope
+{
+   public:
+      explicit inline RFID_ProfilerScope(const char* probe) : m_probe(probe)
+      {
+         if(RFID_Profiler::enabled())
+            m_timer.start();
+      }
+
+      inline ~RFID_ProfilerScope()
+      {
+         if(m_timer.isValid())
+            RFID_Profiler::getInstance()->addSample(m_probe,
+                                                    m_timer.nsecsElapsed() / 1000);
+      }
+
+   private:
+      const char* m_probe;
+      QElapsedTimer m_timer;
+};
+
+#define RFID_PROFILE(probe) RFID_ProfilerScope _rfid_profiler_scope(probe)
+
+#endif
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef RFID_SCHEDULER_H
+#define RFID_SCHEDULER_H
+
+#include <QQueue>
+#include <QTimer>
+#include <QVector>
+#include <QObject>
+#include <QByteArray>
+
+#include "RFID_Global.h"
+
+#define RFID_SCHEDULER_TIMEOUT      100
+#define RFID_SCHEDULER_MIN_TIMEOUT  10
+#define RFID_SCHEDULER_MAX_SKIPS    4
+#define RFID_CALIBRATION_COMMANDS   32
+#define RFID_CALIBRATION_TIMEOUT    500
+#define RFID_CALIBRATION_MARGIN     3
+
+/**
+ * Command lanes of the scheduler, sorted by priority (highest first)
+ */
+enum RFID_CommandLane {
+   RFID_LANE_CONTROL        = 0,
+   RFID_LANE_WRITE          = 1,
+   RFID_LANE_TARGETED_READ  = 2,
+   RFID_LANE_INVENTORY      = 3,
+   RFID_NUM_LANES           = 4
+};
+
+/**
+ * @brief The RFID_Scheduler class
+ *
+ * Serializes the commands sent to a RFID reader, so that only one command is
+ * waiting for a response at any given time. Commands are queued in priority
+ * lanes: control commands are always sent first, and the other lanes are
+ * served by priority, with a lower priority lane being served once it has
+ * been skipped @c RFID_SCHEDULER_MAX_SKIPS times in a row (so that the tag
+ * scanner keeps working while writes are being sent).
+ *
+ * The reader driver must call @c responseReceived() when a response packet
+ * is received, otherwise the next command is sent once the current command
+ * times out.
+ *
+ * Every queued command gets an operation ID, which can be used to cancel it.
+ * Commands can also be associated to the tag that they target (the owner),
+ * so that all the commands of a tag are cancelled when the tag leaves the
+ * field. If the cancelled command is waiting for its response, the reader
+ * driver must discard the response (see @c currentCancelled()).
+ *
+ * The round-trip time (in microseconds) of every answered command is
+ * registered by the profiler and reported with the @c commandAnswered()
+ * signal, commands that are not answered in time are reported (with their
+ * operation ID) with the @c commandTimedOut() signal.
+ *
+ * The @c calibrate() function sends a burst of commands (holding back every
+ * lane until the burst is complete) to measure the round-trip distribution
+ * and command rate of the reader, and derives the response timeout from
+ * them.
+ */
+class RFID_Scheduler : public QObject
+{
+      Q_OBJECT
+
+   signals:
+      void commandTimedOut(const quint32 operation);
+      void commandAnswered(const qint64 roundTrip);
+      void calibrated(const RFID_Calibration& calibration);
+
+   public:
+      explicit RFID_Scheduler(QObject* parent = Q_NULLPTR);
+
+      bool idle() const;
+      bool calibrating() const;
+      int timeout() const;
+      int pendingCommands(const RFID_CommandLane lane) const;
+      bool pending(const quint32 operation) const;
+
+      bool currentCancelled() const;
+      QByteArray currentFrame() const;
+      quint32 currentOperation() const;
+
+      quint32 enqueue(const RFID_CommandLane lane,
+                      const QByteArray& frame,
+                      const quint32 owner = 0,
+                      const bool coalesce = false);
+
+      void calibrate(const QByteArray& frame,
+                     const int commands = RFID_CALIBRATION_COMMANDS);
+
+   public slots:
+      void clear();
+      void responseReceived();
+      void setTimeout(const int timeout);
+      void cancel(const quint32 operation);
+      void cancelOwner(const quint32 owner);
+
+   private slots:
+      void onTimeout();
+
+   private:
+      bool send();
+      void dispatch();
+      void finishCalibration();
+
+      typedef struct {
+         quint32 id;
+         quint32 owner;
+         QByteArray frame;
+         qint64 timestamp;
+      } Command;
+
+   private:
+      bool m_inFlight;
+      bool m_cancelled;
+      Command m_current;
+      qint64 m_sentAt;
+      quint32 m_lastOperation;
+      QTimer m_timer;
+      int m_skipped[RFID_NUM_LANES];
+      QQueue<Command> m_lanes[RFID_NUM_LANES];
+
+      bool m_calibrating;
+      int m_calibrationSent;
+      int m_calibrationCommands;
+      qint64 m_calibrationStart;
+      QByteArray m_calibrationFrame;
+      QVector<qint64> m_roundTrips;
+};
+
+#endif
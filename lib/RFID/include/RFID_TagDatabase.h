@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef RFID_TAG_DATABASE_H
+#define RFID_TAG_DATABASE_H
+
+#include <QHash>
+#include <QTimer>
+#include <QThread>
+#include <QObject>
+#include <QVector>
+#include <QSqlQuery>
+#include <QSqlDatabase>
+
+#include "RFID_Global.h"
+
+#define RFID_DB_BATCH_SIZE          256
+#define RFID_DB_FLUSH_INTERVAL      250
+
+/**
+ * @brief The RFID_TagDatabaseWriter class
+ *
+ * Writes the changes of the tag store to the history database, this object
+ * lives in the database thread (see @c RFID_TagDatabase).
+ */
+class RFID_TagDatabaseWriter : public QObject
+{
+      Q_OBJECT
+
+   public:
+      explicit RFID_TagDatabaseWriter(const QString& connection);
+
+      QString errorString() const;
+
+   public slots:
+      bool open(const QString& fileName);
+      void close();
+      bool flush();
+      void onTagsChanged(const RFID_ChangeSet& changes);
+
+   private:
+      bool exec(const QString& statement);
+
+      typedef struct {
+         quint32 tag;
+         quint32 fields;
+         qint64 time;
+         QByteArray epc;
+         QByteArray tid;
+      } Event;
+
+   private:
+      qint64 m_session;
+      QString m_error;
+      QString m_connection;
+
+      QTimer m_timer;
+      QSqlQuery m_tagQuery;
+      QSqlQuery m_eventQuery;
+
+      QVector<Event> m_events;
+      QHash<quint32, RFID_Tag> m_tags;
+};
+
+/**
+ * @brief The RFID_TagDatabase class
+ *
+ * Optional SQLite history of the tag store (enabled with the @c rfid_sqlite
+ * qmake configuration option), so that the history of a station can be
+ * queried offline.
+ *
+ * The database has a @c tags table with the latest data of every tag, and an
+ * @c events table with the changes of each tag (added, data changed, presence
+ * changed or removed), both indexed by EPC, TID and time. Rows are tagged with
+ * the session (the UTC time at which the database was opened), since tag IDs
+ * are only unique within a session.
+ *
+ * The database is written by its own thread, which receives the change sets
+ * of the tag store and reads the changed tags from the published snapshots,
+ * so the reader is never blocked by database inserts. Changes are written
+ * with prepared statements in batched transactions, once
+ * @c RFID_DB_BATCH_SIZE changes are pending or @c RFID_DB_FLUSH_INTERVAL
+ * milliseconds after the first pending change. The database is opened in WAL
+ * mode, so it can be queried while the application is running.
+ */
+class RFID_TagDatabase : public QObject
+{
+      Q_OBJECT
+
+   public:
+      explicit RFID_TagDatabase(QObject* parent = Q_NULLPTR);
+      ~RFID_TagDatabase();
+
+      bool isOpen() const;
+      QString errorString() const;
+
+      bool open(const QString& fileName);
+
+   public slots:
+      void close();
+
+   private:
+      QThread m_thread;
+      QString m_error;
+      RFID_TagDatabaseWriter* m_writer;
+};
+
+#endif
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef RFID_TAG_HISTORY_H
+#define RFID_TAG_HISTORY_H
+
+#include "RFID_Global.h"
+
+#include <QHash>
+#include <QVector>
+#include <QString>
+#include <QStringList>
+
+#define RFID_HISTORY_DEPTH          16
+#define RFID_HISTORY_WRITE_TIMEOUT  5000
+
+/**
+ * Version of a memory bank of a tag, @a field is the changed tag field
+ * (see @c RFID_TagField), @a timestamp is the monotonic time of the change
+ * (see @c RFID_Clock) and @a writer is the identity of the application
+ * component that wrote the data (empty if the change was not written by
+ * this application)
+ */
+typedef struct {
+   qint64 timestamp;
+   quint32 field;
+   QString writer;
+   QByteArray before;
+   QByteArray after;
+} RFID_TagVersion;
+
+/**
+ * @brief The RFID_TagHistory class
+ *
+ * Keeps the previous contents of the memory banks (EPC, RFU and user
+ * datagrams) of each tag, so that re-encoded tags keep an audit trail.
+ *
+ * Each change is stored as a backward delta: the 16-bit memory words that
+ * changed, with their previous value. Older versions are rebuilt by
+ * applying the deltas to the current data of the tag, from the newest to the
+ * oldest change.
+ *
+ * Only the latest @c RFID_HISTORY_DEPTH changes of each tag are kept, and
+ * writer identities are interned so that each change only stores an index.
+ */
+class RFID_TagHistory
+{
+   public:
+      RFID_TagHistory();
+
+      int count(const quint32 tag) const;
+      qint64 size() const;
+      QVector<RFID_TagVersion> versions(const RFID_Tag& tag) const;
+
+      void clear();
+      void remove(const quint32 tag);
+      void record(const quint32 tag,
+                  const quint32 field,
+                  const QByteArray& before,
+                  const QByteArray& after,
+                  const qint64 timestamp,
+                  const QString& writer);
+
+   private:
+      typedef struct {
+         qint64 timestamp;
+         quint32 field;
+         int writer;
+         QByteArray delta;
+      } Delta;
+
+   private:
+      qint64 m_size;
+      QStringList m_writers;
+      QHash<quint32, QVector<Delta>> m_deltas;
+};
+
+#endif
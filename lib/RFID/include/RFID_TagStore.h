@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef RFID_TAG_STORE_H
+#define RFID_TAG_STORE_H
+
+#include "RFID_Global.h"
+
+#include <QHash>
+#include <QVector>
+#include <QReadWriteLock>
+
+/**
+ * @brief The RFID_TagStore class
+ *
+ * Registry of the tags of the tag history, keeps the tags in the order in
+ * which they were registered and indexes them by ID, TID and EPC.
+ *
+ * Tags are registered, modified and deleted only by the thread that owns the
+ * store (the thread of the @c RFID class, which processes the data of every
+ * reader), so that the owner thread can read the registered tags directly.
+ * Every modification is done while holding the write lock of the store, so
+ * that any other thread can obtain a consistent copy of a tag with the
+ * @c copy() functions.
+ *
+ * The store remembers the TIDs and EPCs indexed for each tag, so that
+ * removing a tag does not need to scan the indexes.
+ */
+class RFID_TagStore
+{
+   public:
+      RFID_TagStore();
+
+      int count() const;
+      const RFID_TagList& tags() const;
+      RFID_Tag* find(const RFID_TagKey& tid) const;
+      RFID_Tag* find(const QByteArray& epc) const;
+
+      bool copy(const quint32 id, RFID_Tag* tag) const;
+      bool copy(const RFID_TagKey& tid, RFID_Tag* tag) const;
+      bool copy(const QByteArray& epc, RFID_Tag* tag) const;
+
+      void clear();
+      void index(RFID_Tag* tag);
+      void insert(RFID_Tag* tag);
+      void remove(RFID_Tag* tag);
+
+      bool update(RFID_Tag* tag,
+                  const quint32 field,
+                  const QByteArray& data,
+                  QByteArray* previous = Q_NULLPTR);
+      bool updateKey(RFID_Tag* tag, const RFID_TagKey& key);
+      bool updateTimestamps(RFID_Tag* tag, const qint64 timestamp);
+
+   private:
+      typedef struct {
+         QVector<RFID_TagKey> tids;
+         QVector<QByteArray> epcs;
+      } Keys;
+
+      bool copyTag(const RFID_Tag* source, RFID_Tag* tag) const;
+
+   private:
+      mutable QReadWriteLock m_lock;
+
+      RFID_TagList m_list;
+      QHash<quint32, RFID_Tag*> m_tags;
+      QHash<RFID_TagKey, RFID_Tag*> m_tids;
+      QHash<QByteArray, RFID_Tag*> m_epcs;
+      QHash<const RFID_Tag*, Keys> m_keys;
+};
+
+#endif
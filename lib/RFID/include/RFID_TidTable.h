@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef RFID_TID_TABLE_H
+#define RFID_TID_TABLE_H
+
+#include "RFID_Global.h"
+
+#include <QHash>
+#include <QVector>
+#include <QReadWriteLock>
+
+#include <cstring>
+
+#define RFID_TID_SERIAL_LENGTH      8
+#define RFID_TID_MAX_LENGTH         32
+
+/**
+ * Fixed-size copy of a TID prefix, followed by the length of the serial
+ * number, so that the prefix of a TID can be looked up without allocating
+ */
+typedef struct {
+   int length;
+   char data[RFID_TID_MAX_LENGTH - RFID_TID_SERIAL_LENGTH + 1];
+} RFID_TidPrefix;
+
+inline bool operator==(const RFID_TidPrefix& a, const RFID_TidPrefix& b)
+{
+   return a.length == b.length
+          && memcmp(a.data, b.data, static_cast<size_t>(a.length)) == 0;
+}
+
+inline uint qHash(const RFID_TidPrefix& prefix, uint seed = 0)
+{
+   return qHashBits(prefix.data, static_cast<size_t>(prefix.length), seed);
+}
+
+/**
+ * @brief The RFID_TidTable class
+ *
+ * Interns the TID prefixes (manufacturer, model and any other bytes before
+ * the serial number) of the tags, so that each tag only needs to store a
+ * @c RFID_TagKey instead of a heap-allocated copy of its TID.
+ *
+ * Prefixes are never removed, and the table can be accessed from any thread.
+ * TIDs longer than @c RFID_TID_MAX_LENGTH bytes are not supported.
+ */
+class RFID_TidTable
+{
+   public:
+      static RFID_TidTable* getInstance();
+
+      int prefixCount() const;
+      RFID_TagKey intern(const QByteArray& tid);
+      QByteArray tid(const RFID_TagKey& key) const;
+
+   private:
+      RFID_TidTable();
+
+   private:
+      mutable QReadWriteLock m_lock;
+      QVector<QByteArray> m_prefixes;
+      QHash<RFID_TidPrefix, quint64> m_ids;
+};
+
+#endif
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef RFID_USER_SCHEMA_H
+#define RFID_USER_SCHEMA_H
+
+#include "RFID_Global.h"
+
+#include <QVector>
+#include <QString>
+#include <QStringList>
+
+/**
+ * Types of the fields of the user memory, numeric fields are up to 8 bytes
+ * wide, @c RFID_USER_BCD fields are decoded as decimal numbers (e.g. a date
+ * code @c 0x24 @c 0x05 @c 0x18 is decoded as 240518) and
+ * @c RFID_USER_FLAG fields are a single bit of a byte.
+ */
+enum RFID_UserFieldType {
+   RFID_USER_UINT  = 0,
+   RFID_USER_INT   = 1,
+   RFID_USER_BCD   = 2,
+   RFID_USER_FLAG  = 3,
+   RFID_USER_ASCII = 4,
+   RFID_USER_HEX   = 5
+};
+
+/**
+ * Comparison operators of the filter predicates
+ */
+enum RFID_UserOperator {
+   RFID_USER_NONZERO = 0,
+   RFID_USER_ZERO    = 1,
+   RFID_USER_EQ      = 2,
+   RFID_USER_NE      = 3,
+   RFID_USER_LT      = 4,
+   RFID_USER_LE      = 5,
+   RFID_USER_GT      = 6,
+   RFID_USER_GE      = 7
+};
+
+/**
+ * Compiled field of the user memory schema, the @a offset is relative to
+ * the beginning of the user memory (datagram N begins at offset
+ * N * RFID_USER_LENGTH / RFID_NUM_USER_DATAGRAMS)
+ */
+typedef struct {
+   quint8 type;
+   quint8 offset;
+   quint8 width;
+   quint8 bit;
+   bool littleEndian;
+} RFID_UserField;
+
+/**
+ * Compiled filter predicate, @a text is only used by text fields
+ */
+typedef struct {
+   int field;
+   int op;
+   qint64 value;
+   QByteArray text;
+} RFID_UserPredicate;
+
+/**
+ * @brief The RFID_UserSchema class
+ *
+ * Decodes the structured records (lot numbers, date codes, flags...) stored
+ * in the user memory of the tags.
+ *
+ * The schema is defined in a JSON file with a @c fields array, e.g.:
+ *
+ * @code
+ * { "fields": [
+ *     { "name": "Lot",  "type": "uint", "offset": 0, "width": 4 },
+ *     { "name": "Date", "type": "bcd",  "offset": 4, "width": 3 },
+ *     { "name": "Qty",  "type": "int",  "offset": 7, "width": 2,
+ *       "endian": "little" },
+ *     { "name": "Sold", "type": "flag", "offset": 9, "bit": 0 },
+ *     { "name": "SKU",  "type": "ascii", "offset": 10, "width": 8 }
+ * ] }
+ * @endcode
+ *
+ * The schema is compiled once into a flat array of fields, numeric fields
+ * are read directly from the user datagrams of the tag, without copying
+ * the user memory or allocating memory for each field.
+ *
+ * Filters are expressions such as <tt>Lot == 1234 && Date >= 240101 &&
+ * Sold</tt>, they are compiled into a list of predicates that are evaluated
+ * for every tag of the history table.
+ */
+class RFID_UserSchema
+{
+   public:
+      RFID_UserSchema();
+
+      int count() const;
+      bool isEmpty() const;
+      bool hasFilter() const;
+      QString errorString() const;
+      QStringList names() const;
+      int indexOf(const QString& name) const;
+
+      bool value(const RFID_Tag& tag, const int field, qint64* value) const;
+      QString text(const RFID_Tag& tag, const int field) const;
+      bool matches(const RFID_Tag& tag) const;
+
+      void clear();
+      bool load(const QString& fileName);
+      bool compile(const QByteArray& json);
+      bool setFilter(const QString& expression);
+
+   private:
+      QString m_errorString;
+      QStringList m_names;
+      QVector<RFID_UserField> m_fields;
+      QVector<RFID_UserPredicate> m_filter;
+};
+
+#endif
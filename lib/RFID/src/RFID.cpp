@@ -1,701 +1,1535 @@
-/*
- * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
- *
- * Permission is hereby granted, free of charge, to any person obtaining a copy
- * of this software and associated documentation files (the "Software"), to deal
- * in the Software without restriction, including without limitation the rights
- * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
- * copies of the Software, and to permit persons to whom the Software is
- * furnished to do so, subject to the following conditions:
- *
- * The above copyright notice and this permission notice shall be included in
- * all copies or substantial portions of the Software.
- *
- * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
- * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
- * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
- * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
- * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
- * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
- * THE SOFTWARE.
- */
-
-//------------------------------------------------------------------------------
-// Library headers
-//------------------------------------------------------------------------------
-
-#include "RFID.h"
-#include "RFID_Reader.h"
-#include "RFID_SerialManager.h"
-
-//------------------------------------------------------------------------------
-// RFID Reader Drivers
-//------------------------------------------------------------------------------
-
-#include "SM_6210.h"
-
-//------------------------------------------------------------------------------
-// Qt libraries
-//------------------------------------------------------------------------------
-
-#include <cstdio>
-#include <cstdlib>
-
-#include <QTimer>
-#include <QMessageBox>
-
-//------------------------------------------------------------------------------
-// Utility functions
-//------------------------------------------------------------------------------
-
-static QString HexDump(const char* data, size_t size)
-{
-   char str[4096] = "";
-   char ascii[17];
-
-   size_t i, j;
-   ascii[16] = '\0';
-   for(i = 0; i < size; ++i) {
-      sprintf(str + strlen(str), "%02X ", static_cast<quint8>(data[i]));
-
-      if(data[i] >= ' ' &&  data[i] <= '~')
-         ascii[i % 16] = data[i];
-      else
-         ascii[i % 16] = '.';
-
-      if((i+1) % 8 == 0 || i+1 == size) {
-         sprintf(str + strlen(str), " ");
-         if((i+1) % 16 == 0)
-            sprintf(str + strlen(str), "|  %s \n", ascii);
-
-         else if(i+1 == size) {
-            ascii[(i+1) % 16] = '\0';
-
-            if((i+1) % 16 <= 8)
-               sprintf(str + strlen(str), " ");
-            for(j = (i+1) % 16; j < 16; ++j)
-               sprintf(str + strlen(str), "   ");
-
-            sprintf(str + strlen(str), "|  %s \n", ascii);
-         }
-      }
-   }
-
-   return QString(str);
-}
-
-//------------------------------------------------------------------------------
-// Constructor, destructor & instance access functions
-//------------------------------------------------------------------------------
-
-/**
- * Pointer to the only instance of the @c RFID_Bridge class
- */
-static RFID* INSTANCE = Q_NULLPTR;
-
-/**
- * @brief RFID_Bridge::RFID_Bridge
- *
- * Initializes internal variables and begins the periodic scan loop
- */
-RFID::RFID()
-{
-   // Set null reader
-   m_reader = Q_NULLPTR;
-
-   // Configure watchdog timer
-   m_watchdog.setInterval(RFID_CURRENT_TAG_TIMEOUT);
-   connect(&m_watchdog, &QTimer::timeout, this, &RFID::resetCurrentTag);
-
-   // Start scanner & watchdog timer
-   QTimer::singleShot(1000, this, SLOT(scan()));
-   QTimer::singleShot(1000, &m_watchdog, SLOT(start()));
-}
-
-/**
- * @brief RFID_Bridge::~RFID_Bridge
- *
- * Destroys the current RFID reader class before the @c RFID_Bridge class
- * is destroyed
- */
-RFID::~RFID()
-{
-   unloadReader();
-}
-
-/**
- * @brief RFID_Bridge::getInstance
- * @returns the only instance of the @a RFID_Bridge class
- */
-RFID* RFID::getInstance()
-{
-   if(INSTANCE == Q_NULLPTR)
-      INSTANCE = new RFID;
-
-   return INSTANCE;
-}
-
-//------------------------------------------------------------------------------
-// Misc. info access functions
-//------------------------------------------------------------------------------
-
-/**
- * @brief RFID_Bridge::chipCount
- * @returns the number of tags read by the current RFID reader
- */
-int RFID::tagCount() const
-{
-   return rfidTags().count();
-}
-
-/**
- * @brief RFID_Bridge::readerAccessible
- * @returns @c true if a RFID reader driver is loaded and the current RFID
- *          reader is ready to be used
- */
-bool RFID::readerAccessible() const
-{
-   if(reader() != Q_NULLPTR)
-      return reader()->loaded();
-
-   return false;
-}
-
-/**
- * @brief RFID_Bridge::reader
- * @returns a pointer to the current RFID reader driver
- */
-RFID_Reader* RFID::reader() const
-{
-   return m_reader;
-}
-
-/**
- * @brief RFID_Bridge::currentTag
- * @returns a pointer to the current RFID tag being scanned/written by the
- *          RFID reader
- */
-RFID_Tag* RFID::currentTag()
-{
-   if(reader())
-      return reader()->currentTag();
-
-   return Q_NULLPTR;
-}
-
-/**
- * @brief RFID_Bridge::rfidTags
- * @returns a list of RFIDS tags found by the RFID reader
- */
-RFID_TagList RFID::rfidTags() const
-{
-   return m_tags;
-}
-
-/**
- * @brief RFID_Bridge::rfidReaders
- * @returns a list with supported RFID reader devices
- */
-QStringList RFID::rfidReaders() const
-{
-   return QStringList {
-      "SM-6210 USB UHF RFID Programmer",
-      "RDM530 USB UART HF RFID Programmer"
-   };
-}
-
-/**
- * @brief RFID::getUserData
- * Generates a @c QByteArray from all the user data sections of the given @a
- * tag.
- */
-QByteArray RFID::getUserData(const RFID_Tag* tag) const
-{
-   Q_ASSERT(tag);
-
-   QByteArray data;
-   for(int i = 0; i < RFID_NUM_USER_DATAGRAMS; ++i)
-      data.append(tag->usr[i]);
-
-   return data;
-}
-
-/**
- * @brief RFID::generateMemoryMap
- * @param tag
- * @returns a string with all the data found in the given RFID @a tag
- */
-QString RFID::generateMemoryMap(const RFID_Tag* tag) const
-{
-   Q_ASSERT(tag);
-
-   // Init dump string
-   QString dump;
-
-   // Add tag ID data
-   dump.append(tr("# Tag ID (%1 bytes)\n").arg(tag->tid.length()));
-   dump.append(HexDump(
-                  tag->tid.constData(),
-                  static_cast<size_t>(tag->tid.length())));
-   dump.append("\n");
-
-   // Add EPC data
-   dump.append(tr("# EPC (%1 bytes)\n").arg(tag->epc.length()));
-   dump.append(HexDump(
-                  tag->epc.constData(),
-                  static_cast<size_t>(tag->epc.length())));
-   dump.append("\n");
-
-   // Add user data
-   QByteArray usr = getUserData(tag);
-   dump.append(tr("# User data (%1 bytes)\n").arg(usr.length()));
-   dump.append(HexDump(
-                  usr.constData(),
-                  static_cast<size_t>(usr.length())));
-   dump.append("\n");
-
-   // Add RFU data
-   dump.append(tr("# RFU (%1 bytes)\n").arg(tag->rfu.length()));
-   dump.append(HexDump(
-                  tag->rfu.constData(),
-                  static_cast<size_t>(tag->rfu.length())));
-   dump.append("\n");
-
-   // Return dump string
-   return dump;
-}
-
-/**
- * @brief RFID_Bridge::clearHistory
- *
- * Clears the RFID tag list and read count indicators
- */
-void RFID::clearHistory()
-{
-   m_tags.clear();
-   resetCurrentTag();
-   emit tagCountChanged();
-}
-
-//------------------------------------------------------------------------------
-// Reader loading/unloading
-//------------------------------------------------------------------------------
-
-/**
- * @brief RFID_Bridge::unloadReader
- *
- * Unloads the current RFID reader driver from memory
- */
-void RFID::unloadReader()
-{
-   if(m_reader) {
-      clearHistory();
-      disconnect(m_reader, &RFID_Reader::epcFound, this, &RFID::onEpcFound);
-      disconnect(m_reader, &RFID_Reader::tidFound, this, &RFID::onTidFound);
-      disconnect(m_reader, &RFID_Reader::usrFound, this, &RFID::onUsrFound);
-      disconnect(m_reader, &RFID_Reader::rfuFound, this, &RFID::onRfuFound);
-
-      m_reader->deleteLater();
-      m_reader = Q_NULLPTR;
-   }
-}
-
-/**
- * @brief RFID_Bridge::setReader
- * @param index index of the RFID reader from the list returned by the
- *        @c rfidReaders() function
- */
-void RFID::setReader(const int index)
-{
-   if(index == 0)
-      setReader(new SM_6210());
-}
-
-/**
- * @brief RFID_Bridge::setReader
- * @param newReader pointer to the new RFID reader driver
- *
- * Changes the RFID reader driver used to read, write and manage RFID tags
- */
-void RFID::setReader(RFID_Reader* newReader)
-{
-   if(newReader) {
-      unloadReader();
-      clearHistory();
-
-      m_reader = newReader;
-      connect(m_reader, &RFID_Reader::epcFound, this, &RFID::onEpcFound);
-      connect(m_reader, &RFID_Reader::tidFound, this, &RFID::onTidFound);
-      connect(m_reader, &RFID_Reader::usrFound, this, &RFID::onUsrFound);
-      connect(m_reader, &RFID_Reader::rfuFound, this, &RFID::onRfuFound);
-
-      emit readerChanged();
-   }
-}
-
-//------------------------------------------------------------------------------
-// Reader interface functions
-//------------------------------------------------------------------------------
-
-/**
- * @brief RFID_Bridge::lockTag
- *
- * Asks the user for confirmation to lock the current tag manged by the RFID
- * reader. If user acknowledgement is given, then the driver shall use its
- * own means to block the current RFID tag->
- */
-void RFID::lockTag()
-{
-   int r = QMessageBox::question(Q_NULLPTR,
-                                 tr("Block tag"),
-                                 tr("Are you sure you want to block tag?"),
-                                 QMessageBox::Yes | QMessageBox::No,
-                                 QMessageBox::No);
-
-   if(r == QMessageBox::Yes && reader()) {
-      if(reader()->lockTag())
-         QMessageBox::information(Q_NULLPTR,
-                                  tr("Block tag"),
-                                  tr("Current tag was successfully blocked")
-                                 );
-
-      else
-         QMessageBox::critical(Q_NULLPTR,
-                               tr("Block tag"),
-                               tr("An error occurred while trying to "
-                                  "block the current tag"));
-   }
-}
-
-/**
- * @brief RFID_Bridge::killTag
- *
- * Asks the user for confirmation to kill the current tag manged by the RFID
- * reader. If user acknowledgement is given, then the driver shall use its
- * own means to kill the current RFID tag->
- */
-void RFID::killTag()
-{
-   int r = QMessageBox::question(Q_NULLPTR,
-                                 tr("Kill tag"),
-                                 tr("Are you sure you want to kill tag?"),
-                                 QMessageBox::Yes | QMessageBox::No,
-                                 QMessageBox::No);
-
-   if(r == QMessageBox::Yes && reader()) {
-      if(reader()->killTag())
-         QMessageBox::information(Q_NULLPTR,
-                                  tr("Kill tag"),
-                                  tr("Current tag was successfully "
-                                     "killed"));
-      else
-         QMessageBox::critical(Q_NULLPTR,
-                               tr("Kill tag"),
-                               tr("An error occurred while trying to "
-                                  "kill the current tag"));
-   }
-}
-
-/**
- * @brief RFID_Bridge::eraseTag
- *
- * Asks the user for confirmation to format the current tag manged by the RFID
- * reader. If user acknowledgement is given, then the driver shall use its
- * own means to format the current RFID tag->
- */
-void RFID::eraseTag()
-{
-   int r = QMessageBox::question(Q_NULLPTR,
-                                 tr("Format tag"),
-                                 tr("Are you sure you want to format tag?"),
-                                 QMessageBox::Yes | QMessageBox::No,
-                                 QMessageBox::No);
-
-   if(r == QMessageBox::Yes && reader()) {
-      if(reader()->eraseTag())
-         QMessageBox::information(Q_NULLPTR,
-                                  tr("Erase tag"),
-                                  tr("Current tag was successfully "
-                                     "erased."));
-      else
-         QMessageBox::critical(Q_NULLPTR,
-                               tr("Erase tag"),
-                               tr("An error occurred while trying to "
-                                  "erase/format the current tag"));
-   }
-}
-
-/**
- * @brief RFID_Bridge::writeEpc
- * @param epc new EPC data
- * @return @c true if operation is successfull, @c false if not
- *
- * Changes the EPC data of the current RFID tag using the means implemented
- * by the RFID reader driver loaded in memory.
- */
-bool RFID::writeEpc(const QByteArray& epc)
-{
-   if(readerAccessible())
-      return reader()->writeEpc(epc);
-
-   return false;
-}
-
-/**
- * @brief RFID_Bridge::writeRfu
- * @param rfu new reserved for future use data
- * @return @c true if operation is successfull, @c false if not
- *
- * Changes the RFU data of the current RFID tag using the means implemented
- * by the RFID reader driver loaded in memory.
- */
-bool RFID::writeRfu(const QByteArray& rfu)
-{
-   if(readerAccessible())
-      return reader()->writeRfu(rfu);
-
-   return false;
-}
-
-/**
- * @brief RFID_Bridge::writeUserData
- * @param userData new user data
- * @return @c true if operation is successfull, @c false if not
- *
- * Changes the user data of the current RFID tag using the means implemented
- * by the RFID reader driver loaded in memory.
- */
-bool RFID::writeUserData(const QByteArray& userData)
-{
-   if(readerAccessible())
-      return reader()->writeUserData(userData);
-
-   return false;
-}
-
-/**
- * @brief RFID_Bridge::scan
- * Scans for new and existing RFID tags and updates their information.
- */
-void RFID::scan()
-{
-   if(readerAccessible())
-      reader()->scan();
-
-   QTimer::singleShot(RFID_CURRENT_TAG_TIMEOUT / 50, this, &RFID::scan);
-}
-
-/**
- * @brief RFID::resetCurrentTag
- *
- * Called when the watchdog timer expires, this happens when the reader cannot
- * communicate with a tag after some amount of time.
- */
-void RFID::resetCurrentTag()
-{
-   if(reader()) {
-      reader()->setCurrentTag(Q_NULLPTR);
-      emit currentTagChanged();
-   }
-
-   m_watchdog.start();
-}
-
-//------------------------------------------------------------------------------
-// Slots for incoming RFID tag data management
-//------------------------------------------------------------------------------
-
-/**
- * @brief RFID::onEpcFound
- * @param epc
- *
- * Updates the @a epc data of the current tag or registers a new tag based
- * on current tag information
- */
-void RFID::onEpcFound(const QByteArray& epc)
-{
-   RFID_Tag* tag = new RFID_Tag;
-   tag->epc = epc;
-
-   if(currentTag()) {
-      if(currentTag()->epc != epc && !currentTag()->epc.isEmpty())
-         updateTagList(tag);
-      else {
-         updateTagData(&currentTag()->epc, epc);
-         free(tag);
-      }
-   }
-
-   else
-      updateTagList(tag);
-}
-
-/**
- * @brief RFID::onTidFound
- * @param tid
- *
- * Updates the @a tid data of the current tag or registers a new tag based
- * on current tag information
- */
-void RFID::onTidFound(const QByteArray& tid)
-{
-   RFID_Tag* tag = new RFID_Tag;
-   tag->tid = tid;
-
-   if(currentTag()) {
-      if(currentTag()->tid != tid && !currentTag()->tid.isEmpty())
-         updateTagList(tag);
-      else {
-         updateTagData(&currentTag()->tid, tid);
-         updateTagList(currentTag());
-         free(tag);
-      }
-   }
-
-   else
-      updateTagList(tag);
-}
-
-/**
- * @brief RFID::onUsrFound
- * @param usr user data
- *
- * Updates the @a usr data of the current tag or registers a new tag based
- * on current tag information
- */
-void RFID::onUsrFound(const QByteArray& usr, const int datagram)
-{
-   Q_ASSERT(datagram < RFID_NUM_USER_DATAGRAMS && datagram >= 0);
-
-   RFID_Tag* tag = new RFID_Tag;
-   tag->usr[datagram] = usr;
-
-   if(currentTag()) {
-      if(currentTag()->usr[datagram] != usr && !currentTag()->usr[datagram].isEmpty())
-         updateTagList(tag);
-      else {
-         updateTagData(&currentTag()->usr[datagram], usr);
-         updateTagList(currentTag());
-         free(tag);
-      }
-   }
-
-   else
-      updateTagList(tag);
-}
-
-/**
- * @brief RFID::onRfuFound
- * @param rfu reserved data
- *
- * Updates the @a rfu data of the current tag or registers a new tag based
- * on current tag information
- */
-void RFID::onRfuFound(const QByteArray& rfu)
-{
-   RFID_Tag* tag = new RFID_Tag;
-   tag->rfu = rfu;
-
-   if(currentTag()) {
-      if(currentTag()->rfu != rfu && !currentTag()->rfu.isEmpty())
-         updateTagList(tag);
-      else {
-         updateTagData(&currentTag()->rfu, rfu);
-         updateTagList(currentTag());
-         free(tag);
-      }
-   }
-
-   else
-      updateTagList(tag);
-}
-
-//------------------------------------------------------------------------------
-// Tag history management
-//------------------------------------------------------------------------------
-
-/**
- * @brief RFID::updateTagList
- * @param tag
- *
- * Registers the given @a tag and its data to the tag history list, and manages
- * the tag list so that data is not duplicated.
- *
- * @note the @a tag will not be complete, so this function is in charge of
- *       generating a tag list with complete information over time.
- */
-void RFID::updateTagList(RFID_Tag* tag)
-{
-   Q_ASSERT(tag != Q_NULLPTR && reader());
-
-   // Reset watchdog
-   m_watchdog.start();
-
-   // Do not add tag to list if it already exists
-   bool tagFound = false;
-
-   // Try to update existing tag (so we can "slowly" gather more information
-   // about each RFID tag that is being scanned).
-   for(int i = 0; i < tagCount(); ++i) {
-      RFID_Tag* t = m_tags.at(i);
-      if(t->epc == tag->epc || t->tid == tag->tid) {
-         tagFound = true;
-         updateTagData(&t->epc, tag->epc);
-         updateTagData(&t->tid, tag->tid);
-         updateTagData(&t->rfu, tag->rfu);
-
-         for(int i = 0; i < RFID_NUM_USER_DATAGRAMS; ++i)
-            updateTagData(&t->usr[i], tag->usr[i]);
-
-         break;
-      }
-   }
-
-   // Tag not found on list, register new tag..
-   if(!tagFound) {
-      m_tags.append(tag);
-      emit tagCountChanged();
-   }
-
-   // Cleanup tag list to remove duplicates
-   int tags = tagCount();
-   for(int i = 0; i < tags; ++i) {
-      RFID_Tag* ta = m_tags.at(i);
-      for(int j = i + 1; j < tags; ++j) {
-         RFID_Tag* tb = m_tags.at(j);
-         if(ta == tb)
-            m_tags.removeAt(j);
-         else if(ta->tid == tb->tid)
-            m_tags.removeAt(j);
-
-         if(tags != tagCount()) {
-            tags = tagCount();
-            emit tagCountChanged();
-         }
-      }
-   }
-
-   // Change current tag
-   if(currentTag() != tag) {
-      reader()->setCurrentTag(tag);
-      emit currentTagChanged();
-   }
-}
-
-/**
- * @brief RFID::updateTagData
- * @param dest pointer to destination byte array
- * @param src  source byte array
- *
- * Compares the contents of @a dest and src and determines if the tag data
- * needs to be updated. In the eventual case of a tag update, the appropiate
- * signals are sent by this function.
- */
-void RFID::updateTagData(QByteArray* dest, const QByteArray& src)
-{
-   if(!src.isEmpty() && *dest != src) {
-      *dest = src;
-      emit tagUpdated();
-   }
-}
-
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+//------------------------------------------------------------------------------
+// Library headers
+//------------------------------------------------------------------------------
+
+#include "RFID.h"
+#include "RFID_Log.h"
+#include "RFID_Clock.h"
+#include "RFID_Reader.h"
+#include "RFID_Profiler.h"
+#include "RFID_SerialManager.h"
+#include "RFID_TidTable.h"
+
+//------------------------------------------------------------------------------
+// RFID Reader Drivers
+//------------------------------------------------------------------------------
+
+#include "SM_6210.h"
+
+//------------------------------------------------------------------------------
+// Qt libraries
+//------------------------------------------------------------------------------
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <QTimer>
+#include <QThread>
+#include <QMessageBox>
+
+//------------------------------------------------------------------------------
+// Utility functions
+//------------------------------------------------------------------------------
+
+static QString HexDump(const char* data, size_t size)
+{
+   char str[4096] = "";
+   char ascii[17];
+
+   size_t i, j;
+   ascii[16] = '\0';
+   for(i = 0; i < size; ++i) {
+      sprintf(str + strlen(str), "%02X ", static_cast<quint8>(data[i]));
+
+      if(data[i] >= ' ' &&  data[i] <= '~')
+         ascii[i % 16] = data[i];
+      else
+         ascii[i % 16] = '.';
+
+      if((i+1) % 8 == 0 || i+1 == size) {
+         sprintf(str + strlen(str), " ");
+         if((i+1) % 16 == 0)
+            sprintf(str + strlen(str), "|  %s \n", ascii);
+
+         else if(i+1 == size) {
+            ascii[(i+1) % 16] = '\0';
+
+            if((i+1) % 16 <= 8)
+               sprintf(str + strlen(str), " ");
+            for(j = (i+1) % 16; j < 16; ++j)
+               sprintf(str + strlen(str), "   ");
+
+            sprintf(str + strlen(str), "|  %s \n", ascii);
+         }
+      }
+   }
+
+   return QString(str);
+}
+
+/**
+ * Returns the name of the memory bank of the given tag @a field
+ */
+static QString FieldName(const quint32 field)
+{
+   switch(field) {
+      case RFID_FIELD_EPC:
+         return QObject::tr("EPC");
+      case RFID_FIELD_RFU:
+         return QObject::tr("RFU");
+      default:
+         break;
+   }
+
+   for(int i = 0; i < RFID_NUM_USER_DATAGRAMS; ++i)
+      if(field == static_cast<quint32>(RFID_FIELD_USR << i))
+         return QObject::tr("User data %1").arg(i);
+
+   return QString();
+}
+
+/**
+ * Returns @c true if the given tag @a field is a low priority memory bank
+ * (RFU or user data)
+ */
+static inline bool IsBankRead(const quint32 field)
+{
+   return field != RFID_FIELD_EPC && field != RFID_FIELD_TID;
+}
+
+/**
+ * Registers the time elapsed between the reception of tag data with the
+ * given @a timestamp and its processing by the tag store
+ */
+static void RegisterLatency(const qint64 timestamp)
+{
+   if(RFID_Profiler::enabled()) {
+      const qint64 latency = RFID_Clock::getInstance()->now() - timestamp;
+      RFID_Profiler::getInstance()->addSample("Tag data latency",
+                                              latency / 1000);
+   }
+}
+
+//------------------------------------------------------------------------------
+// Constructor, destructor & instance access functions
+//------------------------------------------------------------------------------
+
+/**
+ * Pointer to the only instance of the @c RFID_Bridge class
+ */
+static RFID* INSTANCE = Q_NULLPTR;
+
+/**
+ * @brief RFID_Bridge::RFID_Bridge
+ *
+ * Initializes internal variables and begins the periodic scan loop
+ */
+RFID::RFID()
+{
+   // Set null reader
+   m_reader = Q_NULLPTR;
+
+   // Start the monotonic clock used to timestamp tag data
+   RFID_Clock::getInstance();
+
+   // Register change set type, so that it can be used in queued connections
+   qRegisterMetaType<RFID_ChangeSet>("RFID_ChangeSet");
+   qRegisterMetaType<RFID_Calibration>("RFID_Calibration");
+
+   // Configure overload policy
+   m_processPending = false;
+   m_maxPendingEvents = RFID_MAX_PENDING_EVENTS;
+   m_overloadPolicy = RFID_SHED_DUPLICATES | RFID_SHED_BANK_READS;
+
+   // Publish an empty tag list snapshot
+   m_lastTagId = 0;
+   m_generation.store(0);
+   m_publishPending = false;
+   publishSnapshot();
+
+   // Configure watchdog timer
+   m_watchdog.setInterval(RFID_CURRENT_TAG_TIMEOUT);
+   connect(&m_watchdog, &QTimer::timeout, this, &RFID::resetCurrentTag);
+
+   // Start scanner & watchdog timer
+   QTimer::singleShot(1000, this, SLOT(scan()));
+   QTimer::singleShot(1000, &m_watchdog, SLOT(start()));
+}
+
+/**
+ * @brief RFID_Bridge::~RFID_Bridge
+ *
+ * Destroys the current RFID reader class before the @c RFID_Bridge class
+ * is destroyed
+ */
+RFID::~RFID()
+{
+   unloadReader();
+}
+
+/**
+ * @brief RFID_Bridge::getInstance
+ * @returns the only instance of the @a RFID_Bridge class
+ */
+RFID* RFID::getInstance()
+{
+   if(INSTANCE == Q_NULLPTR)
+      INSTANCE = new RFID;
+
+   return INSTANCE;
+}
+
+//------------------------------------------------------------------------------
+// Misc. info access functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_Bridge::chipCount
+ * @returns the number of tags read by the current RFID reader
+ */
+int RFID::tagCount() const
+{
+   return m_store.count();
+}
+
+/**
+ * @brief RFID_Bridge::readerAccessible
+ * @returns @c true if a RFID reader driver is loaded and the current RFID
+ *          reader is ready to be used
+ */
+bool RFID::readerAccessible() const
+{
+   if(reader() != Q_NULLPTR)
+      return reader()->loaded();
+
+   return false;
+}
+
+/**
+ * @brief RFID::generation
+ * @returns the generation of the tag store, the generation is increased every
+ *          time that a tag, the tag list or the current tag is modified
+ */
+quint64 RFID::generation() const
+{
+   return m_generation.load();
+}
+
+/**
+ * @brief RFID::pendingEvents
+ * @returns the number of tag data events waiting to be processed
+ */
+int RFID::pendingEvents() const
+{
+   return m_events.count();
+}
+
+/**
+ * @brief RFID::overloadPolicy
+ * @returns the @c RFID_OverloadPolicy flags used when the queue of pending
+ *          tag data events is full
+ */
+int RFID::overloadPolicy() const
+{
+   return m_overloadPolicy;
+}
+
+/**
+ * @brief RFID::maxPendingEvents
+ * @returns the size of the queue of pending tag data events
+ */
+int RFID::maxPendingEvents() const
+{
+   return m_maxPendingEvents;
+}
+
+/**
+ * @brief RFID_Bridge::reader
+ * @returns a pointer to the current RFID reader driver
+ */
+RFID_Reader* RFID::reader() const
+{
+   return m_reader;
+}
+
+/**
+ * @brief RFID_Bridge::currentTag
+ * @returns a pointer to the current RFID tag being scanned/written by the
+ *          RFID reader
+ */
+RFID_Tag* RFID::currentTag()
+{
+   if(reader())
+      return reader()->currentTag();
+
+   return Q_NULLPTR;
+}
+
+/**
+ * @brief RFID::snapshot
+ *
+ * Returns a read-only copy of the tag list, snapshots are immutable, so they
+ * can be iterated from any thread while the RFID reader keeps modifying the
+ * tag list.
+ *
+ * A new snapshot is only generated once per tag store generation, so calling
+ * this function repeatedly is cheap. When called from a thread that does not
+ * own this object, the latest published snapshot is returned (snapshots are
+ * published as soon as control returns to the event loop of this object).
+ */
+RFID_TagSnapshotPtr RFID::snapshot()
+{
+   if(QThread::currentThread() == thread())
+      publishSnapshot();
+
+   QMutexLocker locker(&m_snapshotMutex);
+   return m_snapshot;
+}
+
+/**
+ * @brief RFID_Bridge::rfidTags
+ * @returns a list of RFIDS tags found by the RFID reader
+ *
+ * @note The tags of this list are modified by the RFID reader, use the
+ *       @c snapshot() function to obtain a read-only copy of the list.
+ */
+const RFID_TagList& RFID::rfidTags() const
+{
+   return m_store.tags();
+}
+
+/**
+ * @brief RFID::copyTag
+ * @param id  ID of the tag
+ * @param tag set to a copy of the current data of the tag
+ * @returns @c true if the tag is registered
+ *
+ * @note Unlike @c rfidTags(), this function can be called from any thread,
+ *       the tag store is locked while the tag is copied.
+ */
+bool RFID::copyTag(const quint32 id, RFID_Tag* tag) const
+{
+   return m_store.copy(id, tag);
+}
+
+/**
+ * @brief RFID::copyTag
+ * @param tid compact TID of the tag
+ * @param tag set to a copy of the current data of the tag
+ * @returns @c true if the tag is registered, can be called from any thread
+ */
+bool RFID::copyTag(const RFID_TagKey& tid, RFID_Tag* tag) const
+{
+   return m_store.copy(tid, tag);
+}
+
+/**
+ * @brief RFID::copyTag
+ * @param epc current or previous EPC of the tag
+ * @param tag set to a copy of the current data of the tag
+ * @returns @c true if the tag is registered, can be called from any thread
+ */
+bool RFID::copyTag(const QByteArray& epc, RFID_Tag* tag) const
+{
+   return m_store.copy(epc, tag);
+}
+
+/**
+ * @brief RFID_Bridge::rfidReaders
+ * @returns a list with supported RFID reader devices
+ */
+QStringList RFID::rfidReaders() const
+{
+   return QStringList {
+      "SM-6210 USB UHF RFID Programmer",
+      "RDM530 USB UART HF RFID Programmer"
+   };
+}
+
+/**
+ * @brief RFID::getUserData
+ * Generates a @c QByteArray from all the user data sections of the given @a
+ * tag.
+ */
+QByteArray RFID::getUserData(const RFID_Tag* tag) const
+{
+   Q_ASSERT(tag);
+
+   QByteArray data;
+   for(int i = 0; i < RFID_NUM_USER_DATAGRAMS; ++i)
+      data.append(tag->usr[i]);
+
+   return data;
+}
+
+/**
+ * @brief RFID::generateMemoryMap
+ * @param tag
+ * @returns a string with all the data found in the given RFID @a tag
+ */
+QString RFID::generateMemoryMap(const RFID_Tag* tag) const
+{
+   Q_ASSERT(tag);
+
+   // Init dump string
+   QString dump;
+
+   // Add tag read times
+   const RFID_Clock* clock = RFID_Clock::getInstance();
+   dump.append(tr("# First seen: %1\n")
+               .arg(clock->toDateTime(tag->firstSeen).toString(Qt::ISODateWithMs)));
+   dump.append(tr("# Last seen: %1\n")
+               .arg(clock->toDateTime(tag->lastSeen).toString(Qt::ISODateWithMs)));
+   dump.append("\n");
+
+   // Add tag ID data
+   const QByteArray tid = RFID_TidTable::getInstance()->tid(tag->tid);
+   dump.append(tr("# Tag ID (%1 bytes)\n").arg(tid.length()));
+   dump.append(HexDump(
+                  tid.constData(),
+                  static_cast<size_t>(tid.length())));
+   dump.append("\n");
+
+   // Add EPC data
+   dump.append(tr("# EPC (%1 bytes)\n").arg(tag->epc.length()));
+   dump.append(HexDump(
+                  tag->epc.constData(),
+                  static_cast<size_t>(tag->epc.length())));
+   dump.append("\n");
+
+   // Add user data
+   QByteArray usr = getUserData(tag);
+   dump.append(tr("# User data (%1 bytes)\n").arg(usr.length()));
+   dump.append(HexDump(
+                  usr.constData(),
+                  static_cast<size_t>(usr.length())));
+   dump.append("\n");
+
+   // Add RFU data
+   dump.append(tr("# RFU (%1 bytes)\n").arg(tag->rfu.length()));
+   dump.append(HexDump(
+                  tag->rfu.constData(),
+                  static_cast<size_t>(tag->rfu.length())));
+   dump.append("\n");
+
+   // Add previous versions of the memory banks (newest first)
+   const QVector<RFID_TagVersion> versions = history(tag);
+   if(!versions.isEmpty()) {
+      dump.append(tr("# History (%1 changes)\n").arg(versions.count()));
+      foreach(const RFID_TagVersion& version, versions) {
+         const QString writer = version.writer.isEmpty() ? tr("External") :
+                                version.writer;
+         dump.append(tr("%1  %2  (%3)\n")
+                     .arg(clock->toDateTime(version.timestamp)
+                          .toString(Qt::ISODateWithMs),
+                          FieldName(version.field), writer));
+         dump.append(tr("   before: %1\n")
+                     .arg(QString::fromLatin1(version.before.toHex(' '))));
+         dump.append(tr("   after:  %1\n")
+                     .arg(QString::fromLatin1(version.after.toHex(' '))));
+      }
+
+      dump.append("\n");
+   }
+
+   // Return dump string
+   return dump;
+}
+
+/**
+ * @brief RFID::history
+ * @param tag registered tag
+ * @returns the previous versions of the memory banks of the given @a tag,
+ *          the newest change is placed first
+ */
+QVector<RFID_TagVersion> RFID::history(const RFID_Tag* tag) const
+{
+   Q_ASSERT(tag);
+   return m_history.versions(*tag);
+}
+
+/**
+ * @brief RFID::writer
+ * @returns the identity registered in the tag history for the writes
+ *          requested through this class (e.g. the name of a batch script)
+ */
+QString RFID::writer() const
+{
+   if(m_writer.isEmpty())
+      return tr("Operator");
+
+   return m_writer;
+}
+
+/**
+ * @brief RFID::setWriter
+ * @param writer identity of the component that requests the following
+ *               writes, an empty string restores the default identity
+ */
+void RFID::setWriter(const QString& writer)
+{
+   m_writer = writer;
+}
+
+/**
+ * @brief RFID_Bridge::clearHistory
+ *
+ * Clears the RFID tag list and read count indicators
+ */
+void RFID::clearHistory()
+{
+   m_events.clear();
+   m_writes.clear();
+   m_history.clear();
+   RFID_Profiler::getInstance()->setCounter("Tag history bytes", 0);
+   resetCurrentTag();
+
+   const RFID_TagList tags = m_store.tags();
+   foreach(RFID_Tag* tag, tags)
+      markModified(tag, RFID_FIELD_REMOVED);
+
+   m_store.clear();
+   qDeleteAll(tags);
+   emit tagCountChanged();
+}
+
+/**
+ * @brief RFID::restore
+ * @param tags tags of a previous session (e.g. loaded from a checkpoint)
+ *
+ * Replaces the tag history with the given @a tags, tag IDs are kept so that
+ * new tags do not reuse the IDs of the restored tags.
+ */
+void RFID::restore(const QVector<RFID_Tag>& tags)
+{
+   clearHistory();
+
+   foreach(const RFID_Tag& tag, tags) {
+      if(tag.id == 0)
+         continue;
+
+      RFID_Tag* copy = new RFID_Tag(tag);
+      m_lastTagId = qMax(m_lastTagId, tag.id);
+      m_store.insert(copy);
+      markModified(copy, RFID_FIELD_ADDED);
+   }
+
+   emit tagCountChanged();
+}
+
+//------------------------------------------------------------------------------
+// Reader loading/unloading
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_Bridge::unloadReader
+ *
+ * Unloads the current RFID reader driver from memory
+ */
+void RFID::unloadReader()
+{
+   if(m_reader) {
+      clearHistory();
+      disconnect(m_reader, &RFID_Reader::epcFound, this, &RFID::onEpcFound);
+      disconnect(m_reader, &RFID_Reader::tidFound, this, &RFID::onTidFound);
+      disconnect(m_reader, &RFID_Reader::usrFound, this, &RFID::onUsrFound);
+      disconnect(m_reader, &RFID_Reader::rfuFound, this, &RFID::onRfuFound);
+      disconnect(m_reader, &RFID_Reader::calibrated,
+                 this, &RFID::readerCalibrated);
+
+      m_reader->deleteLater();
+      m_reader = Q_NULLPTR;
+   }
+}
+
+/**
+ * @brief RFID_Bridge::setReader
+ * @param index index of the RFID reader from the list returned by the
+ *        @c rfidReaders() function
+ */
+void RFID::setReader(const int index)
+{
+   if(index == 0)
+      setReader(new SM_6210());
+}
+
+/**
+ * @brief RFID_Bridge::setReader
+ * @param newReader pointer to the new RFID reader driver
+ *
+ * Changes the RFID reader driver used to read, write and manage RFID tags
+ */
+void RFID::setReader(RFID_Reader* newReader)
+{
+   if(newReader) {
+      unloadReader();
+      clearHistory();
+
+      m_reader = newReader;
+      connect(m_reader, &RFID_Reader::epcFound, this, &RFID::onEpcFound);
+      connect(m_reader, &RFID_Reader::tidFound, this, &RFID::onTidFound);
+      connect(m_reader, &RFID_Reader::usrFound, this, &RFID::onUsrFound);
+      connect(m_reader, &RFID_Reader::rfuFound, this, &RFID::onRfuFound);
+      connect(m_reader, &RFID_Reader::calibrated,
+              this, &RFID::readerCalibrated);
+
+      emit readerChanged();
+   }
+}
+
+/**
+ * @brief RFID::setOverloadPolicy
+ * @param policy combination of @c RFID_OverloadPolicy flags
+ *
+ * Changes the events that can be discarded when the queue of pending tag data
+ * events is full. Events that cannot be discarded are queued anyway, so the
+ * queue may grow beyond its maximum size.
+ */
+void RFID::setOverloadPolicy(const int policy)
+{
+   m_overloadPolicy = policy;
+}
+
+/**
+ * @brief RFID::setMaxPendingEvents
+ * @param maxEvents maximum number of queued tag data events
+ *
+ * Changes the number of tag data events that can be queued before the
+ * overload policy is applied.
+ */
+void RFID::setMaxPendingEvents(const int maxEvents)
+{
+   m_maxPendingEvents = qMax(maxEvents, 1);
+}
+
+//------------------------------------------------------------------------------
+// Reader interface functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_Bridge::lockTag
+ *
+ * Asks the user for confirmation to lock the current tag manged by the RFID
+ * reader. If user acknowledgement is given, then the driver shall use its
+ * own means to block the current RFID tag->
+ */
+void RFID::lockTag()
+{
+   int r = QMessageBox::question(Q_NULLPTR,
+                                 tr("Block tag"),
+                                 tr("Are you sure you want to block tag?"),
+                                 QMessageBox::Yes | QMessageBox::No,
+                                 QMessageBox::No);
+
+   if(r == QMessageBox::Yes && reader()) {
+      if(reader()->lockTag())
+         QMessageBox::information(Q_NULLPTR,
+                                  tr("Block tag"),
+                                  tr("Current tag was successfully blocked")
+                                 );
+
+      else
+         QMessageBox::critical(Q_NULLPTR,
+                               tr("Block tag"),
+                               tr("An error occurred while trying to "
+                                  "block the current tag"));
+   }
+}
+
+/**
+ * @brief RFID_Bridge::killTag
+ *
+ * Asks the user for confirmation to kill the current tag manged by the RFID
+ * reader. If user acknowledgement is given, then the driver shall use its
+ * own means to kill the current RFID tag->
+ */
+void RFID::killTag()
+{
+   int r = QMessageBox::question(Q_NULLPTR,
+                                 tr("Kill tag"),
+                                 tr("Are you sure you want to kill tag?"),
+                                 QMessageBox::Yes | QMessageBox::No,
+                                 QMessageBox::No);
+
+   if(r == QMessageBox::Yes && reader()) {
+      if(reader()->killTag())
+         QMessageBox::information(Q_NULLPTR,
+                                  tr("Kill tag"),
+                                  tr("Current tag was successfully "
+                                     "killed"));
+      else
+         QMessageBox::critical(Q_NULLPTR,
+                               tr("Kill tag"),
+                               tr("An error occurred while trying to "
+                                  "kill the current tag"));
+   }
+}
+
+/**
+ * @brief RFID_Bridge::eraseTag
+ *
+ * Asks the user for confirmation to format the current tag manged by the RFID
+ * reader. If user acknowledgement is given, then the driver shall use its
+ * own means to format the current RFID tag->
+ */
+void RFID::eraseTag()
+{
+   int r = QMessageBox::question(Q_NULLPTR,
+                                 tr("Format tag"),
+                                 tr("Are you sure you want to format tag?"),
+                                 QMessageBox::Yes | QMessageBox::No,
+                                 QMessageBox::No);
+
+   if(r == QMessageBox::Yes && reader()) {
+      if(reader()->eraseTag())
+         QMessageBox::information(Q_NULLPTR,
+                                  tr("Erase tag"),
+                                  tr("Current tag was successfully "
+                                     "erased."));
+      else
+         QMessageBox::critical(Q_NULLPTR,
+                               tr("Erase tag"),
+                               tr("An error occurred while trying to "
+                                  "erase/format the current tag"));
+   }
+}
+
+/**
+ * @brief RFID_Bridge::writeEpc
+ * @param epc new EPC data
+ * @return @c true if operation is successfull, @c false if not
+ *
+ * Changes the EPC data of the current RFID tag using the means implemented
+ * by the RFID reader driver loaded in memory.
+ */
+bool RFID::writeEpc(const QByteArray& epc)
+{
+   if(readerAccessible() && reader()->writeEpc(epc)) {
+      registerWrite(RFID_FIELD_EPC);
+      return true;
+   }
+
+   return false;
+}
+
+/**
+ * @brief RFID_Bridge::writeRfu
+ * @param rfu new reserved for future use data
+ * @return @c true if operation is successfull, @c false if not
+ *
+ * Changes the RFU data of the current RFID tag using the means implemented
+ * by the RFID reader driver loaded in memory.
+ */
+bool RFID::writeRfu(const QByteArray& rfu)
+{
+   if(readerAccessible() && reader()->writeRfu(rfu)) {
+      registerWrite(RFID_FIELD_RFU);
+      return true;
+   }
+
+   return false;
+}
+
+/**
+ * @brief RFID_Bridge::writeUserData
+ * @param userData new user data
+ * @return @c true if operation is successfull, @c false if not
+ *
+ * Changes the user data of the current RFID tag using the means implemented
+ * by the RFID reader driver loaded in memory.
+ */
+bool RFID::writeUserData(const QByteArray& userData)
+{
+   if(readerAccessible() && reader()->writeUserData(userData)) {
+      quint32 fields = 0;
+      for(int i = 0; i < RFID_NUM_USER_DATAGRAMS; ++i)
+         fields |= RFID_FIELD_USR << i;
+
+      registerWrite(fields);
+      return true;
+   }
+
+   return false;
+}
+
+/**
+ * @brief RFID_Bridge::scan
+ * Scans for new and existing RFID tags and updates their information. The
+ * scan interval is given by the reader driver, which may adjust it to the
+ * speed of the reader.
+ */
+void RFID::scan()
+{
+   int interval = RFID_SCAN_INTERVAL;
+   if(readerAccessible()) {
+      reader()->scan();
+      interval = reader()->scanInterval();
+   }
+
+   QTimer::singleShot(interval, this, &RFID::scan);
+}
+
+/**
+ * @brief RFID::resetCurrentTag
+ *
+ * Called when the watchdog timer expires, this happens when the reader cannot
+ * communicate with a tag after some amount of time.
+ */
+void RFID::resetCurrentTag()
+{
+   if(reader()) {
+      if(reader()->currentTag())
+         markModified(reader()->currentTag(), RFID_FIELD_PRESENCE);
+
+      reader()->setCurrentTag(Q_NULLPTR);
+      emit currentTagChanged();
+   }
+
+   m_watchdog.start();
+}
+
+/**
+ * @brief RFID::publishSnapshot
+ *
+ * Generates a new read-only copy of the tag list if the tag store has been
+ * modified since the last snapshot was generated, and replaces the published
+ * snapshot with it. Readers that still hold the previous snapshot keep using
+ * it until they release it.
+ *
+ * The changes applied to the tag store since the previous snapshot are then
+ * reported with the @c tagsChanged() signal.
+ */
+void RFID::publishSnapshot()
+{
+   m_publishPending = false;
+
+   // Snapshot is up to date
+   const quint64 generation = m_generation.load();
+   if(m_snapshot && m_snapshot->generation == generation)
+      return;
+
+   // Copy tag data (tag byte arrays are implicitly shared)
+   RFID_TagSnapshot* snapshot = new RFID_TagSnapshot;
+   snapshot->generation = generation;
+   snapshot->currentTag = -1;
+   const RFID_TagList& tags = m_store.tags();
+   snapshot->tags.reserve(tags.count());
+   for(int i = 0; i < tags.count(); ++i) {
+      RFID_Tag* tag = tags.at(i);
+      if(reader() && reader()->currentTag() == tag)
+         snapshot->currentTag = i;
+
+      snapshot->tags.append(*tag);
+   }
+
+   // Publish snapshot
+   m_snapshotMutex.lock();
+   m_snapshot = RFID_TagSnapshotPtr(snapshot);
+   m_snapshotMutex.unlock();
+
+   // Report changes
+   RFID_ChangeSet changes;
+   changes.generation = generation;
+   changes.changes.reserve(m_changes.count());
+   QHash<quint32, quint32>::const_iterator it;
+   for(it = m_changes.constBegin(); it != m_changes.constEnd(); ++it) {
+      RFID_TagChange change;
+      change.tag = it.key();
+      change.fields = it.value();
+      changes.changes.append(change);
+   }
+
+   m_changes.clear();
+   emit tagsChanged(changes);
+}
+
+//------------------------------------------------------------------------------
+// Slots for incoming RFID tag data management
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID::onEpcFound
+ *
+ * Queues the @a epc data received at the given @a timestamp
+ */
+void RFID::onEpcFound(const QByteArray& epc, const qint64 timestamp)
+{
+   enqueueEvent(RFID_FIELD_EPC, epc, timestamp);
+}
+
+/**
+ * @brief RFID::onTidFound
+ *
+ * Queues the @a tid data received at the given @a timestamp
+ */
+void RFID::onTidFound(const QByteArray& tid, const qint64 timestamp)
+{
+   enqueueEvent(RFID_FIELD_TID, tid, timestamp);
+}
+
+/**
+ * @brief RFID::onUsrFound
+ *
+ * Queues the @a usr data of the given @a datagram received at the given
+ * @a timestamp
+ */
+void RFID::onUsrFound(const QByteArray& usr, const int datagram,
+                      const qint64 timestamp)
+{
+   Q_ASSERT(datagram < RFID_NUM_USER_DATAGRAMS && datagram >= 0);
+   enqueueEvent(RFID_FIELD_USR << datagram, usr, timestamp);
+}
+
+/**
+ * @brief RFID::onRfuFound
+ *
+ * Queues the @a rfu data received at the given @a timestamp
+ */
+void RFID::onRfuFound(const QByteArray& rfu, const qint64 timestamp)
+{
+   enqueueEvent(RFID_FIELD_RFU, rfu, timestamp);
+}
+
+//------------------------------------------------------------------------------
+// Tag data queue management
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID::enqueueEvent
+ * @param field     tag field read by the RFID reader
+ * @param data      data of the tag field
+ * @param timestamp monotonic time at which the data was received
+ *
+ * Adds the tag data to the queue of pending events, which is processed in
+ * batches when control returns to the event loop. If the queue is full, the
+ * overload policy decides which events are discarded.
+ *
+ * The event is owned by the current tag, which is the tag that the reader
+ * was reading when the data was received.
+ */
+void RFID::enqueueEvent(const quint32 field,
+                        const QByteArray& data,
+                        const qint64 timestamp)
+{
+   Event event;
+   event.field = field;
+   event.owner = currentTagId();
+   event.data = data;
+   event.timestamp = timestamp;
+   event.lastTimestamp = timestamp;
+
+   // Apply overload policy
+   if(m_events.count() >= m_maxPendingEvents && !shedEvents(event))
+      return;
+
+   // Queue event
+   m_events.append(event);
+   RFID_Profiler::getInstance()->setCounterMax("RFID queue high watermark",
+                                               m_events.count());
+
+   // Schedule event processing
+   if(!m_processPending) {
+      m_processPending = true;
+      QTimer::singleShot(0, this, &RFID::processEvents);
+   }
+}
+
+/**
+ * @brief RFID::shedEvents
+ * @param event new event that does not fit in the queue
+ * @returns @c true if the new @a event must be queued, @c false if it was
+ *          merged with a queued event or dropped
+ *
+ * Applies the overload policy when the queue of pending events is full:
+ *
+ * - Duplicated reads of the same tag are merged with the queued read (only
+ *   the timestamp of the new read is kept), as long as no other tag was read
+ *   in between.
+ * - Low priority reads (RFU & user data) are dropped, the RFID reader reads
+ *   them again in the next scan cycles.
+ * - EPC and TID reads are never dropped, they are queued even if that makes
+ *   the queue exceed its maximum size.
+ */
+bool RFID::shedEvents(const Event& event)
+{
+   RFID_Profiler* profiler = RFID_Profiler::getInstance();
+
+   // Merge duplicated reads
+   if(m_overloadPolicy & RFID_SHED_DUPLICATES) {
+      for(int i = m_events.count() - 1; i >= 0; --i) {
+         Event& queued = m_events[i];
+         if(queued.field == event.field && queued.owner == event.owner
+               && queued.data == event.data) {
+            queued.lastTimestamp = qMax(queued.lastTimestamp, event.timestamp);
+            profiler->addCount("RFID duplicate reads dropped");
+            return false;
+         }
+
+         // Do not merge reads across tag changes
+         if(!IsBankRead(queued.field))
+            break;
+      }
+   }
+
+   // Drop low priority reads, starting with the oldest
+   if(m_overloadPolicy & RFID_SHED_BANK_READS) {
+      if(IsBankRead(event.field)) {
+         profiler->addCount("RFID bank reads dropped");
+         return false;
+      }
+
+      for(int i = 0; i < m_events.count(); ++i) {
+         if(IsBankRead(m_events.at(i).field)) {
+            m_events.removeAt(i);
+            profiler->addCount("RFID bank reads dropped");
+            return true;
+         }
+      }
+   }
+
+   // Nothing can be dropped, queue the event anyway
+   profiler->addCount("RFID queue overflows");
+   RFID_LOG(RFID_LOG_STORE, RFID_LOG_WARNING,
+            "Event queue overflow, %1 events pending", m_events.count() + 1);
+   return true;
+}
+
+/**
+ * @brief RFID::processEvents
+ *
+ * Processes up to @c RFID_EVENT_BATCH_SIZE pending events and schedules the
+ * processing of the remaining events, so that the event loop (and the serial
+ * port) is serviced between batches.
+ */
+void RFID::processEvents()
+{
+   RFID_PROFILE("RFID::processEvents");
+
+   m_processPending = false;
+
+   // Reader unloaded, pending events are no longer valid
+   if(!reader()) {
+      m_events.clear();
+      return;
+   }
+
+   // Process a batch of events
+   for(int i = 0; i < RFID_EVENT_BATCH_SIZE && !m_events.isEmpty(); ++i)
+      processEvent(m_events.takeFirst());
+
+   // Update queue metrics
+   RFID_Profiler::getInstance()->setCounter("RFID pending events",
+                                            m_events.count());
+
+   // Schedule processing of the remaining events
+   if(!m_events.isEmpty()) {
+      m_processPending = true;
+      QTimer::singleShot(0, this, &RFID::processEvents);
+   }
+}
+
+/**
+ * @brief RFID::processEvent
+ *
+ * Registers the data of the given @a event in the tag store. Events other
+ * than EPC sightings are dropped if the current tag changed since they were
+ * received (e.g. the watchdog expired or another tag was sighted while the
+ * event was queued), so that the data of a tag is never registered in
+ * another tag, nor in a new tag without EPC.
+ */
+void RFID::processEvent(const Event& event)
+{
+   // Drop stale reads (and bank reads received without a current tag, which
+   // cannot be matched with a tag)
+   const quint32 owner = currentTagId();
+   if(event.field != RFID_FIELD_EPC && (owner == 0 || event.owner != owner)) {
+      RFID_Profiler::getInstance()->addCount("RFID stale reads dropped");
+      return;
+   }
+
+   switch(event.field) {
+      case RFID_FIELD_EPC:
+         processEpc(event.data, event.timestamp);
+         break;
+      case RFID_FIELD_TID:
+         processTid(event.data, event.timestamp);
+         break;
+      case RFID_FIELD_RFU:
+         processRfu(event.data, event.timestamp);
+         break;
+      default:
+         for(int i = 0; i < RFID_NUM_USER_DATAGRAMS; ++i)
+            if(event.field == static_cast<quint32>(RFID_FIELD_USR << i))
+               processUsr(event.data, i, event.timestamp);
+         break;
+   }
+
+   // Register the reads that were merged with this event (the tag of the
+   // event is the current tag once the event is processed)
+   if(event.lastTimestamp > event.timestamp && currentTag())
+      updateTagTimestamps(currentTag(), event.lastTimestamp);
+}
+
+//------------------------------------------------------------------------------
+// Tag data processing functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID::processEpc
+ * @param epc
+ *
+ * Updates the @a epc data of the current tag or registers a new tag based
+ * on current tag information, @a timestamp is the monotonic time at which
+ * the data was received
+ */
+void RFID::processEpc(const QByteArray& epc, const qint64 timestamp)
+{
+   RegisterLatency(timestamp);
+
+   // Update current tag without allocating a new tag structure, the
+   // watchdog is reset because the tag is still in front of the reader (in
+   // degraded mode, the EPC is the only data read from the current tag)
+   if(currentTag()) {
+      if(currentTag()->epc == epc || currentTag()->epc.isEmpty()) {
+         m_watchdog.start();
+         updateTagData(currentTag(), RFID_FIELD_EPC, epc);
+         updateTagTimestamps(currentTag(), timestamp);
+         return;
+      }
+   }
+
+   // Look for the tag in the history, a tag is only allocated if it is new
+   RFID_Tag* tag = probeTag(timestamp);
+   tag->epc = epc;
+   updateTagList(tag);
+}
+
+/**
+ * @brief RFID::processTid
+ * @param tid
+ *
+ * Updates the @a tid data of the current tag or registers a new tag based
+ * on current tag information, @a timestamp is the monotonic time at which
+ * the data was received
+ */
+void RFID::processTid(const QByteArray& tid, const qint64 timestamp)
+{
+   RegisterLatency(timestamp);
+
+   // Get compact TID
+   const RFID_TagKey key = RFID_TidTable::getInstance()->intern(tid);
+
+   // Update current tag without allocating a new tag structure
+   if(currentTag()) {
+      if(currentTag()->tid == key || !RFID_ValidKey(currentTag()->tid)) {
+         updateTagKey(currentTag(), key);
+         updateTagTimestamps(currentTag(), timestamp);
+         updateTagList(currentTag());
+         return;
+      }
+   }
+
+   // Look for the tag in the history, a tag is only allocated if it is new
+   RFID_Tag* tag = probeTag(timestamp);
+   tag->tid = key;
+   updateTagList(tag);
+}
+
+/**
+ * @brief RFID::processUsr
+ * @param usr user data
+ *
+ * Updates the @a usr data of the current tag or registers a new tag based
+ * on current tag information, @a timestamp is the monotonic time at which
+ * the data was received
+ */
+void RFID::processUsr(const QByteArray& usr, const int datagram,
+                      const qint64 timestamp)
+{
+   Q_ASSERT(datagram < RFID_NUM_USER_DATAGRAMS && datagram >= 0);
+
+   RegisterLatency(timestamp);
+
+   // Update current tag without allocating a new tag structure
+   if(currentTag()) {
+      QByteArray* current = &currentTag()->usr[datagram];
+      if(*current == usr || current->isEmpty()) {
+         updateTagData(currentTag(), RFID_FIELD_USR << datagram, usr);
+         updateTagTimestamps(currentTag(), timestamp);
+         updateTagList(currentTag());
+         return;
+      }
+   }
+
+   // Look for the tag in the history, a tag is only allocated if it is new
+   RFID_Tag* tag = probeTag(timestamp);
+   tag->usr[datagram] = usr;
+   updateTagList(tag);
+}
+
+/**
+ * @brief RFID::processRfu
+ * @param rfu reserved data
+ *
+ * Updates the @a rfu data of the current tag or registers a new tag based
+ * on current tag information, @a timestamp is the monotonic time at which
+ * the data was received
+ */
+void RFID::processRfu(const QByteArray& rfu, const qint64 timestamp)
+{
+   RegisterLatency(timestamp);
+
+   // Update current tag without allocating a new tag structure
+   if(currentTag()) {
+      if(currentTag()->rfu == rfu || currentTag()->rfu.isEmpty()) {
+         updateTagData(currentTag(), RFID_FIELD_RFU, rfu);
+         updateTagTimestamps(currentTag(), timestamp);
+         updateTagList(currentTag());
+         return;
+      }
+   }
+
+   // Look for the tag in the history, a tag is only allocated if it is new
+   RFID_Tag* tag = probeTag(timestamp);
+   tag->rfu = rfu;
+   updateTagList(tag);
+}
+
+//------------------------------------------------------------------------------
+// Tag history management
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID::markModified
+ * @param tag   modified tag
+ * @param fields modified tag fields
+ *
+ * Registers the change in the change set that will be reported with the next
+ * snapshot, increases the tag store generation and schedules the publication
+ * of a new tag list snapshot.
+ */
+void RFID::markModified(const RFID_Tag* tag, const quint32 fields)
+{
+   if(tag && tag->id != 0)
+      m_changes[tag->id] |= fields;
+
+   m_generation.fetchAndAddOrdered(1);
+
+   if(!m_publishPending) {
+      m_publishPending = true;
+      QTimer::singleShot(0, this, &RFID::publishSnapshot);
+   }
+}
+
+/**
+ * @brief RFID::updateTagList
+ * @param tag
+ *
+ * Registers the given @a tag and its data to the tag history list, and manages
+ * the tag list so that data is not duplicated.
+ *
+ * Tags are identified by their TID when it is known, the EPCs read from each
+ * tag are registered as aliases of the tag, so that a tag keeps a single
+ * history entry when its EPC is re-encoded.
+ *
+ * Unregistered tags are given as the probe tag (see @c probeTag()), which is
+ * only copied to a new tag if no registered tag has the same identity.
+ *
+ * @note the @a tag will not be complete, so this function is in charge of
+ *       generating a tag list with complete information over time.
+ */
+void RFID::updateTagList(RFID_Tag* tag)
+{
+   Q_ASSERT(tag != Q_NULLPTR && reader());
+
+   RFID_PROFILE("RFID::updateTagList");
+
+   // Reset watchdog
+   m_watchdog.start();
+
+   // Find the registered tag with the same identity
+   RFID_Tag* match = findTag(tag);
+
+   // Merge data with the registered tag (so we can "slowly" gather more
+   // information about each RFID tag that is being scanned).
+   if(match) {
+      mergeTag(match, tag);
+
+      // Tag was registered twice (e.g. its EPC was re-encoded before its
+      // TID was known), remove the duplicated entry
+      if(tag->id != 0)
+         removeTag(tag);
+   }
+
+   // Tag not found on list, register a copy of the probe tag
+   else if(tag->id == 0) {
+      match = new RFID_Tag(*tag);
+      match->id = ++m_lastTagId;
+      m_store.insert(match);
+      markModified(match, RFID_FIELD_ADDED);
+      emit tagCountChanged();
+   }
+
+   // Tag is registered and unique
+   else
+      match = tag;
+
+   // Register TID & EPC of the tag
+   m_store.index(match);
+
+   // Change current tag
+   if(currentTag() != match) {
+      markModified(currentTag(), RFID_FIELD_PRESENCE);
+      markModified(match, RFID_FIELD_PRESENCE);
+      reader()->setCurrentTag(match);
+      emit currentTagChanged();
+   }
+}
+
+/**
+ * @brief RFID::currentTagId
+ * @returns the ID of the current tag, or 0 if there is no current tag
+ */
+quint32 RFID::currentTagId()
+{
+   if(currentTag())
+      return currentTag()->id;
+
+   return 0;
+}
+
+/**
+ * @brief RFID::probeTag
+ * @param timestamp monotonic time at which the tag was read
+ *
+ * Clears and returns the probe tag, which holds the data of a read that does
+ * not belong to the current tag until it is matched with a registered tag.
+ * Reusing the probe tag avoids allocating a temporary tag whenever the
+ * reader switches between tags that are already registered.
+ */
+RFID_Tag* RFID::probeTag(const qint64 timestamp)
+{
+   m_probe = RFID_Tag();
+   m_probe.firstSeen = timestamp;
+   m_probe.lastSeen = timestamp;
+   return &m_probe;
+}
+
+/**
+ * @brief RFID::findTag
+ * @param tag tag to look for
+ *
+ * Returns the registered tag (other than @a tag) with the same identity as
+ * the given @a tag, or @c NULL if there is no such tag.
+ *
+ * The TID identifies a tag, EPCs are only used to find a tag when the TID of
+ * either tag is unknown (EPCs can be re-encoded and duplicated).
+ */
+RFID_Tag* RFID::findTag(const RFID_Tag* tag) const
+{
+   Q_ASSERT(tag);
+
+   // Look for TID
+   if(RFID_ValidKey(tag->tid)) {
+      RFID_Tag* t = m_store.find(tag->tid);
+      if(t && t != tag)
+         return t;
+   }
+
+   // Look for EPC alias
+   if(!tag->epc.isEmpty()) {
+      RFID_Tag* t = m_store.find(tag->epc);
+      if(t && t != tag && (!RFID_ValidKey(t->tid) || !RFID_ValidKey(tag->tid)))
+         return t;
+   }
+
+   return Q_NULLPTR;
+}
+
+/**
+ * @brief RFID::mergeTag
+ * @param dest registered tag
+ * @param src  tag with the same identity as @a dest
+ *
+ * Copies the known data of @a src into @a dest
+ */
+void RFID::mergeTag(RFID_Tag* dest, const RFID_Tag* src)
+{
+   Q_ASSERT(dest && src);
+
+   updateTagData(dest, RFID_FIELD_EPC, src->epc);
+   updateTagKey(dest, src->tid);
+   updateTagData(dest, RFID_FIELD_RFU, src->rfu);
+
+   for(int i = 0; i < RFID_NUM_USER_DATAGRAMS; ++i)
+      updateTagData(dest, RFID_FIELD_USR << i, src->usr[i]);
+
+   updateTagTimestamps(dest, src->firstSeen);
+   updateTagTimestamps(dest, src->lastSeen);
+}
+
+/**
+ * @brief RFID::removeTag
+ * @param tag registered tag
+ *
+ * Removes the given @a tag from the tag list & indexes and deletes it
+ */
+void RFID::removeTag(RFID_Tag* tag)
+{
+   Q_ASSERT(tag);
+
+   // Make sure that nobody points to the tag
+   if(currentTag() == tag)
+      reader()->setCurrentTag(Q_NULLPTR);
+
+   // Remove tag from the store, its indexes & the tag list
+   m_store.remove(tag);
+
+   // Remove tag history
+   m_writes.remove(tag->id);
+   m_history.remove(tag->id);
+
+   markModified(tag, RFID_FIELD_REMOVED);
+   emit tagCountChanged();
+   delete tag;
+}
+
+/**
+ * @brief RFID::updateTagData
+ * @param tag   tag to update
+ * @param field tag field to update (only one field)
+ * @param src   source byte array
+ *
+ * Compares the contents of the @a field of the @a tag and @a src and
+ * determines if the tag data needs to be updated (the tag is updated
+ * atomically by the tag store). In the eventual case of a tag update, the
+ * appropiate signals are sent by this function.
+ */
+void RFID::updateTagData(RFID_Tag* tag, const quint32 field, const QByteArray& src)
+{
+   QByteArray previous;
+   if(m_store.update(tag, field, src, &previous)) {
+      // Keep the previous data of registered tags in the tag history
+      if(tag->id != 0 && !previous.isEmpty()) {
+         m_history.record(tag->id, field, previous, src,
+                          RFID_Clock::getInstance()->now(),
+                          writerOf(tag, field));
+         RFID_Profiler::getInstance()->setCounter("Tag history bytes",
+                                                  m_history.size());
+      }
+
+      markModified(tag, field);
+      emit tagUpdated();
+
+      // Register EPC alias of registered tags
+      if(field == RFID_FIELD_EPC && tag->id != 0)
+         m_store.index(tag);
+   }
+}
+
+/**
+ * @brief RFID::updateTagKey
+ * @param tag tag to update
+ * @param key compact TID of the tag
+ *
+ * Changes the TID of the given @a tag if the @a key is valid and different
+ * from the current TID of the @a tag.
+ */
+void RFID::updateTagKey(RFID_Tag* tag, const RFID_TagKey& key)
+{
+   Q_ASSERT(tag);
+
+   if(m_store.updateKey(tag, key)) {
+      markModified(tag, RFID_FIELD_TID);
+      emit tagUpdated();
+   }
+}
+
+/**
+ * @brief RFID::registerWrite
+ * @param fields tag fields written to the current tag
+ *
+ * Registers the identity of the writer of the current tag, so that the
+ * changes read from the tag during the next @c RFID_HISTORY_WRITE_TIMEOUT
+ * milliseconds are attributed to the writer.
+ */
+void RFID::registerWrite(const quint32 fields)
+{
+   if(!currentTag())
+      return;
+
+   const qint64 now = RFID_Clock::getInstance()->now();
+   Write& write = m_writes[currentTag()->id];
+   if(write.expires < now || write.writer != writer())
+      write.fields = 0;
+
+   write.fields |= fields;
+   write.writer = writer();
+   write.expires = now + RFID_HISTORY_WRITE_TIMEOUT * Q_INT64_C(1000000);
+}
+
+/**
+ * @brief RFID::writerOf
+ * @param tag   modified tag
+ * @param field modified tag field
+ *
+ * @returns the identity of the writer of the given @a field of the @a tag,
+ *          or an empty string if the change was not requested by this
+ *          application (or if the write is too old)
+ */
+QString RFID::writerOf(const RFID_Tag* tag, const quint32 field)
+{
+   Q_ASSERT(tag);
+
+   QHash<quint32, Write>::iterator it = m_writes.find(tag->id);
+   if(it == m_writes.end())
+      return QString();
+
+   if(it->expires < RFID_Clock::getInstance()->now()) {
+      m_writes.erase(it);
+      return QString();
+   }
+
+   if(it->fields & field)
+      return it->writer;
+
+   return QString();
+}
+
+/**
+ * @brief RFID::updateTagTimestamps
+ * @param tag       tag to update
+ * @param timestamp monotonic time at which the tag was read
+ *
+ * Extends the first seen/last seen interval of the @a tag so that it
+ * includes the given @a timestamp.
+ */
+void RFID::updateTagTimestamps(RFID_Tag* tag, const qint64 timestamp)
+{
+   Q_ASSERT(tag);
+
+   if(m_store.updateTimestamps(tag, timestamp))
+      markModified(tag, RFID_FIELD_SEEN);
+}
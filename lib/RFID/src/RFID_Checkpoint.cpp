@@ -0,0 +1,817 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "RFID.h"
+#include "RFID_Clock.h"
+#include "RFID_Profiler.h"
+#include "RFID_TidTable.h"
+#include "RFID_Checkpoint.h"
+
+#include <QMap>
+#include <QFile>
+#include <QtEndian>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QtConcurrent>
+
+#include <cstring>
+#include <algorithm>
+
+#if defined(Q_OS_WIN)
+#   include <io.h>
+#else
+#   include <unistd.h>
+#endif
+
+/*
+ * Layout of the checkpoint header:
+ *
+ *    Offset  Size  Field
+ *    0       4     Magic ("RFCK")
+ *    4       2     Format version (little endian)
+ *    6       2     CRC-16 of the tag records (little endian)
+ *    8       4     Number of tags (little endian)
+ *    12      4     Size of the tag records (little endian)
+ *    16      8     UTC time of the checkpoint in microseconds (little endian)
+ *    24      8     Checkpoint sequence number (little endian)
+ *
+ * Each tag record begins with the tag ID (4 bytes) and the first/last seen
+ * UTC times (8 bytes each), followed by the TID, EPC, RFU, keys and user
+ * datagrams of the tag, each one prefixed by its length (1 byte).
+ */
+static const char* MAGIC                    = "RFCK";
+static const int HEADER_SIZE                = 32;
+static const int VERSION_OFFSET             = 4;
+static const int CHECKSUM_OFFSET            = 6;
+static const int COUNT_OFFSET               = 8;
+static const int PAYLOAD_SIZE_OFFSET        = 12;
+static const int TIMESTAMP_OFFSET           = 16;
+static const int SEQUENCE_OFFSET            = 24;
+static const int RECORD_FIXED_SIZE          = 20;
+
+/*
+ * Layout of the journal entry header:
+ *
+ *    Offset  Size  Field
+ *    0       4     Magic ("RFCJ")
+ *    4       8     Checkpoint sequence number (little endian)
+ *    12      4     Number of modified tags (little endian)
+ *    16      4     Number of removed tags (little endian)
+ *    20      4     Size of the entry payload (little endian)
+ *    24      2     CRC-16 of the entry payload (little endian)
+ *    26      2     Reserved
+ *
+ * The payload contains the records of the modified tags (encoded like the
+ * tag records of the checkpoint), followed by the IDs of the removed tags
+ * (4 bytes each).
+ */
+static const char* JOURNAL_MAGIC            = "RFCJ";
+static const int ENTRY_HEADER_SIZE          = 28;
+static const int ENTRY_SEQUENCE_OFFSET      = 4;
+static const int ENTRY_MODIFIED_OFFSET      = 12;
+static const int ENTRY_REMOVED_OFFSET       = 16;
+static const int ENTRY_PAYLOAD_SIZE_OFFSET  = 20;
+static const int ENTRY_CHECKSUM_OFFSET      = 24;
+
+//------------------------------------------------------------------------------
+// Encoding functions
+//------------------------------------------------------------------------------
+
+/**
+ * Converts the given monotonic @a timestamp to UTC, unknown timestamps (0)
+ * are kept as they are
+ */
+static inline qint64 ToUtc(const qint64 timestamp)
+{
+   if(timestamp == 0)
+      return 0;
+
+   return RFID_Clock::getInstance()->toUtc(timestamp);
+}
+
+/**
+ * Converts the given @a utc time to the monotonic clock of this session,
+ * unknown timestamps (0) are kept as they are
+ */
+static inline qint64 FromUtc(const qint64 utc)
+{
+   if(utc == 0)
+      return 0;
+
+   return RFID_Clock::getInstance()->fromUtc(utc);
+}
+
+/**
+ * Returns the tag with the given @a id in the @a snapshot, or @c NULL if the
+ * tag is not in the snapshot (snapshot tags are sorted by ID)
+ */
+static const RFID_Tag* FindTag(const RFID_TagSnapshotPtr& snapshot,
+                               const quint32 id)
+{
+   QVector<RFID_Tag>::const_iterator it;
+   it = std::lower_bound(snapshot->tags.constBegin(),
+                         snapshot->tags.constEnd(),
+                         id,
+                         [](const RFID_Tag& tag, const quint32 id) {
+      return tag.id < id;
+   });
+
+   if(it != snapshot->tags.constEnd() && it->id == id)
+      return &(*it);
+
+   return Q_NULLPTR;
+}
+
+/**
+ * Appends the given @a field (prefixed by its length) to the @a data
+ */
+static inline void AppendField(QByteArray& data, const QByteArray& field)
+{
+   const int length = qMin(field.length(), 0xff);
+   data.append(static_cast<char>(length));
+   data.append(field.constData(), length);
+}
+
+/**
+ * Reads a length-prefixed field at the given position and moves the position
+ * after the field, returns @c false if the field exceeds the @a end of the
+ * data
+ */
+static inline bool ReadField(const char** pos,
+                             const char* end,
+                             QByteArray* field)
+{
+   if(*pos >= end)
+      return false;
+
+   const int length = static_cast<quint8>(**pos);
+   *pos += 1;
+   if(end - *pos < length)
+      return false;
+
+   *field = QByteArray(*pos, length);
+   *pos += length;
+   return true;
+}
+
+/**
+ * Appends the record of the given @a tag to the @a data
+ */
+static void AppendTag(QByteArray& data, const RFID_Tag& tag)
+{
+   char fixed[RECORD_FIXED_SIZE];
+   qToLittleEndian<quint32>(tag.id, fixed);
+   qToLittleEndian<qint64>(ToUtc(tag.firstSeen), fixed + 4);
+   qToLittleEndian<qint64>(ToUtc(tag.lastSeen), fixed + 12);
+   data.append(fixed, RECORD_FIXED_SIZE);
+
+   AppendField(data, RFID_TidTable::getInstance()->tid(tag.tid));
+   AppendField(data, tag.epc);
+   AppendField(data, tag.rfu);
+   for(int i = 0; i < RFID_NUM_KEYS; ++i)
+      AppendField(data, tag.keys[i]);
+   for(int i = 0; i < RFID_NUM_USER_DATAGRAMS; ++i)
+      AppendField(data, tag.usr[i]);
+}
+
+/**
+ * Reads the tag record at the given position and moves the position after
+ * the record, returns @c false if the record exceeds the @a end of the data
+ */
+static bool ReadTag(const char** pos, const char* end, RFID_Tag* tag)
+{
+   if(end - *pos < RECORD_FIXED_SIZE)
+      return false;
+
+   tag->id = qFromLittleEndian<quint32>(*pos);
+   tag->firstSeen = FromUtc(qFromLittleEndian<qint64>(*pos + 4));
+   tag->lastSeen = FromUtc(qFromLittleEndian<qint64>(*pos + 12));
+   *pos += RECORD_FIXED_SIZE;
+
+   QByteArray tid;
+   bool ok = ReadField(pos, end, &tid);
+   ok &= ReadField(pos, end, &tag->epc);
+   ok &= ReadField(pos, end, &tag->rfu);
+   for(int j = 0; j < RFID_NUM_KEYS; ++j)
+      ok &= ReadField(pos, end, &tag->keys[j]);
+   for(int j = 0; j < RFID_NUM_USER_DATAGRAMS; ++j)
+      ok &= ReadField(pos, end, &tag->usr[j]);
+
+   if(ok)
+      tag->tid = RFID_TidTable::getInstance()->intern(tid);
+
+   return ok;
+}
+
+/**
+ * Encodes a journal entry with the given @a sequence number, containing the
+ * given @a ids: tags found in the @a snapshot are registered as modified,
+ * and the other ones as removed.
+ */
+static QByteArray Entry(const RFID_TagSnapshotPtr& snapshot,
+                        const QVector<quint32>& ids,
+                        const quint64 sequence)
+{
+   // Encode modified tags and collect removed tags
+   quint32 modified = 0;
+   QVector<quint32> removed;
+   QByteArray data(ENTRY_HEADER_SIZE, 0);
+   foreach(const quint32 id, ids) {
+      const RFID_Tag* tag = FindTag(snapshot, id);
+      if(tag) {
+         AppendTag(data, *tag);
+         ++modified;
+      }
+
+      else
+         removed.append(id);
+   }
+
+   // Encode removed tags
+   char id[4];
+   foreach(const quint32 tag, removed) {
+      qToLittleEndian<quint32>(tag, id);
+      data.append(id, 4);
+   }
+
+   // Fill header
+   const uint payloadSize =
+      static_cast<uint>(data.length() - ENTRY_HEADER_SIZE);
+   char* header = data.data();
+   memcpy(header, JOURNAL_MAGIC, 4);
+   qToLittleEndian<quint64>(sequence, header + ENTRY_SEQUENCE_OFFSET);
+   qToLittleEndian<quint32>(modified, header + ENTRY_MODIFIED_OFFSET);
+   qToLittleEndian<quint32>(static_cast<quint32>(removed.count()),
+                            header + ENTRY_REMOVED_OFFSET);
+   qToLittleEndian<quint32>(payloadSize, header + ENTRY_PAYLOAD_SIZE_OFFSET);
+   qToLittleEndian<quint16>(qChecksum(header + ENTRY_HEADER_SIZE, payloadSize),
+                            header + ENTRY_CHECKSUM_OFFSET);
+
+   return data;
+}
+
+/**
+ * Flushes the data written to the given @a file to the storage device
+ */
+static bool Sync(QFile& file)
+{
+   if(!file.flush())
+      return false;
+
+#if defined(Q_OS_WIN)
+   return _commit(file.handle()) == 0;
+#else
+   return fsync(file.handle()) == 0;
+#endif
+}
+
+/**
+ * Appends a journal entry with the tags of the given @a ids to the journal
+ * file, this function is executed by a worker thread (or by the owner thread
+ * when the checkpoint is closed). The journal is truncated back to its
+ * previous size if the entry cannot be written completely.
+ *
+ * Each entry already holds every tag modified during the last checkpoint
+ * interval, so the entry is synced to the storage device as a single batch.
+ *
+ * Returns an empty string on success, or the description of the error.
+ */
+static QString Append(const QString& journalName,
+                      const RFID_TagSnapshotPtr& snapshot,
+                      const QVector<quint32>& ids,
+                      const quint64 sequence)
+{
+   RFID_PROFILE("RFID_Checkpoint::append");
+
+   const QByteArray data = Entry(snapshot, ids, sequence);
+
+   QFile file(journalName);
+   if(!file.open(QFile::ReadWrite))
+      return file.errorString();
+
+   const qint64 size = file.size();
+   if(!file.seek(size))
+      return file.errorString();
+
+   if(file.write(data) != data.length() || !Sync(file)) {
+      const QString error = file.errorString();
+      file.resize(size);
+      return error;
+   }
+
+   return QString();
+}
+
+/**
+ * Encodes the tags of the given @a snapshot and replaces the checkpoint file
+ * with them, then empties the journal, since its entries are included in the
+ * new checkpoint. This function is executed by a worker thread.
+ *
+ * Returns an empty string on success, or the description of the error.
+ */
+static QString Write(const QString& fileName,
+                     const QString& journalName,
+                     const RFID_TagSnapshotPtr& snapshot,
+                     const quint64 sequence)
+{
+   RFID_PROFILE("RFID_Checkpoint::write");
+
+   // Encode tag records after the header
+   QByteArray data(HEADER_SIZE, 0);
+   data.reserve(HEADER_SIZE + snapshot->tags.count() * 128);
+   foreach(const RFID_Tag& tag, snapshot->tags)
+      AppendTag(data, tag);
+
+   // Fill header
+   const qint64 now = RFID_Clock::getInstance()->now();
+   const uint payloadSize = static_cast<uint>(data.length() - HEADER_SIZE);
+   char* header = data.data();
+   memcpy(header, MAGIC, 4);
+   qToLittleEndian<quint16>(RFID_CHECKPOINT_VERSION, header + VERSION_OFFSET);
+   qToLittleEndian<quint16>(qChecksum(header + HEADER_SIZE, payloadSize),
+                            header + CHECKSUM_OFFSET);
+   qToLittleEndian<quint32>(static_cast<quint32>(snapshot->tags.count()),
+                            header + COUNT_OFFSET);
+   qToLittleEndian<quint32>(payloadSize, header + PAYLOAD_SIZE_OFFSET);
+   qToLittleEndian<qint64>(ToUtc(now), header + TIMESTAMP_OFFSET);
+   qToLittleEndian<quint64>(sequence, header + SEQUENCE_OFFSET);
+
+   // Replace the checkpoint file atomically
+   QSaveFile file(fileName);
+   if(!file.open(QSaveFile::WriteOnly))
+      return file.errorString();
+
+   if(file.write(data) != data.length()) {
+      const QString error = file.errorString();
+      file.cancelWriting();
+      return error;
+   }
+
+   if(!file.commit())
+      return file.errorString();
+
+   // Empty the journal, the entries left by a failure are older than the new
+   // checkpoint and are skipped when it is restored
+   QFile journal(journalName);
+   if(journal.exists() && !journal.resize(0))
+      return journal.errorString();
+
+   return QString();
+}
+
+/**
+ * Validates the checkpoint at the given @a data and rebuilds its tags,
+ * returns @c false if the checkpoint is invalid or incomplete
+ */
+static bool Parse(const char* data,
+                  const qint64 size,
+                  QVector<RFID_Tag>* tags,
+                  quint64* sequence)
+{
+   Q_ASSERT(data && tags && sequence);
+
+   // Validate header
+   if(size < HEADER_SIZE || memcmp(data, MAGIC, 4) != 0)
+      return false;
+
+   const quint16 version = qFromLittleEndian<quint16>(data + VERSION_OFFSET);
+   const quint16 checksum = qFromLittleEndian<quint16>(data + CHECKSUM_OFFSET);
+   const quint32 count = qFromLittleEndian<quint32>(data + COUNT_OFFSET);
+   const quint32 payloadSize =
+      qFromLittleEndian<quint32>(data + PAYLOAD_SIZE_OFFSET);
+   if(version != RFID_CHECKPOINT_VERSION || payloadSize != size - HEADER_SIZE)
+      return false;
+
+   // Validate tag records
+   const char* pos = data + HEADER_SIZE;
+   if(qChecksum(pos, payloadSize) != checksum)
+      return false;
+
+   // Rebuild tags
+   const char* end = pos + payloadSize;
+   tags->reserve(static_cast<int>(qMin<quint32>(count, payloadSize)));
+   for(quint32 i = 0; i < count; ++i) {
+      RFID_Tag tag;
+      if(!ReadTag(&pos, end, &tag))
+         return false;
+
+      tags->append(tag);
+   }
+
+   *sequence = qFromLittleEndian<quint64>(data + SEQUENCE_OFFSET);
+   return pos == end;
+}
+
+/**
+ * Applies the entries of the journal at the given @a data with a sequence
+ * number greater than the given @a sequence to the @a tags, and updates
+ * @a sequence with the last applied entry.
+ *
+ * Returns the size of the valid entries, the rest of the journal (e.g. an
+ * entry torn by a power loss) is ignored.
+ */
+static qint64 Replay(const char* data,
+                     const qint64 size,
+                     QMap<quint32, RFID_Tag>* tags,
+                     quint64* sequence)
+{
+   Q_ASSERT(data && tags && sequence);
+
+   qint64 offset = 0;
+   while(size - offset >= ENTRY_HEADER_SIZE) {
+      // Validate entry
+      const char* header = data + offset;
+      if(memcmp(header, JOURNAL_MAGIC, 4) != 0)
+         break;
+
+      const quint32 payloadSize =
+         qFromLittleEndian<quint32>(header + ENTRY_PAYLOAD_SIZE_OFFSET);
+      if(payloadSize > size - offset - ENTRY_HEADER_SIZE)
+         break;
+
+      const char* pos = header + ENTRY_HEADER_SIZE;
+      const char* end = pos + payloadSize;
+      const quint16 checksum =
+         qFromLittleEndian<quint16>(header + ENTRY_CHECKSUM_OFFSET);
+      if(qChecksum(pos, payloadSize) != checksum)
+         break;
+
+      // Decode entry
+      bool ok = true;
+      QVector<RFID_Tag> modified;
+      const quint32 modifiedCount =
+         qFromLittleEndian<quint32>(header + ENTRY_MODIFIED_OFFSET);
+      const quint32 removedCount =
+         qFromLittleEndian<quint32>(header + ENTRY_REMOVED_OFFSET);
+      for(quint32 i = 0; ok && i < modifiedCount; ++i) {
+         RFID_Tag tag;
+         ok = ReadTag(&pos, end, &tag);
+         modified.append(tag);
+      }
+
+      if(!ok || end - pos != static_cast<qint64>(removedCount) * 4)
+         break;
+
+      // Apply entry (entries already included in the checkpoint are skipped)
+      offset += ENTRY_HEADER_SIZE + payloadSize;
+      const quint64 entrySequence =
+         qFromLittleEndian<quint64>(header + ENTRY_SEQUENCE_OFFSET);
+      if(entrySequence <= *sequence)
+         continue;
+
+      *sequence = entrySequence;
+      foreach(const RFID_Tag& tag, modified)
+         tags->insert(tag.id, tag);
+      for(quint32 i = 0; i < removedCount; ++i, pos += 4)
+         tags->remove(qFromLittleEndian<quint32>(pos));
+   }
+
+   return offset;
+}
+
+/**
+ * Maps the given @a file to memory (or reads it to the @a buffer if it cannot
+ * be mapped), returns a pointer to the file contents and their @a size
+ */
+static const char* Map(QFile& file, QByteArray& buffer, qint64* size)
+{
+   *size = file.size();
+   const char* data = reinterpret_cast<const char*>(file.map(0, *size));
+   if(!data) {
+      buffer = file.readAll();
+      data = buffer.constData();
+      *size = buffer.size();
+   }
+
+   return data;
+}
+
+/**
+ * Unmaps the @a data returned by @c Map(), if it was mapped to memory
+ */
+static void Unmap(QFile& file, const QByteArray& buffer, const char* data)
+{
+   if(data != buffer.constData())
+      file.unmap(reinterpret_cast<uchar*>(const_cast<char*>(data)));
+}
+
+//------------------------------------------------------------------------------
+// Constructor & destructor
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_Checkpoint::RFID_Checkpoint
+ *
+ * Configures the checkpoint timer and begins tracking the changes of the tag
+ * store
+ */
+RFID_Checkpoint::RFID_Checkpoint(QObject* parent) : QObject(parent)
+{
+   m_compact = false;
+   m_sequence = 0;
+
+   m_timer.setInterval(RFID_CHECKPOINT_INTERVAL);
+   connect(&m_timer, &QTimer::timeout, this, &RFID_Checkpoint::save);
+   connect(&m_watcher, &QFutureWatcher<QString>::finished,
+           this, &RFID_Checkpoint::onSaved);
+   connect(RFID::getInstance(), &RFID::tagsChanged,
+           this, &RFID_Checkpoint::onTagsChanged);
+}
+
+/**
+ * @brief RFID_Checkpoint::~RFID_Checkpoint
+ *
+ * Saves the final changes of the session
+ */
+RFID_Checkpoint::~RFID_Checkpoint()
+{
+   close();
+}
+
+//------------------------------------------------------------------------------
+// Checkpoint information functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_Checkpoint::isOpen
+ * @returns @c true if checkpoints are being saved
+ */
+bool RFID_Checkpoint::isOpen() const
+{
+   return !m_fileName.isEmpty();
+}
+
+/**
+ * @brief RFID_Checkpoint::fileName
+ * @returns the path of the checkpoint file
+ */
+QString RFID_Checkpoint::fileName() const
+{
+   return m_fileName;
+}
+
+/**
+ * @brief RFID_Checkpoint::errorString
+ * @returns a description of the last restore or save error
+ */
+QString RFID_Checkpoint::errorString() const
+{
+   return m_error;
+}
+
+//------------------------------------------------------------------------------
+// Checkpoint control functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_Checkpoint::open
+ * @param fileName path of the checkpoint file
+ *
+ * Restores the tag history saved in the given checkpoint file and its journal
+ * (if any) and begins saving the changes of the tag store every
+ * @c RFID_CHECKPOINT_INTERVAL milliseconds.
+ *
+ * Returns @c false if the existing checkpoint cannot be restored, in that
+ * case the tag history is not modified, and the invalid checkpoint is
+ * replaced by the next one.
+ */
+bool RFID_Checkpoint::open(const QString& fileName)
+{
+   close();
+
+   m_error.clear();
+   m_sequence = 0;
+   m_fileName = fileName;
+   m_compact = !QFile::exists(fileName);
+   const bool restored = restore();
+
+   // The restored tags are already saved, publish them and discard their
+   // changes so that they are not written to the journal again
+   RFID::getInstance()->snapshot();
+   m_dirty.clear();
+   m_timer.start();
+
+   return restored;
+}
+
+/**
+ * @brief RFID_Checkpoint::save
+ *
+ * Appends the tags modified since the last checkpoint to the journal in a
+ * worker thread, or compacts the journal into a new checkpoint file if the
+ * journal has grown larger than the checkpoint. Nothing is done if the tag
+ * store has not changed, or if the previous checkpoint is still being written.
+ */
+void RFID_Checkpoint::save()
+{
+   if(!isOpen() || m_watcher.isRunning())
+      return;
+
+   // Obtain the latest snapshot (and its changes)
+   const RFID_TagSnapshotPtr snapshot = RFID::getInstance()->snapshot();
+   if(!snapshot)
+      return;
+
+   // Compact the journal into a new checkpoint
+   const qint64 journalSize = QFileInfo(journalName()).size();
+   const qint64 limit = qMax<qint64>(RFID_CHECKPOINT_JOURNAL,
+                                     QFileInfo(m_fileName).size());
+   if(m_compact || journalSize > limit) {
+      m_dirty.clear();
+      m_compact = false;
+      RFID_Profiler::getInstance()->addCount("Checkpoint compactions");
+      m_watcher.setFuture(QtConcurrent::run(Write,
+                                            m_fileName,
+                                            journalName(),
+                                            snapshot,
+                                            ++m_sequence));
+      return;
+   }
+
+   // Append the modified tags to the journal
+   if(!m_dirty.isEmpty())
+      m_watcher.setFuture(QtConcurrent::run(Append,
+                                            journalName(),
+                                            snapshot,
+                                            takeDirtyTags(),
+                                            ++m_sequence));
+}
+
+/**
+ * @brief RFID_Checkpoint::close
+ *
+ * Waits for the checkpoint being written (if any), appends the latest changes
+ * of the tag store to the journal and stops saving checkpoints. A complete
+ * checkpoint is only written here if there is no valid checkpoint file.
+ */
+void RFID_Checkpoint::close()
+{
+   if(!isOpen())
+      return;
+
+   m_timer.stop();
+   m_watcher.waitForFinished();
+
+   QString error;
+   const RFID_TagSnapshotPtr snapshot = RFID::getInstance()->snapshot();
+   if(snapshot && m_compact)
+      error = Write(m_fileName, journalName(), snapshot, ++m_sequence);
+   else if(snapshot && !m_dirty.isEmpty())
+      error = Append(journalName(), snapshot, takeDirtyTags(), ++m_sequence);
+
+   if(!error.isEmpty())
+      m_error = error;
+
+   m_dirty.clear();
+   m_compact = false;
+   m_fileName.clear();
+}
+
+//------------------------------------------------------------------------------
+// Private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_Checkpoint::onSaved
+ *
+ * Registers the result of the checkpoint written by the worker thread. The
+ * changes of a failed journal entry are lost, so the next checkpoint is a
+ * complete one.
+ */
+void RFID_Checkpoint::onSaved()
+{
+   const QString error = m_watcher.result();
+   if(error.isEmpty()) {
+      RFID_Profiler::getInstance()->addCount("Checkpoints saved");
+      return;
+   }
+
+   m_error = error;
+   m_compact = true;
+   RFID_Profiler::getInstance()->addCount("Checkpoint errors");
+}
+
+/**
+ * @brief RFID_Checkpoint::onTagsChanged
+ *
+ * Registers the tags of the given change set, which are written to the
+ * journal with the next checkpoint
+ */
+void RFID_Checkpoint::onTagsChanged(const RFID_ChangeSet& changes)
+{
+   if(!isOpen())
+      return;
+
+   foreach(const RFID_TagChange& change, changes.changes)
+      m_dirty.insert(change.tag);
+}
+
+/**
+ * @brief RFID_Checkpoint::journalName
+ * @returns the path of the journal file of the checkpoint
+ */
+QString RFID_Checkpoint::journalName() const
+{
+   return m_fileName + ".journal";
+}
+
+/**
+ * @brief RFID_Checkpoint::takeDirtyTags
+ * @returns the IDs of the tags modified since the last checkpoint, sorted,
+ *          and clears them
+ */
+QVector<quint32> RFID_Checkpoint::takeDirtyTags()
+{
+   QVector<quint32> ids;
+   ids.reserve(m_dirty.count());
+   foreach(const quint32 id, m_dirty)
+      ids.append(id);
+
+   m_dirty.clear();
+   std::sort(ids.begin(), ids.end());
+   return ids;
+}
+
+/**
+ * @brief RFID_Checkpoint::restore
+ *
+ * Memory-maps the checkpoint file and its journal and replaces the tag
+ * history with their tags, returns @c true if there is no checkpoint file.
+ * Torn entries at the end of the journal are removed.
+ */
+bool RFID_Checkpoint::restore()
+{
+   RFID_PROFILE("RFID_Checkpoint::restore");
+
+   // Nothing to restore
+   QFile file(m_fileName);
+   if(!file.exists())
+      return true;
+
+   // Open file
+   if(!file.open(QFile::ReadOnly)) {
+      m_error = file.errorString();
+      m_compact = true;
+      return false;
+   }
+
+   // Rebuild tags
+   qint64 size;
+   QByteArray buffer;
+   QVector<RFID_Tag> tags;
+   quint64 sequence = 0;
+   const char* data = Map(file, buffer, &size);
+   const bool valid = Parse(data, size, &tags, &sequence);
+   Unmap(file, buffer, data);
+
+   // Checkpoint is corrupted
+   if(!valid) {
+      m_error = tr("Invalid checkpoint file");
+      m_compact = true;
+      return false;
+   }
+
+   // Apply the journal entries written after the checkpoint
+   QFile journal(journalName());
+   if(journal.size() > 0 && journal.open(QFile::ReadWrite)) {
+      QMap<quint32, RFID_Tag> map;
+      foreach(const RFID_Tag& tag, tags)
+         map.insert(tag.id, tag);
+
+      const quint64 base = sequence;
+      data = Map(journal, buffer, &size);
+      const qint64 length = Replay(data, size, &map, &sequence);
+      if(sequence != base)
+         tags = map.values().toVector();
+
+      Unmap(journal, buffer, data);
+      if(length < size)
+         journal.resize(length);
+   }
+
+   // Replace tag history
+   m_sequence = sequence;
+   RFID::getInstance()->restore(tags);
+   RFID_Profiler::getInstance()->setCounter("Checkpoint restored tags",
+                                            tags.count());
+   return true;
+}
@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "RFID_Clock.h"
+
+/**
+ * Pointer to the only instance of the @c RFID_Clock class
+ */
+static RFID_Clock* INSTANCE = Q_NULLPTR;
+
+//------------------------------------------------------------------------------
+// Constructor & instance access functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_Clock::RFID_Clock
+ *
+ * Starts the monotonic clock, calibrates the UTC mapping and configures the
+ * periodic re-calibration timer
+ */
+RFID_Clock::RFID_Clock()
+{
+   m_clock.start();
+   m_offset.store(0);
+   m_uncertainty.store(0);
+   calibrate();
+
+   m_timer.setInterval(RFID_CLOCK_CALIBRATION_INTERVAL);
+   connect(&m_timer, &QTimer::timeout, this, &RFID_Clock::calibrate);
+   m_timer.start();
+}
+
+/**
+ * @brief RFID_Clock::getInstance
+ * @returns the only instance of the @c RFID_Clock class
+ */
+RFID_Clock* RFID_Clock::getInstance()
+{
+   if(INSTANCE == Q_NULLPTR)
+      INSTANCE = new RFID_Clock;
+
+   return INSTANCE;
+}
+
+//------------------------------------------------------------------------------
+// Time access functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_Clock::now
+ * @returns the current monotonic timestamp in nanoseconds, this function can
+ *          be called from any thread
+ */
+qint64 RFID_Clock::now() const
+{
+   return m_clock.nsecsElapsed();
+}
+
+/**
+ * @brief RFID_Clock::offset
+ * @returns the difference (in microseconds) between the UTC wall clock and
+ *          the monotonic clock obtained during the last calibration
+ */
+qint64 RFID_Clock::offset() const
+{
+   return m_offset.load();
+}
+
+/**
+ * @brief RFID_Clock::uncertainty
+ * @returns the maximum error (in microseconds) of the monotonic to UTC
+ *          mapping obtained during the last calibration
+ */
+qint64 RFID_Clock::uncertainty() const
+{
+   return m_uncertainty.load();
+}
+
+/**
+ * @brief RFID_Clock::toUtc
+ * @param timestamp monotonic timestamp in nanoseconds
+ * @returns the UTC time (in microseconds since the epoch) of the given
+ *          monotonic @a timestamp
+ */
+qint64 RFID_Clock::toUtc(const qint64 timestamp) const
+{
+   return timestamp / 1000 + offset();
+}
+
+/**
+ * @brief RFID_Clock::fromUtc
+ * @param utc UTC time in microseconds since the epoch
+ * @returns the monotonic timestamp (in nanoseconds) of the given @a utc time,
+ *          times before the start of the clock give negative timestamps
+ */
+qint64 RFID_Clock::fromUtc(const qint64 utc) const
+{
+   return (utc - offset()) * 1000;
+}
+
+/**
+ * @brief RFID_Clock::toDateTime
+ * @param timestamp monotonic timestamp in nanoseconds
+ * @returns the UTC date/time of the given monotonic @a timestamp
+ */
+QDateTime RFID_Clock::toDateTime(const qint64 timestamp) const
+{
+   return QDateTime::fromMSecsSinceEpoch(toUtc(timestamp) / 1000, Qt::UTC);
+}
+
+//------------------------------------------------------------------------------
+// Calibration functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_Clock::calibrate
+ *
+ * Obtains the offset between the UTC wall clock and the monotonic clock.
+ *
+ * The wall clock only has a resolution of one millisecond, so this function
+ * waits for the wall clock to tick and reads the monotonic clock right before
+ * and after the tick. The moment of the tick is known with a precision of
+ * a few microseconds, which is much better than reading both clocks at a
+ * random point in time.
+ */
+void RFID_Clock::calibrate()
+{
+   const qint64 start = QDateTime::currentMSecsSinceEpoch();
+   const qint64 deadline = now() + 2 * 1000 * 1000;
+
+   // Wait for the wall clock to tick (at most two milliseconds)
+   qint64 wall = start;
+   qint64 before = now();
+   qint64 after = before;
+   while(wall == start && after < deadline) {
+      before = after;
+      wall = QDateTime::currentMSecsSinceEpoch();
+      after = now();
+   }
+
+   // The tick happened between the last two monotonic clock readings
+   const qint64 tick = (before + after) / 2 / 1000;
+   m_offset.store(wall * 1000 - tick);
+
+   // Wall clock did not tick, the error is the clock resolution
+   if(wall == start)
+      m_uncertainty.store(1000);
+   else
+      m_uncertainty.store((after - before) / 2 / 1000 + 1);
+}
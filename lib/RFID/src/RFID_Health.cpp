@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "RFID_Health.h"
+
+/*
+ * Score penalties of each kind of link error, a window in which every command
+ * times out or every packet is corrupted scores 40 points at most
+ */
+static const double TIMEOUT_PENALTY         = 60;
+static const double CHECKSUM_PENALTY        = 60;
+static const int RESYNC_PENALTY             = 5;
+static const int MAX_RESYNC_PENALTY         = 30;
+static const double DRIFT_PENALTY           = 20;
+static const double MAX_DRIFT_PENALTY       = 30;
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_Health::RFID_Health
+ *
+ * Initializes the score and begins the periodic evaluation of the link
+ */
+RFID_Health::RFID_Health(QObject* parent) : QObject(parent)
+{
+   m_baseline = 0;
+   m_degraded = false;
+   reset();
+
+   m_timer.setInterval(RFID_HEALTH_WINDOW);
+   connect(&m_timer, &QTimer::timeout, this, &RFID_Health::update);
+   m_timer.start();
+}
+
+//------------------------------------------------------------------------------
+// Status access functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_Health::score
+ * @returns the current health score, from 0 (unusable) to 100 (no errors)
+ */
+int RFID_Health::score() const
+{
+   return m_score;
+}
+
+/**
+ * @brief RFID_Health::degraded
+ * @returns @c true if the driver should use its degraded scan plan
+ */
+bool RFID_Health::degraded() const
+{
+   return m_degraded;
+}
+
+/**
+ * @brief RFID_Health::baseline
+ * @returns the expected round-trip time (in microseconds), or 0 if unknown
+ */
+qint64 RFID_Health::baseline() const
+{
+   return m_baseline;
+}
+
+//------------------------------------------------------------------------------
+// Event registration functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_Health::reset
+ *
+ * Restores the score of a healthy link, this is used when the serial device
+ * is connected or disconnected
+ */
+void RFID_Health::reset()
+{
+   m_score = 100;
+   m_packets = 0;
+   m_resyncs = 0;
+   m_timeouts = 0;
+   m_responses = 0;
+   m_roundTrips = 0;
+   m_checksumErrors = 0;
+
+   if(m_degraded) {
+      m_degraded = false;
+      emit degradedChanged(false);
+   }
+}
+
+/**
+ * @brief RFID_Health::addPacket
+ *
+ * Registers a packet that was received and verified successfully
+ */
+void RFID_Health::addPacket()
+{
+   ++m_packets;
+}
+
+/**
+ * @brief RFID_Health::addResync
+ *
+ * Registers a re-synchronization of the receive buffer (garbage data that
+ * had to be skipped, or data that had to be dropped)
+ */
+void RFID_Health::addResync()
+{
+   ++m_resyncs;
+}
+
+/**
+ * @brief RFID_Health::addTimeout
+ *
+ * Registers a command that was not answered in time
+ */
+void RFID_Health::addTimeout()
+{
+   ++m_timeouts;
+}
+
+/**
+ * @brief RFID_Health::addChecksumError
+ *
+ * Registers a packet that was discarded because of an invalid checksum
+ */
+void RFID_Health::addChecksumError()
+{
+   ++m_checksumErrors;
+}
+
+/**
+ * @brief RFID_Health::addResponse
+ * @param roundTrip time (in microseconds) between the command and its response
+ */
+void RFID_Health::addResponse(const qint64 roundTrip)
+{
+   ++m_responses;
+   m_roundTrips += roundTrip;
+}
+
+/**
+ * @brief RFID_Health::setBaseline
+ * @param roundTrip expected round-trip time (in microseconds), the health
+ *        score is reduced if the measured round-trip time drifts above it
+ */
+void RFID_Health::setBaseline(const qint64 roundTrip)
+{
+   m_baseline = roundTrip;
+}
+
+//------------------------------------------------------------------------------
+// Score calculation
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_Health::update
+ *
+ * Calculates the score of the events registered since the previous call,
+ * updates the rolling score and switches the degraded status (with
+ * hysteresis) if needed.
+ */
+void RFID_Health::update()
+{
+   const int commands = m_responses + m_timeouts;
+   const int packets = m_packets + m_checksumErrors;
+
+   // No traffic in this window, keep current score
+   if(commands == 0 && packets == 0 && m_resyncs == 0)
+      return;
+
+   // Calculate window penalty
+   double penalty = 0;
+   if(commands > 0)
+      penalty += TIMEOUT_PENALTY * m_timeouts / commands;
+   if(packets > 0)
+      penalty += CHECKSUM_PENALTY * m_checksumErrors / packets;
+
+   penalty += qMin(m_resyncs * RESYNC_PENALTY, MAX_RESYNC_PENALTY);
+
+   if(m_baseline > 0 && m_responses > 0) {
+      const double average = static_cast<double>(m_roundTrips) / m_responses;
+      const double drift = average / m_baseline - 1;
+      if(drift > 0)
+         penalty += qMin(drift * DRIFT_PENALTY, MAX_DRIFT_PENALTY);
+   }
+
+   // Update rolling score
+   const int window = qBound(0, qRound(100 - penalty), 100);
+   const int score = (m_score * (100 - RFID_HEALTH_SMOOTHING)
+                      + window * RFID_HEALTH_SMOOTHING + 50) / 100;
+
+   // Reset window counters
+   m_packets = 0;
+   m_resyncs = 0;
+   m_timeouts = 0;
+   m_responses = 0;
+   m_roundTrips = 0;
+   m_checksumErrors = 0;
+
+   // Notify score changes
+   if(score != m_score) {
+      m_score = score;
+      emit scoreChanged(m_score);
+   }
+
+   // Switch degraded status
+   if(!m_degraded && m_score < RFID_HEALTH_DEGRADED) {
+      m_degraded = true;
+      emit degradedChanged(true);
+   }
+
+   else if(m_degraded && m_score > RFID_HEALTH_RECOVERED) {
+      m_degraded = false;
+      emit degradedChanged(false);
+   }
+}
@@ -0,0 +1,434 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "RFID_Clock.h"
+#include "RFID_Profiler.h"
+#include "RFID_JobLedger.h"
+
+#include <QtEndian>
+
+#include <cstring>
+
+#if defined(Q_OS_WIN)
+#   include <io.h>
+#else
+#   include <unistd.h>
+#endif
+
+/*
+ * Layout of a ledger record:
+ *
+ *    Offset  Size  Field
+ *    0       1     Magic byte
+ *    1       1     Job state
+ *    2       1     TID length
+ *    3       1     Reserved
+ *    4       8     UTC timestamp in microseconds (little endian)
+ *    12      16    TID (padded with zeroes)
+ *    28      4     Job index, or -1 if no job was assigned (little endian)
+ *    32      2     Reserved
+ *    34      2     CRC-16 of bytes 0-33 (little endian)
+ */
+static const quint8 RECORD_MAGIC            = 0x4c;
+static const int TIMESTAMP_OFFSET           = 4;
+static const int TID_OFFSET                 = 12;
+static const int JOB_OFFSET                 = 28;
+static const int CHECKSUM_OFFSET            = 34;
+
+//------------------------------------------------------------------------------
+// Utility functions
+//------------------------------------------------------------------------------
+
+/**
+ * Returns @c true if the given @a record is complete and its checksum is valid
+ */
+static bool ValidRecord(const char* record)
+{
+   if(static_cast<quint8>(record[0]) != RECORD_MAGIC)
+      return false;
+
+   if(static_cast<quint8>(record[1]) > RFID_JOB_LOCKED)
+      return false;
+
+   if(static_cast<quint8>(record[2]) > RFID_LEDGER_TID_SIZE)
+      return false;
+
+   const quint16 checksum = qFromLittleEndian<quint16>(record + CHECKSUM_OFFSET);
+   return checksum == qChecksum(record, CHECKSUM_OFFSET);
+}
+
+/**
+ * Generates a ledger record for the given @a tid, @a state and @a job
+ */
+static QByteArray Record(const QByteArray& tid,
+                         const RFID_JobState state,
+                         const int job)
+{
+   QByteArray record(RFID_LEDGER_RECORD_SIZE, 0);
+   char* data = record.data();
+
+   const qint64 now = RFID_Clock::getInstance()->now();
+   const qint64 timestamp = RFID_Clock::getInstance()->toUtc(now);
+
+   data[0] = static_cast<char>(RECORD_MAGIC);
+   data[1] = static_cast<char>(state);
+   data[2] = static_cast<char>(tid.length());
+   qToLittleEndian<qint64>(timestamp, data + TIMESTAMP_OFFSET);
+   memcpy(data + TID_OFFSET, tid.constData(), static_cast<size_t>(tid.length()));
+   qToLittleEndian<qint32>(job, data + JOB_OFFSET);
+   qToLittleEndian<quint16>(qChecksum(data, CHECKSUM_OFFSET),
+                            data + CHECKSUM_OFFSET);
+
+   return record;
+}
+
+/**
+ * Flushes the data written to the given @a file to the storage device
+ */
+static bool Sync(QFile& file)
+{
+   if(!file.flush())
+      return false;
+
+#if defined(Q_OS_WIN)
+   return _commit(file.handle()) == 0;
+#else
+   return fsync(file.handle()) == 0;
+#endif
+}
+
+//------------------------------------------------------------------------------
+// Constructor & destructor
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_JobLedger::RFID_JobLedger
+ *
+ * Configures the group commit timer
+ */
+RFID_JobLedger::RFID_JobLedger(QObject* parent) : QObject(parent)
+{
+   m_pendingRecords = 0;
+
+   m_timer.setSingleShot(true);
+   m_timer.setInterval(RFID_LEDGER_COMMIT_INTERVAL);
+   connect(&m_timer, &QTimer::timeout, this, &RFID_JobLedger::commit);
+}
+
+/**
+ * @brief RFID_JobLedger::~RFID_JobLedger
+ *
+ * Commits the pending records and closes the ledger file
+ */
+RFID_JobLedger::~RFID_JobLedger()
+{
+   close();
+}
+
+//------------------------------------------------------------------------------
+// Status access functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_JobLedger::isOpen
+ * @returns @c true if a ledger file is open
+ */
+bool RFID_JobLedger::isOpen() const
+{
+   return m_file.isOpen();
+}
+
+/**
+ * @brief RFID_JobLedger::tagCount
+ * @returns the number of tags with a committed record in the ledger
+ */
+int RFID_JobLedger::tagCount() const
+{
+   return m_states.count();
+}
+
+/**
+ * @brief RFID_JobLedger::pendingCount
+ * @returns the number of records that are not committed yet
+ */
+int RFID_JobLedger::pendingCount() const
+{
+   return m_pendingRecords;
+}
+
+/**
+ * @brief RFID_JobLedger::fileName
+ * @returns the path of the ledger file
+ */
+QString RFID_JobLedger::fileName() const
+{
+   return m_file.fileName();
+}
+
+/**
+ * @brief RFID_JobLedger::errorString
+ * @returns a description of the last file error
+ */
+QString RFID_JobLedger::errorString() const
+{
+   return m_error;
+}
+
+/**
+ * @brief RFID_JobLedger::state
+ * @returns the latest state registered for the tag with the given @a tid
+ */
+RFID_JobState RFID_JobLedger::state(const QByteArray& tid) const
+{
+   if(m_pendingStates.contains(tid))
+      return static_cast<RFID_JobState>(m_pendingStates.value(tid));
+
+   return static_cast<RFID_JobState>(m_states.value(tid, RFID_JOB_NONE));
+}
+
+/**
+ * @brief RFID_JobLedger::done
+ * @returns @c true if the tag with the given @a tid has reached the given
+ *          @a target state, in which case the encoder can skip it
+ */
+bool RFID_JobLedger::done(const QByteArray& tid,
+                          const RFID_JobState target) const
+{
+   return state(tid) >= target;
+}
+
+/**
+ * @brief RFID_JobLedger::jobState
+ * @returns the latest state registered for the tag assigned to the job with
+ *          the given index
+ */
+RFID_JobState RFID_JobLedger::jobState(const int job) const
+{
+   if(m_pendingJobs.contains(job))
+      return static_cast<RFID_JobState>(m_pendingJobs.value(job));
+
+   return static_cast<RFID_JobState>(m_jobs.value(job, RFID_JOB_NONE));
+}
+
+/**
+ * @brief RFID_JobLedger::jobDone
+ * @returns @c true if the tag assigned to the given @a job has reached the
+ *          given @a target state, in which case the encoder can skip the job
+ */
+bool RFID_JobLedger::jobDone(const int job, const RFID_JobState target) const
+{
+   return jobState(job) >= target;
+}
+
+//------------------------------------------------------------------------------
+// Ledger file functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_JobLedger::open
+ * @param fileName path of the ledger file, it is created if it does not exist
+ *
+ * Opens the given ledger and replays its records, so that the state of every
+ * tag is known immediately. Returns @c false if the file cannot be opened.
+ */
+bool RFID_JobLedger::open(const QString& fileName)
+{
+   close();
+
+   m_file.setFileName(fileName);
+   if(!m_file.open(QFile::ReadWrite | QFile::Unbuffered)) {
+      m_error = m_file.errorString();
+      return false;
+   }
+
+   if(!replay()) {
+      m_file.close();
+      m_jobs.clear();
+      m_states.clear();
+      return false;
+   }
+
+   return m_file.seek(m_file.size());
+}
+
+/**
+ * @brief RFID_JobLedger::close
+ *
+ * Commits the pending records and closes the ledger file, records that
+ * cannot be committed are discarded
+ */
+void RFID_JobLedger::close()
+{
+   if(isOpen()) {
+      commit();
+      m_file.close();
+   }
+
+   m_pending.clear();
+   m_pendingRecords = 0;
+   m_jobs.clear();
+   m_states.clear();
+   m_pendingJobs.clear();
+   m_pendingStates.clear();
+}
+
+/**
+ * @brief RFID_JobLedger::commit
+ *
+ * Writes the pending records to the ledger file and flushes them to the
+ * storage device with a single fsync. Returns @c false on a file error.
+ *
+ * If the commit fails, the partially written records are removed from the
+ * file (so that later commits are not appended after a torn record, which
+ * would discard them when the ledger is replayed) and the pending records
+ * are kept, so that they are retried with the next commit.
+ */
+bool RFID_JobLedger::commit()
+{
+   m_timer.stop();
+
+   if(m_pending.isEmpty() || !isOpen())
+      return true;
+
+   // Write pending records after the last committed record
+   const qint64 size = m_file.size();
+   const int records = m_pendingRecords;
+   const bool ok = m_file.seek(size)
+                   && m_file.write(m_pending) == m_pending.length()
+                   && Sync(m_file);
+
+   // Commit error, roll back the partial write and keep the pending records
+   if(!ok) {
+      m_error = m_file.errorString();
+      m_file.resize(size);
+      m_file.seek(size);
+      RFID_Profiler::getInstance()->addCount("Ledger commit errors");
+      return false;
+   }
+
+   // Register the committed states
+   QHash<int, quint8>::const_iterator job;
+   for(job = m_pendingJobs.constBegin(); job != m_pendingJobs.constEnd(); ++job)
+      m_jobs.insert(job.key(), job.value());
+
+   QHash<QByteArray, quint8>::const_iterator tag;
+   for(tag = m_pendingStates.constBegin();
+         tag != m_pendingStates.constEnd(); ++tag)
+      m_states.insert(tag.key(), tag.value());
+
+   m_pending.clear();
+   m_pendingRecords = 0;
+   m_pendingJobs.clear();
+   m_pendingStates.clear();
+
+   // Notify commit
+   RFID_Profiler::getInstance()->addCount("Ledger commits");
+   RFID_Profiler::getInstance()->addCount("Ledger records", records);
+   emit committed(records);
+   return true;
+}
+
+/**
+ * @brief RFID_JobLedger::record
+ * @param tid   TID of the tag
+ * @param state new state of the tag
+ * @param job   index of the job assigned to the tag, or -1 if none
+ *
+ * Registers the new state of the given tag (and of its job). The record is
+ * written with the next group commit, but the new state is visible
+ * immediately.
+ */
+void RFID_JobLedger::record(const QByteArray& tid,
+                            const RFID_JobState state,
+                            const int job)
+{
+   if(!isOpen() || tid.isEmpty() || tid.length() > RFID_LEDGER_TID_SIZE)
+      return;
+
+   m_pendingStates.insert(tid, static_cast<quint8>(state));
+   if(job >= 0)
+      m_pendingJobs.insert(job, static_cast<quint8>(state));
+
+   m_pending.append(Record(tid, state, qMax(job, -1)));
+   ++m_pendingRecords;
+
+   if(m_pendingRecords >= RFID_LEDGER_BATCH_SIZE)
+      commit();
+   else if(!m_timer.isActive())
+      m_timer.start();
+}
+
+/**
+ * @brief RFID_JobLedger::replay
+ *
+ * Reads every record of the ledger file (the latest record of each tag and
+ * of each job wins). Records that follow a torn or corrupted record are truncated, since
+ * they can only be the result of an interrupted write.
+ */
+bool RFID_JobLedger::replay()
+{
+   m_jobs.clear();
+   m_states.clear();
+
+   const qint64 size = m_file.size();
+   if(size == 0)
+      return true;
+
+   // Map the ledger file
+   const uchar* data = m_file.map(0, size);
+   if(!data) {
+      m_error = m_file.errorString();
+      return false;
+   }
+
+   // Replay records
+   qint64 valid = 0;
+   m_states.reserve(static_cast<int>(size / RFID_LEDGER_RECORD_SIZE));
+   while(valid + RFID_LEDGER_RECORD_SIZE <= size) {
+      const char* record = reinterpret_cast<const char*>(data + valid);
+      if(!ValidRecord(record))
+         break;
+
+      const int length = static_cast<quint8>(record[2]);
+      const int job = qFromLittleEndian<qint32>(record + JOB_OFFSET);
+      m_states.insert(QByteArray(record + TID_OFFSET, length),
+                      static_cast<quint8>(record[1]));
+      if(job >= 0)
+         m_jobs.insert(job, static_cast<quint8>(record[1]));
+
+      valid += RFID_LEDGER_RECORD_SIZE;
+   }
+
+   m_file.unmap(const_cast<uchar*>(data));
+
+   // Remove the torn records
+   if(valid < size) {
+      RFID_Profiler::getInstance()->addCount("Ledger bytes truncated",
+                                             size - valid);
+      if(!m_file.resize(valid)) {
+         m_error = m_file.errorString();
+         return false;
+      }
+   }
+
+   return true;
+}
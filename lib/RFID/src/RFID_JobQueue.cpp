@@ -0,0 +1,445 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "RFID_Profiler.h"
+#include "RFID_JobQueue.h"
+
+#include <QFile>
+#include <QThread>
+#include <QtConcurrent>
+
+#include <cstring>
+
+/*
+ * Flags stored in the first byte of each job
+ */
+static const quint8 JOB_HAS_EPC             = 0x01;
+static const quint8 JOB_HAS_USR             = 0x02;
+static const int EPC_OFFSET                 = 1;
+static const int USR_OFFSET                 = 1 + RFID_EPC_LENGTH;
+
+/**
+ * Range of the CSV file parsed by a worker thread, @a first is set for the
+ * chunk that contains the first line of the file
+ */
+typedef struct {
+   const char* begin;
+   const char* end;
+   bool first;
+} Chunk;
+
+/**
+ * Jobs and errors of a chunk, error lines are relative to the chunk
+ */
+typedef struct {
+   int lines;
+   int errorCount;
+   QByteArray jobs;
+   QVector<RFID_JobError> errors;
+} ChunkResult;
+
+//------------------------------------------------------------------------------
+// Parsing functions
+//------------------------------------------------------------------------------
+
+/**
+ * Returns the value of the given hexadecimal digit, or -1 if @a c is not a
+ * hexadecimal digit
+ */
+static inline int HexValue(const char c)
+{
+   if(c >= '0' && c <= '9')
+      return c - '0';
+   if(c >= 'a' && c <= 'f')
+      return c - 'a' + 10;
+   if(c >= 'A' && c <= 'F')
+      return c - 'A' + 10;
+
+   return -1;
+}
+
+/**
+ * Converts the hexadecimal field between @a begin and @a end to binary data,
+ * which is written to @a dest (up to @a max bytes). Spaces, tabs and quotes
+ * are ignored. The number of bytes written is stored in @a length.
+ */
+static int ParseField(const char* begin,
+                      const char* end,
+                      char* dest,
+                      const int max,
+                      int* length,
+                      const int tooLong)
+{
+   int bytes = 0;
+   int high = -1;
+   for(const char* c = begin; c < end; ++c) {
+      if(*c == ' ' || *c == '\t' || *c == '"' || *c == '\r')
+         continue;
+
+      const int value = HexValue(*c);
+      if(value < 0)
+         return RFID_ROW_INVALID_HEX;
+
+      if(high < 0) {
+         high = value;
+         continue;
+      }
+
+      if(bytes >= max)
+         return tooLong;
+
+      dest[bytes++] = static_cast<char>((high << 4) | value);
+      high = -1;
+   }
+
+   if(high >= 0)
+      return RFID_ROW_ODD_LENGTH;
+
+   *length = bytes;
+   return RFID_ROW_OK;
+}
+
+/**
+ * Parses and validates the row between @a begin and @a end, and writes the
+ * resulting job to @a job
+ */
+static int ParseRow(const char* begin, const char* end, char* job)
+{
+   // Find columns
+   const char* comma = static_cast<const char*>(
+                          memchr(begin, ',', static_cast<size_t>(end - begin)));
+   const char* epcEnd = comma ? comma : end;
+   const char* usrBegin = comma ? comma + 1 : end;
+   if(comma && memchr(usrBegin, ',', static_cast<size_t>(end - usrBegin)))
+      return RFID_ROW_TOO_MANY_COLUMNS;
+
+   // Parse EPC & user data
+   int epcLength = 0;
+   int usrLength = 0;
+   memset(job, 0, RFID_JOB_SIZE);
+   int error = ParseField(begin, epcEnd, job + EPC_OFFSET, RFID_EPC_LENGTH,
+                          &epcLength, RFID_ROW_EPC_TOO_LONG);
+   if(error == RFID_ROW_OK)
+      error = ParseField(usrBegin, end, job + USR_OFFSET, RFID_USER_LENGTH,
+                         &usrLength, RFID_ROW_USR_TOO_LONG);
+
+   if(error != RFID_ROW_OK)
+      return error;
+
+   // Nothing to write
+   if(epcLength == 0 && usrLength == 0)
+      return RFID_ROW_EMPTY;
+
+   // Set job flags
+   quint8 flags = 0;
+   if(epcLength > 0)
+      flags |= JOB_HAS_EPC;
+   if(usrLength > 0)
+      flags |= JOB_HAS_USR;
+
+   job[0] = static_cast<char>(flags);
+   return RFID_ROW_OK;
+}
+
+/**
+ * Parses all the rows of the given @a chunk, this function is executed by
+ * the worker threads
+ */
+static ChunkResult ParseChunk(const Chunk& chunk)
+{
+   ChunkResult result;
+   result.lines = 0;
+   result.errorCount = 0;
+
+   char job[RFID_JOB_SIZE];
+   const char* line = chunk.begin;
+   while(line < chunk.end) {
+      // Get end of line
+      const size_t available = static_cast<size_t>(chunk.end - line);
+      const char* eol = static_cast<const char*>(memchr(line, '\n', available));
+      if(!eol)
+         eol = chunk.end;
+
+      // Parse row
+      ++result.lines;
+      const int error = ParseRow(line, eol, job);
+      line = eol + 1;
+
+      // Register job
+      if(error == RFID_ROW_OK) {
+         result.jobs.append(job, RFID_JOB_SIZE);
+         continue;
+      }
+
+      // Blank lines & headers are not errors
+      if(error == RFID_ROW_EMPTY || (chunk.first && result.lines == 1))
+         continue;
+
+      // Register error
+      ++result.errorCount;
+      if(result.errors.count() < RFID_JOB_MAX_ERRORS) {
+         RFID_JobError e;
+         e.line = result.lines;
+         e.reason = error;
+         result.errors.append(e);
+      }
+   }
+
+   return result;
+}
+
+//------------------------------------------------------------------------------
+// Constructor & job access functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_JobQueue::RFID_JobQueue
+ *
+ * Creates an empty job queue
+ */
+RFID_JobQueue::RFID_JobQueue()
+{
+   m_errorCount = 0;
+}
+
+/**
+ * @brief RFID_JobQueue::count
+ * @returns the number of valid jobs
+ */
+int RFID_JobQueue::count() const
+{
+   return m_jobs.length() / RFID_JOB_SIZE;
+}
+
+/**
+ * @brief RFID_JobQueue::errorCount
+ * @returns the number of invalid rows of the imported file
+ */
+int RFID_JobQueue::errorCount() const
+{
+   return m_errorCount;
+}
+
+/**
+ * @brief RFID_JobQueue::errorString
+ * @returns a description of the file error that stopped the last import
+ */
+QString RFID_JobQueue::errorString() const
+{
+   return m_errorString;
+}
+
+/**
+ * @brief RFID_JobQueue::errors
+ * @returns the first @c RFID_JOB_MAX_ERRORS invalid rows of the imported file
+ */
+QVector<RFID_JobError> RFID_JobQueue::errors() const
+{
+   return m_errors;
+}
+
+/**
+ * @brief RFID_JobQueue::reason
+ * @returns a description of the given row @a error
+ */
+QString RFID_JobQueue::reason(const int error)
+{
+   switch(error) {
+      case RFID_ROW_OK:
+         return QObject::tr("Valid row");
+      case RFID_ROW_EMPTY:
+         return QObject::tr("Empty row");
+      case RFID_ROW_INVALID_HEX:
+         return QObject::tr("Invalid hexadecimal data");
+      case RFID_ROW_ODD_LENGTH:
+         return QObject::tr("Incomplete byte (odd number of digits)");
+      case RFID_ROW_EPC_TOO_LONG:
+         return QObject::tr("EPC data cannot be larger than %1 bytes")
+                .arg(RFID_EPC_LENGTH);
+      case RFID_ROW_USR_TOO_LONG:
+         return QObject::tr("User data cannot be larger than %1 bytes")
+                .arg(RFID_USER_LENGTH);
+      case RFID_ROW_TOO_MANY_COLUMNS:
+         return QObject::tr("Too many columns");
+      default:
+         break;
+   }
+
+   return QObject::tr("Unknown error");
+}
+
+/**
+ * @brief RFID_JobQueue::hasEpc
+ * @returns @c true if the job at the given @a index writes the EPC
+ */
+bool RFID_JobQueue::hasEpc(const int index) const
+{
+   Q_ASSERT(index >= 0 && index < count());
+   return m_jobs.at(index * RFID_JOB_SIZE) & JOB_HAS_EPC;
+}
+
+/**
+ * @brief RFID_JobQueue::hasUserData
+ * @returns @c true if the job at the given @a index writes the user data
+ */
+bool RFID_JobQueue::hasUserData(const int index) const
+{
+   Q_ASSERT(index >= 0 && index < count());
+   return m_jobs.at(index * RFID_JOB_SIZE) & JOB_HAS_USR;
+}
+
+/**
+ * @brief RFID_JobQueue::epc
+ * @returns the EPC to write with the job at the given @a index, or an empty
+ *          byte array if the job does not write the EPC
+ */
+QByteArray RFID_JobQueue::epc(const int index) const
+{
+   if(!hasEpc(index))
+      return QByteArray();
+
+   return m_jobs.mid(index * RFID_JOB_SIZE + EPC_OFFSET, RFID_EPC_LENGTH);
+}
+
+/**
+ * @brief RFID_JobQueue::userData
+ * @returns the user data to write with the job at the given @a index, or an
+ *          empty byte array if the job does not write the user data
+ */
+QByteArray RFID_JobQueue::userData(const int index) const
+{
+   if(!hasUserData(index))
+      return QByteArray();
+
+   return m_jobs.mid(index * RFID_JOB_SIZE + USR_OFFSET, RFID_USER_LENGTH);
+}
+
+//------------------------------------------------------------------------------
+// Import functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_JobQueue::clear
+ *
+ * Removes all the jobs and errors
+ */
+void RFID_JobQueue::clear()
+{
+   m_jobs.clear();
+   m_errors.clear();
+   m_errorCount = 0;
+   m_errorString.clear();
+}
+
+/**
+ * @brief RFID_JobQueue::import
+ * @param fileName path of the CSV file to import
+ *
+ * Replaces the jobs of the queue with the rows of the given CSV file, which
+ * are parsed in parallel. Returns @c false if the file cannot be read, invalid
+ * rows do not stop the import (see @c errors()).
+ */
+bool RFID_JobQueue::import(const QString& fileName)
+{
+   RFID_PROFILE("RFID_JobQueue::import");
+
+   clear();
+
+   // Open file
+   QFile file(fileName);
+   if(!file.open(QFile::ReadOnly)) {
+      m_errorString = file.errorString();
+      return false;
+   }
+
+   // Empty file
+   qint64 size = file.size();
+   if(size == 0)
+      return true;
+
+   // Map file to memory (or read it if it cannot be mapped)
+   QByteArray buffer;
+   const char* data = reinterpret_cast<const char*>(file.map(0, size));
+   const bool mapped = (data != Q_NULLPTR);
+   if(!mapped) {
+      buffer = file.readAll();
+      data = buffer.constData();
+      size = buffer.size();
+   }
+
+   // Split file in chunks at line boundaries
+   const qint64 threads = qMax(QThread::idealThreadCount(), 1);
+   const qint64 chunkSize = qMax<qint64>(RFID_JOB_MIN_CHUNK_SIZE,
+                                         size / (threads * 4));
+   QVector<Chunk> chunks;
+   const char* end = data + size;
+   for(const char* begin = data; begin < end;) {
+      const char* chunkEnd = end;
+      if(end - begin > chunkSize) {
+         const char* boundary = begin + chunkSize;
+         const size_t available = static_cast<size_t>(end - boundary);
+         chunkEnd = static_cast<const char*>(memchr(boundary, '\n', available));
+         chunkEnd = chunkEnd ? chunkEnd + 1 : end;
+      }
+
+      Chunk chunk;
+      chunk.begin = begin;
+      chunk.end = chunkEnd;
+      chunk.first = (begin == data);
+      chunks.append(chunk);
+      begin = chunkEnd;
+   }
+
+   // Parse chunks in parallel
+   const QVector<ChunkResult> results =
+      QtConcurrent::blockingMapped<QVector<ChunkResult>>(chunks, ParseChunk);
+
+   // Merge the results of each chunk (in file order)
+   int jobs = 0;
+   foreach(const ChunkResult& result, results)
+      jobs += result.jobs.length();
+
+   int lines = 0;
+   m_jobs.reserve(jobs);
+   foreach(const ChunkResult& result, results) {
+      m_jobs.append(result.jobs);
+      m_errorCount += result.errorCount;
+      foreach(RFID_JobError error, result.errors) {
+         if(m_errors.count() < RFID_JOB_MAX_ERRORS) {
+            error.line += lines;
+            m_errors.append(error);
+         }
+      }
+
+      lines += result.lines;
+   }
+
+   // Unmap file
+   if(mapped)
+      file.unmap(reinterpret_cast<uchar*>(const_cast<char*>(data)));
+
+   // Register import statistics
+   RFID_Profiler::getInstance()->setCounter("Job queue rows", count());
+   RFID_Profiler::getInstance()->setCounter("Job queue invalid rows",
+                                            m_errorCount);
+   return true;
+}
@@ -0,0 +1,575 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "RFID_Log.h"
+#include "RFID_Clock.h"
+#include "RFID_Profiler.h"
+
+#include <QThread>
+#include <QtEndian>
+#include <QWaitCondition>
+#include <QDateTime>
+#include <QtConcurrent>
+#include <QCoreApplication>
+
+#include <cstdio>
+#include <cstring>
+
+/**
+ * Magic bytes written at the beginning of binary log files
+ */
+static const char* BINARY_MAGIC = "RFLG";
+
+/**
+ * Names of the log categories and levels
+ */
+static const char* CATEGORY_NAMES[] = {
+   "protocol", "scheduler", "health", "serial", "store"
+};
+
+static const char* LEVEL_NAMES[] = {
+   "debug", "info", "warning", "error", "off"
+};
+
+/**
+ * Pointer to the only instance of the @c RFID_Log class
+ */
+static RFID_Log* INSTANCE = Q_NULLPTR;
+
+/**
+ * Only warnings and errors are logged by default
+ */
+QAtomicInteger<int> RFID_Log::LEVELS[RFID_LOG_CATEGORIES] = {
+   RFID_LOG_WARNING,
+   RFID_LOG_WARNING,
+   RFID_LOG_WARNING,
+   RFID_LOG_WARNING,
+   RFID_LOG_WARNING
+};
+
+//------------------------------------------------------------------------------
+// Log sink thread
+//------------------------------------------------------------------------------
+
+/**
+ * @brief The RFID_LogSink class
+ *
+ * Background thread that writes the queued log records, the thread sleeps
+ * until a producer queues a record or until the sink is stopped.
+ *
+ * Only the first producer that queues a record after the sink went idle
+ * takes the mutex to wake the sink, the other producers only read the
+ * pending flag.
+ */
+class RFID_LogSink : public QThread
+{
+   public:
+      explicit RFID_LogSink(RFID_Log* log) : m_stop(false), m_log(log)
+      {
+         m_pending.store(0);
+      }
+
+      void wake()
+      {
+         if(m_pending.testAndSetOrdered(0, 1)) {
+            QMutexLocker locker(&m_mutex);
+            m_condition.wakeOne();
+         }
+      }
+
+      void stop()
+      {
+         m_mutex.lock();
+         m_stop = true;
+         m_condition.wakeOne();
+         m_mutex.unlock();
+
+         wait();
+      }
+
+   protected:
+      void run()
+      {
+         forever {
+            m_mutex.lock();
+            while(!m_stop && m_pending.load() == 0)
+               m_condition.wait(&m_mutex);
+            const bool stop = m_stop;
+            m_mutex.unlock();
+
+            // Records queued from now on set the pending flag again
+            m_pending.store(0);
+            m_log->flush();
+
+            if(stop)
+               return;
+         }
+      }
+
+   private:
+      bool m_stop;
+      QMutex m_mutex;
+      RFID_Log* m_log;
+      QWaitCondition m_condition;
+      QAtomicInteger<int> m_pending;
+};
+
+/**
+ * Compresses the given rotated log @a segment into the given @a archive and
+ * removes the segment, this function is executed by a worker thread. The
+ * segment is kept if it cannot be compressed.
+ */
+static void CompressSegment(const QString& segment,
+                            const QVector<RFID_LogBlock>& blocks,
+                            const int format,
+                            const QString& archive)
+{
+   RFID_PROFILE("RFID_Log::compress");
+
+   if(RFID_LogArchive::compress(segment, blocks, format, archive))
+      QFile::remove(segment);
+   else
+      RFID_Profiler::getInstance()->addCount("Log compression errors");
+}
+
+/**
+ * Writes the pending log records and stops the sink thread before the
+ * application exits
+ */
+static void ShutdownLog()
+{
+   if(INSTANCE)
+      INSTANCE->shutdown();
+}
+
+//------------------------------------------------------------------------------
+// Constructor & instance access functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_Log::RFID_Log
+ *
+ * Initializes the record queue and starts the sink thread
+ */
+RFID_Log::RFID_Log()
+{
+   m_tail = 0;
+   m_written = 0;
+   m_head.store(0);
+   m_format = RFID_LOG_TEXT;
+   for(quint32 i = 0; i < RFID_LOG_QUEUE_SIZE; ++i)
+      m_slots[i].sequence.store(i);
+
+   m_sink = new RFID_LogSink(this);
+   m_sink->start(QThread::LowPriority);
+}
+
+/**
+ * @brief RFID_Log::getInstance
+ * @returns the only instance of the @c RFID_Log class
+ */
+RFID_Log* RFID_Log::getInstance()
+{
+   if(INSTANCE == Q_NULLPTR) {
+      INSTANCE = new RFID_Log;
+      qAddPostRoutine(ShutdownLog);
+   }
+
+   return INSTANCE;
+}
+
+//------------------------------------------------------------------------------
+// Level functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_Log::level
+ * @returns the minimum level of the records logged for the given @a category
+ */
+int RFID_Log::level(const int category)
+{
+   Q_ASSERT(category >= 0 && category < RFID_LOG_CATEGORIES);
+   return LEVELS[category].load();
+}
+
+/**
+ * @brief RFID_Log::setLevel
+ *
+ * Changes the minimum level of the records logged for the given @a category
+ */
+void RFID_Log::setLevel(const int category, const int level)
+{
+   Q_ASSERT(category >= 0 && category < RFID_LOG_CATEGORIES);
+   LEVELS[category].store(qBound(0, level, static_cast<int>(RFID_LOG_OFF)));
+}
+
+/**
+ * @brief RFID_Log::setLevel
+ *
+ * Changes the minimum level of the records logged for every category
+ */
+void RFID_Log::setLevel(const int level)
+{
+   for(int i = 0; i < RFID_LOG_CATEGORIES; ++i)
+      setLevel(i, level);
+}
+
+/**
+ * @brief RFID_Log::levelName
+ * @returns the name of the given @a level (e.g. "warning")
+ */
+QString RFID_Log::levelName(const int level)
+{
+   if(level >= 0 && level <= RFID_LOG_OFF)
+      return QString::fromLatin1(LEVEL_NAMES[level]);
+
+   return QString::number(level);
+}
+
+/**
+ * @brief RFID_Log::categoryName
+ * @returns the name of the given @a category (e.g. "protocol")
+ */
+QString RFID_Log::categoryName(const int category)
+{
+   if(category >= 0 && category < RFID_LOG_CATEGORIES)
+      return QString::fromLatin1(CATEGORY_NAMES[category]);
+
+   return QString::number(category);
+}
+
+//------------------------------------------------------------------------------
+// Output functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_Log::fileName
+ * @returns the path of the log file, or an empty string if the records are
+ *          written to the standard error output
+ */
+QString RFID_Log::fileName() const
+{
+   return m_file.fileName();
+}
+
+/**
+ * @brief RFID_Log::errorString
+ * @returns a description of the last output error
+ */
+QString RFID_Log::errorString() const
+{
+   return m_error;
+}
+
+/**
+ * @brief RFID_Log::setOutput
+ * @param fileName path of the log file, records are written to the standard
+ *                 error output (as text) if the path is empty
+ * @param format   format of the records written to the log file
+ *
+ * Writes the pending records to the current output and changes the output of
+ * the log sink. Records are appended to the file if it already exists.
+ * Returns @c false (and writes to the standard error output) if the file
+ * cannot be opened.
+ */
+bool RFID_Log::setOutput(const QString& fileName, const RFID_LogFormat format)
+{
+   flush();
+
+   QMutexLocker locker(&m_outputMutex);
+   m_file.close();
+   m_file.setFileName(QString());
+   m_format = RFID_LOG_TEXT;
+
+   // Write to the standard error output
+   if(fileName.isEmpty())
+      return true;
+
+   // Open log file
+   return openFile(fileName, format);
+}
+
+/**
+ * @brief RFID_Log::rotate
+ *
+ * Renames the current log file to a segment file, compresses the segment in
+ * a worker thread and begins a new log file with the same name
+ */
+void RFID_Log::rotate()
+{
+   const QString fileName = m_file.fileName();
+   const QString stamp = QDateTime::currentDateTimeUtc()
+                         .toString("yyyyMMdd-hhmmss-zzz");
+   const QString segment = QString("%1.%2.seg").arg(fileName, stamp);
+   const QString archive = QString("%1.%2.rfz").arg(fileName, stamp);
+
+   // Close log file & compress it in the background
+   m_file.close();
+   if(QFile::rename(fileName, segment))
+      QtConcurrent::run(CompressSegment, segment, m_blocks,
+                        static_cast<int>(m_format), archive);
+
+   // Begin new log file
+   if(!openFile(fileName, m_format))
+      m_format = RFID_LOG_TEXT;
+}
+
+/**
+ * @brief RFID_Log::openFile
+ *
+ * Opens the given log file (records are appended if the file exists) and
+ * resets the block index of the segment. Returns @c false if the file cannot
+ * be opened.
+ */
+bool RFID_Log::openFile(const QString& fileName, const RFID_LogFormat format)
+{
+   m_blocks.clear();
+
+   // Open log file
+   m_file.setFileName(fileName);
+   if(!m_file.open(QFile::WriteOnly | QFile::Append)) {
+      m_error = m_file.errorString();
+      m_file.setFileName(QString());
+      return false;
+   }
+
+   // Existing data goes to the first block (its times are unknown)
+   m_format = format;
+   m_written = m_file.size();
+   if(m_written > 0) {
+      RFID_LogBlock block;
+      block.offset = 0;
+      block.first = 0;
+      block.last = 0;
+      m_blocks.append(block);
+   }
+
+   // Identify new binary logs
+   else if(format == RFID_LOG_BINARY)
+      m_written = m_file.write(BINARY_MAGIC, 4);
+
+   return true;
+}
+
+//------------------------------------------------------------------------------
+// Record queue functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_Log::flush
+ *
+ * Writes every queued record to the output, this function is called by the
+ * sink thread whenever records are queued
+ */
+void RFID_Log::flush()
+{
+   QMutexLocker locker(&m_outputMutex);
+
+   RFID_LogRecord record;
+   bool written = false;
+   while(pop(&record)) {
+      write(record);
+      written = true;
+   }
+
+   if(!written)
+      return;
+
+   if(m_file.isOpen())
+      m_file.flush();
+   else
+      fflush(stderr);
+}
+
+/**
+ * @brief RFID_Log::shutdown
+ *
+ * Stops the sink thread once it has written the queued records and waits
+ * for it to finish, records queued afterwards are only written by explicit
+ * calls to @c flush(). This function is called before the application exits.
+ */
+void RFID_Log::shutdown()
+{
+   m_sink->stop();
+}
+
+/**
+ * @brief RFID_Log::push
+ * @param category category of the record
+ * @param level    level of the record
+ * @param message  message of the record (must be a string literal)
+ * @param values   values of the message placeholders
+ * @param count    number of @a values
+ *
+ * Adds a record to the queue without locking (any number of threads can
+ * push records). Each slot of the queue has a sequence number that tells
+ * producers and the sink whether the slot is free or holds a record, so a
+ * producer only needs to reserve a position with a compare-and-swap. The
+ * record is dropped if the queue is full. The sink is woken once the record
+ * has been queued.
+ */
+void RFID_Log::push(const int category,
+                    const int level,
+                    const char* message,
+                    const qint64* values,
+                    const int count)
+{
+   quint32 position = m_head.load();
+   forever {
+      Slot& slot = m_slots[position % RFID_LOG_QUEUE_SIZE];
+      const qint32 diff = static_cast<qint32>(slot.sequence.loadAcquire()
+                                              - position);
+
+      // Slot is free, try to reserve it
+      if(diff == 0) {
+         if(m_head.testAndSetRelaxed(position, position + 1, position)) {
+            RFID_LogRecord& record = slot.record;
+            record.timestamp = RFID_Clock::getInstance()->now();
+            record.message = message;
+            record.category = static_cast<quint8>(category);
+            record.level = static_cast<quint8>(level);
+            record.count = static_cast<quint8>(count);
+            memcpy(record.values, values,
+                   sizeof(qint64) * static_cast<size_t>(count));
+            slot.sequence.storeRelease(position + 1);
+            m_sink->wake();
+            return;
+         }
+      }
+
+      // Queue is full, drop the record
+      else if(diff < 0) {
+         RFID_Profiler::getInstance()->addCount("Log records dropped");
+         return;
+      }
+
+      // Another producer reserved the slot
+      else
+         position = m_head.load();
+   }
+}
+
+/**
+ * @brief RFID_Log::pop
+ *
+ * Removes the oldest record of the queue and copies it to @a record, returns
+ * @c false if the queue is empty. Only one thread can pop records at a time
+ * (see @c flush()).
+ */
+bool RFID_Log::pop(RFID_LogRecord* record)
+{
+   Q_ASSERT(record);
+
+   Slot& slot = m_slots[m_tail % RFID_LOG_QUEUE_SIZE];
+   if(slot.sequence.loadAcquire() != m_tail + 1)
+      return false;
+
+   *record = slot.record;
+   slot.sequence.storeRelease(m_tail + RFID_LOG_QUEUE_SIZE);
+   ++m_tail;
+   return true;
+}
+
+/**
+ * @brief RFID_Log::write
+ *
+ * Formats the given @a record and writes it to the output
+ *
+ * Binary records contain the UTC time in microseconds (8 bytes), the
+ * category, level and number of values (1 byte each), the length of the
+ * message (2 bytes) followed by the message, and the values (8 bytes each).
+ * Integers are written in little endian order.
+ */
+void RFID_Log::write(const RFID_LogRecord& record)
+{
+   const RFID_Clock* clock = RFID_Clock::getInstance();
+
+   // Write binary record
+   if(m_format == RFID_LOG_BINARY && m_file.isOpen()) {
+      const quint16 length = static_cast<quint16>(qstrlen(record.message));
+      QByteArray data(13 + length + record.count * 8, 0);
+      char* dest = data.data();
+      qToLittleEndian<qint64>(clock->toUtc(record.timestamp), dest);
+      dest[8] = static_cast<char>(record.category);
+      dest[9] = static_cast<char>(record.level);
+      dest[10] = static_cast<char>(record.count);
+      qToLittleEndian<quint16>(length, dest + 11);
+      memcpy(dest + 13, record.message, length);
+      for(int i = 0; i < record.count; ++i)
+         qToLittleEndian<qint64>(record.values[i], dest + 13 + length + i * 8);
+
+      writeData(data, clock->toUtc(record.timestamp));
+      return;
+   }
+
+   // Format text record
+   QString message = QString::fromLatin1(record.message);
+   for(int i = 0; i < record.count; ++i)
+      message = message.arg(record.values[i]);
+
+   const QDateTime time = clock->toDateTime(record.timestamp);
+   const QString line = QString("%1 %2 %3: %4\n")
+                        .arg(time.toString(Qt::ISODateWithMs),
+                             levelName(record.level),
+                             categoryName(record.category),
+                             message);
+
+   // Write text record
+   if(m_file.isOpen())
+      writeData(line.toUtf8(), clock->toUtc(record.timestamp));
+   else
+      fputs(line.toLocal8Bit().constData(), stderr);
+}
+
+/**
+ * @brief RFID_Log::writeData
+ * @param data encoded log record
+ * @param utc  UTC time of the record (in microseconds)
+ *
+ * Writes the given record to the log file, registers it in the block index
+ * of the segment (a new block begins every @c RFID_LOG_BLOCK_SIZE bytes) and
+ * rotates the log file once it reaches @c RFID_LOG_SEGMENT_SIZE bytes.
+ */
+void RFID_Log::writeData(const QByteArray& data, const qint64 utc)
+{
+   // Begin a new block or extend the current block
+   if(m_blocks.isEmpty()
+         || m_written - m_blocks.last().offset >= RFID_LOG_BLOCK_SIZE) {
+      RFID_LogBlock block;
+      block.offset = m_blocks.isEmpty() ? 0 : m_written;
+      block.first = utc;
+      block.last = utc;
+      m_blocks.append(block);
+   }
+
+   else
+      m_blocks.last().last = utc;
+
+   // Write record
+   const qint64 bytes = m_file.write(data);
+   if(bytes > 0)
+      m_written += bytes;
+
+   // Rotate log file
+   if(m_written >= RFID_LOG_SEGMENT_SIZE)
+      rotate();
+}
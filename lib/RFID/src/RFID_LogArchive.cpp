@@ -0,0 +1,404 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "RFID_LogArchive.h"
+
+#include <QtEndian>
+#include <QSaveFile>
+
+#include <cstring>
+
+/*
+ * Layout of a log archive:
+ *
+ *    Offset  Size  Field
+ *    0       4     Magic ("RFLZ")
+ *    4       2     Archive version (little endian)
+ *    6       2     Log format (little endian, see RFID_LogFormat)
+ *    8       4     Number of blocks (little endian)
+ *    12      4     Reserved
+ *    16      8     Offset of the block index (little endian)
+ *    24      ...   Compressed blocks (see qCompress())
+ *
+ * Each entry of the block index has the UTC time of the first and last
+ * records of the block (8 bytes each), the offset of the block in the archive
+ * (8 bytes), and its compressed and raw sizes (4 bytes each). Integers are
+ * written in little endian order.
+ */
+static const char* MAGIC                    = "RFLZ";
+static const int HEADER_SIZE                = 24;
+static const int VERSION_OFFSET             = 4;
+static const int FORMAT_OFFSET              = 6;
+static const int COUNT_OFFSET               = 8;
+static const int INDEX_OFFSET               = 16;
+static const int ENTRY_SIZE                 = 32;
+
+//------------------------------------------------------------------------------
+// Utility functions
+//------------------------------------------------------------------------------
+
+/**
+ * Changes the value of the given @a error (if it is not @c NULL)
+ */
+static inline void SetError(QString* error, const QString& text)
+{
+   if(error)
+      *error = text;
+}
+
+//------------------------------------------------------------------------------
+// Constructor & destructor
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_LogArchive::RFID_LogArchive
+ *
+ * Initializes an archive reader, use @c open() to read an archive
+ */
+RFID_LogArchive::RFID_LogArchive()
+{
+   m_size = 0;
+   m_format = 0;
+   m_blockCount = 0;
+   m_data = Q_NULLPTR;
+}
+
+/**
+ * @brief RFID_LogArchive::~RFID_LogArchive
+ *
+ * Unmaps and closes the archive file
+ */
+RFID_LogArchive::~RFID_LogArchive()
+{
+   close();
+}
+
+//------------------------------------------------------------------------------
+// Archive information functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_LogArchive::isOpen
+ * @returns @c true if an archive is open
+ */
+bool RFID_LogArchive::isOpen() const
+{
+   return m_data != Q_NULLPTR;
+}
+
+/**
+ * @brief RFID_LogArchive::format
+ * @returns the format of the archived log (see @c RFID_LogFormat)
+ */
+int RFID_LogArchive::format() const
+{
+   return m_format;
+}
+
+/**
+ * @brief RFID_LogArchive::blockCount
+ * @returns the number of compressed blocks of the archive
+ */
+int RFID_LogArchive::blockCount() const
+{
+   return m_blockCount;
+}
+
+/**
+ * @brief RFID_LogArchive::errorString
+ * @returns a description of the last error
+ */
+QString RFID_LogArchive::errorString() const
+{
+   return m_error;
+}
+
+/**
+ * @brief RFID_LogArchive::blockStart
+ * @returns the UTC time (in microseconds) of the first record of the block
+ *          at the given @a index
+ */
+qint64 RFID_LogArchive::blockStart(const int index) const
+{
+   return qFromLittleEndian<qint64>(indexEntry(index));
+}
+
+/**
+ * @brief RFID_LogArchive::blockEnd
+ * @returns the UTC time (in microseconds) of the last record of the block at
+ *          the given @a index
+ */
+qint64 RFID_LogArchive::blockEnd(const int index) const
+{
+   return qFromLittleEndian<qint64>(indexEntry(index) + 8);
+}
+
+/**
+ * @brief RFID_LogArchive::findBlock
+ * @param utc UTC time in microseconds
+ * @returns the index of the first block with records logged at or after the
+ *          given @a utc time, or -1 if there is no such block
+ */
+int RFID_LogArchive::findBlock(const qint64 utc) const
+{
+   int first = 0;
+   int last = m_blockCount;
+   while(first < last) {
+      const int middle = first + (last - first) / 2;
+      if(blockEnd(middle) < utc)
+         first = middle + 1;
+      else
+         last = middle;
+   }
+
+   if(first < m_blockCount)
+      return first;
+
+   return -1;
+}
+
+/**
+ * @brief RFID_LogArchive::block
+ * @returns the decompressed data of the block at the given @a index, only
+ *          that block is read from the archive
+ */
+QByteArray RFID_LogArchive::block(const int index) const
+{
+   const uchar* entry = indexEntry(index);
+   const quint64 offset = qFromLittleEndian<quint64>(entry + 16);
+   const quint32 size = qFromLittleEndian<quint32>(entry + 24);
+   return qUncompress(m_data + offset, static_cast<int>(size));
+}
+
+//------------------------------------------------------------------------------
+// Archive reading functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_LogArchive::open
+ *
+ * Memory-maps the given archive and validates its header and block index,
+ * returns @c false if the archive cannot be read or is invalid
+ */
+bool RFID_LogArchive::open(const QString& fileName)
+{
+   close();
+
+   // Open & map file
+   m_file.setFileName(fileName);
+   if(!m_file.open(QFile::ReadOnly)) {
+      m_error = m_file.errorString();
+      return false;
+   }
+
+   m_size = m_file.size();
+   const uchar* data = Q_NULLPTR;
+   if(m_size >= HEADER_SIZE)
+      data = m_file.map(0, m_size);
+
+   if(!data) {
+      m_error = QObject::tr("Cannot map log archive");
+      close();
+      return false;
+   }
+
+   // Validate header & block index
+   const quint16 version = qFromLittleEndian<quint16>(data + VERSION_OFFSET);
+   const quint32 count = qFromLittleEndian<quint32>(data + COUNT_OFFSET);
+   const quint64 index = qFromLittleEndian<quint64>(data + INDEX_OFFSET);
+   const quint64 indexSize = static_cast<quint64>(count) * ENTRY_SIZE;
+   if(memcmp(data, MAGIC, 4) != 0
+         || version != RFID_LOG_ARCHIVE_VERSION
+         || index < HEADER_SIZE
+         || index + indexSize != static_cast<quint64>(m_size)) {
+      m_file.unmap(const_cast<uchar*>(data));
+      m_error = QObject::tr("Invalid log archive");
+      close();
+      return false;
+   }
+
+   // Validate blocks
+   for(quint32 i = 0; i < count; ++i) {
+      const uchar* entry = data + index + i * ENTRY_SIZE;
+      const quint64 offset = qFromLittleEndian<quint64>(entry + 16);
+      const quint32 size = qFromLittleEndian<quint32>(entry + 24);
+      if(offset < HEADER_SIZE || offset + size > index) {
+         m_file.unmap(const_cast<uchar*>(data));
+         m_error = QObject::tr("Invalid log archive");
+         close();
+         return false;
+      }
+   }
+
+   m_data = data;
+   m_blockCount = static_cast<int>(count);
+   m_format = qFromLittleEndian<quint16>(data + FORMAT_OFFSET);
+   return true;
+}
+
+/**
+ * @brief RFID_LogArchive::close
+ *
+ * Unmaps and closes the archive file
+ */
+void RFID_LogArchive::close()
+{
+   if(m_data)
+      m_file.unmap(const_cast<uchar*>(m_data));
+
+   m_file.close();
+   m_size = 0;
+   m_format = 0;
+   m_blockCount = 0;
+   m_data = Q_NULLPTR;
+}
+
+/**
+ * @brief RFID_LogArchive::indexEntry
+ * @returns a pointer to the index entry of the block at the given @a index
+ */
+const uchar* RFID_LogArchive::indexEntry(const int index) const
+{
+   Q_ASSERT(isOpen());
+   Q_ASSERT(index >= 0 && index < m_blockCount);
+
+   const quint64 offset = qFromLittleEndian<quint64>(m_data + INDEX_OFFSET);
+   return m_data + offset + static_cast<quint64>(index) * ENTRY_SIZE;
+}
+
+//------------------------------------------------------------------------------
+// Archive writing functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_LogArchive::compress
+ * @param segment  path of the log segment to compress
+ * @param blocks   blocks of the segment, sorted by offset
+ * @param format   format of the log segment (see @c RFID_LogFormat)
+ * @param fileName path of the archive file
+ * @param error    description of the error (if any)
+ *
+ * Compresses each block of the given log segment and writes the blocks and
+ * their index to the archive file. If no blocks are given, the whole segment
+ * is compressed as a single block. The archive is replaced atomically, and
+ * the segment is not modified.
+ */
+bool RFID_LogArchive::compress(const QString& segment,
+                               const QVector<RFID_LogBlock>& blocks,
+                               const int format,
+                               const QString& fileName,
+                               QString* error)
+{
+   // Open & map segment (or read it if it cannot be mapped)
+   QFile input(segment);
+   if(!input.open(QFile::ReadOnly)) {
+      SetError(error, input.errorString());
+      return false;
+   }
+
+   QByteArray buffer;
+   qint64 size = input.size();
+   const uchar* data = Q_NULLPTR;
+   if(size > 0)
+      data = input.map(0, size);
+
+   const bool mapped = (data != Q_NULLPTR);
+   if(!mapped) {
+      buffer = input.readAll();
+      data = reinterpret_cast<const uchar*>(buffer.constData());
+      size = buffer.size();
+   }
+
+   // Compress the whole segment if its blocks are unknown
+   QVector<RFID_LogBlock> ranges = blocks;
+   if(ranges.isEmpty()) {
+      RFID_LogBlock block;
+      block.offset = 0;
+      block.first = 0;
+      block.last = 0;
+      ranges.append(block);
+   }
+
+   // Open archive & reserve space for the header
+   QSaveFile output(fileName);
+   if(!output.open(QSaveFile::WriteOnly)) {
+      SetError(error, output.errorString());
+      return false;
+   }
+
+   char header[HEADER_SIZE];
+   memset(header, 0, HEADER_SIZE);
+   output.write(header, HEADER_SIZE);
+
+   // Compress blocks
+   quint32 count = 0;
+   QByteArray index;
+   char entry[ENTRY_SIZE];
+   for(int i = 0; i < ranges.count(); ++i) {
+      const qint64 start = qBound<qint64>(0, ranges.at(i).offset, size);
+      qint64 end = size;
+      if(i + 1 < ranges.count())
+         end = qBound<qint64>(start, ranges.at(i + 1).offset, size);
+
+      if(end <= start)
+         continue;
+
+      const int rawSize = static_cast<int>(end - start);
+      const QByteArray compressed = qCompress(data + start, rawSize);
+      qToLittleEndian<qint64>(ranges.at(i).first, entry);
+      qToLittleEndian<qint64>(ranges.at(i).last, entry + 8);
+      qToLittleEndian<quint64>(static_cast<quint64>(output.pos()), entry + 16);
+      qToLittleEndian<quint32>(static_cast<quint32>(compressed.size()),
+                               entry + 24);
+      qToLittleEndian<quint32>(static_cast<quint32>(rawSize), entry + 28);
+      index.append(entry, ENTRY_SIZE);
+      output.write(compressed);
+      ++count;
+   }
+
+   // Write block index
+   const qint64 indexOffset = output.pos();
+   output.write(index);
+
+   // Write header
+   memcpy(header, MAGIC, 4);
+   qToLittleEndian<quint16>(RFID_LOG_ARCHIVE_VERSION, header + VERSION_OFFSET);
+   qToLittleEndian<quint16>(static_cast<quint16>(format),
+                            header + FORMAT_OFFSET);
+   qToLittleEndian<quint32>(count, header + COUNT_OFFSET);
+   qToLittleEndian<quint64>(static_cast<quint64>(indexOffset),
+                            header + INDEX_OFFSET);
+   output.seek(0);
+   output.write(header, HEADER_SIZE);
+
+   // Unmap segment
+   if(mapped)
+      input.unmap(const_cast<uchar*>(data));
+
+   // Replace archive
+   if(!output.commit()) {
+      SetError(error, output.errorString());
+      return false;
+   }
+
+   return true;
+}
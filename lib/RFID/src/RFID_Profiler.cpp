@@ -0,0 +1,294 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "RFID_Profiler.h"
+
+#include <QCoreApplication>
+
+#include <algorithm>
+
+/**
+ * Name of the probe used to register the event loop lag
+ */
+static const char* EVENT_LOOP_PROBE = "Event loop lag";
+
+/**
+ * Returns a byte array that points to the given string literal
+ */
+static inline QByteArray Key(const char* name)
+{
+   return QByteArray::fromRawData(name, static_cast<int>(qstrlen(name)));
+}
+
+/**
+ * Profiling is disabled by default, so that production runs do not pay for
+ * the heartbeat timer and the probe samples
+ */
+QAtomicInteger<int> RFID_Profiler::ENABLED(0);
+
+//------------------------------------------------------------------------------
+// Utility functions
+//------------------------------------------------------------------------------
+
+/**
+ * Returns the value at the given @a percentile of the sorted @a samples
+ */
+static qint64 Percentile(const QVector<qint64>& samples, const int percentile)
+{
+   if(samples.isEmpty())
+      return 0;
+
+   int index = (samples.count() * percentile) / 100;
+   return samples.at(qMin(index, samples.count() - 1));
+}
+
+//------------------------------------------------------------------------------
+// Constructor & instance access functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_Profiler::RFID_Profiler
+ *
+ * Configures and starts the event loop heartbeat timer. The profiler can be
+ * created by a worker thread, so it is moved to the thread of the
+ * application, whose event loop is the one measured by the heartbeat.
+ */
+RFID_Profiler::RFID_Profiler()
+{
+   m_lastBeat = 0;
+   m_clock.start();
+
+   m_heartbeat.setTimerType(Qt::PreciseTimer);
+   m_heartbeat.setInterval(RFID_PROFILER_HEARTBEAT);
+   connect(&m_heartbeat, &QTimer::timeout, this, &RFID_Profiler::onHeartbeat);
+
+   QCoreApplication* app = QCoreApplication::instance();
+   if(app && thread() != app->thread()) {
+      moveToThread(app->thread());
+      m_heartbeat.moveToThread(app->thread());
+   }
+
+   if(enabled())
+      QMetaObject::invokeMethod(&m_heartbeat, "start");
+}
+
+/**
+ * @brief RFID_Profiler::getInstance
+ * @returns the only instance of the @c RFID_Profiler class, the instance is
+ *          created by the first caller (from any thread)
+ */
+RFID_Profiler* RFID_Profiler::getInstance()
+{
+   static RFID_Profiler* instance = new RFID_Profiler;
+   return instance;
+}
+
+//------------------------------------------------------------------------------
+// Statistics access functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_Profiler::stats
+ * @returns the statistics of every registered probe, the worst offenders
+ *          (highest 99th percentile) are placed first
+ */
+RFID_ProbeStatsList RFID_Profiler::stats() const
+{
+   RFID_ProbeStatsList list;
+
+   QMutexLocker locker(&m_mutex);
+   QHash<QByteArray, Probe>::const_iterator it;
+   for(it = m_probes.constBegin(); it != m_probes.constEnd(); ++it) {
+      const Probe& probe = it.value();
+
+      // Get the samples that have been registered so far & sort them
+      QVector<qint64> samples = probe.samples;
+      if(probe.calls < samples.count())
+         samples.resize(static_cast<int>(probe.calls));
+      std::sort(samples.begin(), samples.end());
+
+      // Register probe statistics
+      RFID_ProbeStats stats;
+      stats.name = QString::fromUtf8(it.key());
+      stats.calls = probe.calls;
+      stats.total = probe.total;
+      stats.p50 = Percentile(samples, 50);
+      stats.p95 = Percentile(samples, 95);
+      stats.p99 = Percentile(samples, 99);
+      stats.max = probe.max;
+      list.append(stats);
+   }
+
+   std::sort(list.begin(), list.end(),
+             [](const RFID_ProbeStats& a, const RFID_ProbeStats& b) {
+      return a.p99 > b.p99;
+   });
+
+   return list;
+}
+
+/**
+ * @brief RFID_Profiler::counters
+ * @returns the current value of every registered counter, sorted by name
+ */
+RFID_CounterList RFID_Profiler::counters() const
+{
+   RFID_CounterList list;
+
+   QMutexLocker locker(&m_mutex);
+   QHash<QByteArray, qint64>::const_iterator it;
+   for(it = m_counters.constBegin(); it != m_counters.constEnd(); ++it) {
+      RFID_Counter counter;
+      counter.name = QString::fromUtf8(it.key());
+      counter.value = it.value();
+      list.append(counter);
+   }
+
+   std::sort(list.begin(), list.end(),
+             [](const RFID_Counter& a, const RFID_Counter& b) {
+      return a.name < b.name;
+   });
+
+   return list;
+}
+
+/**
+ * @brief RFID_Profiler::addSample
+ * @param probe name of the probe (must be a string literal)
+ * @param usecs duration of the sample in microseconds
+ *
+ * Registers a new sample for the given @a probe, the oldest sample of the
+ * probe is overwritten once the ring is full.
+ */
+void RFID_Profiler::addSample(const char* probe, const qint64 usecs)
+{
+   if(!enabled())
+      return;
+
+   QMutexLocker locker(&m_mutex);
+   Probe& p = m_probes[Key(probe)];
+   if(p.samples.isEmpty()) {
+      p.next = 0;
+      p.calls = 0;
+      p.total = 0;
+      p.max = 0;
+      p.samples.resize(RFID_PROFILER_SAMPLES);
+   }
+
+   p.samples[p.next] = usecs;
+   p.next = (p.next + 1) % RFID_PROFILER_SAMPLES;
+   p.calls += 1;
+   p.total += usecs;
+   p.max = qMax(p.max, usecs);
+}
+
+/**
+ * @brief RFID_Profiler::addCount
+ * @param counter name of the counter (must be a string literal)
+ * @param count   value to add to the counter
+ */
+void RFID_Profiler::addCount(const char* counter, const qint64 count)
+{
+   QMutexLocker locker(&m_mutex);
+   m_counters[Key(counter)] += count;
+}
+
+/**
+ * @brief RFID_Profiler::setCounter
+ * @param counter name of the counter (must be a string literal)
+ * @param value   new value of the counter
+ */
+void RFID_Profiler::setCounter(const char* counter, const qint64 value)
+{
+   QMutexLocker locker(&m_mutex);
+   m_counters[Key(counter)] = value;
+}
+
+/**
+ * @brief RFID_Profiler::setCounterMax
+ * @param counter name of the counter (must be a string literal)
+ * @param value   measured value
+ *
+ * Changes the value of the @a counter if the given @a value is greater than
+ * the current value, this is used to register high watermarks.
+ */
+void RFID_Profiler::setCounterMax(const char* counter, const qint64 value)
+{
+   QMutexLocker locker(&m_mutex);
+   qint64& current = m_counters[Key(counter)];
+   current = qMax(current, value);
+}
+
+//------------------------------------------------------------------------------
+// Profiler control functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_Profiler::reset
+ *
+ * Removes all the samples and counters registered by the profiler
+ */
+void RFID_Profiler::reset()
+{
+   QMutexLocker locker(&m_mutex);
+   m_probes.clear();
+   m_counters.clear();
+   m_lastBeat = 0;
+}
+
+/**
+ * @brief RFID_Profiler::setEnabled
+ *
+ * Enables or disables the slot probes and the event loop heartbeat
+ */
+void RFID_Profiler::setEnabled(const bool enabled)
+{
+   ENABLED.store(enabled ? 1 : 0);
+
+   m_mutex.lock();
+   m_lastBeat = 0;
+   m_mutex.unlock();
+
+   // The heartbeat timer lives in the thread of the application
+   QMetaObject::invokeMethod(&m_heartbeat, enabled ? "start" : "stop");
+}
+
+/**
+ * @brief RFID_Profiler::onHeartbeat
+ *
+ * Called by the heartbeat timer, the time elapsed since the previous beat
+ * minus the timer interval is the time that the event loop was blocked.
+ */
+void RFID_Profiler::onHeartbeat()
+{
+   const qint64 now = m_clock.nsecsElapsed() / 1000;
+
+   m_mutex.lock();
+   const qint64 lastBeat = m_lastBeat;
+   m_lastBeat = now;
+   m_mutex.unlock();
+
+   if(lastBeat > 0) {
+      const qint64 lag = now - lastBeat - RFID_PROFILER_HEARTBEAT * 1000;
+      addSample(EVENT_LOOP_PROBE, qMax(lag, Q_INT64_C(0)));
+   }
+}
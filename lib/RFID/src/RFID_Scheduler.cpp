@@ -0,0 +1,552 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "RFID_Log.h"
+#include "RFID_Clock.h"
+#include "RFID_Profiler.h"
+#include "RFID_Scheduler.h"
+#include "RFID_SerialManager.h"
+
+#include <QtMath>
+
+#include <algorithm>
+
+/**
+ * Names of the probes used to register the time that the commands of each
+ * lane wait before being sent
+ */
+static const char* LANE_PROBES[RFID_NUM_LANES] = {
+   "Scheduler control lane wait",
+   "Scheduler write lane wait",
+   "Scheduler targeted read lane wait",
+   "Scheduler inventory lane wait"
+};
+
+/**
+ * Name of the probe used to register the round-trip time of the commands
+ */
+static const char* ROUND_TRIP_PROBE = "Scheduler round trip";
+
+/**
+ * Returns the value at the given @a percentile of the sorted @a samples
+ */
+static qint64 Percentile(const QVector<qint64>& samples, const int percentile)
+{
+   if(samples.isEmpty())
+      return 0;
+
+   int index = (samples.count() * percentile) / 100;
+   return samples.at(qMin(index, samples.count() - 1));
+}
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_Scheduler::RFID_Scheduler
+ *
+ * Initializes internal variables and configures the response timeout timer
+ */
+RFID_Scheduler::RFID_Scheduler(QObject* parent) : QObject(parent)
+{
+   m_sentAt = 0;
+   m_inFlight = false;
+   m_cancelled = false;
+   m_lastOperation = 0;
+   m_calibrating = false;
+   m_calibrationSent = 0;
+   m_calibrationStart = 0;
+   m_calibrationCommands = 0;
+   m_current.id = 0;
+   m_current.owner = 0;
+   m_current.timestamp = 0;
+   for(int i = 0; i < RFID_NUM_LANES; ++i)
+      m_skipped[i] = 0;
+
+   m_timer.setSingleShot(true);
+   m_timer.setInterval(RFID_SCHEDULER_TIMEOUT);
+   connect(&m_timer, &QTimer::timeout, this, &RFID_Scheduler::onTimeout);
+}
+
+//------------------------------------------------------------------------------
+// Status access functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_Scheduler::idle
+ * @returns @c true if no command is waiting for a response and no commands
+ *          are queued
+ */
+bool RFID_Scheduler::idle() const
+{
+   if(m_inFlight)
+      return false;
+
+   for(int i = 0; i < RFID_NUM_LANES; ++i)
+      if(!m_lanes[i].isEmpty())
+         return false;
+
+   return true;
+}
+
+/**
+ * @brief RFID_Scheduler::calibrating
+ * @returns @c true if the calibration burst is being sent, queued commands
+ *          are sent once the calibration is finished
+ */
+bool RFID_Scheduler::calibrating() const
+{
+   return m_calibrating;
+}
+
+/**
+ * @brief RFID_Scheduler::timeout
+ * @returns the time (in milliseconds) to wait for the response of a command
+ */
+int RFID_Scheduler::timeout() const
+{
+   return m_timer.interval();
+}
+
+/**
+ * @brief RFID_Scheduler::pendingCommands
+ * @returns the number of commands queued in the given @a lane
+ */
+int RFID_Scheduler::pendingCommands(const RFID_CommandLane lane) const
+{
+   Q_ASSERT(lane >= 0 && lane < RFID_NUM_LANES);
+   return m_lanes[lane].count();
+}
+
+/**
+ * @brief RFID_Scheduler::pending
+ * @returns @c true if the given @a operation is queued or waiting for its
+ *          response
+ */
+bool RFID_Scheduler::pending(const quint32 operation) const
+{
+   if(m_inFlight && m_current.id == operation)
+      return true;
+
+   for(int i = 0; i < RFID_NUM_LANES; ++i) {
+      foreach(const Command& command, m_lanes[i])
+         if(command.id == operation)
+            return true;
+   }
+
+   return false;
+}
+
+/**
+ * @brief RFID_Scheduler::currentCancelled
+ * @returns @c true if the command that is waiting for its response has been
+ *          cancelled, in which case its response must be discarded
+ */
+bool RFID_Scheduler::currentCancelled() const
+{
+   return m_inFlight && m_cancelled;
+}
+
+/**
+ * @brief RFID_Scheduler::currentFrame
+ * @returns the command packet that is waiting for its response, or an empty
+ *          byte array if the RFID reader is not busy
+ */
+QByteArray RFID_Scheduler::currentFrame() const
+{
+   if(m_inFlight)
+      return m_current.frame;
+
+   return QByteArray();
+}
+
+/**
+ * @brief RFID_Scheduler::currentOperation
+ * @returns the operation ID of the command that is waiting for its response,
+ *          or 0 if the RFID reader is not busy (or is being calibrated)
+ */
+quint32 RFID_Scheduler::currentOperation() const
+{
+   if(m_inFlight)
+      return m_current.id;
+
+   return 0;
+}
+
+//------------------------------------------------------------------------------
+// Command queuing functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_Scheduler::enqueue
+ * @param lane     priority lane of the command
+ * @param frame    command packet to send to the RFID reader
+ * @param owner    ID of the tag targeted by the command (0 if the command
+ *                 does not target a specific tag)
+ * @param coalesce if set to @c true, the command is not queued if the same
+ *                 command is already waiting in the @a lane for the same
+ *                 @a owner (used for periodic reads)
+ *
+ * Queues the given command and sends it immediately if the RFID reader is not
+ * busy. Returns the operation ID of the command, or 0 if the serial device is
+ * not connected.
+ */
+quint32 RFID_Scheduler::enqueue(const RFID_CommandLane lane,
+                                const QByteArray& frame,
+                                const quint32 owner,
+                                const bool coalesce)
+{
+   Q_ASSERT(lane >= 0 && lane < RFID_NUM_LANES);
+
+   // Device not connected, abort
+   if(!RFID_SerialManager::getInstance()->connected())
+      return 0;
+
+   // Command is already queued
+   if(coalesce) {
+      foreach(const Command& command, m_lanes[lane])
+         if(command.owner == owner && command.frame == frame)
+            return command.id;
+   }
+
+   // Get operation ID (0 is reserved for errors)
+   if(++m_lastOperation == 0)
+      ++m_lastOperation;
+
+   // Queue command
+   Command command;
+   command.id = m_lastOperation;
+   command.owner = owner;
+   command.frame = frame;
+   command.timestamp = RFID_Clock::getInstance()->now();
+   m_lanes[lane].enqueue(command);
+
+   // Send command if reader is not busy
+   dispatch();
+   return command.id;
+}
+
+/**
+ * @brief RFID_Scheduler::calibrate
+ * @param frame    command packet to send, it must be a command that does not
+ *                 change the state of the reader and that is always answered
+ * @param commands number of commands to send
+ *
+ * Sends the given command @a commands times back-to-back, measuring the
+ * round-trip time of each response. Once every command has been answered
+ * (or has timed out), the response timeout is set to the 99th percentile of
+ * the round-trip times multiplied by @c RFID_CALIBRATION_MARGIN and the
+ * @c calibrated() signal is emitted.
+ *
+ * Queued commands are held back during the calibration, so that they do not
+ * skew the measurements.
+ */
+void RFID_Scheduler::calibrate(const QByteArray& frame, const int commands)
+{
+   // Device not connected, abort
+   if(!RFID_SerialManager::getInstance()->connected())
+      return;
+
+   // Configure calibration
+   m_calibrating = true;
+   m_calibrationSent = 0;
+   m_calibrationFrame = frame;
+   m_calibrationCommands = qMax(commands, 1);
+   m_calibrationStart = RFID_Clock::getInstance()->now();
+   m_roundTrips.clear();
+   m_roundTrips.reserve(m_calibrationCommands);
+
+   // Be patient with the reader until we know how fast it is
+   m_timer.setInterval(RFID_CALIBRATION_TIMEOUT);
+
+   // Begin calibration once the current command is answered
+   dispatch();
+}
+
+/**
+ * @brief RFID_Scheduler::cancel
+ * @param operation operation ID returned by @c enqueue()
+ *
+ * Removes the given command from its lane. If the command is waiting for its
+ * response, the response is discarded when it arrives.
+ */
+void RFID_Scheduler::cancel(const quint32 operation)
+{
+   if(m_inFlight && m_current.id == operation && !m_cancelled) {
+      m_cancelled = true;
+      RFID_Profiler::getInstance()->addCount("Scheduler operations cancelled");
+      return;
+   }
+
+   for(int i = 0; i < RFID_NUM_LANES; ++i) {
+      for(int j = 0; j < m_lanes[i].count(); ++j) {
+         if(m_lanes[i].at(j).id == operation) {
+            m_lanes[i].removeAt(j);
+            RFID_Profiler::getInstance()->addCount(
+               "Scheduler operations cancelled");
+            return;
+         }
+      }
+   }
+}
+
+/**
+ * @brief RFID_Scheduler::cancelOwner
+ * @param owner ID of the tag targeted by the commands
+ *
+ * Cancels all the commands that target the given tag, this is used when the
+ * tag leaves the field of the RFID reader.
+ */
+void RFID_Scheduler::cancelOwner(const quint32 owner)
+{
+   if(owner == 0)
+      return;
+
+   int cancelled = 0;
+   if(m_inFlight && m_current.owner == owner && !m_cancelled) {
+      m_cancelled = true;
+      ++cancelled;
+   }
+
+   for(int i = 0; i < RFID_NUM_LANES; ++i) {
+      for(int j = m_lanes[i].count() - 1; j >= 0; --j) {
+         if(m_lanes[i].at(j).owner == owner) {
+            m_lanes[i].removeAt(j);
+            ++cancelled;
+         }
+      }
+   }
+
+   if(cancelled > 0)
+      RFID_Profiler::getInstance()->addCount("Scheduler operations cancelled",
+                                             cancelled);
+}
+
+/**
+ * @brief RFID_Scheduler::clear
+ *
+ * Removes all the queued commands, and stops waiting for the response of the
+ * current command
+ */
+void RFID_Scheduler::clear()
+{
+   m_timer.stop();
+   m_inFlight = false;
+   m_cancelled = false;
+   m_calibrating = false;
+
+   for(int i = 0; i < RFID_NUM_LANES; ++i) {
+      m_skipped[i] = 0;
+      m_lanes[i].clear();
+   }
+}
+
+/**
+ * @brief RFID_Scheduler::responseReceived
+ *
+ * Called by the reader driver when the response packet of the current command
+ * is received (even if the command was cancelled), the next queued command
+ * (if any) is sent immediately.
+ */
+void RFID_Scheduler::responseReceived()
+{
+   if(m_inFlight) {
+      const qint64 rtt = RFID_Clock::getInstance()->now() - m_sentAt;
+      RFID_Profiler::getInstance()->addSample(ROUND_TRIP_PROBE, rtt / 1000);
+      if(m_calibrating)
+         m_roundTrips.append(rtt);
+
+      emit commandAnswered(rtt / 1000);
+
+      if(m_cancelled)
+         RFID_Profiler::getInstance()->addCount("Scheduler responses discarded");
+
+      m_timer.stop();
+      m_inFlight = false;
+      m_cancelled = false;
+      dispatch();
+   }
+}
+
+/**
+ * @brief RFID_Scheduler::setTimeout
+ * @param timeout time (in milliseconds) to wait for the response of a command
+ */
+void RFID_Scheduler::setTimeout(const int timeout)
+{
+   m_timer.setInterval(qMax(timeout, 1));
+}
+
+/**
+ * @brief RFID_Scheduler::onTimeout
+ *
+ * Called when the RFID reader does not respond to the current command in
+ * time, the next queued command (if any) is sent.
+ */
+void RFID_Scheduler::onTimeout()
+{
+   m_inFlight = false;
+   m_cancelled = false;
+   RFID_Profiler::getInstance()->addCount("Scheduler timeouts");
+   RFID_LOG(RFID_LOG_SCHEDULER, RFID_LOG_DEBUG,
+            "Command %1 not answered in %2 ms",
+            m_current.id, timeout());
+   emit commandTimedOut(m_current.id);
+   dispatch();
+}
+
+/**
+ * @brief RFID_Scheduler::dispatch
+ *
+ * Sends the next command if the RFID reader is not busy.
+ *
+ * During a calibration, only the calibration commands are sent.
+ *
+ * Control commands preempt every other lane. Otherwise, a lane that has been
+ * skipped @c RFID_SCHEDULER_MAX_SKIPS times in a row is served first, and if
+ * there is no such lane, the highest priority lane with commands is served.
+ */
+void RFID_Scheduler::dispatch()
+{
+   while(!m_inFlight) {
+      // Send the next calibration command, or finish the calibration
+      if(m_calibrating) {
+         if(m_calibrationSent >= m_calibrationCommands) {
+            finishCalibration();
+            continue;
+         }
+
+         ++m_calibrationSent;
+         m_current.id = 0;
+         m_current.owner = 0;
+         m_current.frame = m_calibrationFrame;
+         m_current.timestamp = RFID_Clock::getInstance()->now();
+         send();
+         continue;
+      }
+
+      // Select lane
+      int lane = -1;
+      if(!m_lanes[RFID_LANE_CONTROL].isEmpty())
+         lane = RFID_LANE_CONTROL;
+
+      for(int i = RFID_LANE_WRITE; i < RFID_NUM_LANES && lane < 0; ++i) {
+         if(!m_lanes[i].isEmpty() && m_skipped[i] >= RFID_SCHEDULER_MAX_SKIPS)
+            lane = i;
+      }
+
+      for(int i = 0; i < RFID_NUM_LANES && lane < 0; ++i) {
+         if(!m_lanes[i].isEmpty())
+            lane = i;
+      }
+
+      // Nothing to send
+      if(lane < 0)
+         return;
+
+      // Update fair sharing counters
+      for(int i = 0; i < RFID_NUM_LANES; ++i) {
+         if(i == lane || m_lanes[i].isEmpty())
+            m_skipped[i] = 0;
+         else
+            ++m_skipped[i];
+      }
+
+      // Register the time that the command waited in its lane
+      m_current = m_lanes[lane].dequeue();
+      const qint64 wait = RFID_Clock::getInstance()->now() - m_current.timestamp;
+      RFID_Profiler::getInstance()->addSample(LANE_PROBES[lane], wait / 1000);
+
+      // Send command & wait for response
+      send();
+   }
+}
+
+/**
+ * @brief RFID_Scheduler::send
+ *
+ * Sends the current command and waits for its response. Returns @c false if
+ * the command cannot be sent, in which case the command is ignored.
+ */
+bool RFID_Scheduler::send()
+{
+   const qint64 bytes = RFID_SerialManager::getInstance()->writeData(
+                           m_current.frame);
+   if(bytes != m_current.frame.length())
+      return false;
+
+   m_inFlight = true;
+   m_cancelled = false;
+   m_sentAt = RFID_Clock::getInstance()->now();
+   m_timer.start();
+   return true;
+}
+
+/**
+ * @brief RFID_Scheduler::finishCalibration
+ *
+ * Calculates the round-trip statistics of the calibration burst, adjusts the
+ * response timeout and notifies the reader driver. The default timeout is
+ * kept if the reader did not answer any command.
+ */
+void RFID_Scheduler::finishCalibration()
+{
+   m_calibrating = false;
+
+   // Calculate round-trip percentiles
+   std::sort(m_roundTrips.begin(), m_roundTrips.end());
+   RFID_Calibration calibration;
+   calibration.sent = m_calibrationSent;
+   calibration.received = m_roundTrips.count();
+   calibration.p50 = Percentile(m_roundTrips, 50) / 1000;
+   calibration.p99 = Percentile(m_roundTrips, 99) / 1000;
+   calibration.max = m_roundTrips.isEmpty() ? 0 : m_roundTrips.last() / 1000;
+
+   // Calculate the number of answered commands per second
+   const qint64 elapsed = RFID_Clock::getInstance()->now() - m_calibrationStart;
+   calibration.rate = 0;
+   if(elapsed > 0)
+      calibration.rate = calibration.received * 1e9 / elapsed;
+
+   // Update response timeout
+   int timeout = RFID_SCHEDULER_TIMEOUT;
+   if(calibration.received > 0) {
+      timeout = qCeil(calibration.p99 * RFID_CALIBRATION_MARGIN / 1000.0);
+      timeout = qBound(RFID_SCHEDULER_MIN_TIMEOUT, timeout,
+                       RFID_CALIBRATION_TIMEOUT);
+   }
+
+   setTimeout(timeout);
+   calibration.timeout = timeout;
+
+   // Register results
+   const int lost = calibration.sent - calibration.received;
+   RFID_Profiler* profiler = RFID_Profiler::getInstance();
+   profiler->setCounter("Calibration round trip p99 (us)", calibration.p99);
+   profiler->setCounter("Calibration commands lost", lost);
+   RFID_LOG(RFID_LOG_SCHEDULER, RFID_LOG_INFO,
+            "Calibrated: %1 of %2 commands answered, p99 %3 us, timeout %4 ms",
+            calibration.received, calibration.sent, calibration.p99, timeout);
+
+   emit calibrated(calibration);
+}
@@ -0,0 +1,422 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "RFID.h"
+#include "RFID_Clock.h"
+#include "RFID_Profiler.h"
+#include "RFID_TidTable.h"
+#include "RFID_TagDatabase.h"
+
+#include <QSqlError>
+
+#include <algorithm>
+
+//------------------------------------------------------------------------------
+// Utility functions
+//------------------------------------------------------------------------------
+
+/**
+ * Returns the tag with the given @a id in the @a snapshot, or @c NULL if the
+ * tag is not in the snapshot. Snapshot tags are sorted by ID, since new tags
+ * are always appended to the tag list.
+ */
+static const RFID_Tag* FindTag(const RFID_TagSnapshotPtr& snapshot,
+                               const quint32 id)
+{
+   QVector<RFID_Tag>::const_iterator it;
+   it = std::lower_bound(snapshot->tags.constBegin(),
+                         snapshot->tags.constEnd(),
+                         id,
+                         [](const RFID_Tag& tag, const quint32 id) {
+      return tag.id < id;
+   });
+
+   if(it != snapshot->tags.constEnd() && it->id == id)
+      return &(*it);
+
+   return Q_NULLPTR;
+}
+
+/**
+ * Returns the UTC time of the given monotonic @a timestamp, unknown
+ * timestamps (0) are kept as they are
+ */
+static inline qint64 ToUtc(const qint64 timestamp)
+{
+   if(timestamp == 0)
+      return 0;
+
+   return RFID_Clock::getInstance()->toUtc(timestamp);
+}
+
+//------------------------------------------------------------------------------
+// Database writer
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_TagDatabaseWriter::RFID_TagDatabaseWriter
+ * @param connection name of the database connection used by the writer
+ *
+ * Configures the batch timer
+ */
+RFID_TagDatabaseWriter::RFID_TagDatabaseWriter(const QString& connection) :
+   m_connection(connection),
+   m_timer(this)
+{
+   m_session = 0;
+
+   m_timer.setSingleShot(true);
+   m_timer.setInterval(RFID_DB_FLUSH_INTERVAL);
+   connect(&m_timer, &QTimer::timeout, this, &RFID_TagDatabaseWriter::flush);
+}
+
+/**
+ * @brief RFID_TagDatabaseWriter::errorString
+ * @returns a description of the last database error
+ */
+QString RFID_TagDatabaseWriter::errorString() const
+{
+   return m_error;
+}
+
+/**
+ * @brief RFID_TagDatabaseWriter::open
+ *
+ * Opens (or creates) the database file, switches it to WAL mode, creates the
+ * tables & indexes and prepares the insert statements. Returns @c false on
+ * error.
+ */
+bool RFID_TagDatabaseWriter::open(const QString& fileName)
+{
+   QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", m_connection);
+   db.setDatabaseName(fileName);
+   if(!db.open()) {
+      m_error = db.lastError().text();
+      return false;
+   }
+
+   // Configure database & create schema
+   const bool ok = exec("PRAGMA journal_mode=WAL")
+                   && exec("PRAGMA synchronous=NORMAL")
+                   && exec("CREATE TABLE IF NOT EXISTS tags ("
+                           "session INTEGER NOT NULL, "
+                           "id INTEGER NOT NULL, "
+                           "epc BLOB, tid BLOB, rfu BLOB, usr BLOB, "
+                           "first_seen INTEGER, last_seen INTEGER, "
+                           "PRIMARY KEY (session, id))")
+                   && exec("CREATE TABLE IF NOT EXISTS events ("
+                           "session INTEGER NOT NULL, "
+                           "tag INTEGER NOT NULL, "
+                           "time INTEGER NOT NULL, "
+                           "fields INTEGER NOT NULL, "
+                           "epc BLOB, tid BLOB)")
+                   && exec("CREATE INDEX IF NOT EXISTS tags_epc ON tags (epc)")
+                   && exec("CREATE INDEX IF NOT EXISTS tags_tid ON tags (tid)")
+                   && exec("CREATE INDEX IF NOT EXISTS tags_last_seen "
+                           "ON tags (last_seen)")
+                   && exec("CREATE INDEX IF NOT EXISTS events_time "
+                           "ON events (time)")
+                   && exec("CREATE INDEX IF NOT EXISTS events_epc "
+                           "ON events (epc)")
+                   && exec("CREATE INDEX IF NOT EXISTS events_tid "
+                           "ON events (tid)");
+
+   if(!ok)
+      return false;
+
+   // Prepare insert statements
+   m_tagQuery = QSqlQuery(db);
+   m_eventQuery = QSqlQuery(db);
+   if(!m_tagQuery.prepare("INSERT OR REPLACE INTO tags "
+                          "(session, id, epc, tid, rfu, usr, "
+                          "first_seen, last_seen) "
+                          "VALUES (?, ?, ?, ?, ?, ?, ?, ?)")
+         || !m_eventQuery.prepare("INSERT INTO events "
+                                  "(session, tag, time, fields, epc, tid) "
+                                  "VALUES (?, ?, ?, ?, ?, ?)")) {
+      m_error = db.lastError().text();
+      return false;
+   }
+
+   // Begin session
+   const RFID_Clock* clock = RFID_Clock::getInstance();
+   m_session = clock->toUtc(clock->now());
+   return true;
+}
+
+/**
+ * @brief RFID_TagDatabaseWriter::close
+ *
+ * Writes the pending changes and closes the database
+ */
+void RFID_TagDatabaseWriter::close()
+{
+   if(m_session != 0)
+      flush();
+
+   m_session = 0;
+   m_tagQuery = QSqlQuery();
+   m_eventQuery = QSqlQuery();
+   QSqlDatabase::database(m_connection, false).close();
+   QSqlDatabase::removeDatabase(m_connection);
+}
+
+/**
+ * @brief RFID_TagDatabaseWriter::flush
+ *
+ * Writes the pending tags and events in a single transaction, returns
+ * @c false if the transaction fails (the pending changes are discarded, so
+ * that a broken database does not exhaust the memory)
+ */
+bool RFID_TagDatabaseWriter::flush()
+{
+   m_timer.stop();
+   if(m_tags.isEmpty() && m_events.isEmpty())
+      return true;
+
+   RFID_PROFILE("RFID_TagDatabase::flush");
+
+   QSqlDatabase db = QSqlDatabase::database(m_connection, false);
+   bool ok = db.transaction();
+
+   // Write the latest data of the changed tags
+   RFID_TidTable* tids = RFID_TidTable::getInstance();
+   QHash<quint32, RFID_Tag>::const_iterator it;
+   for(it = m_tags.constBegin(); ok && it != m_tags.constEnd(); ++it) {
+      const RFID_Tag& tag = it.value();
+      QByteArray usr;
+      for(int i = 0; i < RFID_NUM_USER_DATAGRAMS; ++i)
+         usr.append(tag.usr[i]);
+
+      m_tagQuery.bindValue(0, m_session);
+      m_tagQuery.bindValue(1, tag.id);
+      m_tagQuery.bindValue(2, tag.epc);
+      m_tagQuery.bindValue(3, tids->tid(tag.tid));
+      m_tagQuery.bindValue(4, tag.rfu);
+      m_tagQuery.bindValue(5, usr);
+      m_tagQuery.bindValue(6, ToUtc(tag.firstSeen));
+      m_tagQuery.bindValue(7, ToUtc(tag.lastSeen));
+      ok = m_tagQuery.exec();
+   }
+
+   // Write events
+   for(int i = 0; ok && i < m_events.count(); ++i) {
+      const Event& event = m_events.at(i);
+      m_eventQuery.bindValue(0, m_session);
+      m_eventQuery.bindValue(1, event.tag);
+      m_eventQuery.bindValue(2, event.time);
+      m_eventQuery.bindValue(3, event.fields);
+      m_eventQuery.bindValue(4, event.epc);
+      m_eventQuery.bindValue(5, event.tid);
+      ok = m_eventQuery.exec();
+   }
+
+   // Commit transaction
+   RFID_Profiler* profiler = RFID_Profiler::getInstance();
+   if(ok && db.commit())
+      profiler->addCount("History rows written",
+                         m_tags.count() + m_events.count());
+
+   else {
+      m_error = db.lastError().text();
+      db.rollback();
+      profiler->addCount("History write errors");
+      ok = false;
+   }
+
+   m_tags.clear();
+   m_events.clear();
+   return ok;
+}
+
+/**
+ * @brief RFID_TagDatabaseWriter::onTagsChanged
+ *
+ * Registers the tags of the given change set (read from the latest published
+ * snapshot) and their events. Read updates (@c RFID_FIELD_SEEN) only update
+ * the tag, every other change is also registered as an event.
+ */
+void RFID_TagDatabaseWriter::onTagsChanged(const RFID_ChangeSet& changes)
+{
+   if(m_session == 0)
+      return;
+
+   const RFID_TagSnapshotPtr snapshot = RFID::getInstance()->snapshot();
+   if(!snapshot)
+      return;
+
+   const RFID_Clock* clock = RFID_Clock::getInstance();
+   const qint64 now = clock->toUtc(clock->now());
+   RFID_TidTable* tids = RFID_TidTable::getInstance();
+   foreach(const RFID_TagChange& change, changes.changes) {
+      // Register the latest data of the tag
+      const RFID_Tag* tag = FindTag(snapshot, change.tag);
+      if(tag)
+         m_tags.insert(tag->id, *tag);
+
+      // Only the read times changed
+      if((change.fields & ~RFID_FIELD_SEEN) == 0)
+         continue;
+
+      // Register event
+      Event event;
+      event.tag = change.tag;
+      event.fields = change.fields;
+      event.time = now;
+      if(tag) {
+         event.epc = tag->epc;
+         event.tid = tids->tid(tag->tid);
+      }
+
+      m_events.append(event);
+   }
+
+   // Write batch or wait for more changes
+   if(m_tags.count() + m_events.count() >= RFID_DB_BATCH_SIZE)
+      flush();
+   else if(!m_timer.isActive() && (!m_tags.isEmpty() || !m_events.isEmpty()))
+      m_timer.start();
+}
+
+/**
+ * @brief RFID_TagDatabaseWriter::exec
+ *
+ * Executes the given SQL @a statement, returns @c false on error
+ */
+bool RFID_TagDatabaseWriter::exec(const QString& statement)
+{
+   QSqlQuery query(QSqlDatabase::database(m_connection, false));
+   if(query.exec(statement))
+      return true;
+
+   m_error = query.lastError().text();
+   return false;
+}
+
+//------------------------------------------------------------------------------
+// Constructor & destructor
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_TagDatabase::RFID_TagDatabase
+ *
+ * Initializes the database controller, use @c open() to begin writing the
+ * tag history
+ */
+RFID_TagDatabase::RFID_TagDatabase(QObject* parent) : QObject(parent)
+{
+   m_writer = Q_NULLPTR;
+}
+
+/**
+ * @brief RFID_TagDatabase::~RFID_TagDatabase
+ *
+ * Writes the pending changes and stops the database thread
+ */
+RFID_TagDatabase::~RFID_TagDatabase()
+{
+   close();
+}
+
+//------------------------------------------------------------------------------
+// Database control functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_TagDatabase::isOpen
+ * @returns @c true if the tag history is being written to the database
+ */
+bool RFID_TagDatabase::isOpen() const
+{
+   return m_writer != Q_NULLPTR;
+}
+
+/**
+ * @brief RFID_TagDatabase::errorString
+ * @returns a description of the error that prevented the database from
+ *          being opened
+ */
+QString RFID_TagDatabase::errorString() const
+{
+   return m_error;
+}
+
+/**
+ * @brief RFID_TagDatabase::open
+ * @param fileName path of the SQLite database
+ *
+ * Starts the database thread, opens the database and begins writing the
+ * changes of the tag store to it. Returns @c false if the database cannot be
+ * opened.
+ */
+bool RFID_TagDatabase::open(const QString& fileName)
+{
+   close();
+
+   // Create writer & move it to the database thread
+   const QString connection = QString("RFID_TagDatabase_%1")
+                              .arg(reinterpret_cast<quintptr>(this));
+   m_writer = new RFID_TagDatabaseWriter(connection);
+   m_writer->moveToThread(&m_thread);
+   connect(&m_thread, &QThread::finished,
+           m_writer, &RFID_TagDatabaseWriter::deleteLater);
+   m_thread.start(QThread::LowPriority);
+
+   // Open database from the database thread
+   bool ok = false;
+   QMetaObject::invokeMethod(m_writer, "open",
+                             Qt::BlockingQueuedConnection,
+                             Q_RETURN_ARG(bool, ok),
+                             Q_ARG(QString, fileName));
+
+   if(!ok) {
+      m_error = m_writer->errorString();
+      close();
+      return false;
+   }
+
+   // Receive the changes of the tag store
+   connect(RFID::getInstance(), &RFID::tagsChanged,
+           m_writer, &RFID_TagDatabaseWriter::onTagsChanged);
+
+   return true;
+}
+
+/**
+ * @brief RFID_TagDatabase::close
+ *
+ * Writes the pending changes, closes the database and stops the database
+ * thread
+ */
+void RFID_TagDatabase::close()
+{
+   if(!m_writer)
+      return;
+
+   disconnect(RFID::getInstance(), &RFID::tagsChanged,
+              m_writer, &RFID_TagDatabaseWriter::onTagsChanged);
+   QMetaObject::invokeMethod(m_writer, "close", Qt::BlockingQueuedConnection);
+
+   m_thread.quit();
+   m_thread.wait();
+   m_writer = Q_NULLPTR;
+}
@@ -0,0 +1,282 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "RFID_TagHistory.h"
+
+//------------------------------------------------------------------------------
+// Utility functions
+//------------------------------------------------------------------------------
+
+/**
+ * Returns the 16-bit memory word at the given @a index of the @a data,
+ * missing bytes are read as zeroes
+ */
+static inline quint16 Word(const QByteArray& data, const int index)
+{
+   const int offset = index * 2;
+   quint16 word = 0;
+   if(offset < data.length())
+      word = static_cast<quint16>(static_cast<quint8>(data.at(offset)) << 8);
+   if(offset + 1 < data.length())
+      word |= static_cast<quint8>(data.at(offset + 1));
+
+   return word;
+}
+
+/**
+ * Generates the delta that converts @a after into @a before: the length of
+ * @a before, followed by runs of changed words (index of the first word,
+ * number of words and the previous value of each word)
+ */
+static QByteArray Encode(const QByteArray& before, const QByteArray& after)
+{
+   QByteArray delta;
+   delta.append(static_cast<char>(before.length()));
+
+   const int words = (qMax(before.length(), after.length()) + 1) / 2;
+
+   int i = 0;
+   while(i < words) {
+      if(Word(before, i) == Word(after, i)) {
+         ++i;
+         continue;
+      }
+
+      const int first = i;
+      while(i < words && i - first < 0xff && Word(before, i) != Word(after, i))
+         ++i;
+
+      delta.append(static_cast<char>(first));
+      delta.append(static_cast<char>(i - first));
+      for(int j = first; j < i; ++j) {
+         const quint16 word = Word(before, j);
+         delta.append(static_cast<char>(word >> 8));
+         delta.append(static_cast<char>(word & 0xff));
+      }
+   }
+
+   return delta;
+}
+
+/**
+ * Applies the given @a delta to the @a after data and returns the previous
+ * version of the data
+ */
+static QByteArray Decode(const QByteArray& delta, const QByteArray& after)
+{
+   if(delta.isEmpty())
+      return after;
+
+   const int length = static_cast<quint8>(delta.at(0));
+   QByteArray before = after;
+   before.resize(qMax(after.length(), length));
+   for(int i = after.length(); i < before.length(); ++i)
+      before[i] = 0;
+
+   int pos = 1;
+   while(pos + 2 <= delta.length()) {
+      const int first = static_cast<quint8>(delta.at(pos));
+      const int count = static_cast<quint8>(delta.at(pos + 1));
+      pos += 2;
+
+      for(int j = 0; j < count && pos + 2 <= delta.length(); ++j) {
+         const int offset = (first + j) * 2;
+         if(offset + 2 > before.length())
+            before.resize(offset + 2);
+
+         before[offset] = delta.at(pos);
+         before[offset + 1] = delta.at(pos + 1);
+         pos += 2;
+      }
+   }
+
+   before.resize(length);
+   return before;
+}
+
+/**
+ * Returns the current data of the given @a field of the @a tag
+ */
+static QByteArray FieldData(const RFID_Tag& tag, const quint32 field)
+{
+   switch(field) {
+      case RFID_FIELD_EPC:
+         return tag.epc;
+      case RFID_FIELD_RFU:
+         return tag.rfu;
+      default:
+         break;
+   }
+
+   for(int i = 0; i < RFID_NUM_USER_DATAGRAMS; ++i)
+      if(field == static_cast<quint32>(RFID_FIELD_USR << i))
+         return tag.usr[i];
+
+   return QByteArray();
+}
+
+//------------------------------------------------------------------------------
+// Constructor & access functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_TagHistory::RFID_TagHistory
+ *
+ * Creates an empty history, the first writer identity is reserved for the
+ * changes that were not written by this application
+ */
+RFID_TagHistory::RFID_TagHistory()
+{
+   clear();
+}
+
+/**
+ * @brief RFID_TagHistory::count
+ * @returns the number of changes registered for the @a tag with the given id
+ */
+int RFID_TagHistory::count(const quint32 tag) const
+{
+   return m_deltas.value(tag).count();
+}
+
+/**
+ * @brief RFID_TagHistory::size
+ * @returns the number of bytes used by the deltas of all the tags
+ */
+qint64 RFID_TagHistory::size() const
+{
+   return m_size;
+}
+
+/**
+ * @brief RFID_TagHistory::versions
+ * @param tag registered tag, its current data is used to rebuild the
+ *            previous versions of its memory banks
+ *
+ * @returns the changes registered for the given @a tag, the newest change
+ *          is placed first
+ */
+QVector<RFID_TagVersion> RFID_TagHistory::versions(const RFID_Tag& tag) const
+{
+   QVector<RFID_TagVersion> list;
+   const QVector<Delta> deltas = m_deltas.value(tag.id);
+   if(deltas.isEmpty())
+      return list;
+
+   // Current data of each memory bank, replaced by the previous version as
+   // the deltas are applied
+   QHash<quint32, QByteArray> data;
+
+   list.reserve(deltas.count());
+   for(int i = deltas.count() - 1; i >= 0; --i) {
+      const Delta& delta = deltas.at(i);
+      if(!data.contains(delta.field))
+         data.insert(delta.field, FieldData(tag, delta.field));
+
+      RFID_TagVersion version;
+      version.timestamp = delta.timestamp;
+      version.field = delta.field;
+      version.writer = m_writers.at(delta.writer);
+      version.after = data.value(delta.field);
+      version.before = Decode(delta.delta, version.after);
+      data.insert(delta.field, version.before);
+      list.append(version);
+   }
+
+   return list;
+}
+
+//------------------------------------------------------------------------------
+// History management functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_TagHistory::clear
+ *
+ * Removes the changes of all the tags
+ */
+void RFID_TagHistory::clear()
+{
+   m_size = 0;
+   m_deltas.clear();
+   m_writers.clear();
+   m_writers.append(QString());
+}
+
+/**
+ * @brief RFID_TagHistory::remove
+ *
+ * Removes the changes of the @a tag with the given id (e.g. when a duplicated
+ * tag entry is removed)
+ */
+void RFID_TagHistory::remove(const quint32 tag)
+{
+   const QVector<Delta> deltas = m_deltas.take(tag);
+   foreach(const Delta& delta, deltas)
+      m_size -= delta.delta.size();
+}
+
+/**
+ * @brief RFID_TagHistory::record
+ * @param tag       id of the modified tag
+ * @param field     modified tag field (only one field)
+ * @param before    previous data of the field
+ * @param after     new data of the field
+ * @param timestamp monotonic time of the change
+ * @param writer    identity of the writer (empty if unknown)
+ *
+ * Registers a change of a memory bank of the given @a tag, the oldest change
+ * of the tag is discarded once it has @c RFID_HISTORY_DEPTH changes.
+ */
+void RFID_TagHistory::record(const quint32 tag,
+                             const quint32 field,
+                             const QByteArray& before,
+                             const QByteArray& after,
+                             const qint64 timestamp,
+                             const QString& writer)
+{
+   if(before == after)
+      return;
+
+   // Intern writer identity
+   int index = m_writers.indexOf(writer);
+   if(index < 0) {
+      index = m_writers.count();
+      m_writers.append(writer);
+   }
+
+   // Register delta
+   Delta delta;
+   delta.timestamp = timestamp;
+   delta.field = field;
+   delta.writer = index;
+   delta.delta = Encode(before, after);
+
+   QVector<Delta>& deltas = m_deltas[tag];
+   if(deltas.count() >= RFID_HISTORY_DEPTH) {
+      m_size -= deltas.first().delta.size();
+      deltas.removeFirst();
+   }
+
+   m_size += delta.delta.size();
+   deltas.append(delta);
+}
@@ -0,0 +1,351 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "RFID_TagStore.h"
+
+//------------------------------------------------------------------------------
+// Utility functions
+//------------------------------------------------------------------------------
+
+/**
+ * Returns a pointer to the byte array of the given @a tag that stores the
+ * data of the given @a field (the TID is not stored as a byte array, see
+ * @c RFID_TidTable)
+ */
+static QByteArray* TagField(RFID_Tag* tag, const quint32 field)
+{
+   Q_ASSERT(tag);
+
+   switch(field) {
+      case RFID_FIELD_EPC:
+         return &tag->epc;
+      case RFID_FIELD_RFU:
+         return &tag->rfu;
+      default:
+         break;
+   }
+
+   for(int i = 0; i < RFID_NUM_USER_DATAGRAMS; ++i)
+      if(field == static_cast<quint32>(RFID_FIELD_USR << i))
+         return &tag->usr[i];
+
+   Q_ASSERT(false);
+   return Q_NULLPTR;
+}
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_TagStore::RFID_TagStore
+ *
+ * Creates an empty tag store
+ */
+RFID_TagStore::RFID_TagStore()
+{
+}
+
+//------------------------------------------------------------------------------
+// Tag access functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_TagStore::count
+ * @returns the number of registered tags, can be called from any thread
+ */
+int RFID_TagStore::count() const
+{
+   QReadLocker locker(&m_lock);
+   return m_list.count();
+}
+
+/**
+ * @brief RFID_TagStore::tags
+ * @returns the registered tags, in the order in which they were registered
+ *          (only to be used by the owner thread)
+ */
+const RFID_TagList& RFID_TagStore::tags() const
+{
+   return m_list;
+}
+
+/**
+ * @brief RFID_TagStore::find
+ * @returns the registered tag with the given @a tid, or @c NULL if there is
+ *          no such tag (only to be used by the owner thread)
+ */
+RFID_Tag* RFID_TagStore::find(const RFID_TagKey& tid) const
+{
+   return m_tids.value(tid, Q_NULLPTR);
+}
+
+/**
+ * @brief RFID_TagStore::find
+ * @returns the registered tag that uses (or used) the given @a epc, or
+ *          @c NULL if there is no such tag (only to be used by the owner
+ *          thread)
+ */
+RFID_Tag* RFID_TagStore::find(const QByteArray& epc) const
+{
+   return m_epcs.value(epc, Q_NULLPTR);
+}
+
+/**
+ * @brief RFID_TagStore::copy
+ * @param id  ID of the tag
+ * @param tag set to a copy of the tag
+ * @returns @c true if the tag is registered, can be called from any thread
+ */
+bool RFID_TagStore::copy(const quint32 id, RFID_Tag* tag) const
+{
+   QReadLocker locker(&m_lock);
+   return copyTag(m_tags.value(id, Q_NULLPTR), tag);
+}
+
+/**
+ * @brief RFID_TagStore::copy
+ * @param tid TID of the tag
+ * @param tag set to a copy of the tag
+ * @returns @c true if the tag is registered, can be called from any thread
+ */
+bool RFID_TagStore::copy(const RFID_TagKey& tid, RFID_Tag* tag) const
+{
+   QReadLocker locker(&m_lock);
+   return copyTag(m_tids.value(tid, Q_NULLPTR), tag);
+}
+
+/**
+ * @brief RFID_TagStore::copy
+ * @param epc current or previous EPC of the tag
+ * @param tag set to a copy of the tag
+ * @returns @c true if the tag is registered, can be called from any thread
+ */
+bool RFID_TagStore::copy(const QByteArray& epc, RFID_Tag* tag) const
+{
+   QReadLocker locker(&m_lock);
+   return copyTag(m_epcs.value(epc, Q_NULLPTR), tag);
+}
+
+/**
+ * @brief RFID_TagStore::copyTag
+ *
+ * Copies the @a source tag, the caller must hold the lock of the store
+ */
+bool RFID_TagStore::copyTag(const RFID_Tag* source, RFID_Tag* tag) const
+{
+   Q_ASSERT(tag);
+
+   if(!source)
+      return false;
+
+   *tag = *source;
+   return true;
+}
+
+//------------------------------------------------------------------------------
+// Tag registration functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_TagStore::clear
+ *
+ * Unregisters all the tags, the tags are not deleted
+ */
+void RFID_TagStore::clear()
+{
+   QWriteLocker locker(&m_lock);
+   m_list.clear();
+   m_tags.clear();
+   m_tids.clear();
+   m_epcs.clear();
+   m_keys.clear();
+}
+
+/**
+ * @brief RFID_TagStore::index
+ * @param tag registered tag
+ *
+ * Registers the TID and the current EPC of the given @a tag in the identity
+ * indexes, previous EPCs are kept as aliases of the tag
+ */
+void RFID_TagStore::index(RFID_Tag* tag)
+{
+   Q_ASSERT(tag && tag->id != 0);
+
+   // Keys are already indexed (the usual case, checked without locking
+   // because only the owner thread modifies the indexes)
+   const bool tidIndexed = !RFID_ValidKey(tag->tid)
+                           || m_tids.value(tag->tid, Q_NULLPTR) == tag;
+   const bool epcIndexed = tag->epc.isEmpty()
+                           || m_epcs.value(tag->epc, Q_NULLPTR) == tag;
+   if(tidIndexed && epcIndexed)
+      return;
+
+   // Register the keys, the keys of the tag are remembered so that they can
+   // be removed without scanning the indexes
+   QWriteLocker locker(&m_lock);
+   Keys& keys = m_keys[tag];
+   if(!tidIndexed) {
+      m_tids.insert(tag->tid, tag);
+      if(!keys.tids.contains(tag->tid))
+         keys.tids.append(tag->tid);
+   }
+
+   if(!epcIndexed) {
+      m_epcs.insert(tag->epc, tag);
+      if(!keys.epcs.contains(tag->epc))
+         keys.epcs.append(tag->epc);
+   }
+}
+
+/**
+ * @brief RFID_TagStore::insert
+ * @param tag tag with a unique ID
+ *
+ * Registers the given @a tag and its TID & EPC
+ */
+void RFID_TagStore::insert(RFID_Tag* tag)
+{
+   Q_ASSERT(tag && tag->id != 0);
+
+   {
+      QWriteLocker locker(&m_lock);
+      m_list.append(tag);
+      m_tags.insert(tag->id, tag);
+   }
+
+   index(tag);
+}
+
+/**
+ * @brief RFID_TagStore::remove
+ * @param tag registered tag
+ *
+ * Removes the given @a tag, its TID and all its EPC aliases from the store.
+ * The caller can delete the tag once this function returns
+ */
+void RFID_TagStore::remove(RFID_Tag* tag)
+{
+   Q_ASSERT(tag);
+
+   QWriteLocker locker(&m_lock);
+
+   // Remove the keys of the tag from the indexes (keys that now point to
+   // another tag are kept)
+   const Keys keys = m_keys.take(tag);
+   foreach(const RFID_TagKey& tid, keys.tids) {
+      if(m_tids.value(tid, Q_NULLPTR) == tag)
+         m_tids.remove(tid);
+   }
+
+   foreach(const QByteArray& epc, keys.epcs) {
+      if(m_epcs.value(epc, Q_NULLPTR) == tag)
+         m_epcs.remove(epc);
+   }
+
+   // Unregister the tag
+   if(m_tags.value(tag->id, Q_NULLPTR) == tag)
+      m_tags.remove(tag->id);
+
+   m_list.removeOne(tag);
+}
+
+//------------------------------------------------------------------------------
+// Tag modification functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_TagStore::update
+ * @param tag      tag to update
+ * @param field    tag field to update (only one field)
+ * @param data     new data of the field
+ * @param previous set to the previous data of the field (if not @c NULL)
+ *
+ * Changes the @a field of the @a tag if the given @a data is not empty and
+ * different from the current data.
+ *
+ * @returns @c true if the tag was modified
+ */
+bool RFID_TagStore::update(RFID_Tag* tag,
+                           const quint32 field,
+                           const QByteArray& data,
+                           QByteArray* previous)
+{
+   QByteArray* dest = TagField(tag, field);
+   if(data.isEmpty() || *dest == data)
+      return false;
+
+   QWriteLocker locker(&m_lock);
+   if(previous)
+      *previous = *dest;
+
+   *dest = data;
+   return true;
+}
+
+/**
+ * @brief RFID_TagStore::updateKey
+ * @param tag tag to update
+ * @param key compact TID of the tag
+ *
+ * Changes the TID of the given @a tag if the @a key is valid and different
+ * from the current TID of the @a tag, the new TID is not indexed (see
+ * @c index()).
+ *
+ * @returns @c true if the tag was modified
+ */
+bool RFID_TagStore::updateKey(RFID_Tag* tag, const RFID_TagKey& key)
+{
+   if(!RFID_ValidKey(key) || tag->tid == key)
+      return false;
+
+   QWriteLocker locker(&m_lock);
+   tag->tid = key;
+   return true;
+}
+
+/**
+ * @brief RFID_TagStore::updateTimestamps
+ * @param tag       tag to update
+ * @param timestamp monotonic time at which the tag was read
+ *
+ * Extends the first seen/last seen interval of the @a tag so that it
+ * includes the given @a timestamp.
+ *
+ * @returns @c true if the tag was modified
+ */
+bool RFID_TagStore::updateTimestamps(RFID_Tag* tag, const qint64 timestamp)
+{
+   const bool first = tag->firstSeen == 0 || timestamp < tag->firstSeen;
+   const bool last = timestamp > tag->lastSeen;
+   if(!first && !last)
+      return false;
+
+   QWriteLocker locker(&m_lock);
+   if(first)
+      tag->firstSeen = timestamp;
+   if(last)
+      tag->lastSeen = timestamp;
+
+   return true;
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "RFID_TidTable.h"
+
+/**
+ * Pointer to the only instance of the @c RFID_TidTable class
+ */
+static RFID_TidTable* INSTANCE = Q_NULLPTR;
+
+//------------------------------------------------------------------------------
+// Constructor & instance access functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_TidTable::RFID_TidTable
+ */
+RFID_TidTable::RFID_TidTable()
+{
+}
+
+/**
+ * @brief RFID_TidTable::getInstance
+ * @returns the only instance of the @c RFID_TidTable class
+ */
+RFID_TidTable* RFID_TidTable::getInstance()
+{
+   if(INSTANCE == Q_NULLPTR)
+      INSTANCE = new RFID_TidTable;
+
+   return INSTANCE;
+}
+
+//------------------------------------------------------------------------------
+// TID interning functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_TidTable::prefixCount
+ * @returns the number of different TID prefixes registered so far
+ */
+int RFID_TidTable::prefixCount() const
+{
+   QReadLocker locker(&m_lock);
+   return m_prefixes.count();
+}
+
+/**
+ * @brief RFID_TidTable::intern
+ * @param tid complete TID of a tag
+ *
+ * Splits the given @a tid in its prefix and its serial number (the last
+ * @c RFID_TID_SERIAL_LENGTH bytes), registers the prefix if needed and
+ * returns the compact key of the TID. An empty @a tid, or a @a tid longer
+ * than @c RFID_TID_MAX_LENGTH bytes, returns an invalid key.
+ *
+ * The length of the serial number is stored with the prefix, so that TIDs
+ * of different lengths never get the same key. The prefix is looked up from
+ * a copy on the stack, so interning a known TID does not allocate.
+ */
+RFID_TagKey RFID_TidTable::intern(const QByteArray& tid)
+{
+   RFID_TagKey key;
+   key.prefix = 0;
+   key.serial = 0;
+
+   // TID is unknown or not supported
+   if(tid.isEmpty() || tid.length() > RFID_TID_MAX_LENGTH)
+      return key;
+
+   // Get serial number
+   const int serialLength = qMin(tid.length(), RFID_TID_SERIAL_LENGTH);
+   const int prefixLength = tid.length() - serialLength;
+   for(int i = prefixLength; i < tid.length(); ++i)
+      key.serial = (key.serial << 8) | static_cast<quint8>(tid.at(i));
+
+   // Get prefix (including the serial number length)
+   RFID_TidPrefix prefix;
+   prefix.length = prefixLength + 1;
+   memcpy(prefix.data, tid.constData(), static_cast<size_t>(prefixLength));
+   prefix.data[prefixLength] = static_cast<char>(serialLength);
+
+   // Prefix already registered
+   m_lock.lockForRead();
+   key.prefix = m_ids.value(prefix, 0);
+   m_lock.unlock();
+   if(key.prefix != 0)
+      return key;
+
+   // Register prefix (it may have been registered by another thread)
+   QWriteLocker locker(&m_lock);
+   key.prefix = m_ids.value(prefix, 0);
+   if(key.prefix == 0) {
+      m_prefixes.append(QByteArray(prefix.data, prefix.length));
+      key.prefix = static_cast<quint64>(m_prefixes.count());
+      m_ids.insert(prefix, key.prefix);
+   }
+
+   return key;
+}
+
+/**
+ * @brief RFID_TidTable::tid
+ * @param key compact TID returned by the @c intern() function
+ * @returns the complete TID of the given @a key, or an empty byte array if
+ *          the @a key is not valid
+ */
+QByteArray RFID_TidTable::tid(const RFID_TagKey& key) const
+{
+   // Get prefix
+   QByteArray prefix;
+   m_lock.lockForRead();
+   if(key.prefix > 0 && key.prefix <= static_cast<quint64>(m_prefixes.count()))
+      prefix = m_prefixes.at(static_cast<int>(key.prefix - 1));
+   m_lock.unlock();
+
+   // Invalid key
+   if(prefix.isEmpty())
+      return QByteArray();
+
+   // Rebuild TID from its prefix and its serial number
+   const int serialLength = static_cast<quint8>(prefix.at(prefix.length() - 1));
+   QByteArray tid = prefix.left(prefix.length() - 1);
+   for(int i = serialLength - 1; i >= 0; --i)
+      tid.append(static_cast<char>((key.serial >> (i * 8)) & 0xff));
+
+   return tid;
+}
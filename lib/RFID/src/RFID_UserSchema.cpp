@@ -0,0 +1,593 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "RFID_UserSchema.h"
+
+#include <QFile>
+#include <QObject>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QRegularExpression>
+
+/**
+ * Names of the field types, in the same order as @c RFID_UserFieldType
+ */
+static const char* TYPES[] = {"uint", "int", "bcd", "flag", "ascii", "hex"};
+
+/**
+ * Operators of the filter expressions, in the same order as
+ * @c RFID_UserOperator (the first two operators are implicit)
+ */
+static const char* OPERATORS[] = {"", "!", "==", "!=", "<", "<=", ">", ">="};
+
+//------------------------------------------------------------------------------
+// Utility functions
+//------------------------------------------------------------------------------
+
+/**
+ * Size of each user datagram, datagram N holds the bytes of the user memory
+ * that begin at offset N * DATAGRAM_SIZE
+ */
+static const int DATAGRAM_SIZE = RFID_USER_LENGTH / RFID_NUM_USER_DATAGRAMS;
+
+/**
+ * Returns the byte found at the given @a offset of the user memory of the
+ * @a tag, or -1 if the datagram that holds the byte has not been read (or is
+ * shorter than expected)
+ */
+static inline int UserByte(const RFID_Tag& tag, const int offset)
+{
+   const int datagram = offset / DATAGRAM_SIZE;
+   if(offset < 0 || datagram >= RFID_NUM_USER_DATAGRAMS)
+      return -1;
+
+   const QByteArray& data = tag.usr[datagram];
+   const int index = offset % DATAGRAM_SIZE;
+   if(index >= data.length())
+      return -1;
+
+   return static_cast<quint8>(data.at(index));
+}
+
+/**
+ * Compares the bytes of the given text/hex @a field with the @a data of a
+ * predicate, text fields end at the first null byte and missing bytes are
+ * treated as null bytes. Returns a negative number, zero or a positive
+ * number if the field is lower, equal or greater than the @a data.
+ */
+static int CompareBytes(const RFID_Tag& tag,
+                        const RFID_UserField& field,
+                        const QByteArray& data)
+{
+   const bool text = field.type == RFID_USER_ASCII;
+   for(int i = 0; i < field.width; ++i) {
+      const int a = qMax(UserByte(tag, field.offset + i), 0);
+      const int b = i < data.length() ? static_cast<quint8>(data.at(i)) : 0;
+      if(a != b)
+         return a - b;
+      if(text && a == 0)
+         return 0;
+   }
+
+   return 0;
+}
+
+/**
+ * Returns @c true if the result of a comparison satisfies the operator
+ */
+static inline bool Evaluate(const int op, const qint64 result)
+{
+   switch(op) {
+      case RFID_USER_EQ:
+         return result == 0;
+      case RFID_USER_NE:
+         return result != 0;
+      case RFID_USER_LT:
+         return result < 0;
+      case RFID_USER_LE:
+         return result <= 0;
+      case RFID_USER_GT:
+         return result > 0;
+      case RFID_USER_GE:
+         return result >= 0;
+      default:
+         return false;
+   }
+}
+
+//------------------------------------------------------------------------------
+// Constructor & access functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_UserSchema::RFID_UserSchema
+ *
+ * Creates an empty schema (no fields are decoded)
+ */
+RFID_UserSchema::RFID_UserSchema()
+{
+}
+
+/**
+ * @brief RFID_UserSchema::count
+ * @returns the number of fields defined by the schema
+ */
+int RFID_UserSchema::count() const
+{
+   return m_fields.count();
+}
+
+/**
+ * @brief RFID_UserSchema::isEmpty
+ * @returns @c true if the schema does not define any field
+ */
+bool RFID_UserSchema::isEmpty() const
+{
+   return m_fields.isEmpty();
+}
+
+/**
+ * @brief RFID_UserSchema::hasFilter
+ * @returns @c true if a filter expression is set
+ */
+bool RFID_UserSchema::hasFilter() const
+{
+   return !m_filter.isEmpty();
+}
+
+/**
+ * @brief RFID_UserSchema::errorString
+ * @returns a description of the latest schema or filter error
+ */
+QString RFID_UserSchema::errorString() const
+{
+   return m_errorString;
+}
+
+/**
+ * @brief RFID_UserSchema::names
+ * @returns the names of the fields, in the order of the schema file
+ */
+QStringList RFID_UserSchema::names() const
+{
+   return m_names;
+}
+
+/**
+ * @brief RFID_UserSchema::indexOf
+ * @returns the index of the field with the given @a name (case insensitive),
+ *          or -1 if there is no such field
+ */
+int RFID_UserSchema::indexOf(const QString& name) const
+{
+   for(int i = 0; i < m_names.count(); ++i) {
+      if(m_names.at(i).compare(name, Qt::CaseInsensitive) == 0)
+         return i;
+   }
+
+   return -1;
+}
+
+//------------------------------------------------------------------------------
+// Decoding functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_UserSchema::value
+ * @param tag   tag to decode
+ * @param field index of the field
+ * @param value set to the value of the field
+ *
+ * Decodes the given numeric @a field directly from the user datagrams of the
+ * @a tag, no memory is allocated.
+ *
+ * @returns @c false if the field is not numeric, if the tag does not have
+ *          the bytes of the field or if a BCD field has invalid digits
+ */
+bool RFID_UserSchema::value(const RFID_Tag& tag,
+                            const int field,
+                            qint64* value) const
+{
+   Q_ASSERT(value);
+
+   if(field < 0 || field >= m_fields.count())
+      return false;
+
+   const RFID_UserField& f = m_fields.at(field);
+   if(f.type == RFID_USER_ASCII || f.type == RFID_USER_HEX)
+      return false;
+
+   // Read a single bit
+   if(f.type == RFID_USER_FLAG) {
+      const int byte = UserByte(tag, f.offset);
+      if(byte < 0)
+         return false;
+
+      *value = (byte >> f.bit) & 1;
+      return true;
+   }
+
+   // Read the bytes of the field, most significant byte first
+   quint64 raw = 0;
+   qint64 decimal = 0;
+   for(int i = 0; i < f.width; ++i) {
+      const int offset = f.littleEndian ? f.width - 1 - i : i;
+      const int byte = UserByte(tag, f.offset + offset);
+      if(byte < 0)
+         return false;
+
+      if(f.type == RFID_USER_BCD) {
+         if((byte >> 4) > 9 || (byte & 0x0f) > 9)
+            return false;
+
+         decimal = decimal * 100 + (byte >> 4) * 10 + (byte & 0x0f);
+      }
+
+      raw = (raw << 8) | static_cast<quint64>(byte);
+   }
+
+   // Sign-extend signed fields
+   if(f.type == RFID_USER_INT && f.width < 8) {
+      const int bits = f.width * 8;
+      if(raw & (Q_UINT64_C(1) << (bits - 1)))
+         raw |= ~Q_UINT64_C(0) << bits;
+   }
+
+   *value = f.type == RFID_USER_BCD ? decimal : static_cast<qint64>(raw);
+   return true;
+}
+
+/**
+ * @brief RFID_UserSchema::text
+ * @param tag   tag to decode
+ * @param field index of the field
+ *
+ * @returns the value of the given @a field as text, text fields end at
+ *          the first null byte and hex fields are displayed as space
+ *          separated bytes. An empty string is returned if the tag does not
+ *          have the data of the field.
+ */
+QString RFID_UserSchema::text(const RFID_Tag& tag, const int field) const
+{
+   if(field < 0 || field >= m_fields.count())
+      return QString();
+
+   const RFID_UserField& f = m_fields.at(field);
+   if(f.type == RFID_USER_ASCII || f.type == RFID_USER_HEX) {
+      QByteArray bytes;
+      for(int i = 0; i < f.width; ++i) {
+         const int byte = UserByte(tag, f.offset + i);
+         if(byte < 0 || (f.type == RFID_USER_ASCII && byte == 0))
+            break;
+
+         bytes.append(static_cast<char>(byte));
+      }
+
+      if(f.type == RFID_USER_HEX)
+         return QString::fromLatin1(bytes.toHex(' '));
+
+      return QString::fromLatin1(bytes).trimmed();
+   }
+
+   qint64 number = 0;
+   if(value(tag, field, &number))
+      return QString::number(number);
+
+   return QString();
+}
+
+/**
+ * @brief RFID_UserSchema::matches
+ * @param tag tag to check
+ *
+ * Evaluates the predicates of the filter expression, tags that do not have
+ * the data of a filtered field never match.
+ *
+ * @returns @c true if the @a tag satisfies all the predicates (or if there
+ *          is no filter)
+ */
+bool RFID_UserSchema::matches(const RFID_Tag& tag) const
+{
+   for(int i = 0; i < m_filter.count(); ++i) {
+      const RFID_UserPredicate& p = m_filter.at(i);
+      const RFID_UserField& f = m_fields.at(p.field);
+
+      // Text and hex fields are compared byte by byte
+      if(f.type == RFID_USER_ASCII || f.type == RFID_USER_HEX) {
+         if(UserByte(tag, f.offset + f.width - 1) < 0)
+            return false;
+
+         const int result = CompareBytes(tag, f, p.text);
+         if(p.op == RFID_USER_NONZERO || p.op == RFID_USER_ZERO) {
+            if((result == 0) != (p.op == RFID_USER_ZERO))
+               return false;
+         }
+
+         else if(!Evaluate(p.op, result))
+            return false;
+
+         continue;
+      }
+
+      // Numeric fields
+      qint64 number = 0;
+      if(!value(tag, p.field, &number))
+         return false;
+
+      if(p.op == RFID_USER_NONZERO) {
+         if(number == 0)
+            return false;
+      }
+
+      else if(p.op == RFID_USER_ZERO) {
+         if(number != 0)
+            return false;
+      }
+
+      else if(!Evaluate(p.op, number < p.value ? -1 : (number > p.value ? 1 : 0)))
+         return false;
+   }
+
+   return true;
+}
+
+//------------------------------------------------------------------------------
+// Schema & filter compilation functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief RFID_UserSchema::clear
+ *
+ * Removes all the fields of the schema and the filter
+ */
+void RFID_UserSchema::clear()
+{
+   m_names.clear();
+   m_fields.clear();
+   m_filter.clear();
+   m_errorString.clear();
+}
+
+/**
+ * @brief RFID_UserSchema::load
+ * @param fileName path of the JSON schema file
+ * @returns @c true if the schema was read & compiled successfully
+ */
+bool RFID_UserSchema::load(const QString& fileName)
+{
+   QFile file(fileName);
+   if(!file.open(QFile::ReadOnly)) {
+      m_errorString = file.errorString();
+      return false;
+   }
+
+   return compile(file.readAll());
+}
+
+/**
+ * @brief RFID_UserSchema::compile
+ * @param json contents of a JSON schema file
+ *
+ * Validates the field definitions and compiles them into the flat field
+ * array used by the decoder. The current schema & filter are kept if the
+ * new schema is not valid.
+ *
+ * @returns @c true on success, see @c errorString() otherwise
+ */
+bool RFID_UserSchema::compile(const QByteArray& json)
+{
+   // Parse the JSON document
+   QJsonParseError error;
+   const QJsonDocument document = QJsonDocument::fromJson(json, &error);
+   if(error.error != QJsonParseError::NoError) {
+      m_errorString = QObject::tr("Invalid JSON at offset %1: %2")
+                      .arg(error.offset).arg(error.errorString());
+      return false;
+   }
+
+   const QJsonArray definitions = document.object().value("fields").toArray();
+   if(definitions.isEmpty()) {
+      m_errorString = QObject::tr("The schema does not define any field");
+      return false;
+   }
+
+   // Compile each field definition
+   QStringList names;
+   QVector<RFID_UserField> fields;
+   const QRegularExpression identifier("^[A-Za-z_][A-Za-z0-9_]*$");
+   for(int i = 0; i < definitions.count(); ++i) {
+      const QJsonObject object = definitions.at(i).toObject();
+      const QString name = object.value("name").toString();
+      const QString type = object.value("type").toString("uint");
+      const QString endian = object.value("endian").toString("big");
+      const int offset = object.value("offset").toInt(-1);
+      const int width = object.value("width").toInt(type == "flag" ? 1 : 0);
+      const int bit = object.value("bit").toInt(0);
+
+      // Validate the field name
+      if(!identifier.match(name).hasMatch()) {
+         m_errorString = QObject::tr("Field %1 has an invalid name \"%2\"")
+                         .arg(i + 1).arg(name);
+         return false;
+      }
+
+      if(names.contains(name, Qt::CaseInsensitive)) {
+         m_errorString = QObject::tr("Field \"%1\" is defined twice").arg(name);
+         return false;
+      }
+
+      // Get the field type
+      int code = -1;
+      for(int j = 0; j < static_cast<int>(sizeof(TYPES) / sizeof(TYPES[0])); ++j) {
+         if(type == QLatin1String(TYPES[j]))
+            code = j;
+      }
+
+      if(code < 0) {
+         m_errorString = QObject::tr("Field \"%1\" has an unknown type \"%2\"")
+                         .arg(name, type);
+         return false;
+      }
+
+      // Validate the position of the field
+      const bool numeric = code != RFID_USER_ASCII && code != RFID_USER_HEX;
+      if(offset < 0 || width < 1 || offset + width > RFID_USER_LENGTH ||
+            (numeric && width > 8) || (code == RFID_USER_FLAG && width != 1)) {
+         m_errorString = QObject::tr("Field \"%1\" does not fit in the "
+                                     "user memory").arg(name);
+         return false;
+      }
+
+      if(bit < 0 || bit > 7) {
+         m_errorString = QObject::tr("Field \"%1\" has an invalid bit "
+                                     "number").arg(name);
+         return false;
+      }
+
+      if(endian != "big" && endian != "little") {
+         m_errorString = QObject::tr("Field \"%1\" has an unknown byte "
+                                     "order \"%2\"").arg(name, endian);
+         return false;
+      }
+
+      // Register the compiled field
+      RFID_UserField field;
+      field.type = static_cast<quint8>(code);
+      field.offset = static_cast<quint8>(offset);
+      field.width = static_cast<quint8>(width);
+      field.bit = static_cast<quint8>(bit);
+      field.littleEndian = endian == "little";
+      fields.append(field);
+      names.append(name);
+   }
+
+   // Replace the current schema, the filter refers to the old fields
+   m_names = names;
+   m_fields = fields;
+   m_filter.clear();
+   m_errorString.clear();
+   return true;
+}
+
+/**
+ * @brief RFID_UserSchema::setFilter
+ * @param expression filter expression, an empty expression clears the filter
+ *
+ * Compiles a filter expression into a list of predicates. The expression is
+ * a list of conditions joined with @c &&, each condition is either a field
+ * name (the field is not zero/empty), a field name preceded by @c ! (the
+ * field is zero/empty) or a comparison between a field and a value, e.g.
+ * <tt>Lot == 1234 && SKU != "AB-12" && !Sold</tt>.
+ *
+ * Numbers can be written in decimal or in hexadecimal (with the @c 0x
+ * prefix), text values are written between quotes and hex fields are
+ * compared with hexadecimal byte strings. The current filter is kept if the
+ * expression is not valid.
+ *
+ * @returns @c true on success, see @c errorString() otherwise
+ */
+bool RFID_UserSchema::setFilter(const QString& expression)
+{
+   const QRegularExpression condition(
+      "^(!?)\\s*([A-Za-z_][A-Za-z0-9_]*)\\s*(?:(==|!=|<=|>=|<|>)\\s*(.+))?$");
+
+   QVector<RFID_UserPredicate> filter;
+   const QStringList conditions = expression.split("&&");
+   for(int i = 0; i < conditions.count(); ++i) {
+      const QString text = conditions.at(i).trimmed();
+      if(text.isEmpty() && conditions.count() == 1)
+         break;
+
+      // Split the condition
+      const QRegularExpressionMatch match = condition.match(text);
+      if(!match.hasMatch()) {
+         m_errorString = QObject::tr("Invalid condition \"%1\"").arg(text);
+         return false;
+      }
+
+      const bool negated = !match.captured(1).isEmpty();
+      const QString op = match.captured(3);
+      const QString value = match.captured(4).trimmed();
+      if(negated && !op.isEmpty()) {
+         m_errorString = QObject::tr("Invalid condition \"%1\"").arg(text);
+         return false;
+      }
+
+      // Get the field
+      RFID_UserPredicate predicate;
+      predicate.value = 0;
+      predicate.field = indexOf(match.captured(2));
+      if(predicate.field < 0) {
+         m_errorString = QObject::tr("Unknown field \"%1\"")
+                         .arg(match.captured(2));
+         return false;
+      }
+
+      // Get the operator
+      predicate.op = negated ? RFID_USER_ZERO : RFID_USER_NONZERO;
+      for(int j = RFID_USER_EQ; j <= RFID_USER_GE; ++j) {
+         if(op == QLatin1String(OPERATORS[j]))
+            predicate.op = j;
+      }
+
+      // Convert the value to the representation of the field
+      const RFID_UserField& f = m_fields.at(predicate.field);
+      if(!op.isEmpty()) {
+         bool ok = false;
+         if(f.type == RFID_USER_ASCII) {
+            ok = value.length() >= 2 && value.startsWith('"') &&
+                 value.endsWith('"');
+            predicate.text = value.mid(1, value.length() - 2).toLatin1();
+         }
+
+         else if(f.type == RFID_USER_HEX) {
+            QString hex = value;
+            hex.remove(' ');
+            if(hex.startsWith("0x", Qt::CaseInsensitive))
+               hex.remove(0, 2);
+
+            ok = hex.length() % 2 == 0 &&
+                 QRegularExpression("^[0-9A-Fa-f]*$").match(hex).hasMatch();
+            predicate.text = QByteArray::fromHex(hex.toLatin1());
+         }
+
+         else if(value.startsWith("0x", Qt::CaseInsensitive))
+            predicate.value = value.mid(2).toLongLong(&ok, 16);
+
+         else
+            predicate.value = value.toLongLong(&ok, 10);
+
+         if(!ok || predicate.text.length() > f.width) {
+            m_errorString = QObject::tr("Invalid value for field \"%1\": %2")
+                            .arg(match.captured(2), value);
+            return false;
+         }
+      }
+
+      filter.append(predicate);
+   }
+
+   m_filter = filter;
+   m_errorString.clear();
+   return true;
+}
@@ -1,886 +1,1348 @@
-/*
- * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
- *
- * Permission is hereby granted, free of charge, to any person obtaining a copy
- * of this software and associated documentation files (the "Software"), to deal
- * in the Software without restriction, including without limitation the rights
- * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
- * copies of the Software, and to permit persons to whom the Software is
- * furnished to do so, subject to the following conditions:
- *
- * The above copyright notice and this permission notice shall be included in
- * all copies or substantial portions of the Software.
- *
- * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
- * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
- * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
- * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
- * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
- * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
- * THE SOFTWARE.
- */
-
-//------------------------------------------------------------------------------
-// MainWindow & UI includes
-//------------------------------------------------------------------------------
-
-#include "AppInfo.h"
-#include "MainWindow.h"
-#include "ui_MainWindow.h"
-
-//------------------------------------------------------------------------------
-// LibRFID includes
-//------------------------------------------------------------------------------
-
-#include <RFID.h>
-#include <RFID_SerialManager.h>
-
-//------------------------------------------------------------------------------
-// Library includes
-//------------------------------------------------------------------------------
-
-#include <QFile>
-#include <QTimer>
-#include <QScreen>
-#include <QScrollBar>
-#include <QMessageBox>
-#include <QFileDialog>
-#include <QSerialPort>
-#include <QApplication>
-#include <QDesktopServices>
-#include <QStandardItemModel>
-
-//------------------------------------------------------------------------------
-// Custom utility functions
-//------------------------------------------------------------------------------
-
-/**
- * Displays the given @a data in Hexadecimal format and separates each byte
- * with a space (for easier reading)
- */
-static QString ByteArrayToHex(const QByteArray& data)
-{
-   // Init empty string
-   QString str;
-
-   // Get unformatted HEX representation of data
-   QString hex = QString::fromUtf8(data.toHex());
-
-   // Separate HEX values into packets of two characters
-   int i = 0;
-   while(i < hex.length()) {
-      str.append(hex.at(i));
-
-      if(hex.length() > i + 1) {
-         str.append(hex.at(i + 1));
-         str.append(" ");
-         i += 2;
-      }
-
-      else
-         ++i;
-   }
-
-   // Remove extra spaces
-   while(str.startsWith(" "))
-      str.remove(0,1);
-   while(str.endsWith(" "))
-      str.chop(1);
-
-   // Return obtained string
-   return str;
-}
-
-static QByteArray HexToBinary(const QString& hex, bool* ok = Q_NULLPTR)
-{
-   // Init. variables
-   QByteArray binary;
-   QString data = hex;
-
-   // Remove spaces
-   data.remove(" ");
-
-   // Assign true to validation pointer initially
-   if(ok != Q_NULLPTR)
-      *ok = true;
-
-   // Convert hex string to binary (each byte is two chars long)...
-   for(int i = 0; i < data.length(); i += 2) {
-      // Get string for current byte
-      QString str;
-      str.append(data.at(i));
-      str.append(data.at(i + 1));
-
-      // Convert byte string to number
-      quint8 byte = static_cast<quint8>(str.toUInt(ok, 16));
-      if(ok != Q_NULLPTR) {
-         if(*ok)
-            binary.append(static_cast<char>(byte));
-         else
-            return QByteArray();
-      }
-   }
-
-   // Return byte array
-   return binary;
-}
-
-//------------------------------------------------------------------------------
-// Constructor & destructor functions
-//------------------------------------------------------------------------------
-
-/**
- * Configures UI controls, connects signals/slots between UI controls and
- * libRFID, reads saved settings and loads application information to the
- * appropiate labels and controls
- */
-MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent)
-{
-   // Initialize UI objects
-   ui = new Ui::MainWindow;
-   ui->setupUi(this);
-
-   // Configure UI data values & connect signals/slots
-   configureUi();
-   connectSlots();
-
-   // Read settings
-   readSettings();
-
-   // Display current app info on the UI
-   setAppInfo();
-}
-
-/**
- * Deletes UI controls from memory
- */
-MainWindow::~MainWindow()
-{
-   delete ui;
-}
-
-//------------------------------------------------------------------------------
-// UI configuration & signal setup functions
-//------------------------------------------------------------------------------
-
-/**
- * @brief MainWindow::setAppInfo
- *
- * Loads application information data and displays it on the UI of the
- * MainWindow automatically.
- */
-void MainWindow::setAppInfo()
-{
-   // Construct app name & app version strings
-   const QString appName = APP_NAME;
-   const QString appVersion = tr("Version %1 %2")
-                              .arg(APP_VERSION)
-                              .arg(APP_CHANNEL);
-   const QString appCopyright = tr("Copyright (c) %1 %2")
-                                .arg(2019)
-                                .arg(APP_ORGANIZATION);
-
-   // Change values displayed on the UI
-   ui->HT_AppName_Label->setText(appName);
-   ui->HD_AppName_Label->setText(appName);
-   ui->HT_AppOrg_Label->setText(appCopyright);
-   ui->HT_AppVersion_Label->setText(appVersion);
-   ui->HD_AppVersion_Label->setText(appVersion);
-
-   // Set window title
-   setWindowTitle(QString("%1 - %2").arg(appName).arg(appVersion));
-}
-
-/**
- * @brief MainWindow::configureUi
- *
- * Configures the UI elements and the information they display before the
- * MainWindow is shown to the user.
- */
-void MainWindow::configureUi()
-{
-   // Display first tab
-   ui->MW_TabWidget->setCurrentIndex(0);
-
-   // Fill hardware config combos
-   updateBaudRates();
-   updateRfidReaders();
-
-   // Generate monospace font
-   QFont monospace = qApp->font();
-#if defined(Q_OS_WIN)
-   monospace.setPointSize(10);
-   monospace.setFamily("Consolas");
-#elif defined(Q_OS_LINUX)
-   monospace.setPointSize(11);
-   monospace.setFamily("DejaVu Sans Mono");
-#elif defined(Q_OS_OSX)
-   monospace.setPointSize(12);
-   monospace.setFamily("Menlo");
-#else
-   monospace.setPointSize(10);
-   monospace.setFamily("Monospace");
-#endif
-
-   // Use monospace fonts on console text editors
-   ui->TH_TableView->setFont(monospace);
-   ui->TM_EPC_LineEdit->setFont(monospace);
-   ui->TM_RFU_LineEdit->setFont(monospace);
-   ui->TM_TagID_LineEdit->setFont(monospace);
-   ui->TM_UserData_TextEdit->setFont(monospace);
-   ui->TM_MemoryDump_TextEdit->setFont(monospace);
-
-   // Enable disable controls accordingly
-   updateTagManagementControls();
-
-   // Set status LED color and text
-   updateStatus();
-
-   // Set tag history headers
-   updateTagsTable();
-
-   // Set fixed window size, move window to top-left corner
-   resize(minimumSize());
-   move(100, 20);
-}
-
-/**
- * @brief MainWindow::connectSlots
- *
- * Connects the signals/slots between the UI elements and the appication logic
- */
-void MainWindow::connectSlots()
-{
-   // Connect serial manager signals/slots
-   RFID_SerialManager* srmg = RFID_SerialManager::getInstance();
-   connect(srmg, &RFID_SerialManager::availableDevicesChanged,
-           this, &MainWindow::updateSerialDevices);
-   connect(srmg, &RFID_SerialManager::connectionStatusChanged,
-           this, &MainWindow::onPortConnectionChanged);
-
-   // Connect reader selection to RFID bridge
-   connect(ui->HC_Readers_Combo,
-           SIGNAL(currentIndexChanged(int)),
-           RFID::getInstance(),
-           SLOT(setReader(int)));
-
-   // Change baud rate when the baud rate combo's index is changed
-   connect(ui->HC_BaudRate_Combo,
-           SIGNAL(currentIndexChanged(int)),
-           srmg, SLOT(setBaudRate(int)));
-
-   // Disconnect current device if user selects another device while being
-   // connected to a serial port
-   connect(ui->HC_SerialPort_Combo,
-           SIGNAL(currentIndexChanged(int)),
-           this, SLOT(updateDevice(int)));
-
-   // Hardware configuration tab signals/slots
-   connect(ui->HC_Connect_Button,
-           &QPushButton::clicked,
-           this, &MainWindow::connectDevice);
-
-   // Update tag management controls automatically
-   connect(RFID::getInstance(),
-           &RFID::currentTagChanged,
-           this, &MainWindow::updateTagManagementControls);
-   connect(RFID::getInstance(),
-           &RFID::tagUpdated,
-           this, &MainWindow::updateTagManagementControls);
-
-   // Update RFID history table automatically
-   connect(RFID::getInstance(),
-           &RFID::tagCountChanged,
-           this, &MainWindow::updateTagsTable);
-   connect(RFID::getInstance(),
-           &RFID::currentTagChanged,
-           this, &MainWindow::updateTagsTable);
-   connect(RFID::getInstance(),
-           &RFID::tagUpdated,
-           this, &MainWindow::updateTagsTable);
-
-   // Table controls
-   connect(ui->TH_Clear_Button,
-           &QPushButton::clicked,
-           RFID::getInstance(),
-           &RFID::clearHistory);
-   connect(ui->TH_Export_Button,
-           &QPushButton::clicked,
-           this, &MainWindow::exportTagsTable);
-
-   // Connect tag management signals/slots
-   connect(ui->TM_Kill_Button,
-           &QPushButton::clicked,
-           this, &MainWindow::killTag);
-   connect(ui->TM_Block_Button,
-           &QPushButton::clicked,
-           this, &MainWindow::lockTag);
-   connect(ui->TM_Format_Button,
-           &QPushButton::clicked,
-           this, &MainWindow::eraseTag);
-
-   // Connect RFID tag writing signals/slots
-   connect(ui->TM_WriteRfu_Button,
-           &QPushButton::clicked,
-           this, &MainWindow::writeRfuData);
-   connect(ui->TM_WriteEpc_Button,
-           &QPushButton::clicked,
-           this, &MainWindow::writeEpcData);
-   connect(ui->TM_WriteUserData_Button,
-           &QPushButton::clicked,
-           this, &MainWindow::writeUserData);
-}
-
-//------------------------------------------------------------------------------
-// Application state loading & saving functions
-//------------------------------------------------------------------------------
-
-void MainWindow::readSettings()
-{
-
-}
-
-void MainWindow::saveSettings()
-{
-
-}
-
-//------------------------------------------------------------------------------
-// Hardware configuration tab functions
-//------------------------------------------------------------------------------
-
-/**
- * @brief MainWindow::updateStatus
- *
- * Updates the status LED and text based on what the RFID reader driver reports
- * to the program. If the RFID reader driver is ready, then the MainWindow will
- * show a green LED and a "RFID Reader Ready" message on the status area.
- *
- * Otherwise, the MainWindow will show a red LED and "Waiting for RFID Reader"
- * message on the status area.
- */
-void MainWindow::updateStatus()
-{
-   if(RFID::getInstance()->readerAccessible()) {
-      ui->HD_RfidStatus_Icon->setEnabled(true);
-      ui->HD_RfidStatus_Label->setEnabled(true);
-      ui->HD_RfidStatus_Label->setText(tr("RFID Reader Ready"));
-   }
-
-   else {
-      ui->HD_RfidStatus_Icon->setEnabled(false);
-      ui->HD_RfidStatus_Label->setEnabled(false);
-      ui->HD_RfidStatus_Label->setText(tr("Waiting for RFID Reader"));
-   }
-
-   QTimer::singleShot(1000, this, &MainWindow::updateStatus);
-}
-
-/**
- * @brief MainWindow::connectDevice
- *
- * This function is called when the user clicks on the connect/disconnect
- * button in the Hardware Configuration tab. This function toggles the
- * connection state with the current serial device selected by the user.
- */
-void MainWindow::connectDevice()
-{
-   RFID_SerialManager* sm = RFID_SerialManager::getInstance();
-
-   if(!sm->connected()) {
-      RFID::getInstance()->clearHistory();
-      sm->setBaudRate(ui->HC_BaudRate_Combo->currentIndex());
-      sm->setDevice(ui->HC_SerialPort_Combo->currentIndex());
-   }
-
-   else
-      sm->disconnectDevice(false);
-}
-
-/**
- * @brief MainWindow::updateBaudRates
- * Queries for available baud rates from the system and displays them on the
- * baud rate selector combobox.
- */
-void MainWindow::updateBaudRates()
-{
-   // Fill baud rates combobox
-   ui->HC_BaudRate_Combo->clear();
-   QStringList list = RFID_SerialManager::getInstance()->availableBaudRates();
-   for(int i = 0; i < list.count(); ++i)
-      ui->HC_BaudRate_Combo->addItem(list.at(i));
-
-   // Select 9600 baud rate index
-   ui->HC_BaudRate_Combo->setCurrentText("9600");
-}
-
-/**
- * @brief MainWindow::updateRfidReaders
- * Updates the items displayed on the RFID reader combobox.
- */
-void MainWindow::updateRfidReaders()
-{
-   ui->HC_Readers_Combo->clear();
-   foreach(QString reader, RFID::getInstance()->rfidReaders())
-      ui->HC_Readers_Combo->addItem(reader);
-
-   RFID::getInstance()->setReader(0);
-}
-
-/**
- * @brief MainWindow::updateSerialDevices
- *
- * Updates the elements displayed on the serial device selector combobox.
- */
-void MainWindow::updateSerialDevices()
-{
-   // Update devices combobox
-   ui->HC_SerialPort_Combo->clear();
-   QStringList devices = RFID_SerialManager::getInstance()->availableDevices();
-   for(int i = 0; i < devices.count(); ++i)
-      ui->HC_SerialPort_Combo->addItem(devices.at(i));
-
-   // If there are no devices, add dummy text
-   if(devices.count() == 0)
-      ui->HC_SerialPort_Combo->addItem(tr("No serial devices found"));
-
-   // Enable/disable connect button based on number of devices
-   ui->HC_Connect_Button->setEnabled(devices.count() > 0);
-}
-
-/**
- * @brief MainWindow::onPortConnectionChanged
- *
- * Called when the serial port connection status is changed. This function
- * updates the user interface components, such as the HEX console and the
- * connect button text and check state.
- */
-void MainWindow::onPortConnectionChanged()
-{
-   // Serial port connected, allow user to manually disconnect from device
-   if(RFID_SerialManager::getInstance()->connected()) {
-      ui->HC_Connect_Button->setChecked(true);
-      ui->HC_Connect_Button->setText(tr("Disconnect"));
-   }
-
-   // Serial port disconnected, allow user to connected to another device
-   else {
-      ui->HC_Connect_Button->setChecked(false);
-      ui->HC_Connect_Button->setText(tr("Connect"));
-   }
-}
-
-/**
- * Enables or disables the tag management controls depending if the RFID reader
- * has access to an RFID chip or not.
- *
- * Also, the function will read current RFID tag data and display it on the
- * appropiate user interface controls.
- */
-void MainWindow::updateTagManagementControls()
-{
-   QString epc, tid, rfu, usr, mem;
-   RFID_Tag* tag = RFID::getInstance()->currentTag();
-   ui->MW_TagManagement_Tab->setEnabled(tag != Q_NULLPTR);
-
-   if(tag) {
-      epc = ByteArrayToHex(tag->epc);
-      tid = ByteArrayToHex(tag->tid);
-      rfu = ByteArrayToHex(tag->rfu);
-      usr = ByteArrayToHex(RFID::getInstance()->getUserData(tag));
-      mem = RFID::getInstance()->generateMemoryMap(tag);
-   }
-
-   ui->TM_EPC_LineEdit->setText(epc);
-   ui->TM_RFU_LineEdit->setText(rfu);
-   ui->TM_TagID_LineEdit->setText(tid);
-   ui->TM_UserData_TextEdit->setPlainText(usr);
-   ui->TM_MemoryDump_TextEdit->setPlainText(mem);
-}
-
-/**
- * @brief MainWindow::updateDevice
- * @param index unused
- *
- * This function disconnects the current serial device when the user selects
- * a different serial device from the serial device combobox.
- */
-void MainWindow::updateDevice(const int index)
-{
-   (void) index;
-   RFID_SerialManager::getInstance()->disconnectDevice(false);
-}
-
-/**
- * @brief MainWindow::exportTagsTable
- *
- * Exports the tag history table to a CSV file for further reference
- */
-void MainWindow::exportTagsTable()
-{
-   // Used to ask user if he/she wants to open file after writing
-   bool ok = true;
-
-   // Ask user for file save location
-   QString l = QFileDialog::getSaveFileName(this,
-                                            tr("Export Tag Data"),
-                                            QDir::homePath(),
-                                            tr("Comma Separated Values (*.csv);"));
-
-   // Check if location is valid
-   if(l.isEmpty())
-      return;
-
-   // Try to open file for writing
-   QFile file(l);
-   if(file.open(QFile::WriteOnly)) {
-      // Get table model
-      QStandardItemModel* model = static_cast<QStandardItemModel*>(ui->TH_TableView->model());
-
-      // Get row & column count
-      int rows = model->rowCount();
-      int columns = model->columnCount();
-
-      // Create CSV data string
-      QString csv = tr("Tag ID,EPC,User Data,Reserved Data\n");
-      for(int i = 0; i < rows; i++) {
-         for(int j = 0; j < columns; j++) {
-            csv += model->data(model->index(i,j)).toString();
-            csv += ",";
-         }
-
-         csv += "\n";
-      }
-
-      // Write data to file
-      if(file.write(csv.toUtf8()) != csv.toUtf8().length()) {
-         ok = false;
-         QMessageBox::critical(this,
-                               tr("File write error"),
-                               tr("Could not write table data to \"%1\"").arg(l));
-      }
-
-      // Close file
-      file.close();
-   }
-
-   // File open error
-   else {
-      ok = false;
-      QMessageBox::critical(this,
-                            tr("File open error"),
-                            tr("Cannot open \"%1\" for writting!").arg(l));
-   }
-
-   // Notify user and ask to open file using system apps
-   if(ok) {
-      int ans = QMessageBox::question(this,
-                                      tr("Information"),
-                                      tr("The tag data table was successfully"
-                                         " exported, do you want to open it?"),
-                                      QMessageBox::Yes | QMessageBox::No);
-
-      if(ans == QMessageBox::Yes)
-         QDesktopServices::openUrl(QUrl::fromLocalFile(l));
-   }
-}
-
-/**
- * @brief MainWindow::onTagCountChanged
- *
- * Generates the RFID history table when the tag count is changed
- */
-void MainWindow::updateTagsTable()
-{
-   // Get pointer to RFID manager instance
-   RFID* rfid = RFID::getInstance();
-
-   // Generate curated tag list (only accept tags that have at least
-   // tag Id and EPC present)
-   RFID_TagList list;
-   for(int i = 0; i < rfid->tagCount(); ++i) {
-      RFID_Tag* tag = rfid->rfidTags().at(i);
-      if(!tag->epc.isEmpty() && !tag->tid.isEmpty())
-         list.append(tag);
-   }
-
-   // Display tag count
-   ui->TH_TagCount_LCD->display(list.count());
-
-   // Create table model
-   QTableView* table = ui->TH_TableView;
-   QStandardItemModel* model = new QStandardItemModel(
-      list.count(), 4, table);
-
-   // Set table headers
-   QStringList labels = {tr("Tag ID"), tr("EPC"), tr("User Data"), tr("RFU")};
-   model->setHorizontalHeaderLabels(labels);
-
-   // Stretch column headers
-   table->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
-
-   // Get current tag EPC & TID data (to highlight it on the table)
-   QString ct_epc;
-   QString ct_tid;
-   if(rfid->currentTag()) {
-      ct_epc = ByteArrayToHex(rfid->currentTag()->epc);
-      ct_tid = ByteArrayToHex(rfid->currentTag()->tid);
-   }
-
-   // Add data to table
-   for(int i = 0; i < model->rowCount(); ++i) {
-      // Get pointer to RFID tag data structure
-      RFID_Tag* tag = list.at(i);
-
-      // Get tag data in Hex format
-      QString epcStr = ByteArrayToHex(tag->epc);
-      QString tidStr = ByteArrayToHex(tag->tid);
-      QString rfuStr = ByteArrayToHex(tag->rfu);
-      QString usrStr = ByteArrayToHex(rfid->getUserData(tag));
-
-      // Add data to model
-      model->setItem(i, 0, new QStandardItem(tidStr));
-      model->setItem(i, 1, new QStandardItem(epcStr));
-      model->setItem(i, 2, new QStandardItem(usrStr));
-      model->setItem(i, 3, new QStandardItem(rfuStr));
-
-      // Highlight current tag
-      if(epcStr == ct_epc && tidStr == ct_tid) {
-         model->item(i, 0)->setBackground(QBrush(Qt::darkGreen));
-         model->item(i, 1)->setBackground(QBrush(Qt::darkGreen));
-         model->item(i, 2)->setBackground(QBrush(Qt::darkGreen));
-         model->item(i, 3)->setBackground(QBrush(Qt::darkGreen));
-      }
-   }
-
-   // Set table model
-   table->setModel(model);
-}
-
-//------------------------------------------------------------------------------
-// RFID tag management functions
-//------------------------------------------------------------------------------
-
-/**
- * @brief MainWindow::killTag
- *
- * Instructs libRFID to try to kill the current tag, message boxes and user
- * notifications will be handled automatically by the @a RFID class.
- */
-void MainWindow::killTag()
-{
-   RFID::getInstance()->killTag();
-}
-
-/**
- * @brief MainWindow::lockTag
- *
- * Instructs libRFID to try to lock the current tag, message boxes and user
- * notifications will be handled automatically by the @a RFID class.
- */
-void MainWindow::lockTag()
-{
-   RFID::getInstance()->lockTag();
-}
-
-/**
- * @brief MainWindow::eraseTag
- *
- * Instructs libRFID to try to erase the current tag, message boxes and user
- * notifications will be handled automatically by the @a RFID class.
- */
-void MainWindow::eraseTag()
-{
-   RFID::getInstance()->eraseTag();
-}
-
-void MainWindow::writeEpcData()
-{
-   // Get EPC binary data
-   bool epcOk;
-   QByteArray epc = HexToBinary(ui->TM_EPC_LineEdit->text(), &epcOk);
-
-   // Validate EPC conversion
-   if(!epcOk) {
-      QMessageBox::critical(this,
-                            tr("Encoding error"),
-                            tr("Cannot encode EPC data into binary data"));
-      return;
-   }
-
-   // If EPC data length is less than EPC requirement, add zeroes
-   while(epc.length() < RFID_EPC_LENGTH)
-      epc.append(static_cast<char>(0x00));
-
-   // If EPC data length is too large, complain
-   if(epc.length() > RFID_EPC_LENGTH) {
-      QMessageBox::critical(this,
-                            tr("Encoding error"),
-                            tr("EPC data cannot be larger than %1 bytes")
-                            .arg(RFID_EPC_LENGTH));
-      return;
-   }
-
-   // Write EPC and RFU data
-   epcOk = RFID::getInstance()->writeEpc(epc);
-
-   // Show success messagebox
-   if(epcOk)
-      QMessageBox::information(this,
-                               tr("RFID Manager"),
-                               tr("RFID Tag data updated successfully!"));
-
-   // Show EPC writting error
-   else
-      QMessageBox::critical(this,
-                            tr("Tag Update Error"),
-                            tr("An error has ocurred while trying to update "
-                               "the tag's EPC data"));
-}
-
-void MainWindow::writeRfuData()
-{
-   // Get RFU binary data
-   bool rfuOk;
-   QByteArray rfu = HexToBinary(ui->TM_RFU_LineEdit->text(), &rfuOk);
-
-   // Get user data fields
-
-   // Validate RFU conversion
-   if(!rfuOk) {
-      QMessageBox::critical(this,
-                            tr("Encoding error"),
-                            tr("Cannot encode RFU data into binary data"));
-      return;
-   }
-
-   // If RFU data length is less than RFU requirement, add zeroes
-   while(rfu.length() < RFID_RFU_LENGTH)
-      rfu.append(static_cast<char>(0x00));
-
-   // If RFU data length is too large, complain
-   if(rfu.length() > RFID_RFU_LENGTH) {
-      QMessageBox::critical(this,
-                            tr("Encoding error"),
-                            tr("RFU data cannot be larger than %1 bytes")
-                            .arg(RFID_RFU_LENGTH));
-      return;
-   }
-
-   // Write RFU data
-   rfuOk = RFID::getInstance()->writeRfu(rfu);
-
-   // Show success messagebox
-   if(rfuOk)
-      QMessageBox::information(this,
-                               tr("RFID Manager"),
-                               tr("RFID Tag data updated successfully!"));
-
-   // Show RFU writting error
-   else
-      QMessageBox::critical(this,
-                            tr("Tag Update Error"),
-                            tr("An error has ocurred while trying to update "
-                               "the tag's RFU data"));
-}
-
-void MainWindow::writeUserData()
-{
-   // Get user binary data
-   bool userOk;
-   QByteArray user = HexToBinary(ui->TM_UserData_TextEdit->toPlainText(),
-                                 &userOk);
-
-   // Validate user conversion
-   if(!userOk) {
-      QMessageBox::critical(this,
-                            tr("Encoding error"),
-                            tr("Cannot encode RFU data into binary data"));
-      return;
-   }
-
-   // If RFU data length is less than RFU requirement, add zeroes
-   while(user.length() < RFID_USER_LENGTH)
-      user.append(static_cast<char>(0x00));
-
-   // If RFU data length is too large, complain
-   if(user.length() > RFID_USER_LENGTH) {
-      QMessageBox::critical(this,
-                            tr("Encoding error"),
-                            tr("RFU data cannot be larger than %1 bytes")
-                            .arg(RFID_USER_LENGTH));
-      return;
-   }
-
-   // Write user data
-   userOk = RFID::getInstance()->writeUserData(user);
-
-   // Show success messagebox
-   if(userOk)
-      QMessageBox::information(this,
-                               tr("RFID Manager"),
-                               tr("RFID Tag data updated successfully!"));
-
-   // Show RFU writting error
-   else
-      QMessageBox::critical(this,
-                            tr("Tag Update Error"),
-                            tr("An error has ocurred while trying to update "
-                               "the tag's RFU data"));
-}
-
-/**
- * @brief MainWindow::writeRfidData
- *
- * Instructs libRFID to try to write the new EPC, RFU and UserData given by
- * the user through the user interface.
- */
-void MainWindow::writeRfidData()
-{
-
-}
-
-/**
- * @brief MainWindow::copyMemoryDump
- *
- * Copies the memory dump text into the system clipboard.
- */
-void MainWindow::copyMemoryDump()
-{
-   ui->TM_MemoryDump_TextEdit->copy();
-}
-
-/**
- * @brief MainWindow::savesMemoryDump
- *
- * Saves the memory dump text into a text file in a location and file name
- * specified by the user.
- */
-void MainWindow::saveMemoryDump()
-{
-
-}
-
-//------------------------------------------------------------------------------
-// Help tab functions
-//------------------------------------------------------------------------------
-
-/**
- * @brief MainWindow::openWebsite
- *
- * Opens the project's website through the system's web browser
- */
-void MainWindow::openWebsite()
-{
-
-}
-
-/**
- * @brief MainWindow::reportError
- *
- * Opens the project's issues website through the system's web browser
- */
-void MainWindow::reportError()
-{
-
-}
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+//------------------------------------------------------------------------------
+// MainWindow & UI includes
+//------------------------------------------------------------------------------
+
+#include "AppInfo.h"
+#include "MainWindow.h"
+#include "ScriptEngine.h"
+#include "TrafficModel.h"
+#include "ui_MainWindow.h"
+
+//------------------------------------------------------------------------------
+// LibRFID includes
+//------------------------------------------------------------------------------
+
+#include <RFID.h>
+#include <RFID_Checkpoint.h>
+#include <RFID_Profiler.h>
+#include <RFID_Reader.h>
+#include <RFID_SerialManager.h>
+#include <RFID_TidTable.h>
+
+#if defined(RFID_SQLITE)
+#   include <RFID_TagDatabase.h>
+#endif
+
+//------------------------------------------------------------------------------
+// Library includes
+//------------------------------------------------------------------------------
+
+#include <QDir>
+#include <QFile>
+#include <QTimer>
+#include <QScreen>
+#include <QScrollBar>
+#include <QMessageBox>
+#include <QFileDialog>
+#include <QSerialPort>
+#include <QApplication>
+#include <QDesktopServices>
+#include <QStandardPaths>
+#include <QStandardItemModel>
+
+//------------------------------------------------------------------------------
+// Custom utility functions
+//------------------------------------------------------------------------------
+
+/**
+ * Displays the given @a data in Hexadecimal format and separates each byte
+ * with a space (for easier reading)
+ */
+static QString ByteArrayToHex(const QByteArray& data)
+{
+   return QString::fromLatin1(data.toHex(' '));
+}
+
+/**
+ * Changes the text and background of the item at the given @a row and
+ * @a column of the @a model. The item is only created if it does not exist
+ * and it is only modified if its data is different, so that refreshing a
+ * large table does not re-create or re-paint unchanged cells.
+ */
+static void SetTableItem(QStandardItemModel* model,
+                         const int row,
+                         const int column,
+                         const QString& text,
+                         const QBrush& background)
+{
+   QStandardItem* item = model->item(row, column);
+   if(!item) {
+      item = new QStandardItem(text);
+      item->setBackground(background);
+      model->setItem(row, column, item);
+      return;
+   }
+
+   if(item->text() != text)
+      item->setText(text);
+   if(item->background() != background)
+      item->setBackground(background);
+}
+
+/**
+ * Change set fields of all the user datagrams
+ */
+static const quint32 USER_FIELDS = (RFID_FIELD_USR << RFID_NUM_USER_DATAGRAMS)
+                                   - RFID_FIELD_USR;
+
+static QByteArray HexToBinary(const QString& hex, bool* ok = Q_NULLPTR)
+{
+   // Init. variables
+   QByteArray binary;
+   QString data = hex;
+
+   // Remove spaces
+   data.remove(" ");
+
+   // Assign true to validation pointer initially
+   if(ok != Q_NULLPTR)
+      *ok = true;
+
+   // Convert hex string to binary (each byte is two chars long)...
+   for(int i = 0; i < data.length(); i += 2) {
+      // Get string for current byte
+      QString str;
+      str.append(data.at(i));
+      str.append(data.at(i + 1));
+
+      // Convert byte string to number
+      quint8 byte = static_cast<quint8>(str.toUInt(ok, 16));
+      if(ok != Q_NULLPTR) {
+         if(*ok)
+            binary.append(static_cast<char>(byte));
+         else
+            return QByteArray();
+      }
+   }
+
+   // Return byte array
+   return binary;
+}
+
+//------------------------------------------------------------------------------
+// Constructor & destructor functions
+//------------------------------------------------------------------------------
+
+/**
+ * Configures UI controls, connects signals/slots between UI controls and
+ * libRFID, reads saved settings and loads application information to the
+ * appropiate labels and controls
+ */
+MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent)
+{
+   // Initialize internal variables
+   m_tableGeneration = 0;
+   m_scripts = new ScriptEngine(this);
+   m_checkpoint = new RFID_Checkpoint(this);
+   m_database = Q_NULLPTR;
+
+   // Initialize UI objects
+   ui = new Ui::MainWindow;
+   ui->setupUi(this);
+
+   // Configure UI data values & connect signals/slots
+   configureUi();
+   connectSlots();
+
+   // Read settings
+   readSettings();
+
+   // Restore the tag history of the previous session
+   const QString path = QStandardPaths::writableLocation(
+                           QStandardPaths::AppDataLocation);
+   QDir().mkpath(path);
+   if(!m_checkpoint->open(path + "/session.checkpoint"))
+      QMessageBox::warning(this,
+                           tr("Session"),
+                           tr("Cannot restore the previous session: %1")
+                           .arg(m_checkpoint->errorString()));
+
+   // Write the tag history to the SQLite database
+#if defined(RFID_SQLITE)
+   m_database = new RFID_TagDatabase(this);
+   if(!m_database->open(path + "/history.sqlite"))
+      QMessageBox::warning(this,
+                           tr("Tag history"),
+                           tr("Cannot open the tag history database: %1")
+                           .arg(m_database->errorString()));
+#endif
+
+   // Display current app info on the UI
+   setAppInfo();
+}
+
+/**
+ * Deletes UI controls from memory
+ */
+MainWindow::~MainWindow()
+{
+   delete ui;
+}
+
+//------------------------------------------------------------------------------
+// UI configuration & signal setup functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief MainWindow::setAppInfo
+ *
+ * Loads application information data and displays it on the UI of the
+ * MainWindow automatically.
+ */
+void MainWindow::setAppInfo()
+{
+   // Construct app name & app version strings
+   const QString appName = APP_NAME;
+   const QString appVersion = tr("Version %1 %2")
+                              .arg(APP_VERSION)
+                              .arg(APP_CHANNEL);
+   const QString appCopyright = tr("Copyright (c) %1 %2")
+                                .arg(2019)
+                                .arg(APP_ORGANIZATION);
+
+   // Change values displayed on the UI
+   ui->HT_AppName_Label->setText(appName);
+   ui->HD_AppName_Label->setText(appName);
+   ui->HT_AppOrg_Label->setText(appCopyright);
+   ui->HT_AppVersion_Label->setText(appVersion);
+   ui->HD_AppVersion_Label->setText(appVersion);
+
+   // Set window title
+   setWindowTitle(QString("%1 - %2").arg(appName).arg(appVersion));
+}
+
+/**
+ * @brief MainWindow::configureUi
+ *
+ * Configures the UI elements and the information they display before the
+ * MainWindow is shown to the user.
+ */
+void MainWindow::configureUi()
+{
+   // Display first tab
+   ui->MW_TabWidget->setCurrentIndex(0);
+
+   // Fill hardware config combos
+   updateBaudRates();
+   updateRfidReaders();
+
+   // Generate monospace font
+   QFont monospace = qApp->font();
+#if defined(Q_OS_WIN)
+   monospace.setPointSize(10);
+   monospace.setFamily("Consolas");
+#elif defined(Q_OS_LINUX)
+   monospace.setPointSize(11);
+   monospace.setFamily("DejaVu Sans Mono");
+#elif defined(Q_OS_OSX)
+   monospace.setPointSize(12);
+   monospace.setFamily("Menlo");
+#else
+   monospace.setPointSize(10);
+   monospace.setFamily("Monospace");
+#endif
+
+   // Use monospace fonts on console text editors
+   ui->TH_TableView->setFont(monospace);
+   ui->TH_Filter_LineEdit->setFont(monospace);
+   ui->TM_EPC_LineEdit->setFont(monospace);
+   ui->TM_RFU_LineEdit->setFont(monospace);
+   ui->TM_TagID_LineEdit->setFont(monospace);
+   ui->TM_UserData_TextEdit->setFont(monospace);
+   ui->TM_MemoryDump_TextEdit->setFont(monospace);
+   ui->DG_TableView->setFont(monospace);
+   ui->TR_TableView->setFont(monospace);
+   ui->TR_Filter_LineEdit->setFont(monospace);
+
+   // Enable disable controls accordingly
+   updateTagManagementControls();
+
+   // Set status LED color and text
+   updateStatus();
+
+   // Create tag history table model (it is re-used on every table update)
+   QStringList tagLabels = {tr("Tag ID"), tr("EPC"), tr("User Data"), tr("RFU")};
+   QStandardItemModel* tagsModel = new QStandardItemModel(0, tagLabels.count(),
+                                                          ui->TH_TableView);
+   tagsModel->setHorizontalHeaderLabels(tagLabels);
+   ui->TH_TableView->setModel(tagsModel);
+   ui->TH_TableView->horizontalHeader()->setSectionResizeMode(
+      QHeaderView::Stretch);
+
+   // Set tag history data
+   updateTagsTable();
+
+   // Create diagnostics table model & begin refreshing it periodically
+   QStringList labels = {tr("Probe"), tr("Calls"), tr("p50 (us)"),
+                         tr("p95 (us)"), tr("p99 (us)"), tr("Max (us)")
+                        };
+   QStandardItemModel* model = new QStandardItemModel(0, labels.count(),
+                                                      ui->DG_TableView);
+   model->setHorizontalHeaderLabels(labels);
+   ui->DG_TableView->setModel(model);
+   ui->DG_TableView->horizontalHeader()->setSectionResizeMode(
+      QHeaderView::Stretch);
+   updateDiagnostics();
+
+   // Create serial traffic model, rows have a fixed height so that the view
+   // does not need to measure the contents of every captured frame
+   m_traffic = new TrafficModel(this);
+   ui->TR_TableView->setModel(m_traffic);
+   ui->TR_TableView->setWordWrap(false);
+   ui->TR_TableView->verticalHeader()->hide();
+   ui->TR_TableView->verticalHeader()->setSectionResizeMode(
+      QHeaderView::Fixed);
+   ui->TR_TableView->verticalHeader()->setDefaultSectionSize(
+      QFontMetrics(monospace).height() + 4);
+   ui->TR_TableView->horizontalHeader()->setStretchLastSection(true);
+
+   // Set fixed window size, move window to top-left corner
+   resize(minimumSize());
+   move(100, 20);
+}
+
+/**
+ * @brief MainWindow::connectSlots
+ *
+ * Connects the signals/slots between the UI elements and the appication logic
+ */
+void MainWindow::connectSlots()
+{
+   // Connect serial manager signals/slots
+   RFID_SerialManager* srmg = RFID_SerialManager::getInstance();
+   connect(srmg, &RFID_SerialManager::availableDevicesChanged,
+           this, &MainWindow::updateSerialDevices);
+   connect(srmg, &RFID_SerialManager::connectionStatusChanged,
+           this, &MainWindow::onPortConnectionChanged);
+
+   // Show the round-trip statistics of the reader
+   connect(RFID::getInstance(),
+           &RFID::readerCalibrated,
+           this, &MainWindow::onReaderCalibrated);
+
+   // Connect reader selection to RFID bridge
+   connect(ui->HC_Readers_Combo,
+           SIGNAL(currentIndexChanged(int)),
+           RFID::getInstance(),
+           SLOT(setReader(int)));
+
+   // Change baud rate when the baud rate combo's index is changed
+   connect(ui->HC_BaudRate_Combo,
+           SIGNAL(currentIndexChanged(int)),
+           srmg, SLOT(setBaudRate(int)));
+
+   // Disconnect current device if user selects another device while being
+   // connected to a serial port
+   connect(ui->HC_SerialPort_Combo,
+           SIGNAL(currentIndexChanged(int)),
+           this, SLOT(updateDevice(int)));
+
+   // Hardware configuration tab signals/slots
+   connect(ui->HC_Connect_Button,
+           &QPushButton::clicked,
+           this, &MainWindow::connectDevice);
+   connect(ui->HC_Script_Button,
+           &QPushButton::clicked,
+           this, &MainWindow::runScript);
+
+   // Update tag management controls automatically
+   connect(RFID::getInstance(),
+           &RFID::currentTagChanged,
+           this, &MainWindow::updateTagManagementControls);
+
+   // Update RFID history table & tag management controls automatically
+   connect(RFID::getInstance(),
+           &RFID::tagsChanged,
+           this, &MainWindow::onTagsChanged);
+
+   // Table controls
+   connect(ui->TH_Clear_Button,
+           &QPushButton::clicked,
+           RFID::getInstance(),
+           &RFID::clearHistory);
+   connect(ui->TH_Export_Button,
+           &QPushButton::clicked,
+           this, &MainWindow::exportTagsTable);
+   connect(ui->TH_Schema_Button,
+           &QPushButton::clicked,
+           this, &MainWindow::loadUserSchema);
+   connect(ui->TH_Filter_LineEdit,
+           &QLineEdit::editingFinished,
+           this, &MainWindow::setTagsFilter);
+
+   // Connect tag management signals/slots
+   connect(ui->TM_Kill_Button,
+           &QPushButton::clicked,
+           this, &MainWindow::killTag);
+   connect(ui->TM_Block_Button,
+           &QPushButton::clicked,
+           this, &MainWindow::lockTag);
+   connect(ui->TM_Format_Button,
+           &QPushButton::clicked,
+           this, &MainWindow::eraseTag);
+
+   // Connect RFID tag writing signals/slots
+   connect(ui->TM_WriteRfu_Button,
+           &QPushButton::clicked,
+           this, &MainWindow::writeRfuData);
+   connect(ui->TM_WriteEpc_Button,
+           &QPushButton::clicked,
+           this, &MainWindow::writeEpcData);
+   connect(ui->TM_WriteUserData_Button,
+           &QPushButton::clicked,
+           this, &MainWindow::writeUserData);
+
+   // Connect diagnostics signals/slots
+   connect(ui->DG_Reset_Button,
+           &QPushButton::clicked,
+           this, &MainWindow::resetDiagnostics);
+   connect(ui->DG_Enabled_Checkbox,
+           &QCheckBox::toggled,
+           RFID_Profiler::getInstance(),
+           &RFID_Profiler::setEnabled);
+
+   // Connect serial traffic signals/slots
+   connect(ui->TR_Pause_Button,
+           &QPushButton::toggled,
+           m_traffic, &TrafficModel::setPaused);
+   connect(ui->TR_Clear_Button,
+           &QPushButton::clicked,
+           m_traffic, &TrafficModel::clear);
+   connect(ui->TR_Export_Button,
+           &QPushButton::clicked,
+           this, &MainWindow::exportTraffic);
+   connect(ui->TR_Filter_LineEdit,
+           &QLineEdit::editingFinished,
+           this, &MainWindow::setTrafficFilter);
+}
+
+//------------------------------------------------------------------------------
+// Application state loading & saving functions
+//------------------------------------------------------------------------------
+
+void MainWindow::readSettings()
+{
+
+}
+
+void MainWindow::saveSettings()
+{
+
+}
+
+//------------------------------------------------------------------------------
+// Hardware configuration tab functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief MainWindow::updateStatus
+ *
+ * Updates the status LED and text based on what the RFID reader driver reports
+ * to the program. If the RFID reader driver is ready, then the MainWindow will
+ * show a green LED and a "RFID Reader Ready" message on the status area.
+ *
+ * Otherwise, the MainWindow will show a red LED and "Waiting for RFID Reader"
+ * message on the status area.
+ */
+void MainWindow::updateStatus()
+{
+   if(RFID::getInstance()->readerAccessible()) {
+      ui->HD_RfidStatus_Icon->setEnabled(true);
+      ui->HD_RfidStatus_Label->setEnabled(true);
+      ui->HD_RfidStatus_Label->setText(tr("RFID Reader Ready"));
+   }
+
+   else {
+      ui->HD_RfidStatus_Icon->setEnabled(false);
+      ui->HD_RfidStatus_Label->setEnabled(false);
+      ui->HD_RfidStatus_Label->setText(tr("Waiting for RFID Reader"));
+   }
+
+   QTimer::singleShot(1000, this, &MainWindow::updateStatus);
+}
+
+/**
+ * @brief MainWindow::runScript
+ *
+ * Asks the user for a JavaScript batch job and runs it, the script runs
+ * without any user interaction, so the result is only displayed once the
+ * script finishes.
+ */
+void MainWindow::runScript()
+{
+   // Ask user for script location
+   QString file = QFileDialog::getOpenFileName(this,
+                                               tr("Run Script"),
+                                               QDir::homePath(),
+                                               tr("JavaScript files (*.js)"));
+
+   // Check if location is valid
+   if(file.isEmpty())
+      return;
+
+   // Collect script messages
+   QStringList messages;
+   QMetaObject::Connection connection = connect(m_scripts,
+                                                &ScriptEngine::message,
+                                                [&messages](const QString & text) {
+      messages.append(text);
+   });
+
+   // Run script
+   ui->HC_Script_Button->setEnabled(false);
+   const bool ok = m_scripts->run(file);
+   ui->HC_Script_Button->setEnabled(true);
+   disconnect(connection);
+
+   // Only show the last messages of the script
+   if(messages.count() > 20)
+      messages = messages.mid(messages.count() - 20);
+
+   // Show results
+   if(ok) {
+      QMessageBox::information(this,
+                               tr("Script finished"),
+                               messages.join("\n"));
+   }
+
+   else {
+      messages.append(m_scripts->errorString());
+      QMessageBox::critical(this,
+                            tr("Script error"),
+                            messages.join("\n"));
+   }
+}
+
+/**
+ * @brief MainWindow::connectDevice
+ *
+ * This function is called when the user clicks on the connect/disconnect
+ * button in the Hardware Configuration tab. This function toggles the
+ * connection state with the current serial device selected by the user.
+ */
+void MainWindow::connectDevice()
+{
+   RFID_SerialManager* sm = RFID_SerialManager::getInstance();
+
+   if(!sm->connected()) {
+      RFID::getInstance()->clearHistory();
+      sm->setBaudRate(ui->HC_BaudRate_Combo->currentIndex());
+      sm->setDevice(ui->HC_SerialPort_Combo->currentIndex());
+   }
+
+   else
+      sm->disconnectDevice(false);
+}
+
+/**
+ * @brief MainWindow::updateBaudRates
+ * Queries for available baud rates from the system and displays them on the
+ * baud rate selector combobox.
+ */
+void MainWindow::updateBaudRates()
+{
+   // Fill baud rates combobox
+   ui->HC_BaudRate_Combo->clear();
+   QStringList list = RFID_SerialManager::getInstance()->availableBaudRates();
+   for(int i = 0; i < list.count(); ++i)
+      ui->HC_BaudRate_Combo->addItem(list.at(i));
+
+   // Select 9600 baud rate index
+   ui->HC_BaudRate_Combo->setCurrentText("9600");
+}
+
+/**
+ * @brief MainWindow::updateRfidReaders
+ * Updates the items displayed on the RFID reader combobox.
+ */
+void MainWindow::updateRfidReaders()
+{
+   ui->HC_Readers_Combo->clear();
+   foreach(QString reader, RFID::getInstance()->rfidReaders())
+      ui->HC_Readers_Combo->addItem(reader);
+
+   RFID::getInstance()->setReader(0);
+}
+
+/**
+ * @brief MainWindow::updateSerialDevices
+ *
+ * Updates the elements displayed on the serial device selector combobox.
+ */
+void MainWindow::updateSerialDevices()
+{
+   // Update devices combobox
+   ui->HC_SerialPort_Combo->clear();
+   QStringList devices = RFID_SerialManager::getInstance()->availableDevices();
+   for(int i = 0; i < devices.count(); ++i)
+      ui->HC_SerialPort_Combo->addItem(devices.at(i));
+
+   // If there are no devices, add dummy text
+   if(devices.count() == 0)
+      ui->HC_SerialPort_Combo->addItem(tr("No serial devices found"));
+
+   // Enable/disable connect button based on number of devices
+   ui->HC_Connect_Button->setEnabled(devices.count() > 0);
+}
+
+/**
+ * @brief MainWindow::onPortConnectionChanged
+ *
+ * Called when the serial port connection status is changed. This function
+ * updates the user interface components, such as the HEX console and the
+ * connect button text and check state.
+ */
+void MainWindow::onPortConnectionChanged()
+{
+   // Serial port connected, allow user to manually disconnect from device
+   if(RFID_SerialManager::getInstance()->connected()) {
+      ui->HC_Connect_Button->setChecked(true);
+      ui->HC_Connect_Button->setText(tr("Disconnect"));
+      ui->HC_RoundTrip_Value->setText(tr("Calibrating..."));
+      ui->HC_Timing_Value->setText(tr("Calibrating..."));
+   }
+
+   // Serial port disconnected, allow user to connected to another device
+   else {
+      ui->HC_Connect_Button->setChecked(false);
+      ui->HC_Connect_Button->setText(tr("Connect"));
+      ui->HC_RoundTrip_Value->setText(tr("Not calibrated"));
+      ui->HC_Timing_Value->setText(tr("Not calibrated"));
+   }
+}
+
+/**
+ * @brief MainWindow::onReaderCalibrated
+ *
+ * Displays the round-trip times and command rate measured when the reader
+ * was connected, together with the timeout and scan interval derived from
+ * them.
+ */
+void MainWindow::onReaderCalibrated(const RFID_Calibration& calibration)
+{
+   if(calibration.received == 0) {
+      ui->HC_RoundTrip_Value->setText(tr("No response from reader"));
+      ui->HC_Timing_Value->setText(tr("Using default timing"));
+      return;
+   }
+
+   ui->HC_RoundTrip_Value->setText(tr("p50 %1 ms, p99 %2 ms, max %3 ms "
+                                      "(%4/%5 answered)")
+                                   .arg(calibration.p50 / 1000.0, 0, 'f', 1)
+                                   .arg(calibration.p99 / 1000.0, 0, 'f', 1)
+                                   .arg(calibration.max / 1000.0, 0, 'f', 1)
+                                   .arg(calibration.received)
+                                   .arg(calibration.sent));
+
+   int interval = RFID_SCAN_INTERVAL;
+   if(RFID::getInstance()->reader())
+      interval = RFID::getInstance()->reader()->scanInterval();
+
+   ui->HC_Timing_Value->setText(tr("%1 commands/s, timeout %2 ms, "
+                                   "scan every %3 ms")
+                                .arg(calibration.rate, 0, 'f', 0)
+                                .arg(calibration.timeout)
+                                .arg(interval));
+}
+
+/**
+ * Enables or disables the tag management controls depending if the RFID reader
+ * has access to an RFID chip or not.
+ *
+ * Also, the function will read current RFID tag data and display it on the
+ * appropiate user interface controls.
+ */
+void MainWindow::updateTagManagementControls()
+{
+   RFID_PROFILE("MainWindow::updateTagManagementControls");
+
+   QString epc, tid, rfu, usr, mem;
+   RFID_Tag* tag = RFID::getInstance()->currentTag();
+   ui->MW_TagManagement_Tab->setEnabled(tag != Q_NULLPTR);
+
+   if(tag) {
+      epc = ByteArrayToHex(tag->epc);
+      tid = ByteArrayToHex(RFID_TidTable::getInstance()->tid(tag->tid));
+      rfu = ByteArrayToHex(tag->rfu);
+      usr = ByteArrayToHex(RFID::getInstance()->getUserData(tag));
+      mem = RFID::getInstance()->generateMemoryMap(tag);
+   }
+
+   ui->TM_EPC_LineEdit->setText(epc);
+   ui->TM_RFU_LineEdit->setText(rfu);
+   ui->TM_TagID_LineEdit->setText(tid);
+   ui->TM_UserData_TextEdit->setPlainText(usr);
+   ui->TM_MemoryDump_TextEdit->setPlainText(mem);
+}
+
+/**
+ * @brief MainWindow::updateDevice
+ * @param index unused
+ *
+ * This function disconnects the current serial device when the user selects
+ * a different serial device from the serial device combobox.
+ */
+void MainWindow::updateDevice(const int index)
+{
+   (void) index;
+   RFID_SerialManager::getInstance()->disconnectDevice(false);
+}
+
+/**
+ * @brief MainWindow::exportTagsTable
+ *
+ * Exports the tag history table to a CSV file for further reference
+ */
+void MainWindow::exportTagsTable()
+{
+   // Used to ask user if he/she wants to open file after writing
+   bool ok = true;
+
+   // Ask user for file save location
+   QString l = QFileDialog::getSaveFileName(this,
+                                            tr("Export Tag Data"),
+                                            QDir::homePath(),
+                                            tr("Comma Separated Values (*.csv);"));
+
+   // Check if location is valid
+   if(l.isEmpty())
+      return;
+
+   // Try to open file for writing
+   QFile file(l);
+   if(file.open(QFile::WriteOnly)) {
+      // Get table model
+      QStandardItemModel* model = static_cast<QStandardItemModel*>(ui->TH_TableView->model());
+
+      // Get row & column count
+      int rows = model->rowCount();
+      int columns = model->columnCount();
+
+      // Create CSV data string (decoded user memory fields are placed
+      // after the raw tag data)
+      QString csv = tr("Tag ID,EPC,User Data,Reserved Data");
+      foreach(const QString& name, m_schema.names())
+         csv += "," + name;
+
+      csv += "\n";
+      for(int i = 0; i < rows; i++) {
+         for(int j = 0; j < columns; j++) {
+            csv += model->data(model->index(i,j)).toString();
+            csv += ",";
+         }
+
+         csv += "\n";
+      }
+
+      // Write data to file
+      if(file.write(csv.toUtf8()) != csv.toUtf8().length()) {
+         ok = false;
+         QMessageBox::critical(this,
+                               tr("File write error"),
+                               tr("Could not write table data to \"%1\"").arg(l));
+      }
+
+      // Close file
+      file.close();
+   }
+
+   // File open error
+   else {
+      ok = false;
+      QMessageBox::critical(this,
+                            tr("File open error"),
+                            tr("Cannot open \"%1\" for writting!").arg(l));
+   }
+
+   // Notify user and ask to open file using system apps
+   if(ok) {
+      int ans = QMessageBox::question(this,
+                                      tr("Information"),
+                                      tr("The tag data table was successfully"
+                                         " exported, do you want to open it?"),
+                                      QMessageBox::Yes | QMessageBox::No);
+
+      if(ans == QMessageBox::Yes)
+         QDesktopServices::openUrl(QUrl::fromLocalFile(l));
+   }
+}
+
+/**
+ * @brief MainWindow::onTagCountChanged
+ *
+ * Generates the RFID history table when the tag count is changed
+ */
+void MainWindow::updateTagsTable()
+{
+   RFID_PROFILE("MainWindow::updateTagsTable");
+
+   // Get pointer to RFID manager instance
+   RFID* rfid = RFID::getInstance();
+
+   // Get a read-only copy of the tag list
+   RFID_TagSnapshotPtr snapshot = rfid->snapshot();
+
+   // Generate curated tag list (only accept tags that have at least
+   // tag Id and EPC present, and that match the user memory filter)
+   QVector<int> list;
+   for(int i = 0; i < snapshot->tags.count(); ++i) {
+      const RFID_Tag& tag = snapshot->tags.at(i);
+      if(!tag.epc.isEmpty() && RFID_ValidKey(tag.tid) && m_schema.matches(tag))
+         list.append(i);
+   }
+
+   // Display tag count
+   ui->TH_TagCount_LCD->display(list.count());
+
+   // Get table model & resize it (items of removed rows are deleted by
+   // the model itself)
+   QStandardItemModel* model = static_cast<QStandardItemModel*>(
+                                  ui->TH_TableView->model());
+   model->setRowCount(list.count());
+
+   // Register the tag shown in each row (used to update single rows)
+   m_tableRows.clear();
+   m_tableIndexes = list;
+   m_tableGeneration = snapshot->generation;
+   for(int i = 0; i < list.count(); ++i)
+      m_tableRows.insert(snapshot->tags.at(list.at(i)).id, i);
+
+   // Update table data, only modified cells are changed
+   for(int i = 0; i < list.count(); ++i)
+      updateTableRow(snapshot, i);
+}
+
+/**
+ * @brief MainWindow::updateTableRow
+ * @param snapshot copy of the tag list used to generate the table
+ * @param row      table row to update
+ *
+ * Displays the data of the tag shown at the given @a row of the history
+ * table, the current tag is highlighted.
+ */
+void MainWindow::updateTableRow(const RFID_TagSnapshotPtr& snapshot, const int row)
+{
+   // Get table model & tag data structure
+   QStandardItemModel* model = static_cast<QStandardItemModel*>(
+                                  ui->TH_TableView->model());
+   const int index = m_tableIndexes.at(row);
+   const RFID_Tag* tag = &snapshot->tags.at(index);
+
+   // Highlight current tag
+   const QBrush brush = index == snapshot->currentTag ? QBrush(Qt::darkGreen) :
+                        QBrush();
+
+   // Add data to model
+   QByteArray usr = RFID::getInstance()->getUserData(tag);
+   SetTableItem(model, row, 0,
+                ByteArrayToHex(RFID_TidTable::getInstance()->tid(tag->tid)),
+                brush);
+   SetTableItem(model, row, 1, ByteArrayToHex(tag->epc), brush);
+   SetTableItem(model, row, 2, ByteArrayToHex(usr), brush);
+   SetTableItem(model, row, 3, ByteArrayToHex(tag->rfu), brush);
+
+   // Add decoded user memory fields
+   for(int i = 0; i < m_schema.count(); ++i)
+      SetTableItem(model, row, 4 + i, m_schema.text(*tag, i), brush);
+}
+
+/**
+ * @brief MainWindow::onTagsChanged
+ * @param changes tags & fields modified since the previous change set
+ *
+ * Updates the rows of the history table that display the modified tags, the
+ * complete table is only re-generated when tags are added or removed, or when
+ * a tag gets the data needed to be displayed on the table.
+ *
+ * The tag management controls are only updated if the current tag changed.
+ */
+void MainWindow::onTagsChanged(const RFID_ChangeSet& changes)
+{
+   // Get current tag ID
+   quint32 currentId = 0;
+   if(RFID::getInstance()->currentTag())
+      currentId = RFID::getInstance()->currentTag()->id;
+
+   // Check if the current tag changed & if we need to re-generate the table
+   bool rebuild = false;
+   bool currentChanged = false;
+   foreach(const RFID_TagChange& change, changes.changes) {
+      // Read times are not displayed, ignore tags that were only read again
+      if(change.fields == RFID_FIELD_SEEN)
+         continue;
+
+      if(change.tag == currentId || change.fields & RFID_FIELD_PRESENCE)
+         currentChanged = true;
+
+      if(change.fields & (RFID_FIELD_ADDED | RFID_FIELD_REMOVED))
+         rebuild = true;
+      else if(m_schema.hasFilter() && change.fields & USER_FIELDS)
+         rebuild = true;
+      else if(!m_tableRows.contains(change.tag) &&
+              change.fields & (RFID_FIELD_EPC | RFID_FIELD_TID))
+         rebuild = true;
+   }
+
+   // Update tag management controls
+   if(currentChanged)
+      updateTagManagementControls();
+
+   // Table already displays this generation of the tag store
+   if(changes.generation == m_tableGeneration)
+      return;
+
+   // Re-generate the table
+   if(rebuild)
+      updateTagsTable();
+
+   // Only update rows of modified tags
+   else {
+      RFID_PROFILE("MainWindow::onTagsChanged");
+
+      RFID_TagSnapshotPtr snapshot = RFID::getInstance()->snapshot();
+      foreach(const RFID_TagChange& change, changes.changes) {
+         const int row = m_tableRows.value(change.tag, -1);
+         if(row >= 0 && change.fields != RFID_FIELD_SEEN)
+            updateTableRow(snapshot, row);
+      }
+
+      m_tableGeneration = snapshot->generation;
+   }
+}
+
+/**
+ * @brief MainWindow::loadUserSchema
+ *
+ * Asks the user for a JSON file that describes the fields of the user
+ * memory, and adds a column for each field to the tag history table. The
+ * filter line edit is enabled once a schema is loaded.
+ */
+void MainWindow::loadUserSchema()
+{
+   // Ask user for the schema file
+   QString file = QFileDialog::getOpenFileName(this,
+                                               tr("Load User Memory Schema"),
+                                               QDir::homePath(),
+                                               tr("JSON files (*.json)"));
+
+   // Check if location is valid
+   if(file.isEmpty())
+      return;
+
+   // Compile the schema
+   if(!m_schema.load(file)) {
+      QMessageBox::critical(this,
+                            tr("Schema error"),
+                            tr("Cannot load \"%1\": %2")
+                            .arg(file, m_schema.errorString()));
+      return;
+   }
+
+   // Add a column for each field of the schema
+   QStringList labels = {tr("Tag ID"), tr("EPC"), tr("User Data"), tr("RFU")};
+   labels.append(m_schema.names());
+   QStandardItemModel* model = static_cast<QStandardItemModel*>(
+                                  ui->TH_TableView->model());
+   model->setColumnCount(labels.count());
+   model->setHorizontalHeaderLabels(labels);
+
+   // Compile the current filter with the new fields & re-generate the table
+   // (an invalid filter is reported and ignored)
+   ui->TH_Filter_LineEdit->setEnabled(true);
+   setTagsFilter();
+}
+
+/**
+ * @brief MainWindow::setTagsFilter
+ *
+ * Only displays the tags whose user memory matches the filter expression
+ * written by the user (e.g. "Lot == 1234 && !Sold"), all the tags are
+ * displayed if the line edit is empty
+ */
+void MainWindow::setTagsFilter()
+{
+   if(!m_schema.setFilter(ui->TH_Filter_LineEdit->text()))
+      QMessageBox::warning(this,
+                           tr("Filter error"),
+                           m_schema.errorString());
+
+   updateTagsTable();
+}
+
+//------------------------------------------------------------------------------
+// Diagnostics tab functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief MainWindow::updateDiagnostics
+ *
+ * Displays the event loop lag and the run time percentiles of the profiled
+ * slots, the worst offenders are shown at the top of the table, followed by
+ * the value of the profiler counters. This function is called automatically
+ * every second.
+ */
+void MainWindow::updateDiagnostics()
+{
+   QStandardItemModel* model = static_cast<QStandardItemModel*>(
+                                  ui->DG_TableView->model());
+
+   RFID_ProbeStatsList stats = RFID_Profiler::getInstance()->stats();
+   model->setRowCount(stats.count());
+   for(int i = 0; i < stats.count(); ++i) {
+      const RFID_ProbeStats& probe = stats.at(i);
+      model->setItem(i, 0, new QStandardItem(probe.name));
+      model->setItem(i, 1, new QStandardItem(QString::number(probe.calls)));
+      model->setItem(i, 2, new QStandardItem(QString::number(probe.p50)));
+      model->setItem(i, 3, new QStandardItem(QString::number(probe.p95)));
+      model->setItem(i, 4, new QStandardItem(QString::number(probe.p99)));
+      model->setItem(i, 5, new QStandardItem(QString::number(probe.max)));
+   }
+
+   // Show counters (e.g. overload metrics) below the probes
+   RFID_CounterList counters = RFID_Profiler::getInstance()->counters();
+   model->setRowCount(stats.count() + counters.count());
+   for(int i = 0; i < counters.count(); ++i) {
+      const int row = stats.count() + i;
+      const RFID_Counter& counter = counters.at(i);
+      model->setItem(row, 0, new QStandardItem(counter.name));
+      model->setItem(row, 1, new QStandardItem(QString::number(counter.value)));
+      for(int j = 2; j < model->columnCount(); ++j)
+         model->setItem(row, j, new QStandardItem());
+   }
+
+   QTimer::singleShot(1000, this, &MainWindow::updateDiagnostics);
+}
+
+/**
+ * @brief MainWindow::resetDiagnostics
+ *
+ * Removes all the samples collected by the profiler
+ */
+void MainWindow::resetDiagnostics()
+{
+   RFID_Profiler::getInstance()->reset();
+   static_cast<QStandardItemModel*>(ui->DG_TableView->model())->setRowCount(0);
+}
+
+//------------------------------------------------------------------------------
+// Serial traffic functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief MainWindow::exportTraffic
+ *
+ * Exports the displayed serial frames to a CSV file
+ */
+void MainWindow::exportTraffic()
+{
+   // Ask user for file save location
+   QString l = QFileDialog::getSaveFileName(this,
+                                            tr("Export Serial Traffic"),
+                                            QDir::homePath(),
+                                            tr("Comma Separated Values (*.csv);"));
+
+   // Check if location is valid
+   if(l.isEmpty())
+      return;
+
+   // Try to open file for writing
+   QFile file(l);
+   if(!file.open(QFile::WriteOnly)) {
+      QMessageBox::critical(this,
+                            tr("File open error"),
+                            tr("Cannot open \"%1\" for writting!").arg(l));
+      return;
+   }
+
+   // Write frames to file
+   QTextStream stream(&file);
+   m_traffic->exportCsv(stream);
+   stream.flush();
+   if(stream.status() != QTextStream::Ok) {
+      QMessageBox::critical(this,
+                            tr("File write error"),
+                            tr("Could not write traffic data to \"%1\"").arg(l));
+      return;
+   }
+
+   // Close file
+   file.close();
+
+   // Notify user and ask to open file using system apps
+   int ans = QMessageBox::question(this,
+                                   tr("Information"),
+                                   tr("The serial traffic was successfully"
+                                      " exported, do you want to open it?"),
+                                   QMessageBox::Yes | QMessageBox::No);
+
+   if(ans == QMessageBox::Yes)
+      QDesktopServices::openUrl(QUrl::fromLocalFile(l));
+}
+
+/**
+ * @brief MainWindow::setTrafficFilter
+ *
+ * Only displays the frames with the command code written by the user in the
+ * filter line edit (in hexadecimal format), all the frames are displayed if
+ * the line edit is empty
+ */
+void MainWindow::setTrafficFilter()
+{
+   bool ok = false;
+   int command = ui->TR_Filter_LineEdit->text().toInt(&ok, 16);
+   if(!ok)
+      command = -1;
+
+   if(command != m_traffic->commandFilter())
+      m_traffic->setCommandFilter(command);
+}
+
+//------------------------------------------------------------------------------
+// RFID tag management functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief MainWindow::killTag
+ *
+ * Instructs libRFID to try to kill the current tag, message boxes and user
+ * notifications will be handled automatically by the @a RFID class.
+ */
+void MainWindow::killTag()
+{
+   RFID::getInstance()->killTag();
+}
+
+/**
+ * @brief MainWindow::lockTag
+ *
+ * Instructs libRFID to try to lock the current tag, message boxes and user
+ * notifications will be handled automatically by the @a RFID class.
+ */
+void MainWindow::lockTag()
+{
+   RFID::getInstance()->lockTag();
+}
+
+/**
+ * @brief MainWindow::eraseTag
+ *
+ * Instructs libRFID to try to erase the current tag, message boxes and user
+ * notifications will be handled automatically by the @a RFID class.
+ */
+void MainWindow::eraseTag()
+{
+   RFID::getInstance()->eraseTag();
+}
+
+void MainWindow::writeEpcData()
+{
+   // Get EPC binary data
+   bool epcOk;
+   QByteArray epc = HexToBinary(ui->TM_EPC_LineEdit->text(), &epcOk);
+
+   // Validate EPC conversion
+   if(!epcOk) {
+      QMessageBox::critical(this,
+                            tr("Encoding error"),
+                            tr("Cannot encode EPC data into binary data"));
+      return;
+   }
+
+   // If EPC data length is less than EPC requirement, add zeroes
+   while(epc.length() < RFID_EPC_LENGTH)
+      epc.append(static_cast<char>(0x00));
+
+   // If EPC data length is too large, complain
+   if(epc.length() > RFID_EPC_LENGTH) {
+      QMessageBox::critical(this,
+                            tr("Encoding error"),
+                            tr("EPC data cannot be larger than %1 bytes")
+                            .arg(RFID_EPC_LENGTH));
+      return;
+   }
+
+   // Write EPC and RFU data
+   epcOk = RFID::getInstance()->writeEpc(epc);
+
+   // Show success messagebox
+   if(epcOk)
+      QMessageBox::information(this,
+                               tr("RFID Manager"),
+                               tr("RFID Tag data updated successfully!"));
+
+   // Show EPC writting error
+   else
+      QMessageBox::critical(this,
+                            tr("Tag Update Error"),
+                            tr("An error has ocurred while trying to update "
+                               "the tag's EPC data"));
+}
+
+void MainWindow::writeRfuData()
+{
+   // Get RFU binary data
+   bool rfuOk;
+   QByteArray rfu = HexToBinary(ui->TM_RFU_LineEdit->text(), &rfuOk);
+
+   // Get user data fields
+
+   // Validate RFU conversion
+   if(!rfuOk) {
+      QMessageBox::critical(this,
+                            tr("Encoding error"),
+                            tr("Cannot encode RFU data into binary data"));
+      return;
+   }
+
+   // If RFU data length is less than RFU requirement, add zeroes
+   while(rfu.length() < RFID_RFU_LENGTH)
+      rfu.append(static_cast<char>(0x00));
+
+   // If RFU data length is too large, complain
+   if(rfu.length() > RFID_RFU_LENGTH) {
+      QMessageBox::critical(this,
+                            tr("Encoding error"),
+                            tr("RFU data cannot be larger than %1 bytes")
+                            .arg(RFID_RFU_LENGTH));
+      return;
+   }
+
+   // Write RFU data
+   rfuOk = RFID::getInstance()->writeRfu(rfu);
+
+   // Show success messagebox
+   if(rfuOk)
+      QMessageBox::information(this,
+                               tr("RFID Manager"),
+                               tr("RFID Tag data updated successfully!"));
+
+   // Show RFU writting error
+   else
+      QMessageBox::critical(this,
+                            tr("Tag Update Error"),
+                            tr("An error has ocurred while trying to update "
+                               "the tag's RFU data"));
+}
+
+void MainWindow::writeUserData()
+{
+   // Get user binary data
+   bool userOk;
+   QByteArray user = HexToBinary(ui->TM_UserData_TextEdit->toPlainText(),
+                                 &userOk);
+
+   // Validate user conversion
+   if(!userOk) {
+      QMessageBox::critical(this,
+                            tr("Encoding error"),
+                            tr("Cannot encode RFU data into binary data"));
+      return;
+   }
+
+   // If RFU data length is less than RFU requirement, add zeroes
+   while(user.length() < RFID_USER_LENGTH)
+      user.append(static_cast<char>(0x00));
+
+   // If RFU data length is too large, complain
+   if(user.length() > RFID_USER_LENGTH) {
+      QMessageBox::critical(this,
+                            tr("Encoding error"),
+                            tr("RFU data cannot be larger than %1 bytes")
+                            .arg(RFID_USER_LENGTH));
+      return;
+   }
+
+   // Write user data
+   userOk = RFID::getInstance()->writeUserData(user);
+
+   // Show success messagebox
+   if(userOk)
+      QMessageBox::information(this,
+                               tr("RFID Manager"),
+                               tr("RFID Tag data updated successfully!"));
+
+   // Show RFU writting error
+   else
+      QMessageBox::critical(this,
+                            tr("Tag Update Error"),
+                            tr("An error has ocurred while trying to update "
+                               "the tag's RFU data"));
+}
+
+/**
+ * @brief MainWindow::writeRfidData
+ *
+ * Instructs libRFID to try to write the new EPC, RFU and UserData given by
+ * the user through the user interface.
+ */
+void MainWindow::writeRfidData()
+{
+
+}
+
+/**
+ * @brief MainWindow::copyMemoryDump
+ *
+ * Copies the memory dump text into the system clipboard.
+ */
+void MainWindow::copyMemoryDump()
+{
+   ui->TM_MemoryDump_TextEdit->copy();
+}
+
+/**
+ * @brief MainWindow::savesMemoryDump
+ *
+ * Saves the memory dump text into a text file in a location and file name
+ * specified by the user.
+ */
+void MainWindow::saveMemoryDump()
+{
+
+}
+
+//------------------------------------------------------------------------------
+// Help tab functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief MainWindow::openWebsite
+ *
+ * Opens the project's website through the system's web browser
+ */
+void MainWindow::openWebsite()
+{
+
+}
+
+/**
+ * @brief MainWindow::reportError
+ *
+ * Opens the project's issues website through the system's web browser
+ */
+void MainWindow::reportError()
+{
+
+}
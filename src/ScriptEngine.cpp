@@ -0,0 +1,732 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ScriptEngine.h"
+
+#include <RFID.h>
+#include <RFID_Clock.h>
+#include <RFID_TidTable.h>
+#include <RFID_SerialManager.h>
+
+#include <QFile>
+#include <QTimer>
+#include <QFileInfo>
+#include <QEventLoop>
+#include <QQmlEngine>
+#include <QTextStream>
+#include <QElapsedTimer>
+#include <QSerialPortInfo>
+
+//------------------------------------------------------------------------------
+// Utility functions
+//------------------------------------------------------------------------------
+
+/**
+ * Returns the given @a data as an upper-case hexadecimal string
+ */
+static inline QString ToHex(const QByteArray& data)
+{
+   return QString::fromLatin1(data.toHex()).toUpper();
+}
+
+/**
+ * Names of the job states, as used by the scripts
+ */
+static const char* JOB_STATES[] = {
+   "none", "planned", "written", "verified", "locked"
+};
+
+/**
+ * Returns the data represented by the given hexadecimal string, spaces and
+ * other separators are ignored
+ */
+static inline QByteArray FromHex(const QString& hex)
+{
+   return QByteArray::fromHex(hex.toLatin1());
+}
+
+//------------------------------------------------------------------------------
+// Constructor & script execution functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief ScriptEngine::ScriptEngine
+ *
+ * Exposes the script API as the global @c rfid object
+ */
+ScriptEngine::ScriptEngine(QObject* parent) : QObject(parent)
+{
+   m_running = false;
+
+   QQmlEngine::setObjectOwnership(this, QQmlEngine::CppOwnership);
+   m_engine.globalObject().setProperty("rfid", m_engine.newQObject(this));
+}
+
+/**
+ * @brief ScriptEngine::running
+ * @returns @c true if a script is being executed
+ */
+bool ScriptEngine::running() const
+{
+   return m_running;
+}
+
+/**
+ * @brief ScriptEngine::errorString
+ * @returns the error that stopped the last script (if any)
+ */
+QString ScriptEngine::errorString() const
+{
+   return m_error;
+}
+
+/**
+ * @brief ScriptEngine::run
+ * @param fileName path of the JavaScript file to execute
+ *
+ * Executes the given script and returns once the script finishes. Returns
+ * @c false if the script cannot be read or throws an exception, in which case
+ * the error can be obtained with @c errorString().
+ */
+bool ScriptEngine::run(const QString& fileName)
+{
+   // Only run one script at a time
+   if(m_running) {
+      m_error = tr("A script is already running");
+      return false;
+   }
+
+   // Read script
+   QFile file(fileName);
+   if(!file.open(QFile::ReadOnly)) {
+      m_error = tr("Cannot open \"%1\": %2").arg(fileName, file.errorString());
+      return false;
+   }
+
+   const QString code = QString::fromUtf8(file.readAll());
+   file.close();
+
+   // Execute script, the script is registered as the writer of the tags
+   // it encodes
+   m_error.clear();
+   m_lastTid.clear();
+   m_running = true;
+   RFID::getInstance()->setWriter(tr("Script %1")
+                                  .arg(QFileInfo(fileName).fileName()));
+   const QJSValue result = m_engine.evaluate(code, fileName);
+   RFID::getInstance()->setWriter(QString());
+   m_running = false;
+
+   // Make the progress of the job durable
+   m_ledger.commit();
+
+   // Register uncaught exceptions
+   if(result.isError()) {
+      m_error = tr("%1:%2: %3").arg(fileName)
+                .arg(result.property("lineNumber").toInt())
+                .arg(result.toString());
+      return false;
+   }
+
+   return true;
+}
+
+//------------------------------------------------------------------------------
+// General script functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief ScriptEngine::print
+ *
+ * Reports the given @a text to the user (or the standard output when the
+ * script is run from the command line)
+ */
+void ScriptEngine::print(const QString& text)
+{
+   emit message(text);
+}
+
+/**
+ * @brief ScriptEngine::wait
+ *
+ * Waits for the given amount of milliseconds while the reader keeps working
+ */
+void ScriptEngine::wait(const int msecs)
+{
+   waitFor([]() {
+      return false;
+   }, msecs);
+}
+
+//------------------------------------------------------------------------------
+// Device functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief ScriptEngine::connectDevice
+ * @param portName name of the serial port (e.g. "COM3" or "ttyUSB0")
+ * @param baudRate baud rate of the serial port
+ *
+ * Connects to the RFID reader at the given serial port, no message boxes are
+ * displayed. Returns @c true on success.
+ */
+bool ScriptEngine::connectDevice(const QString& portName, const int baudRate)
+{
+   const int index = QSerialPortInfo::standardBaudRates().indexOf(baudRate);
+   if(index < 0)
+      return false;
+
+   RFID_SerialManager* sm = RFID_SerialManager::getInstance();
+   RFID::getInstance()->clearHistory();
+   sm->setBaudRate(index);
+   return sm->setPort(portName, true);
+}
+
+/**
+ * @brief ScriptEngine::disconnectDevice
+ *
+ * Disconnects the current serial device (without displaying message boxes)
+ */
+void ScriptEngine::disconnectDevice()
+{
+   RFID_SerialManager::getInstance()->disconnectDevice(true);
+}
+
+/**
+ * @brief ScriptEngine::readerReady
+ * @returns @c true if the RFID reader can be used
+ */
+bool ScriptEngine::readerReady() const
+{
+   return RFID::getInstance()->readerAccessible();
+}
+
+//------------------------------------------------------------------------------
+// Tag access functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief ScriptEngine::tagCount
+ * @returns the number of tags found since the history was cleared
+ */
+int ScriptEngine::tagCount() const
+{
+   return RFID::getInstance()->tagCount();
+}
+
+/**
+ * @brief ScriptEngine::tags
+ * @returns an array with every tag found since the history was cleared
+ */
+QJSValue ScriptEngine::tags()
+{
+   const RFID_TagSnapshotPtr snapshot = RFID::getInstance()->snapshot();
+   const int count = snapshot ? snapshot->tags.count() : 0;
+
+   QJSValue array = m_engine.newArray(static_cast<uint>(count));
+   for(int i = 0; i < count; ++i)
+      array.setProperty(static_cast<quint32>(i), tagObject(snapshot->tags.at(i)));
+
+   return array;
+}
+
+/**
+ * @brief ScriptEngine::currentTag
+ * @returns the tag in the field of the reader, or @c null if there is none
+ */
+QJSValue ScriptEngine::currentTag()
+{
+   const RFID_Tag* tag = RFID::getInstance()->currentTag();
+   if(tag)
+      return tagObject(*tag);
+
+   return QJSValue(QJSValue::NullValue);
+}
+
+/**
+ * @brief ScriptEngine::clearHistory
+ *
+ * Removes every tag found so far
+ */
+void ScriptEngine::clearHistory()
+{
+   RFID::getInstance()->clearHistory();
+}
+
+//------------------------------------------------------------------------------
+// Wait functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief ScriptEngine::waitForTag
+ * @returns the tag in the field of the reader, or @c null if no tag enters
+ *          the field before the @a timeout (in milliseconds) expires
+ */
+QJSValue ScriptEngine::waitForTag(const int timeout)
+{
+   waitFor([]() {
+      return RFID::getInstance()->currentTag() != Q_NULLPTR;
+   }, timeout);
+
+   return currentTag();
+}
+
+/**
+ * @brief ScriptEngine::waitForData
+ * @param field   "epc", "tid", "rfu" or "usr"
+ * @param hex     expected data (in hexadecimal format)
+ * @param timeout time to wait (in milliseconds)
+ *
+ * Waits until the given @a field of the current tag is read back with the
+ * expected data, this is used to verify writes. Returns @c false if the data
+ * does not match before the @a timeout expires.
+ */
+bool ScriptEngine::waitForData(const QString& field,
+                               const QString& hex,
+                               const int timeout)
+{
+   const QByteArray expected = FromHex(hex);
+   return waitFor([this, field, expected]() {
+      const RFID_Tag* tag = RFID::getInstance()->currentTag();
+      return tag && tagData(*tag, field) == expected;
+   }, timeout);
+}
+
+//------------------------------------------------------------------------------
+// Tag writing functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief ScriptEngine::writeEpc
+ *
+ * Queues the EPC write commands for the current tag, returns @c false if
+ * there is no current tag or the reader is not ready
+ */
+bool ScriptEngine::writeEpc(const QString& hex)
+{
+   return RFID::getInstance()->writeEpc(FromHex(hex));
+}
+
+/**
+ * @brief ScriptEngine::writeRfu
+ *
+ * Queues the RFU write commands for the current tag, returns @c false if
+ * there is no current tag or the reader is not ready
+ */
+bool ScriptEngine::writeRfu(const QString& hex)
+{
+   return RFID::getInstance()->writeRfu(FromHex(hex));
+}
+
+/**
+ * @brief ScriptEngine::writeUserData
+ *
+ * Queues the user data write commands for the current tag, returns @c false
+ * if there is no current tag or the reader is not ready
+ */
+bool ScriptEngine::writeUserData(const QString& hex)
+{
+   return RFID::getInstance()->writeUserData(FromHex(hex));
+}
+
+//------------------------------------------------------------------------------
+// Job ledger functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief ScriptEngine::openLedger
+ *
+ * Opens (or creates) the job ledger used by @c encode(), so that an
+ * interrupted job can be resumed. Returns @c false if the ledger cannot be
+ * opened.
+ */
+bool ScriptEngine::openLedger(const QString& fileName)
+{
+   if(m_ledger.open(fileName))
+      return true;
+
+   print(tr("Cannot open ledger \"%1\": %2").arg(fileName,
+                                                  m_ledger.errorString()));
+   return false;
+}
+
+/**
+ * @brief ScriptEngine::ledgerState
+ * @returns the state of the tag with the given @a tid in the job ledger
+ *          ("none", "planned", "written", "verified" or "locked")
+ */
+QString ScriptEngine::ledgerState(const QString& tid) const
+{
+   return QString::fromLatin1(JOB_STATES[m_ledger.state(FromHex(tid))]);
+}
+
+/**
+ * @brief ScriptEngine::record
+ *
+ * Registers the given @a state of the tag with the given @a tid in the job
+ * ledger (e.g. to register locked tags). Returns @c false if the state is
+ * unknown or no ledger is open.
+ */
+bool ScriptEngine::record(const QString& tid, const QString& state)
+{
+   for(int i = RFID_JOB_PLANNED; i <= RFID_JOB_LOCKED; ++i) {
+      if(state == QLatin1String(JOB_STATES[i])) {
+         m_ledger.record(FromHex(tid), static_cast<RFID_JobState>(i));
+         return m_ledger.isOpen();
+      }
+   }
+
+   return false;
+}
+
+/**
+ * @brief ScriptEngine::encode
+ * @param epc      EPC to write (in hexadecimal format), empty to keep the EPC
+ * @param userData user data to write (in hexadecimal format), empty to keep
+ *                 the user data
+ * @param timeout  time to wait (in milliseconds) for the tag and for each
+ *                 verification
+ *
+ * Waits for a tag that is not encoded yet, writes the given data and verifies
+ * it, registering the progress of the tag in the job ledger (use
+ * @c encodeJob() to encode the jobs imported with @c importJobs()).
+ *
+ * Returns "verified" or "failed".
+ */
+QString ScriptEngine::encode(const QString& epc,
+                             const QString& userData,
+                             const int timeout)
+{
+   return encodeTag(epc, userData, -1, timeout);
+}
+
+//------------------------------------------------------------------------------
+// Encoding job functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief ScriptEngine::importJobs
+ *
+ * Imports the encoding jobs of the given CSV file (EPC and user data columns)
+ * and validates every row before any tag is written.
+ *
+ * @returns an object with the number of valid @c rows, the @c errorCount and
+ *          the invalid rows (as @c errors with their @c line and @c reason),
+ *          or @c null if the file cannot be read
+ */
+QJSValue ScriptEngine::importJobs(const QString& fileName)
+{
+   if(!m_jobs.import(fileName)) {
+      print(tr("Cannot import jobs from \"%1\": %2").arg(fileName,
+                                                          m_jobs.errorString()));
+      return QJSValue(QJSValue::NullValue);
+   }
+
+   const QVector<RFID_JobError> errors = m_jobs.errors();
+   QJSValue array = m_engine.newArray(static_cast<uint>(errors.count()));
+   for(int i = 0; i < errors.count(); ++i) {
+      QJSValue error = m_engine.newObject();
+      error.setProperty("line", errors.at(i).line);
+      error.setProperty("reason", RFID_JobQueue::reason(errors.at(i).reason));
+      array.setProperty(static_cast<quint32>(i), error);
+   }
+
+   QJSValue result = m_engine.newObject();
+   result.setProperty("rows", m_jobs.count());
+   result.setProperty("errorCount", m_jobs.errorCount());
+   result.setProperty("errors", array);
+   return result;
+}
+
+/**
+ * @brief ScriptEngine::jobCount
+ * @returns the number of valid jobs imported with @c importJobs()
+ */
+int ScriptEngine::jobCount() const
+{
+   return m_jobs.count();
+}
+
+/**
+ * @brief ScriptEngine::job
+ * @returns the EPC and user data (as @c epc and @c usr) of the job at the
+ *          given @a index, fields that are not written are empty strings.
+ *          Returns @c null if the @a index is invalid.
+ */
+QJSValue ScriptEngine::job(const int index)
+{
+   if(index < 0 || index >= m_jobs.count())
+      return QJSValue(QJSValue::NullValue);
+
+   QJSValue object = m_engine.newObject();
+   object.setProperty("epc", ToHex(m_jobs.epc(index)));
+   object.setProperty("usr", ToHex(m_jobs.userData(index)));
+   return object;
+}
+
+/**
+ * @brief ScriptEngine::jobDone
+ * @returns @c true if the job ledger shows the tag assigned to the job at the
+ *          given @a index as verified
+ */
+bool ScriptEngine::jobDone(const int index) const
+{
+   return m_ledger.jobDone(index);
+}
+
+/**
+ * @brief ScriptEngine::nextJob
+ * @returns the index of the first job (starting at the given index) that is
+ *          not done, or -1 if every job is done
+ */
+int ScriptEngine::nextJob(const int from) const
+{
+   for(int i = qMax(from, 0); i < m_jobs.count(); ++i) {
+      if(!m_ledger.jobDone(i))
+         return i;
+   }
+
+   return -1;
+}
+
+/**
+ * @brief ScriptEngine::encodeJob
+ * @param index   index of the job to encode
+ * @param timeout time to wait (in milliseconds) for the tag and for each
+ *                verification
+ *
+ * Waits for a tag that is not encoded yet and encodes the EPC and user data
+ * of the given job on it, the job is registered in the job ledger together
+ * with the tag, so that it is not encoded again if the script is restarted.
+ *
+ * Returns "verified", "skipped" (if the job is already done, in which case
+ * no tag is used) or "failed".
+ */
+QString ScriptEngine::encodeJob(const int index, const int timeout)
+{
+   if(index < 0 || index >= m_jobs.count())
+      return "failed";
+
+   if(m_ledger.jobDone(index))
+      return "skipped";
+
+   return encodeTag(ToHex(m_jobs.epc(index)),
+                    ToHex(m_jobs.userData(index)),
+                    index,
+                    timeout);
+}
+
+//------------------------------------------------------------------------------
+// File functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief ScriptEngine::readCsv
+ * @returns the rows of the given CSV file as arrays of strings, or @c null if
+ *          the file cannot be read
+ */
+QJSValue ScriptEngine::readCsv(const QString& fileName)
+{
+   QFile file(fileName);
+   if(!file.open(QFile::ReadOnly | QFile::Text))
+      return QJSValue(QJSValue::NullValue);
+
+   quint32 row = 0;
+   QTextStream stream(&file);
+   QJSValue rows = m_engine.newArray();
+   while(!stream.atEnd()) {
+      const QString line = stream.readLine().trimmed();
+      if(line.isEmpty())
+         continue;
+
+      const QStringList fields = line.split(',');
+      QJSValue array = m_engine.newArray(static_cast<uint>(fields.count()));
+      for(int i = 0; i < fields.count(); ++i)
+         array.setProperty(static_cast<quint32>(i), fields.at(i).trimmed());
+
+      rows.setProperty(row++, array);
+   }
+
+   return rows;
+}
+
+/**
+ * @brief ScriptEngine::exportTags
+ *
+ * Writes every tag found since the history was cleared to the given CSV file,
+ * returns @c false if the file cannot be written
+ */
+bool ScriptEngine::exportTags(const QString& fileName)
+{
+   QFile file(fileName);
+   if(!file.open(QFile::WriteOnly | QFile::Text))
+      return false;
+
+   QTextStream stream(&file);
+   stream << "Tag ID,EPC,TID,User Data,RFU\n";
+
+   const RFID_TagSnapshotPtr snapshot = RFID::getInstance()->snapshot();
+   if(snapshot) {
+      foreach(const RFID_Tag& tag, snapshot->tags) {
+         stream << tag.id << ","
+                << ToHex(tagData(tag, "epc")) << ","
+                << ToHex(tagData(tag, "tid")) << ","
+                << ToHex(tagData(tag, "usr")) << ","
+                << ToHex(tagData(tag, "rfu")) << "\n";
+      }
+   }
+
+   stream.flush();
+   return stream.status() == QTextStream::Ok;
+}
+
+//------------------------------------------------------------------------------
+// Private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief ScriptEngine::tagObject
+ * @returns a JavaScript object with the data of the given @a tag
+ */
+QJSValue ScriptEngine::tagObject(const RFID_Tag& tag)
+{
+   RFID_Clock* clock = RFID_Clock::getInstance();
+
+   QJSValue object = m_engine.newObject();
+   object.setProperty("id", tag.id);
+   object.setProperty("epc", ToHex(tagData(tag, "epc")));
+   object.setProperty("tid", ToHex(tagData(tag, "tid")));
+   object.setProperty("rfu", ToHex(tagData(tag, "rfu")));
+   object.setProperty("usr", ToHex(tagData(tag, "usr")));
+   object.setProperty("firstSeen",
+                      m_engine.toScriptValue(clock->toDateTime(tag.firstSeen)));
+   object.setProperty("lastSeen",
+                      m_engine.toScriptValue(clock->toDateTime(tag.lastSeen)));
+   return object;
+}
+
+/**
+ * @brief ScriptEngine::tagData
+ * @returns the data of the given @a field ("epc", "tid", "rfu" or "usr") of
+ *          the given @a tag
+ */
+QByteArray ScriptEngine::tagData(const RFID_Tag& tag, const QString& field) const
+{
+   if(field == "epc")
+      return tag.epc;
+   if(field == "tid")
+      return RFID_TidTable::getInstance()->tid(tag.tid);
+   if(field == "rfu")
+      return tag.rfu;
+   if(field == "usr")
+      return RFID::getInstance()->getUserData(&tag);
+
+   return QByteArray();
+}
+
+/**
+ * @brief ScriptEngine::encodeTag
+ *
+ * Waits for a tag with a known TID (the TID identifies the tag in the ledger)
+ * that is not verified in the job ledger and is not the last tag encoded by
+ * this script, so that a tag that stays in the field is not used for the
+ * next job. Then writes the given data to the tag and verifies it, and
+ * registers the progress of the tag and of its @a job in the ledger.
+ */
+QString ScriptEngine::encodeTag(const QString& epc,
+                                const QString& userData,
+                                const int job,
+                                const int timeout)
+{
+   // Wait for a tag that is not encoded yet
+   QByteArray tid;
+   const bool found = waitFor([this, &tid]() {
+      tid.clear();
+      const RFID_Tag* tag = RFID::getInstance()->currentTag();
+      if(tag)
+         tid = tagData(*tag, "tid");
+
+      return !tid.isEmpty() && tid != m_lastTid && !m_ledger.done(tid);
+   }, timeout);
+
+   if(!found)
+      return "failed";
+
+   // Write data
+   bool ok = true;
+   m_ledger.record(tid, RFID_JOB_PLANNED, job);
+   if(!epc.isEmpty())
+      ok &= writeEpc(epc);
+   if(!userData.isEmpty())
+      ok &= writeUserData(userData);
+
+   if(!ok)
+      return "failed";
+
+   // Verify data
+   m_ledger.record(tid, RFID_JOB_WRITTEN, job);
+   if(!epc.isEmpty())
+      ok &= waitForData("epc", epc, timeout);
+   if(ok && !userData.isEmpty())
+      ok &= waitForData("usr", userData, timeout);
+
+   // Check that the verified data belongs to the same tag
+   const RFID_Tag* tag = RFID::getInstance()->currentTag();
+   if(!ok || !tag || tagData(*tag, "tid") != tid)
+      return "failed";
+
+   m_lastTid = tid;
+   m_ledger.record(tid, RFID_JOB_VERIFIED, job);
+   return "verified";
+}
+
+/**
+ * @brief ScriptEngine::waitFor
+ *
+ * Runs the event loop until the given @a condition is met (it is checked
+ * every time that the tag store changes) or the @a timeout expires. Returns
+ * @c true if the condition was met.
+ */
+bool ScriptEngine::waitFor(const std::function<bool()>& condition,
+                           const int timeout)
+{
+   QEventLoop loop;
+   QTimer timer;
+   timer.setSingleShot(true);
+   connect(&timer, &QTimer::timeout, &loop, &QEventLoop::quit);
+   connect(RFID::getInstance(), &RFID::tagsChanged, &loop, &QEventLoop::quit);
+   connect(RFID::getInstance(), &RFID::currentTagChanged,
+           &loop, &QEventLoop::quit);
+
+   QElapsedTimer elapsed;
+   elapsed.start();
+   while(!condition()) {
+      const qint64 remaining = timeout - elapsed.elapsed();
+      if(remaining <= 0)
+         return false;
+
+      timer.start(static_cast<int>(remaining));
+      loop.exec();
+   }
+
+   return true;
+}
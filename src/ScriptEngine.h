@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef SCRIPTENGINE_H
+#define SCRIPTENGINE_H
+
+#include <QObject>
+#include <QJSValue>
+#include <QJSEngine>
+#include <QByteArray>
+
+#include <RFID_Global.h>
+#include <RFID_JobLedger.h>
+#include <RFID_JobQueue.h>
+
+#include <functional>
+
+#define SCRIPT_DEFAULT_TIMEOUT      5000
+
+/**
+ * @brief The ScriptEngine class
+ *
+ * Runs JavaScript batch jobs (e.g. "read every tag on the bench, write the
+ * user data from a table, verify it and export the results") without any
+ * user interaction. The API is exposed to the scripts as the global @c rfid
+ * object, tag data is exchanged as hexadecimal strings.
+ *
+ * Write functions only queue the commands in the reader driver, so scripts
+ * run at the speed of the link. The @c wait*() functions keep the event loop
+ * running while they wait, so that the reader keeps working and the UI (if
+ * any) stays responsive.
+ *
+ * Encoding jobs can be resumed with a job ledger (see @c RFID_JobLedger), the
+ * @c encodeJob() function registers the progress of every tag that it encodes
+ * together with its job, so that @c nextJob() continues with the first job
+ * that is not verified. Tags that the ledger shows as verified (or that were
+ * just encoded and are still in the field) are never encoded again.
+ *
+ * Large encoding jobs are imported with @c importJobs(), which validates the
+ * whole CSV file (see @c RFID_JobQueue) before the first tag is written.
+ *
+ * Example:
+ * @code
+ *    rfid.openLedger("bench.ledger");
+ *    var result = rfid.importJobs("bench.csv");
+ *    if(result.errorCount > 0)
+ *       rfid.print("Skipping " + result.errorCount + " invalid rows");
+ *
+ *    for(var i = rfid.nextJob(0); i >= 0; i = rfid.nextJob(i + 1)) {
+ *       if(rfid.encodeJob(i, 10000) === "failed")
+ *          rfid.print("Cannot encode job " + i);
+ *    }
+ *    rfid.exportTags("results.csv");
+ * @endcode
+ */
+class ScriptEngine : public QObject
+{
+      Q_OBJECT
+
+   signals:
+      void message(const QString& text);
+
+   public:
+      explicit ScriptEngine(QObject* parent = Q_NULLPTR);
+
+      bool running() const;
+      QString errorString() const;
+      bool run(const QString& fileName);
+
+      Q_INVOKABLE void print(const QString& text);
+      Q_INVOKABLE void wait(const int msecs);
+
+      Q_INVOKABLE bool connectDevice(const QString& portName,
+                                     const int baudRate = 9600);
+      Q_INVOKABLE void disconnectDevice();
+      Q_INVOKABLE bool readerReady() const;
+
+      Q_INVOKABLE int tagCount() const;
+      Q_INVOKABLE QJSValue tags();
+      Q_INVOKABLE QJSValue currentTag();
+      Q_INVOKABLE void clearHistory();
+
+      Q_INVOKABLE QJSValue waitForTag(const int timeout = SCRIPT_DEFAULT_TIMEOUT);
+      Q_INVOKABLE bool waitForData(const QString& field,
+                                   const QString& hex,
+                                   const int timeout = SCRIPT_DEFAULT_TIMEOUT);
+
+      Q_INVOKABLE bool writeEpc(const QString& hex);
+      Q_INVOKABLE bool writeRfu(const QString& hex);
+      Q_INVOKABLE bool writeUserData(const QString& hex);
+
+      Q_INVOKABLE bool openLedger(const QString& fileName);
+      Q_INVOKABLE QString ledgerState(const QString& tid) const;
+      Q_INVOKABLE bool record(const QString& tid, const QString& state);
+      Q_INVOKABLE QString encode(const QString& epc,
+                                 const QString& userData,
+                                 const int timeout = SCRIPT_DEFAULT_TIMEOUT);
+
+      Q_INVOKABLE QJSValue importJobs(const QString& fileName);
+      Q_INVOKABLE int jobCount() const;
+      Q_INVOKABLE QJSValue job(const int index);
+      Q_INVOKABLE bool jobDone(const int index) const;
+      Q_INVOKABLE int nextJob(const int from = 0) const;
+      Q_INVOKABLE QString encodeJob(const int index,
+                                    const int timeout = SCRIPT_DEFAULT_TIMEOUT);
+
+      Q_INVOKABLE QJSValue readCsv(const QString& fileName);
+      Q_INVOKABLE bool exportTags(const QString& fileName);
+
+   private:
+      QJSValue tagObject(const RFID_Tag& tag);
+      QByteArray tagData(const RFID_Tag& tag, const QString& field) const;
+      bool waitFor(const std::function<bool()>& condition, const int timeout);
+      QString encodeTag(const QString& epc,
+                        const QString& userData,
+                        const int job,
+                        const int timeout);
+
+   private:
+      bool m_running;
+      QString m_error;
+      QByteArray m_lastTid;
+      QJSEngine m_engine;
+      RFID_JobQueue m_jobs;
+      RFID_JobLedger m_ledger;
+};
+
+#endif
@@ -0,0 +1,414 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "TrafficModel.h"
+
+#include <RFID_Clock.h>
+#include <RFID_SerialManager.h>
+
+#include <QDateTime>
+
+//------------------------------------------------------------------------------
+// Utility functions
+//------------------------------------------------------------------------------
+
+/**
+ * Returns @c true if the given @a byte is the header of a command, response
+ * or result packet
+ */
+static inline bool IsHeader(const char byte)
+{
+   const quint8 header = static_cast<quint8>(byte);
+   return header == 0xa0 || header == 0xe0 || header == 0xe4;
+}
+
+/**
+ * Returns the command code of the given @a frame, or -1 if the frame is not a
+ * valid packet
+ */
+static inline int CommandCode(const QByteArray& frame)
+{
+   if(frame.length() > 2 && IsHeader(frame.at(0)))
+      return static_cast<quint8>(frame.at(2));
+
+   return -1;
+}
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+
+/**
+ * @brief TrafficModel::TrafficModel
+ *
+ * Allocates the frame ring, begins capturing the data exchanged with the
+ * serial device and starts the view update timer
+ */
+TrafficModel::TrafficModel(QObject* parent) : QAbstractTableModel(parent)
+{
+   m_filter = -1;
+   m_paused = false;
+   m_nextSequence = 0;
+   m_shownSequence = 0;
+   m_ring.resize(TRAFFIC_MODEL_CAPACITY);
+
+   RFID_SerialManager* sm = RFID_SerialManager::getInstance();
+   connect(sm, &RFID_SerialManager::dataSent,
+           this, &TrafficModel::onDataSent);
+   connect(sm, &RFID_SerialManager::dataReceived,
+           this, &TrafficModel::onDataReceived);
+
+   m_timer.setInterval(TRAFFIC_MODEL_INTERVAL);
+   connect(&m_timer, &QTimer::timeout, this, &TrafficModel::flush);
+   m_timer.start();
+}
+
+//------------------------------------------------------------------------------
+// Model functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief TrafficModel::rowCount
+ * @returns the number of frames displayed by the model
+ */
+int TrafficModel::rowCount(const QModelIndex& parent) const
+{
+   if(parent.isValid())
+      return 0;
+
+   return m_rows.count();
+}
+
+/**
+ * @brief TrafficModel::columnCount
+ * @returns the number of columns of the model
+ */
+int TrafficModel::columnCount(const QModelIndex& parent) const
+{
+   if(parent.isValid())
+      return 0;
+
+   return ColumnCount;
+}
+
+/**
+ * @brief TrafficModel::data
+ *
+ * Formats the requested cell, this function is only called by the view for
+ * the rows that are visible
+ */
+QVariant TrafficModel::data(const QModelIndex& index, int role) const
+{
+   if(role != Qt::DisplayRole || !index.isValid())
+      return QVariant();
+
+   // Frame has been overwritten, but the view has not been notified yet
+   const quint64 sequence = m_rows.at(index.row());
+   if(m_nextSequence - sequence > TRAFFIC_MODEL_CAPACITY)
+      return QVariant();
+
+   // Format cell
+   const Frame& f = frame(sequence);
+   switch(index.column()) {
+      case TimeColumn: {
+         const qint64 usecs = RFID_Clock::getInstance()->toUtc(f.timestamp);
+         return QDateTime::fromMSecsSinceEpoch(usecs / 1000)
+                .toString("hh:mm:ss.zzz")
+                + QString("%1").arg(usecs % 1000, 3, 10, QChar('0'));
+      }
+      case DirectionColumn:
+         return f.sent ? tr("TX") : tr("RX");
+      case CommandColumn: {
+         const int command = CommandCode(f.data);
+         if(command < 0)
+            return QString("--");
+
+         return QString("%1").arg(command, 2, 16, QChar('0')).toUpper();
+      }
+      case LengthColumn:
+         return f.data.length();
+      case DataColumn:
+         return QString::fromLatin1(f.data.toHex(' ')).toUpper();
+      default:
+         break;
+   }
+
+   return QVariant();
+}
+
+/**
+ * @brief TrafficModel::headerData
+ * @returns the title of the given column
+ */
+QVariant TrafficModel::headerData(int section,
+                                  Qt::Orientation orientation,
+                                  int role) const
+{
+   if(role != Qt::DisplayRole || orientation != Qt::Horizontal)
+      return QAbstractTableModel::headerData(section, orientation, role);
+
+   switch(section) {
+      case TimeColumn:
+         return tr("Time");
+      case DirectionColumn:
+         return tr("Dir.");
+      case CommandColumn:
+         return tr("Cmd.");
+      case LengthColumn:
+         return tr("Length");
+      case DataColumn:
+         return tr("Data");
+      default:
+         break;
+   }
+
+   return QVariant();
+}
+
+//------------------------------------------------------------------------------
+// Capture status & export functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief TrafficModel::paused
+ * @returns @c true if the traffic capture is paused
+ */
+bool TrafficModel::paused() const
+{
+   return m_paused;
+}
+
+/**
+ * @brief TrafficModel::commandFilter
+ * @returns the command code of the displayed frames, or -1 if all the frames
+ *          are displayed
+ */
+int TrafficModel::commandFilter() const
+{
+   return m_filter;
+}
+
+/**
+ * @brief TrafficModel::exportCsv
+ *
+ * Writes the displayed frames to the given @a stream as comma separated values
+ */
+void TrafficModel::exportCsv(QTextStream& stream) const
+{
+   for(int i = 0; i < ColumnCount; ++i) {
+      stream << headerData(i, Qt::Horizontal).toString();
+      stream << (i < ColumnCount - 1 ? "," : "\n");
+   }
+
+   for(int row = 0; row < m_rows.count(); ++row) {
+      for(int i = 0; i < ColumnCount; ++i) {
+         stream << data(index(row, i)).toString();
+         stream << (i < ColumnCount - 1 ? "," : "\n");
+      }
+   }
+}
+
+//------------------------------------------------------------------------------
+// Capture control functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief TrafficModel::clear
+ *
+ * Removes all the captured frames
+ */
+void TrafficModel::clear()
+{
+   beginResetModel();
+   m_rows.clear();
+   m_rxBuffer.clear();
+   m_nextSequence = 0;
+   m_shownSequence = 0;
+   endResetModel();
+}
+
+/**
+ * @brief TrafficModel::setPaused
+ *
+ * Pauses or resumes the traffic capture, the displayed frames are kept while
+ * the capture is paused
+ */
+void TrafficModel::setPaused(const bool paused)
+{
+   m_paused = paused;
+   m_rxBuffer.clear();
+}
+
+/**
+ * @brief TrafficModel::setCommandFilter
+ * @param command command code of the frames to display, or -1 to display
+ *        all the frames
+ *
+ * Changes the filter and re-generates the list of displayed frames from the
+ * frames stored in the ring
+ */
+void TrafficModel::setCommandFilter(const int command)
+{
+   beginResetModel();
+
+   m_filter = command;
+   m_rows.clear();
+
+   quint64 first = 0;
+   if(m_nextSequence > TRAFFIC_MODEL_CAPACITY)
+      first = m_nextSequence - TRAFFIC_MODEL_CAPACITY;
+
+   for(quint64 i = first; i < m_shownSequence; ++i)
+      if(accepts(frame(i)))
+         m_rows.append(i);
+
+   endResetModel();
+}
+
+/**
+ * @brief TrafficModel::flush
+ *
+ * Notifies the views about the frames removed from the ring and the frames
+ * captured since the previous call, this is done periodically so that the
+ * views are not updated for every frame.
+ */
+void TrafficModel::flush()
+{
+   // Get first frame stored in the ring
+   quint64 first = 0;
+   if(m_nextSequence > TRAFFIC_MODEL_CAPACITY)
+      first = m_nextSequence - TRAFFIC_MODEL_CAPACITY;
+
+   // Remove overwritten frames
+   int removed = 0;
+   while(removed < m_rows.count() && m_rows.at(removed) < first)
+      ++removed;
+
+   if(removed > 0) {
+      beginRemoveRows(QModelIndex(), 0, removed - 1);
+      m_rows.remove(0, removed);
+      endRemoveRows();
+   }
+
+   // Add new frames
+   QVector<quint64> rows;
+   for(quint64 i = qMax(m_shownSequence, first); i < m_nextSequence; ++i)
+      if(accepts(frame(i)))
+         rows.append(i);
+
+   if(!rows.isEmpty()) {
+      const int count = m_rows.count();
+      beginInsertRows(QModelIndex(), count, count + rows.count() - 1);
+      m_rows += rows;
+      endInsertRows();
+   }
+
+   m_shownSequence = m_nextSequence;
+}
+
+//------------------------------------------------------------------------------
+// Frame capture functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief TrafficModel::onDataSent
+ *
+ * Registers a frame sent to the serial device
+ */
+void TrafficModel::onDataSent(const QByteArray& data)
+{
+   if(!m_paused)
+      addFrame(true, data, RFID_Clock::getInstance()->now());
+}
+
+/**
+ * @brief TrafficModel::onDataReceived
+ *
+ * Splits the data received from the serial device in frames (using the
+ * length byte of each packet) and registers them. Bytes that are not part of
+ * a packet are registered as a single frame.
+ */
+void TrafficModel::onDataReceived(const QByteArray& data,
+                                  const qint64 timestamp)
+{
+   if(m_paused)
+      return;
+
+   m_rxBuffer.append(data);
+   while(!m_rxBuffer.isEmpty()) {
+      int length = 0;
+
+      // Packet, wait until it is received completely
+      if(IsHeader(m_rxBuffer.at(0))) {
+         if(m_rxBuffer.length() < 2)
+            break;
+
+         length = static_cast<quint8>(m_rxBuffer.at(1)) + 2;
+         if(m_rxBuffer.length() < length)
+            break;
+      }
+
+      // Unknown data, register everything until the next packet header
+      else {
+         while(length < m_rxBuffer.length() && !IsHeader(m_rxBuffer.at(length)))
+            ++length;
+      }
+
+      addFrame(false, m_rxBuffer.left(length), timestamp);
+      m_rxBuffer.remove(0, length);
+   }
+}
+
+/**
+ * @brief TrafficModel::accepts
+ * @returns @c true if the given @a frame passes the command filter
+ */
+bool TrafficModel::accepts(const Frame& frame) const
+{
+   return m_filter < 0 || CommandCode(frame.data) == m_filter;
+}
+
+/**
+ * @brief TrafficModel::frame
+ * @returns the frame with the given @a sequence number
+ */
+const TrafficModel::Frame& TrafficModel::frame(const quint64 sequence) const
+{
+   return m_ring.at(static_cast<int>(sequence % TRAFFIC_MODEL_CAPACITY));
+}
+
+/**
+ * @brief TrafficModel::addFrame
+ *
+ * Stores the frame in the ring, overwriting the oldest frame if the ring is
+ * full (the views are notified by the @c flush() function)
+ */
+void TrafficModel::addFrame(const bool sent,
+                            const QByteArray& data,
+                            const qint64 timestamp)
+{
+   Frame& f = m_ring[static_cast<int>(m_nextSequence % TRAFFIC_MODEL_CAPACITY)];
+   f.sent = sent;
+   f.data = data;
+   f.timestamp = timestamp;
+   ++m_nextSequence;
+}
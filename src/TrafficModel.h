@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TRAFFICMODEL_H
+#define TRAFFICMODEL_H
+
+#include <QTimer>
+#include <QVector>
+#include <QByteArray>
+#include <QTextStream>
+#include <QAbstractTableModel>
+
+#define TRAFFIC_MODEL_CAPACITY      10000
+#define TRAFFIC_MODEL_INTERVAL      100
+
+/**
+ * @brief The TrafficModel class
+ *
+ * Keeps the last @c TRAFFIC_MODEL_CAPACITY frames exchanged with the serial
+ * device in a fixed-size ring, and exposes them as a table model.
+ *
+ * Incoming data is split in frames and stored in the ring immediately, but
+ * the attached views are only notified every @c TRAFFIC_MODEL_INTERVAL
+ * milliseconds. Frames are formatted on demand, so the view only formats the
+ * rows that are visible.
+ */
+class TrafficModel : public QAbstractTableModel
+{
+      Q_OBJECT
+
+   public:
+      enum Columns {
+         TimeColumn,
+         DirectionColumn,
+         CommandColumn,
+         LengthColumn,
+         DataColumn,
+         ColumnCount
+      };
+
+      explicit TrafficModel(QObject* parent = Q_NULLPTR);
+
+      int rowCount(const QModelIndex& parent = QModelIndex()) const;
+      int columnCount(const QModelIndex& parent = QModelIndex()) const;
+      QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const;
+      QVariant headerData(int section, Qt::Orientation orientation,
+                          int role = Qt::DisplayRole) const;
+
+      bool paused() const;
+      int commandFilter() const;
+      void exportCsv(QTextStream& stream) const;
+
+   public slots:
+      void clear();
+      void setPaused(const bool paused);
+      void setCommandFilter(const int command);
+
+   private slots:
+      void flush();
+      void onDataSent(const QByteArray& data);
+      void onDataReceived(const QByteArray& data, const qint64 timestamp);
+
+   private:
+      typedef struct {
+         bool sent;
+         qint64 timestamp;
+         QByteArray data;
+      } Frame;
+
+      bool accepts(const Frame& frame) const;
+      const Frame& frame(const quint64 sequence) const;
+      void addFrame(const bool sent, const QByteArray& data,
+                    const qint64 timestamp);
+
+   private:
+      bool m_paused;
+      int m_filter;
+      QTimer m_timer;
+
+      QVector<Frame> m_ring;
+      quint64 m_nextSequence;
+      QByteArray m_rxBuffer;
+
+      QVector<quint64> m_rows;
+      quint64 m_shownSequence;
+};
+
+#endif
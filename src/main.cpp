@@ -1,84 +1,218 @@
-/*
- * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
- *
- * Permission is hereby granted, free of charge, to any person obtaining a copy
- * of this software and associated documentation files (the "Software"), to deal
- * in the Software without restriction, including without limitation the rights
- * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
- * copies of the Software, and to permit persons to whom the Software is
- * furnished to do so, subject to the following conditions:
- *
- * The above copyright notice and this permission notice shall be included in
- * all copies or substantial portions of the Software.
- *
- * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
- * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
- * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
- * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
- * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
- * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
- * THE SOFTWARE.
- */
-
-#include <QApplication>
-#include <QStyleFactory>
-
-#include "AppInfo.h"
-#include "MainWindow.h"
-
-/**
- * @brief Main entry point of the application
- * @param argc argument count
- * @param argv argument data
- * @return @c qApp event loop exit code
- */
-int main(int argc, char** argv)
-{
-   // Set application attributes
-   QApplication::setApplicationName(APP_NAME);
-   QApplication::setApplicationVersion(APP_VERSION);
-   QApplication::setAttribute(Qt::AA_NativeWindows, true);
-   QApplication::setAttribute(Qt::AA_DisableHighDpiScaling, true);
-
-   // Create QApplication and change widget style to Fusion
-   QApplication app(argc, argv);
-   app.setStyle(QStyleFactory::create("Fusion"));
-
-   // Increase font size for better reading
-   QFont f = QApplication::font();
-   f.setPointSize(f.pointSize() + 2);
-   app.setFont(f);
-
-   // Generate dark color palette
-   QPalette p;
-   p.setColor(QPalette::Text, QColor(0xff, 0xff, 0xff));
-   p.setColor(QPalette::Base, QColor(0x2a, 0x2a, 0x2a));
-   p.setColor(QPalette::Dark, QColor(0x23, 0x23, 0x23));
-   p.setColor(QPalette::Link, QColor(0x2a, 0x82, 0xda));
-   p.setColor(QPalette::Window, QColor(0x35, 0x35, 0x35));
-   p.setColor(QPalette::Shadow, QColor(0x14, 0x14, 0x14));
-   p.setColor(QPalette::Button, QColor(0x35, 0x35, 0x35));
-   p.setColor(QPalette::Highlight, QColor(0x2a, 0x82, 0xda));
-   p.setColor(QPalette::BrightText, QColor(0xff, 0x00, 0x00));
-   p.setColor(QPalette::WindowText, QColor(0xff, 0xff, 0xff));
-   p.setColor(QPalette::ButtonText, QColor(0xff, 0xff, 0xff));
-   p.setColor(QPalette::ToolTipBase, QColor(0xff, 0xff, 0xff));
-   p.setColor(QPalette::ToolTipText, QColor(0xff, 0xff, 0xff));
-   p.setColor(QPalette::AlternateBase, QColor(0x42, 0x42, 0x42));
-   p.setColor(QPalette::HighlightedText, QColor(0xff, 0xff, 0xff));
-   p.setColor(QPalette::Disabled, QPalette::Text, QColor(0x7f, 0x7f, 0x7f));
-   p.setColor(QPalette::Disabled, QPalette::Highlight, QColor(0x50, 0x50, 0x50));
-   p.setColor(QPalette::Disabled, QPalette::WindowText, QColor(0x7f, 0x7f, 0x7f));
-   p.setColor(QPalette::Disabled, QPalette::ButtonText, QColor(0x7f, 0x7f, 0x7f));
-   p.setColor(QPalette::Disabled, QPalette::HighlightedText, QColor(0x7f, 0x7f,0x7f));
-
-   // Change application palette
-   app.setPalette(p);
-
-   // Create MainWindow instance
-   MainWindow window;
-   window.showNormal();
-
-   // Begin qApp event loop
-   return app.exec();
-}
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <QTextStream>
+#include <QApplication>
+#include <QStyleFactory>
+#include <QCommandLineParser>
+
+#include <RFID.h>
+#include <RFID_Log.h>
+
+#include "AppInfo.h"
+#include "MainWindow.h"
+#include "ScriptEngine.h"
+
+/**
+ * Writes the given line of @a text to the given standard @a output
+ */
+static void PrintLine(FILE* output, const QString& text)
+{
+   QTextStream stream(output);
+   stream << text << "\n";
+   stream.flush();
+}
+
+/**
+ * Writes the messages of the script to the standard output
+ */
+static void PrintMessage(const QString& text)
+{
+   PrintLine(stdout, text);
+}
+
+/**
+ * Changes the output and the level of the diagnostic log, records are written
+ * to the standard error output if @a fileName is empty. Returns @c false
+ * (after reporting the error) if the level is unknown or if the log file
+ * cannot be opened.
+ */
+static bool ConfigureLog(const QString& fileName,
+                         const QString& format,
+                         const QString& level)
+{
+   int logLevel = -1;
+   for(int i = RFID_LOG_DEBUG; i <= RFID_LOG_OFF; ++i) {
+      if(RFID_Log::levelName(i) == level)
+         logLevel = i;
+   }
+
+   if(logLevel < 0) {
+      PrintLine(stderr, "Unknown log level: " + level);
+      return false;
+   }
+
+   RFID_Log::setLevel(logLevel);
+   if(fileName.isEmpty())
+      return true;
+
+   RFID_LogFormat logFormat = RFID_LOG_TEXT;
+   if(format == "binary")
+      logFormat = RFID_LOG_BINARY;
+
+   RFID_Log* log = RFID_Log::getInstance();
+   if(!log->setOutput(fileName, logFormat)) {
+      PrintLine(stderr, "Cannot open log file: " + log->errorString());
+      return false;
+   }
+
+   return true;
+}
+
+/**
+ * Runs the given script without showing the main window, if @a port is not
+ * empty, the script is run after connecting to the RFID reader at the given
+ * serial port
+ */
+static int RunScript(const QString& fileName,
+                     const QString& port,
+                     const int baudRate)
+{
+   RFID::getInstance()->setReader(0);
+
+   ScriptEngine engine;
+   QObject::connect(&engine, &ScriptEngine::message, PrintMessage);
+
+   if(!port.isEmpty() && !engine.connectDevice(port, baudRate)) {
+      PrintLine(stderr, "Cannot connect to " + port);
+      return EXIT_FAILURE;
+   }
+
+   if(!engine.run(fileName)) {
+      PrintLine(stderr, engine.errorString());
+      return EXIT_FAILURE;
+   }
+
+   return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Main entry point of the application
+ * @param argc argument count
+ * @param argv argument data
+ * @return @c qApp event loop exit code
+ */
+int main(int argc, char** argv)
+{
+   // Set application attributes
+   QApplication::setApplicationName(APP_NAME);
+   QApplication::setApplicationVersion(APP_VERSION);
+   QApplication::setAttribute(Qt::AA_NativeWindows, true);
+   QApplication::setAttribute(Qt::AA_DisableHighDpiScaling, true);
+
+   // Create QApplication
+   QApplication app(argc, argv);
+
+   // Parse command line options
+   QCommandLineParser parser;
+   parser.addHelpOption();
+   parser.addVersionOption();
+   QCommandLineOption script("script",
+                             "Run the given JavaScript batch job and exit.",
+                             "file");
+   QCommandLineOption port("port",
+                           "Serial port of the RFID reader (for --script).",
+                           "name");
+   QCommandLineOption baud("baud",
+                           "Baud rate of the serial port (for --script).",
+                           "rate", "9600");
+   QCommandLineOption log("log",
+                          "Write the diagnostic log to the given file.",
+                          "file");
+   QCommandLineOption logFormat("log-format",
+                                "Format of the log file (text or binary).",
+                                "format", "text");
+   QCommandLineOption logLevel("log-level",
+                               "Minimum level of the logged records (debug, "
+                               "info, warning, error or off).",
+                               "level", "warning");
+   parser.addOption(script);
+   parser.addOption(port);
+   parser.addOption(baud);
+   parser.addOption(log);
+   parser.addOption(logFormat);
+   parser.addOption(logLevel);
+   parser.process(app);
+
+   // Configure diagnostic log
+   if(!ConfigureLog(parser.value(log),
+                    parser.value(logFormat),
+                    parser.value(logLevel)))
+      return EXIT_FAILURE;
+
+   // Run script without user interface
+   if(parser.isSet(script))
+      return RunScript(parser.value(script),
+                       parser.value(port),
+                       parser.value(baud).toInt());
+
+   // Change widget style to Fusion
+   app.setStyle(QStyleFactory::create("Fusion"));
+
+   // Increase font size for better reading
+   QFont f = QApplication::font();
+   f.setPointSize(f.pointSize() + 2);
+   app.setFont(f);
+
+   // Generate dark color palette
+   QPalette p;
+   p.setColor(QPalette::Text, QColor(0xff, 0xff, 0xff));
+   p.setColor(QPalette::Base, QColor(0x2a, 0x2a, 0x2a));
+   p.setColor(QPalette::Dark, QColor(0x23, 0x23, 0x23));
+   p.setColor(QPalette::Link, QColor(0x2a, 0x82, 0xda));
+   p.setColor(QPalette::Window, QColor(0x35, 0x35, 0x35));
+   p.setColor(QPalette::Shadow, QColor(0x14, 0x14, 0x14));
+   p.setColor(QPalette::Button, QColor(0x35, 0x35, 0x35));
+   p.setColor(QPalette::Highlight, QColor(0x2a, 0x82, 0xda));
+   p.setColor(QPalette::BrightText, QColor(0xff, 0x00, 0x00));
+   p.setColor(QPalette::WindowText, QColor(0xff, 0xff, 0xff));
+   p.setColor(QPalette::ButtonText, QColor(0xff, 0xff, 0xff));
+   p.setColor(QPalette::ToolTipBase, QColor(0xff, 0xff, 0xff));
+   p.setColor(QPalette::ToolTipText, QColor(0xff, 0xff, 0xff));
+   p.setColor(QPalette::AlternateBase, QColor(0x42, 0x42, 0x42));
+   p.setColor(QPalette::HighlightedText, QColor(0xff, 0xff, 0xff));
+   p.setColor(QPalette::Disabled, QPalette::Text, QColor(0x7f, 0x7f, 0x7f));
+   p.setColor(QPalette::Disabled, QPalette::Highlight, QColor(0x50, 0x50, 0x50));
+   p.setColor(QPalette::Disabled, QPalette::WindowText, QColor(0x7f, 0x7f, 0x7f));
+   p.setColor(QPalette::Disabled, QPalette::ButtonText, QColor(0x7f, 0x7f, 0x7f));
+   p.setColor(QPalette::Disabled, QPalette::HighlightedText, QColor(0x7f, 0x7f,0x7f));
+
+   // Change application palette
+   app.setPalette(p);
+
+   // Create MainWindow instance
+   MainWindow window;
+   window.showNormal();
+
+   // Begin qApp event loop
+   return app.exec();
+}
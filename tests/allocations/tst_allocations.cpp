@@ -0,0 +1,313 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "RFID.h"
+#include "RFID_Reader.h"
+#include "FakeReader.h"
+
+#include <QtTest>
+#include <QElapsedTimer>
+
+#include <new>
+#include <atomic>
+#include <cstdlib>
+#include <pthread.h>
+
+//------------------------------------------------------------------------------
+// Test parameters
+//------------------------------------------------------------------------------
+
+/*
+ * Max. number of heap allocations per frame (command sent to the reader and
+ * its answer) in the steady state. The remaining allocations are inherent to
+ * the event loop and to Qt:
+ *
+ * - 1: the scheduler restarts its timeout timer, which registers a new
+ *      timer info with the event dispatcher
+ * - 1: the scheduler lanes are QQueue objects, which allocate a node for
+ *      each queued command
+ * - 1: QSerialPort buffers the written frame
+ * - 1: QSerialPort::readAll() returns a new QByteArray for each read
+ * - 1: the section data is copied into the queued event
+ * - 2: processing the queued events is posted to the event loop (slot object
+ *      and posted event)
+ * - 3: the scan timer is a single-shot timer (timer object, slot object and
+ *      timer info), restarted at most once per frame
+ * - 5: a new tag list snapshot is published if the tag has been updated
+ *      (posted slot object & event, snapshot, tag vector and shared pointer)
+ *
+ * Interning the TID of the tag and looking up the tag do not allocate.
+ */
+static const double ALLOCATION_BUDGET       = 15;
+
+// Tag reads used to warm up caches and to measure the steady state
+static const int WARMUP_READS               = 100;
+static const int MEASURED_READS             = 500;
+
+// Max. time to wait for the stack to read the tags (in milliseconds)
+static const int READ_TIMEOUT               = 30000;
+
+//------------------------------------------------------------------------------
+// Allocation counter
+//------------------------------------------------------------------------------
+
+/*
+ * Only allocations made by the main thread while the counter is enabled are
+ * counted, so that the fake reader thread and the test harness itself do
+ * not affect the results
+ */
+
+static pthread_t MAIN_THREAD;
+static std::atomic<bool> COUNT_ENABLED(false);
+static std::atomic<quint64> ALLOCATIONS(0);
+
+static inline void CountAllocation()
+{
+   if(COUNT_ENABLED.load(std::memory_order_relaxed)
+         && pthread_equal(pthread_self(), MAIN_THREAD))
+      ALLOCATIONS.fetch_add(1, std::memory_order_relaxed);
+}
+
+#ifdef __GLIBC__
+/*
+ * Qt containers allocate with malloc() directly, replace the glibc allocation
+ * functions so that they are counted too (operator new calls malloc())
+ */
+extern "C" {
+   void* __libc_malloc(size_t size);
+   void* __libc_calloc(size_t count, size_t size);
+   void* __libc_realloc(void* ptr, size_t size);
+
+   void* malloc(size_t size)
+   {
+      CountAllocation();
+      return __libc_malloc(size);
+   }
+
+   void* calloc(size_t count, size_t size)
+   {
+      CountAllocation();
+      return __libc_calloc(count, size);
+   }
+
+   void* realloc(void* ptr, size_t size)
+   {
+      CountAllocation();
+      return __libc_realloc(ptr, size);
+   }
+}
+
+static inline void* Allocate(size_t size)
+{
+   return malloc(size ? size : 1);
+}
+#else
+static inline void* Allocate(size_t size)
+{
+   CountAllocation();
+   return malloc(size ? size : 1);
+}
+#endif
+
+void* operator new(size_t size)
+{
+   void* ptr = Allocate(size);
+   if(!ptr)
+      throw std::bad_alloc();
+
+   return ptr;
+}
+
+void* operator new[](size_t size)
+{
+   void* ptr = Allocate(size);
+   if(!ptr)
+      throw std::bad_alloc();
+
+   return ptr;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+   return Allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+   return Allocate(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+   free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+   free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+   free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+   free(ptr);
+}
+
+//------------------------------------------------------------------------------
+// Test case
+//------------------------------------------------------------------------------
+
+/**
+ * @brief The tst_Allocations class
+ *
+ * Drives the RFID stack with a fake SM-6210 reader and verifies that the
+ * number of heap allocations per frame stays within its budget.
+ */
+class tst_Allocations : public QObject
+{
+      Q_OBJECT
+
+   private slots:
+      void initTestCase();
+      void cleanupTestCase();
+      void steadyStateReads();
+
+   private:
+      bool waitForReads(const int reads);
+      bool waitForCurrentTag();
+
+   private:
+      int m_reads;
+      FakeReader m_endpoint;
+};
+
+/**
+ * @brief tst_Allocations::initTestCase
+ * Connects the stack to the fake reader and waits until a tag is read
+ */
+void tst_Allocations::initTestCase()
+{
+   MAIN_THREAD = pthread_self();
+
+   m_reads = 0;
+   QVERIFY(m_endpoint.attach());
+
+   RFID_Reader* reader = RFID::getInstance()->reader();
+   QVERIFY(reader != Q_NULLPTR);
+   connect(reader, &RFID_Reader::epcFound, [this] { ++m_reads; });
+   connect(reader, &RFID_Reader::tidFound, [this] { ++m_reads; });
+   connect(reader, &RFID_Reader::rfuFound, [this] { ++m_reads; });
+   connect(reader, &RFID_Reader::usrFound, [this] { ++m_reads; });
+
+   QVERIFY(waitForCurrentTag());
+}
+
+/**
+ * @brief tst_Allocations::cleanupTestCase
+ * Disconnects the stack from the fake reader
+ */
+void tst_Allocations::cleanupTestCase()
+{
+   RFID::getInstance()->unloadReader();
+   m_endpoint.stop();
+}
+
+/**
+ * @brief tst_Allocations::steadyStateReads
+ *
+ * Counts the heap allocations made while the current tag is read again and
+ * again, and verifies that the allocations per frame are within the
+ * allocation budget
+ */
+void tst_Allocations::steadyStateReads()
+{
+   QVERIFY(waitForReads(WARMUP_READS));
+
+   const int reads = m_reads;
+   const quint64 frames = m_endpoint.frames();
+
+   ALLOCATIONS = 0;
+   COUNT_ENABLED = true;
+   const bool ok = waitForReads(MEASURED_READS);
+   COUNT_ENABLED = false;
+   QVERIFY(ok);
+
+   const double allocations = ALLOCATIONS.load();
+   const double perRead = allocations / (m_reads - reads);
+   const double perFrame = allocations / qMax<quint64>(1, m_endpoint.frames()
+                                                        - frames);
+
+   qInfo("%d reads, %.0f allocations, %.2f per read, %.2f per frame",
+         m_reads - reads, allocations, perRead, perFrame);
+
+   QVERIFY2(perFrame <= ALLOCATION_BUDGET,
+            qPrintable(QString("%1 allocations per frame, budget is %2")
+                       .arg(perFrame).arg(ALLOCATION_BUDGET)));
+}
+
+/**
+ * @brief tst_Allocations::waitForReads
+ *
+ * Processes events until the stack has read @a reads more tag sections,
+ * returns @c false if the reads time out
+ */
+bool tst_Allocations::waitForReads(const int reads)
+{
+   QElapsedTimer timer;
+   timer.start();
+
+   const int target = m_reads + reads;
+   while(m_reads < target && timer.elapsed() < READ_TIMEOUT)
+      QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents, 50);
+
+   return m_reads >= target;
+}
+
+/**
+ * @brief tst_Allocations::waitForCurrentTag
+ *
+ * Processes events until every memory bank of the current tag has been read,
+ * returns @c false if the reads time out
+ */
+bool tst_Allocations::waitForCurrentTag()
+{
+   QElapsedTimer timer;
+   timer.start();
+
+   while(timer.elapsed() < READ_TIMEOUT) {
+      QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents, 50);
+
+      RFID_Tag* tag = RFID::getInstance()->currentTag();
+      if(tag && RFID_ValidKey(tag->tid) && !tag->rfu.isEmpty()
+            && !tag->usr[RFID_NUM_USER_DATAGRAMS - 1].isEmpty())
+         return true;
+   }
+
+   return false;
+}
+
+QTEST_GUILESS_MAIN(tst_Allocations)
+#include "tst_allocations.moc"
@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "SM_6210.h"
+#include "FakeReader.h"
+#include "RFID_SerialManager.h"
+
+#include <QtTest>
+#include <QDir>
+#include <QFile>
+#include <QElapsedTimer>
+
+//------------------------------------------------------------------------------
+// Benchmark parameters
+//------------------------------------------------------------------------------
+
+// Size of the benchmark streams & of each simulated serial port read
+static const int STREAM_SIZE                = 64 * 1024;
+static const int CHUNK_SIZE                 = 32;
+
+// One of every NOISE_RATE bytes is corrupted in the noisy link stream
+static const int NOISE_RATE                 = 100;
+
+//------------------------------------------------------------------------------
+// Utility functions
+//------------------------------------------------------------------------------
+
+/**
+ * Returns the contents of the given corpus @a file (all the files of the
+ * corpus if @a file is empty)
+ */
+static QByteArray Corpus(const QString& file = QString())
+{
+   QDir dir(RFID_CORPUS_DIR);
+   QStringList files(file);
+   if(file.isEmpty())
+      files = dir.entryList(QDir::Files, QDir::Name);
+
+   QByteArray data;
+   foreach(QString name, files) {
+      QFile input(dir.filePath(name));
+      if(input.open(QFile::ReadOnly))
+         data.append(input.readAll());
+   }
+
+   return data;
+}
+
+/**
+ * Repeats the given @a data until the stream has (at least)
+ * @c STREAM_SIZE bytes
+ */
+static QByteArray Stream(const QByteArray& data)
+{
+   QByteArray stream;
+   if(data.isEmpty())
+      return stream;
+
+   while(stream.size() < STREAM_SIZE)
+      stream.append(data);
+
+   return stream;
+}
+
+/**
+ * Corrupts one of every @c NOISE_RATE bytes of the given @a data (the
+ * corrupted bytes are chosen with a fixed seed, so that runs are comparable)
+ */
+static QByteArray Noisy(QByteArray data)
+{
+   quint32 seed = 0x6210;
+   for(int i = 0; i < data.size(); ++i) {
+      seed = seed * 1103515245 + 12345;
+      if((seed >> 16) % NOISE_RATE == 0)
+         data[i] = static_cast<char>(data.at(i) ^ (seed >> 8));
+   }
+
+   return data;
+}
+
+//------------------------------------------------------------------------------
+// Test case
+//------------------------------------------------------------------------------
+
+/**
+ * @brief The tst_Parser class
+ *
+ * Measures the decode throughput of the SM-6210 driver with streams generated
+ * from the fuzzing corpus, the streams are fed to the driver in small chunks,
+ * as they are received from the serial port.
+ */
+class tst_Parser : public QObject
+{
+      Q_OBJECT
+
+   private slots:
+      void initTestCase();
+      void cleanupTestCase();
+      void throughput_data();
+      void throughput();
+
+   private:
+      int m_sightings;
+      SM_6210* m_driver;
+      FakeReader m_endpoint;
+};
+
+/**
+ * @brief tst_Parser::initTestCase
+ *
+ * Connects the serial manager to a silent fake reader, so that the driver
+ * interprets the data fed by the benchmark
+ */
+void tst_Parser::initTestCase()
+{
+   m_sightings = 0;
+   m_driver = new SM_6210();
+   connect(m_driver, &SM_6210::epcFound, [this] { ++m_sightings; });
+
+   m_endpoint.setSilent(true);
+   QVERIFY(m_endpoint.open());
+   QVERIFY(m_driver->loaded());
+}
+
+/**
+ * @brief tst_Parser::cleanupTestCase
+ * Deletes the driver & stops the fake reader
+ */
+void tst_Parser::cleanupTestCase()
+{
+   delete m_driver;
+   m_endpoint.stop();
+}
+
+/**
+ * @brief tst_Parser::throughput_data
+ *
+ * Generates the benchmark streams, the expected number of EPC sightings is
+ * only known for the clean stream (-1 for the other streams)
+ */
+void tst_Parser::throughput_data()
+{
+   QTest::addColumn<QByteArray>("stream");
+   QTest::addColumn<int>("sightings");
+
+   const QByteArray packets = Corpus("stream.bin");
+   const QByteArray scan = Corpus("scan_epc.bin");
+   const QByteArray clean = Stream(packets);
+
+   QVERIFY(!packets.isEmpty() && !scan.isEmpty());
+   QTest::newRow("clean link") << clean << clean.count(scan);
+   QTest::newRow("noisy link") << Noisy(clean) << -1;
+   QTest::newRow("corpus") << Stream(Corpus()) << -1;
+}
+
+/**
+ * @brief tst_Parser::throughput
+ *
+ * Feeds the stream to the driver and reports the decode throughput, for the
+ * clean stream, every EPC packet must be decoded.
+ */
+void tst_Parser::throughput()
+{
+   QFETCH(QByteArray, stream);
+   QFETCH(int, sightings);
+
+   RFID_SerialManager* sm = RFID_SerialManager::getInstance();
+
+   qint64 bytes = 0;
+   qint64 nsecs = 0;
+   QElapsedTimer timer;
+
+   QBENCHMARK {
+      emit sm->connectionStatusChanged();
+      m_sightings = 0;
+
+      timer.start();
+      for(int i = 0; i < stream.size(); i += CHUNK_SIZE) {
+         const int size = qMin(CHUNK_SIZE, stream.size() - i);
+         emit sm->dataReceived(QByteArray::fromRawData(stream.constData() + i,
+                                                       size), 0);
+      }
+
+      nsecs += timer.nsecsElapsed();
+      bytes += stream.size();
+   }
+
+   qInfo("%.2f MB/s, %d EPC sightings per pass",
+         nsecs > 0 ? bytes * 1000.0 / nsecs : 0.0, m_sightings);
+
+   if(sightings >= 0)
+      QCOMPARE(m_sightings, sightings);
+}
+
+QTEST_GUILESS_MAIN(tst_Parser)
+#include "tst_parser.moc"
@@ -0,0 +1,64 @@
+#
+# Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+
+#-------------------------------------------------------------------------------
+# Test configuration
+#-------------------------------------------------------------------------------
+
+CONFIG += console
+CONFIG += testcase
+CONFIG -= app_bundle
+
+#-------------------------------------------------------------------------------
+# Sanitizer build (qmake CONFIG+=sanitizers), runs every test with address &
+# undefined behavior checks
+#-------------------------------------------------------------------------------
+
+sanitizers {
+    CONFIG += sanitizer
+    CONFIG += sanitize_address
+    CONFIG += sanitize_undefined
+}
+
+#-------------------------------------------------------------------------------
+# Qt modules
+#-------------------------------------------------------------------------------
+
+QT += testlib
+
+#-------------------------------------------------------------------------------
+# Include libraries
+#-------------------------------------------------------------------------------
+
+include($$PWD/../lib/RFID/RFID.pri)
+
+#-------------------------------------------------------------------------------
+# Import source code
+#-------------------------------------------------------------------------------
+
+INCLUDEPATH += $$PWD/common
+
+HEADERS += \
+    $$PWD/common/FakeReader.h
+
+SOURCES += \
+    $$PWD/common/FakeReader.cpp
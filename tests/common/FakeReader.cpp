@@ -0,0 +1,500 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "FakeReader.h"
+
+#include "RFID.h"
+#include "RFID_SerialManager.h"
+
+#include <QSerialPortInfo>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+//------------------------------------------------------------------------------
+// SM-6210 protocol constants
+//------------------------------------------------------------------------------
+
+static const quint8 HEADER_START_CODE       = 0xa0;
+static const quint8 HEADER_RESULT_CODE      = 0xe4;
+static const quint8 HEADER_RESPONSE_CODE    = 0xe0;
+
+static const quint8 DEV_STOP_SEARCH         = 0xa8;
+static const quint8 DEV_WRITE_TAG_MW        = 0xab;
+static const quint8 DEV_GET_SINGLE_PARAM    = 0x61;
+static const quint8 DEV_READ_SINGLE_TAG     = 0x82;
+static const quint8 DEV_READ_TAG_DATA       = 0x80;
+static const quint8 CRP_ADD_USERCODE        = 0x64;
+
+static const quint8 RFU_LABEL               = 0x00;
+static const quint8 EPC_LABEL               = 0x01;
+static const quint8 TID_LABEL               = 0x02;
+static const quint8 USR_LABEL               = 0x03;
+
+// Time to wait for command frames before checking if the endpoint is stopped
+static const int POLL_TIMEOUT               = 50;
+
+//------------------------------------------------------------------------------
+// Utility functions
+//------------------------------------------------------------------------------
+
+/**
+ * Calculates the 8-bit checksum (2's complement) used by the SM-6210 reader
+ */
+static quint8 Checksum(const char* data, const int length)
+{
+   quint8 checksum = 0;
+
+   for(int i = 0; i < length; ++i)
+      checksum += static_cast<quint8>(data[i]);
+
+   return (~checksum) + 1;
+}
+
+/**
+ * Generates a packet with the given @a header, @a command and @a payload,
+ * the size field and the checksum are added automatically
+ */
+static QByteArray Packet(const quint8 header,
+                         const quint8 command,
+                         const QByteArray& payload)
+{
+   QByteArray packet;
+   packet.append(static_cast<char>(header));
+   packet.append(static_cast<char>(payload.size() + 2));
+   packet.append(static_cast<char>(command));
+   packet.append(payload);
+   packet.append(static_cast<char>(Checksum(packet.constData(),
+                                            packet.size())));
+   return packet;
+}
+
+/**
+ * Generates @a length bytes of deterministic data for the given @a tag, the
+ * @a bank byte makes the data of each memory bank different
+ */
+static QByteArray TagBytes(const int tag, const quint8 bank, const int length)
+{
+   QByteArray data(length, 0);
+   data[0] = static_cast<char>(0x30 + bank);
+   for(int i = 1; i < length; ++i)
+      data[i] = static_cast<char>((tag >> (8 * ((length - 1 - i) % 4))) & 0xff);
+
+   return data;
+}
+
+//------------------------------------------------------------------------------
+// Constructor & destructor
+//------------------------------------------------------------------------------
+
+FakeReader::FakeReader()
+{
+   m_master = -1;
+   m_silent = false;
+   m_running = false;
+
+   m_tag = 0;
+   m_current = 0;
+   m_answers = 0;
+   m_frames = 0;
+   m_writes = 0;
+   m_tagCount = 1;
+   m_tagPeriod = 1;
+}
+
+FakeReader::~FakeReader()
+{
+   stop();
+}
+
+//------------------------------------------------------------------------------
+// Member functions
+//------------------------------------------------------------------------------
+
+/**
+ * @brief FakeReader::start
+ *
+ * Creates the pseudo-terminal and begins answering the command frames that
+ * are written to it. Returns @c false if the terminal cannot be created.
+ */
+bool FakeReader::start()
+{
+   if(m_running)
+      return true;
+
+   m_master = posix_openpt(O_RDWR | O_NOCTTY);
+   if(m_master < 0)
+      return false;
+
+   if(grantpt(m_master) != 0 || unlockpt(m_master) != 0) {
+      close(m_master);
+      m_master = -1;
+      return false;
+   }
+
+   m_portName = QString::fromLocal8Bit(ptsname(m_master));
+   m_running = true;
+   m_thread = std::thread(&FakeReader::run, this);
+   return true;
+}
+
+/**
+ * @brief FakeReader::stop
+ * Stops the endpoint thread and closes the pseudo-terminal
+ */
+void FakeReader::stop()
+{
+   m_running = false;
+   if(m_thread.joinable())
+      m_thread.join();
+
+   if(m_master >= 0) {
+      close(m_master);
+      m_master = -1;
+   }
+}
+
+/**
+ * @brief FakeReader::open
+ *
+ * Starts the endpoint and connects the serial manager to it (at the baud rate
+ * expected by the SM-6210 driver). Returns @c true on success.
+ */
+bool FakeReader::open()
+{
+   if(!start())
+      return false;
+
+   RFID_SerialManager* sm = RFID_SerialManager::getInstance();
+   sm->setBaudRate(QSerialPortInfo::standardBaudRates().indexOf(9600));
+   return sm->setPort(portName(), true);
+}
+
+/**
+ * @brief FakeReader::attach
+ *
+ * Loads the SM-6210 driver in the @c RFID tag list and connects the serial
+ * manager to the endpoint. Returns @c true on success.
+ */
+bool FakeReader::attach()
+{
+   RFID::getInstance()->setReader(0);
+   return open();
+}
+
+/**
+ * @brief FakeReader::portName
+ * @returns the path of the slave side of the pseudo-terminal
+ */
+QString FakeReader::portName() const
+{
+   return m_portName;
+}
+
+/**
+ * @brief FakeReader::silent
+ * @returns @c true if the endpoint does not answer the command frames
+ */
+bool FakeReader::silent() const
+{
+   return m_silent;
+}
+
+/**
+ * @brief FakeReader::tagCount
+ * @returns the number of tags that are cycled in front of the reader
+ */
+int FakeReader::tagCount() const
+{
+   return m_tagCount;
+}
+
+/**
+ * @brief FakeReader::currentTag
+ * @returns the index of the tag given in the latest inventory answer, which
+ *          is the tag that the targeted reads are answered for
+ */
+int FakeReader::currentTag() const
+{
+   return m_current;
+}
+
+/**
+ * @brief FakeReader::tagPeriod
+ * @returns the number of inventory answers given for each tag before the
+ *          next tag is placed in front of the reader
+ */
+int FakeReader::tagPeriod() const
+{
+   return m_tagPeriod;
+}
+
+/**
+ * @brief FakeReader::frames
+ * @returns the number of command frames answered by the endpoint
+ */
+quint64 FakeReader::frames() const
+{
+   return m_frames;
+}
+
+/**
+ * @brief FakeReader::writes
+ * @returns the number of write commands answered by the endpoint
+ */
+quint64 FakeReader::writes() const
+{
+   return m_writes;
+}
+
+/**
+ * @brief FakeReader::setSilent
+ * Enables or disables the answers to the command frames
+ */
+void FakeReader::setSilent(const bool silent)
+{
+   m_silent = silent;
+}
+
+/**
+ * @brief FakeReader::setTagCount
+ * Changes the number of tags that are cycled in front of the reader
+ */
+void FakeReader::setTagCount(const int count)
+{
+   m_tagCount = qMax(1, count);
+}
+
+/**
+ * @brief FakeReader::setTagPeriod
+ * Changes the number of inventory answers given for each tag
+ */
+void FakeReader::setTagPeriod(const int answers)
+{
+   m_tagPeriod = qMax(1, answers);
+}
+
+/**
+ * @brief FakeReader::epc
+ * @returns the EPC of the given @a tag
+ */
+QByteArray FakeReader::epc(const int tag)
+{
+   return TagBytes(tag, EPC_LABEL, 12);
+}
+
+/**
+ * @brief FakeReader::tid
+ * @returns the TID of the given @a tag
+ */
+QByteArray FakeReader::tid(const int tag)
+{
+   return TagBytes(tag, TID_LABEL, 12);
+}
+
+/**
+ * @brief FakeReader::rfu
+ * @returns the reserved memory of the given @a tag
+ */
+QByteArray FakeReader::rfu(const int tag)
+{
+   return TagBytes(tag, RFU_LABEL, 8);
+}
+
+/**
+ * @brief FakeReader::usr
+ * @returns the user memory of the given @a tag
+ */
+QByteArray FakeReader::usr(const int tag)
+{
+   return TagBytes(tag, USR_LABEL, 64);
+}
+
+/**
+ * @brief FakeReader::run
+ *
+ * Reads the data written by the driver, extracts the command frames from it
+ * (any data that is not part of a frame is discarded) and answers them.
+ */
+void FakeReader::run()
+{
+   QByteArray buffer;
+   char data[256];
+
+   while(m_running) {
+      pollfd fd;
+      fd.fd = m_master;
+      fd.events = POLLIN;
+      fd.revents = 0;
+      if(poll(&fd, 1, POLL_TIMEOUT) <= 0 || !(fd.revents & POLLIN))
+         continue;
+
+      const ssize_t bytes = read(m_master, data, sizeof(data));
+      if(bytes <= 0)
+         continue;
+
+      buffer.append(data, static_cast<int>(bytes));
+      while(!buffer.isEmpty()) {
+         const int start = buffer.indexOf(static_cast<char>(HEADER_START_CODE));
+         if(start < 0) {
+            buffer.clear();
+            break;
+         }
+
+         buffer.remove(0, start);
+         if(buffer.size() < 2)
+            break;
+
+         const int length = static_cast<quint8>(buffer.at(1)) + 2;
+         if(buffer.size() < length)
+            break;
+
+         if(Checksum(buffer.constData(), length - 1)
+               == static_cast<quint8>(buffer.at(length - 1))) {
+            process(reinterpret_cast<const quint8*>(buffer.constData()), length);
+            buffer.remove(0, length);
+         }
+
+         else
+            buffer.remove(0, 1);
+      }
+   }
+}
+
+/**
+ * @brief FakeReader::process
+ *
+ * Answers the given command @a frame the way a SM-6210 reader with a tag in
+ * front of it does
+ */
+void FakeReader::process(const quint8* frame, const int length)
+{
+   ++m_frames;
+
+   const quint8 command = frame[2];
+   switch(command) {
+      case DEV_STOP_SEARCH:
+         reply(Packet(HEADER_RESPONSE_CODE, command, QByteArray(1, 0)));
+         break;
+      case DEV_GET_SINGLE_PARAM: {
+         const char payload[] = {0x00, 0x00, CRP_ADD_USERCODE, 0x00};
+         reply(Packet(HEADER_RESPONSE_CODE, command,
+                      QByteArray(payload, sizeof(payload))));
+         break;
+      }
+      case DEV_READ_SINGLE_TAG: {
+         const int tag = m_tag;
+         m_current = tag;
+         if(++m_answers >= m_tagPeriod) {
+            m_answers = 0;
+            m_tag = (tag + 1) % m_tagCount;
+         }
+
+         QByteArray payload;
+         payload.append(static_cast<char>(0x00));
+         payload.append(static_cast<char>(EPC_LABEL));
+         payload.append(static_cast<char>(2));
+         payload.append(static_cast<char>(6));
+         payload.append(epc(tag));
+         reply(Packet(HEADER_RESPONSE_CODE, command, payload));
+         break;
+      }
+      case DEV_READ_TAG_DATA: {
+         if(length < 8)
+            break;
+
+         QByteArray payload;
+         payload.append(static_cast<char>(frame[3]));
+         payload.append(static_cast<char>(frame[4]));
+         payload.append(static_cast<char>(frame[5]));
+         payload.append(static_cast<char>(frame[6]));
+         payload.append(tagData(m_current, frame[4], frame[5], frame[6]));
+         reply(Packet(HEADER_RESPONSE_CODE, command, payload));
+         break;
+      }
+      case DEV_WRITE_TAG_MW:
+         ++m_writes;
+         reply(Packet(HEADER_RESULT_CODE, command, QByteArray(1, 0)));
+         break;
+      default:
+         reply(Packet(HEADER_RESULT_CODE, command, QByteArray(1, 1)));
+         break;
+   }
+}
+
+/**
+ * @brief FakeReader::reply
+ * Writes the given @a packet to the pseudo-terminal
+ */
+void FakeReader::reply(const QByteArray& packet)
+{
+   if(m_silent)
+      return;
+
+   const char* data = packet.constData();
+   int remaining = packet.size();
+   while(remaining > 0 && m_running) {
+      const ssize_t bytes = write(m_master, data, static_cast<size_t>(remaining));
+      if(bytes <= 0)
+         break;
+
+      data += bytes;
+      remaining -= static_cast<int>(bytes);
+   }
+}
+
+/**
+ * @brief FakeReader::tagData
+ *
+ * Returns @a words words of the memory bank identified by @a label of the
+ * given @a tag, beginning at word @a address. Words outside of the bank are
+ * read as zeroes.
+ */
+QByteArray FakeReader::tagData(const int tag,
+                               const quint8 label,
+                               const int address,
+                               const int words) const
+{
+   QByteArray bank;
+   switch(label) {
+      case RFU_LABEL:
+         bank = rfu(tag);
+         break;
+      case EPC_LABEL:
+         bank = QByteArray(4, 0) + epc(tag);
+         break;
+      case TID_LABEL:
+         bank = tid(tag);
+         break;
+      case USR_LABEL:
+         bank = usr(tag);
+         break;
+      default:
+         break;
+   }
+
+   QByteArray data = bank.mid(address * 2, words * 2);
+   data.append(QByteArray(words * 2 - data.size(), 0));
+   return data;
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef FAKE_READER_H
+#define FAKE_READER_H
+
+#include <QString>
+#include <QByteArray>
+
+#include <atomic>
+#include <thread>
+
+/**
+ * @brief The FakeReader class
+ *
+ * Emulates a SM-6210 reader on a pseudo-terminal, so that the complete RFID
+ * stack (serial manager, scheduler, driver and tag list) can be driven
+ * without hardware. The @c open() function connects the serial manager to the
+ * slave side of the terminal, and @c attach() also loads the SM-6210 driver.
+ *
+ * The endpoint answers every command frame from its own thread, the tag
+ * that is in front of the reader changes after @c tagPeriod() inventory
+ * answers, cycling through @c tagCount() tags with deterministic data.
+ * A silent endpoint reads the command frames but does not answer them, so
+ * that tests can feed their own data to the driver.
+ *
+ * @note Only available on POSIX systems.
+ */
+class FakeReader
+{
+   public:
+      FakeReader();
+      ~FakeReader();
+
+      bool start();
+      void stop();
+      bool open();
+      bool attach();
+
+      QString portName() const;
+
+      bool silent() const;
+      int tagCount() const;
+      int currentTag() const;
+      int tagPeriod() const;
+      quint64 frames() const;
+      quint64 writes() const;
+
+      void setSilent(const bool silent);
+      void setTagCount(const int count);
+      void setTagPeriod(const int answers);
+
+      static QByteArray epc(const int tag);
+      static QByteArray tid(const int tag);
+      static QByteArray rfu(const int tag);
+      static QByteArray usr(const int tag);
+
+   private:
+      void run();
+      void process(const quint8* frame, const int length);
+      void reply(const QByteArray& packet);
+      QByteArray tagData(const int tag, const quint8 label, const int address,
+                         const int words) const;
+
+   private:
+      int m_master;
+      QString m_portName;
+      std::thread m_thread;
+      std::atomic<bool> m_silent;
+      std::atomic<bool> m_running;
+
+      std::atomic<int> m_tag;
+      std::atomic<int> m_current;
+      std::atomic<int> m_answers;
+      std::atomic<int> m_tagCount;
+      std::atomic<int> m_tagPeriod;
+      std::atomic<quint64> m_frames;
+      std::atomic<quint64> m_writes;
+};
+
+#endif
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "SM_6210.h"
+#include "FakeReader.h"
+#include "RFID_SerialManager.h"
+
+#include <QCoreApplication>
+
+#include <cstdint>
+#include <cstdlib>
+
+/*
+ * The fuzz target feeds each input to the SM-6210 driver as data received by
+ * the serial manager. The driver only interprets data while a serial device is
+ * connected, so the serial manager is connected to a silent fake reader (the
+ * commands sent by the driver are read but never answered).
+ *
+ * The driver is reset before each input, so that inputs are independent.
+ */
+
+static SM_6210* DRIVER = Q_NULLPTR;
+static FakeReader* ENDPOINT = Q_NULLPTR;
+
+extern "C" int LLVMFuzzerInitialize(int* argc, char*** argv)
+{
+   static QCoreApplication app(*argc, *argv);
+
+   DRIVER = new SM_6210();
+   ENDPOINT = new FakeReader();
+   ENDPOINT->setSilent(true);
+   if(!ENDPOINT->open() || !DRIVER->loaded())
+      abort();
+
+   return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+   const QByteArray input = QByteArray::fromRawData(
+                               reinterpret_cast<const char*>(data),
+                               static_cast<int>(size));
+
+   RFID_SerialManager* sm = RFID_SerialManager::getInstance();
+   emit sm->connectionStatusChanged();
+   emit sm->dataReceived(input, 0);
+   return 0;
+}
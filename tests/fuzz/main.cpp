@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStringList>
+
+#include <cstdint>
+#include <cstdlib>
+
+extern "C" int LLVMFuzzerInitialize(int* argc, char*** argv);
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+/**
+ * Runs the fuzz target with the given @a file, returns @c false if the file
+ * cannot be read
+ */
+static bool Replay(const QString& file)
+{
+   QFile input(file);
+   if(!input.open(QFile::ReadOnly)) {
+      qWarning("Cannot open %s", qPrintable(file));
+      return false;
+   }
+
+   const QByteArray data = input.readAll();
+   LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(data.constData()),
+                          static_cast<size_t>(data.size()));
+   return true;
+}
+
+/**
+ * Standalone driver for the fuzz target (used when libFuzzer is not
+ * available), runs the target with every file given in the command line (or
+ * contained in the given directories). The seed corpus is used if no files are
+ * given, so that the corpus is replayed under the sanitizers by "make check".
+ */
+int main(int argc, char** argv)
+{
+   LLVMFuzzerInitialize(&argc, &argv);
+
+   QStringList paths;
+   for(int i = 1; i < argc; ++i)
+      paths.append(QString::fromLocal8Bit(argv[i]));
+
+   if(paths.isEmpty())
+      paths.append(RFID_CORPUS_DIR);
+
+   int inputs = 0;
+   foreach(QString path, paths) {
+      if(QFileInfo(path).isDir()) {
+         QDir dir(path);
+         foreach(QString file, dir.entryList(QDir::Files, QDir::Name)) {
+            if(!Replay(dir.filePath(file)))
+               return EXIT_FAILURE;
+
+            ++inputs;
+         }
+      }
+
+      else if(Replay(path))
+         ++inputs;
+
+      else
+         return EXIT_FAILURE;
+   }
+
+   qInfo("%d inputs replayed", inputs);
+   return EXIT_SUCCESS;
+}
@@ -0,0 +1,350 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "RFID.h"
+#include "RFID_Clock.h"
+#include "RFID_Reader.h"
+#include "FakeReader.h"
+#include "MainWindow.h"
+
+#include <QtTest>
+#include <QDir>
+#include <QFile>
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QStandardPaths>
+
+#include <unistd.h>
+
+//------------------------------------------------------------------------------
+// Benchmark parameters
+//------------------------------------------------------------------------------
+
+// Tags injected before the window is refreshed (each tag is three events, so
+// that a batch fits in the event queue of RFID without shedding events)
+static const int BATCH_SIZE                 = 64;
+
+// Number of current tag changes measured for each table size
+static const int HIGHLIGHT_CHANGES          = 500;
+
+// Max. time to wait for the window to process a batch (in milliseconds)
+static const int FRAME_TIMEOUT              = 60000;
+
+//------------------------------------------------------------------------------
+// Utility functions
+//------------------------------------------------------------------------------
+
+/**
+ * Returns the resident set size of the process (in bytes)
+ */
+static qint64 ResidentSetSize()
+{
+   QFile file("/proc/self/statm");
+   if(!file.open(QFile::ReadOnly))
+      return 0;
+
+   const QList<QByteArray> fields = file.readAll().split(' ');
+   if(fields.count() < 2)
+      return 0;
+
+   return fields.at(1).toLongLong() * sysconf(_SC_PAGESIZE);
+}
+
+//------------------------------------------------------------------------------
+// Benchmark reader driver
+//------------------------------------------------------------------------------
+
+/**
+ * @brief The BenchReader class
+ *
+ * Reader driver that never talks to a device, the benchmark emits the tag
+ * data signals of the driver directly, so that the tags reach the window
+ * through the same path as the tags read from a real reader.
+ */
+class BenchReader : public RFID_Reader
+{
+      Q_OBJECT
+
+   public:
+      void scan() {}
+      bool loaded()
+      {
+         return false;
+      }
+      void readEpc() {}
+      void readTid() {}
+      void readRfu() {}
+      void readUsr() {}
+      bool killTag()
+      {
+         return false;
+      }
+      bool lockTag()
+      {
+         return false;
+      }
+      bool eraseTag()
+      {
+         return false;
+      }
+      bool writeRfu(const QByteArray& rfu)
+      {
+         Q_UNUSED(rfu);
+         return false;
+      }
+      bool writeEpc(const QByteArray& epc)
+      {
+         Q_UNUSED(epc);
+         return false;
+      }
+      bool writeUserData(const QByteArray& userData)
+      {
+         Q_UNUSED(userData);
+         return false;
+      }
+};
+
+//------------------------------------------------------------------------------
+// Test case
+//------------------------------------------------------------------------------
+
+/**
+ * @brief The tst_MainWindow class
+ *
+ * Runs the main window on the offscreen platform and measures how the tag
+ * history table behaves when thousands of tags are inserted, updated and
+ * highlighted as the current tag.
+ */
+class tst_MainWindow : public QObject
+{
+      Q_OBJECT
+
+   private slots:
+      void initTestCase();
+      void cleanupTestCase();
+      void tagTable_data();
+      void tagTable();
+
+   private:
+      typedef struct {
+         int frames;
+         qint64 refresh;
+         qint64 maxFrame;
+      } Phase;
+
+      void registerTag();
+      bool frame(Phase* phase);
+      void report(const char* name, const Phase& phase, const qint64 rss);
+
+   private:
+      quint64 m_generation;
+      MainWindow* m_window;
+      BenchReader* m_reader;
+};
+
+/**
+ * @brief tst_MainWindow::initTestCase
+ *
+ * Loads the benchmark driver and shows the main window, the settings and the
+ * session checkpoint are stored in the test locations of the platform, and
+ * the checkpoint of previous runs is removed.
+ */
+void tst_MainWindow::initTestCase()
+{
+   QStandardPaths::setTestModeEnabled(true);
+   const QDir dir(QStandardPaths::writableLocation(
+                     QStandardPaths::AppDataLocation));
+   foreach(QString file, dir.entryList(QStringList("session.checkpoint*")))
+      QFile::remove(dir.filePath(file));
+
+   m_reader = new BenchReader();
+   RFID::getInstance()->setReader(m_reader);
+   m_generation = RFID::getInstance()->generation();
+
+   m_window = new MainWindow();
+   m_window->resize(1280, 800);
+   m_window->show();
+   QVERIFY(QTest::qWaitForWindowExposed(m_window));
+
+   connect(RFID::getInstance(), &RFID::tagsChanged,
+   [this](const RFID_ChangeSet & changes) {
+      m_generation = changes.generation;
+   });
+}
+
+/**
+ * @brief tst_MainWindow::cleanupTestCase
+ * Closes the main window & unloads the benchmark driver
+ */
+void tst_MainWindow::cleanupTestCase()
+{
+   delete m_window;
+   RFID::getInstance()->unloadReader();
+}
+
+/**
+ * @brief tst_MainWindow::tagTable_data
+ * Registers the table sizes to measure
+ */
+void tst_MainWindow::tagTable_data()
+{
+   QTest::addColumn<int>("tags");
+
+   QTest::newRow("1k tags") << 1000;
+   QTest::newRow("10k tags") << 10000;
+   QTest::newRow("100k tags") << 100000;
+}
+
+/**
+ * @brief tst_MainWindow::tagTable
+ *
+ * Injects the given number of tags, then updates the user data of every tag
+ * (which also makes each tag the current tag) and finally changes the current
+ * tag @c HIGHLIGHT_CHANGES times. The refresh time, the frame times and the
+ * memory used by each phase are reported.
+ */
+void tst_MainWindow::tagTable()
+{
+   QFETCH(int, tags);
+
+   RFID* rfid = RFID::getInstance();
+   RFID_Clock* clock = RFID_Clock::getInstance();
+
+   // Start with an empty table
+   rfid->clearHistory();
+   Phase phase = {0, 0, 0};
+   QVERIFY(frame(&phase));
+
+   // Insert the tags
+   phase = {0, 0, 0};
+   qint64 rss = ResidentSetSize();
+   for(int i = 0; i < tags; ++i) {
+      emit m_reader->epcFound(FakeReader::epc(i), clock->now());
+      registerTag();
+      emit m_reader->tidFound(FakeReader::tid(i), clock->now());
+      emit m_reader->rfuFound(FakeReader::rfu(i), clock->now());
+      if((i + 1) % BATCH_SIZE == 0 || i == tags - 1)
+         QVERIFY(frame(&phase));
+   }
+
+   report("Insert", phase, ResidentSetSize() - rss);
+   QCOMPARE(rfid->tagCount(), tags);
+
+   // Update the user data of the tags
+   phase = {0, 0, 0};
+   rss = ResidentSetSize();
+   const QByteArray usr = FakeReader::usr(tags).left(16);
+   for(int i = 0; i < tags; ++i) {
+      emit m_reader->epcFound(FakeReader::epc(i), clock->now());
+      registerTag();
+      emit m_reader->usrFound(usr, 0, clock->now());
+      if((i + 1) % BATCH_SIZE == 0 || i == tags - 1)
+         QVERIFY(frame(&phase));
+   }
+
+   report("Update", phase, ResidentSetSize() - rss);
+
+   // Change the current tag (one change per frame)
+   phase = {0, 0, 0};
+   rss = ResidentSetSize();
+   for(int i = 0; i < HIGHLIGHT_CHANGES; ++i) {
+      const int tag = static_cast<int>((i * 7919LL) % tags);
+      emit m_reader->epcFound(FakeReader::epc(tag), clock->now());
+      QVERIFY(frame(&phase));
+   }
+
+   report("Highlight", phase, ResidentSetSize() - rss);
+}
+
+/**
+ * @brief tst_MainWindow::registerTag
+ *
+ * Processes the queued tag data, so that the sighted tag becomes the current
+ * tag (a reader only reads the memory banks of the current tag, and RFID
+ * drops bank reads that belong to another tag). The window is not refreshed.
+ */
+void tst_MainWindow::registerTag()
+{
+   RFID* rfid = RFID::getInstance();
+   while(rfid->pendingEvents() > 0)
+      QMetaObject::invokeMethod(rfid, "processEvents", Qt::DirectConnection);
+}
+
+/**
+ * @brief tst_MainWindow::frame
+ *
+ * Processes events until the window has been refreshed with every change of
+ * the tag list, then repaints the window. The time spent is registered as a
+ * frame of the given @a phase. Returns @c false if the window is not
+ * refreshed in time.
+ */
+bool tst_MainWindow::frame(Phase* phase)
+{
+   RFID* rfid = RFID::getInstance();
+
+   QElapsedTimer timer;
+   timer.start();
+   while(rfid->pendingEvents() > 0 || m_generation != rfid->generation()) {
+      if(timer.elapsed() > FRAME_TIMEOUT)
+         return false;
+
+      QCoreApplication::processEvents();
+   }
+
+   m_window->repaint();
+
+   const qint64 time = timer.nsecsElapsed();
+   phase->frames += 1;
+   phase->refresh += time;
+   phase->maxFrame = qMax(phase->maxFrame, time);
+   return true;
+}
+
+/**
+ * @brief tst_MainWindow::report
+ * Reports the results of the given @a phase
+ */
+void tst_MainWindow::report(const char* name,
+                            const Phase& phase,
+                            const qint64 rss)
+{
+   qInfo("%s: %d frames, %.1f ms refresh, %.2f ms mean frame, "
+         "%.2f ms max frame, %lld KB RSS", name, phase.frames,
+         phase.refresh / 1e6, phase.refresh / 1e6 / qMax(1, phase.frames),
+         phase.maxFrame / 1e6, rss / 1024);
+}
+
+/**
+ * Runs the benchmark on the offscreen platform (unless another platform is
+ * selected), so that it can run on machines without a display
+ */
+int main(int argc, char** argv)
+{
+   if(qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+      qputenv("QT_QPA_PLATFORM", "offscreen");
+
+   QApplication app(argc, argv);
+   tst_MainWindow test;
+   return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_mainwindow.moc"
@@ -0,0 +1,328 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "RFID.h"
+#include "RFID_Reader.h"
+#include "FakeReader.h"
+
+#include <QtTest>
+#include <QSet>
+#include <QFile>
+#include <QMutex>
+#include <QElapsedTimer>
+#include <QAbstractEventDispatcher>
+#include <private/qhooks_p.h>
+
+#include <malloc.h>
+#include <unistd.h>
+
+//------------------------------------------------------------------------------
+// Test parameters
+//------------------------------------------------------------------------------
+
+/*
+ * The soak test simulates a busy reader at accelerated speed: the current tag
+ * is replaced every TAG_DWELL milliseconds (a real tag stays in front of the
+ * reader for about one second), cycling through TAG_COUNT tags, and the user
+ * data of the current tag is written once per second.
+ *
+ * The tag history is cleared every SAMPLE_INTERVAL milliseconds, right after
+ * the resources of the process are sampled, so that every sample is taken with
+ * the same amount of tags in the history.
+ */
+static const int TAG_COUNT                  = 256;
+static const int TAG_DWELL                  = 20;
+static const int WRITE_INTERVAL             = 1000;
+static const int SAMPLE_INTERVAL            = 10000;
+
+// Default test duration in seconds (can be changed with RFID_SOAK_DURATION)
+static const int DEFAULT_DURATION           = 120;
+
+// Samples taken before the baseline sample, so that caches are warmed up
+static const int WARMUP_SAMPLES             = 2;
+
+// Max. growth of each sampled resource over the baseline sample
+static const qint64 RSS_GROWTH_LIMIT        = 8 * 1024 * 1024;
+static const qint64 HEAP_GROWTH_LIMIT       = 2 * 1024 * 1024;
+static const int OBJECT_GROWTH_LIMIT        = 16;
+static const int TIMER_GROWTH_LIMIT         = 16;
+
+//------------------------------------------------------------------------------
+// QObject tracking
+//------------------------------------------------------------------------------
+
+/*
+ * The QObject hooks (also used by debugging tools) report every object that is
+ * created or destroyed, the live objects are used to count the objects and
+ * the registered timers of the process
+ */
+
+static QMutex OBJECTS_MUTEX;
+static QSet<QObject*> OBJECTS;
+static QHooks::AddQObjectCallback PREVIOUS_ADD = Q_NULLPTR;
+static QHooks::RemoveQObjectCallback PREVIOUS_REMOVE = Q_NULLPTR;
+
+static void AddObject(QObject* object)
+{
+   OBJECTS_MUTEX.lock();
+   OBJECTS.insert(object);
+   OBJECTS_MUTEX.unlock();
+
+   if(PREVIOUS_ADD)
+      PREVIOUS_ADD(object);
+}
+
+static void RemoveObject(QObject* object)
+{
+   OBJECTS_MUTEX.lock();
+   OBJECTS.remove(object);
+   OBJECTS_MUTEX.unlock();
+
+   if(PREVIOUS_REMOVE)
+      PREVIOUS_REMOVE(object);
+}
+
+//------------------------------------------------------------------------------
+// Resource sampling
+//------------------------------------------------------------------------------
+
+/**
+ * Returns the resident set size of the process (in bytes)
+ */
+static qint64 ResidentSetSize()
+{
+   QFile file("/proc/self/statm");
+   if(!file.open(QFile::ReadOnly))
+      return 0;
+
+   const QList<QByteArray> fields = file.readAll().split(' ');
+   if(fields.count() < 2)
+      return 0;
+
+   return fields.at(1).toLongLong() * sysconf(_SC_PAGESIZE);
+}
+
+/**
+ * Returns the number of bytes allocated in the heap
+ */
+static qint64 HeapSize()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+   return static_cast<qint64>(mallinfo2().uordblks);
+#elif defined(__GLIBC__)
+   return static_cast<qint64>(static_cast<unsigned int>(mallinfo().uordblks));
+#else
+   return 0;
+#endif
+}
+
+//------------------------------------------------------------------------------
+// Test case
+//------------------------------------------------------------------------------
+
+/**
+ * @brief The tst_Soak class
+ *
+ * Drives the RFID stack with a fake SM-6210 reader for a long time and
+ * verifies that the memory, the QObjects and the timers of the process do not
+ * grow beyond a bound.
+ */
+class tst_Soak : public QObject
+{
+      Q_OBJECT
+
+   private slots:
+      void initTestCase();
+      void cleanupTestCase();
+      void continuousTraffic();
+
+   private:
+      typedef struct {
+         qint64 rss;
+         qint64 heap;
+         int objects;
+         int timers;
+      } Sample;
+
+      Sample sample() const;
+      void runFor(const int msecs);
+
+   private:
+      quint64 m_reads;
+      quint64 m_tags;
+      FakeReader m_endpoint;
+};
+
+/**
+ * @brief tst_Soak::initTestCase
+ * Installs the QObject hooks and connects the stack to the fake reader
+ */
+void tst_Soak::initTestCase()
+{
+   PREVIOUS_ADD = reinterpret_cast<QHooks::AddQObjectCallback>
+                  (qtHookData[QHooks::AddQObject]);
+   PREVIOUS_REMOVE = reinterpret_cast<QHooks::RemoveQObjectCallback>
+                     (qtHookData[QHooks::RemoveQObject]);
+   qtHookData[QHooks::AddQObject] = reinterpret_cast<quintptr>(&AddObject);
+   qtHookData[QHooks::RemoveQObject] = reinterpret_cast<quintptr>(&RemoveObject);
+
+   m_tags = 0;
+   m_reads = 0;
+   m_endpoint.setTagCount(TAG_COUNT);
+   QVERIFY(m_endpoint.attach());
+
+   RFID* rfid = RFID::getInstance();
+   QVERIFY(rfid->reader() != Q_NULLPTR);
+   connect(rfid->reader(), &RFID_Reader::epcFound, [this] { ++m_reads; });
+   connect(rfid->reader(), &RFID_Reader::tidFound, [this] { ++m_reads; });
+   connect(rfid->reader(), &RFID_Reader::rfuFound, [this] { ++m_reads; });
+   connect(rfid->reader(), &RFID_Reader::usrFound, [this] { ++m_reads; });
+   connect(rfid, &RFID::currentTagChanged, [this] { ++m_tags; });
+}
+
+/**
+ * @brief tst_Soak::cleanupTestCase
+ * Disconnects the stack from the fake reader and removes the QObject hooks
+ */
+void tst_Soak::cleanupTestCase()
+{
+   RFID::getInstance()->unloadReader();
+   m_endpoint.stop();
+
+   qtHookData[QHooks::AddQObject] = reinterpret_cast<quintptr>(PREVIOUS_ADD);
+   qtHookData[QHooks::RemoveQObject] = reinterpret_cast<quintptr>
+                                       (PREVIOUS_REMOVE);
+}
+
+/**
+ * @brief tst_Soak::continuousTraffic
+ *
+ * Runs the tag traffic simulation and samples the resources of the process
+ * every @c SAMPLE_INTERVAL milliseconds. The test fails if a resource grows
+ * beyond its limit over the baseline sample (taken after a warm-up period).
+ */
+void tst_Soak::continuousTraffic()
+{
+   int duration = qgetenv("RFID_SOAK_DURATION").toInt();
+   if(duration <= 0)
+      duration = DEFAULT_DURATION;
+
+   const int samples = qMax(WARMUP_SAMPLES + 1,
+                            duration * 1000 / SAMPLE_INTERVAL);
+
+   Sample baseline = {0, 0, 0, 0};
+   for(int i = 0; i < samples; ++i) {
+      runFor(SAMPLE_INTERVAL);
+
+      const Sample current = sample();
+      RFID::getInstance()->clearHistory();
+
+      qInfo("Sample %d: %lld KB RSS, %lld KB heap, %d objects, %d timers, "
+            "%llu tag changes, %llu reads", i, current.rss / 1024,
+            current.heap / 1024, current.objects, current.timers, m_tags,
+            m_reads);
+
+      if(i < WARMUP_SAMPLES)
+         continue;
+
+      if(i == WARMUP_SAMPLES) {
+         baseline = current;
+         continue;
+      }
+
+      QVERIFY2(current.rss - baseline.rss <= RSS_GROWTH_LIMIT,
+               qPrintable(QString("RSS grew by %1 KB")
+                          .arg((current.rss - baseline.rss) / 1024)));
+      QVERIFY2(current.heap - baseline.heap <= HEAP_GROWTH_LIMIT,
+               qPrintable(QString("Heap grew by %1 KB")
+                          .arg((current.heap - baseline.heap) / 1024)));
+      QVERIFY2(current.objects - baseline.objects <= OBJECT_GROWTH_LIMIT,
+               qPrintable(QString("QObject count grew by %1")
+                          .arg(current.objects - baseline.objects)));
+      QVERIFY2(current.timers - baseline.timers <= TIMER_GROWTH_LIMIT,
+               qPrintable(QString("Timer count grew by %1")
+                          .arg(current.timers - baseline.timers)));
+   }
+
+   QVERIFY(m_reads > 0);
+   QVERIFY(m_endpoint.writes() > 0);
+}
+
+/**
+ * @brief tst_Soak::sample
+ * @returns the current resource usage of the process
+ */
+tst_Soak::Sample tst_Soak::sample() const
+{
+   Sample current;
+   current.rss = ResidentSetSize();
+   current.heap = HeapSize();
+   current.timers = 0;
+
+   OBJECTS_MUTEX.lock();
+   current.objects = OBJECTS.count();
+   foreach(QObject* object, OBJECTS) {
+      QAbstractEventDispatcher* dispatcher =
+         QAbstractEventDispatcher::instance(object->thread());
+      if(dispatcher)
+         current.timers += dispatcher->registeredTimers(object).count();
+   }
+   OBJECTS_MUTEX.unlock();
+
+   return current;
+}
+
+/**
+ * @brief tst_Soak::runFor
+ *
+ * Processes events for @a msecs milliseconds, replacing the current tag every
+ * @c TAG_DWELL milliseconds and writing the user data of the current tag
+ * every @c WRITE_INTERVAL milliseconds
+ */
+void tst_Soak::runFor(const int msecs)
+{
+   RFID* rfid = RFID::getInstance();
+
+   QElapsedTimer timer;
+   QElapsedTimer dwell;
+   QElapsedTimer write;
+   timer.start();
+   dwell.start();
+   write.start();
+
+   while(timer.elapsed() < msecs) {
+      QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents, TAG_DWELL);
+
+      if(dwell.elapsed() >= TAG_DWELL) {
+         QMetaObject::invokeMethod(rfid, "resetCurrentTag");
+         dwell.restart();
+      }
+
+      if(write.elapsed() >= WRITE_INTERVAL && rfid->currentTag()) {
+         rfid->writeUserData(FakeReader::usr(m_endpoint.currentTag()));
+         write.restart();
+      }
+   }
+}
+
+QTEST_GUILESS_MAIN(tst_Soak)
+#include "tst_soak.moc"